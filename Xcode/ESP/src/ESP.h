@@ -44,6 +44,9 @@
 #include "GRT/GRT.h"
 #include "calibrator.h"
 #include "iostream.h"
+#include "latency-tracer.h"
+#include "pipeline-profiler.h"
+#include "sample-queue.h"
 #include "tuneable.h"
 #include "training.h"
 
@@ -178,6 +181,52 @@ void useLeaveOneOutScoring(bool enable = true);
  */
 void setGUIBufferSize(uint32_t buffer_size);
 
+/**
+ @brief Set how many samples may be queued between the input stream and the
+ pipeline (4096 by default). Samples arriving while the queue is full are
+ dropped according to setInputQueueOverflowPolicy(). Call from your setup()
+ function.
+ */
+void setInputQueueSize(uint32_t capacity);
+
+/**
+ @brief Choose which samples to drop when the input queue is full:
+ SampleQueue::kDropOldest (the default) keeps the pipeline close to real time
+ after a stall; SampleQueue::kDropNewest keeps the samples already queued.
+ SampleQueue::kBlock drops nothing and holds up the input stream instead,
+ which only suits a ReplayStream. Call from your setup() function.
+ */
+void setInputQueueOverflowPolicy(SampleQueue::OverflowPolicy policy);
+
+/**
+ @brief Time every stage of the pipeline (each pre-processing, feature
+ extraction and post-processing module, and the classifier) on live data.
+ Off by default, as it adds a little overhead per stage; pressing `i` in the
+ GUI also turns it on while showing the results. Can be called at any time.
+ */
+void useStageProfiling(bool enable = true);
+
+/**
+ @brief Latency of each pipeline stage, followed by the total, over all data
+ processed with stage profiling on since the pipeline last changed.
+ */
+vector<PipelineProfiler::StageStats> getStageLatencies();
+
+/**
+ @brief Trace how long live samples take from their arrival on the input
+ stream to the output streams, hop by hop: waiting in the input queue,
+ calibration, the pipeline, until each output stream has been sent the
+ prediction, and overall. Off by default; pressing `i` in the GUI also turns
+ it on while showing the results. If dump_file is given, the latencies are
+ written to it as CSV when ESP exits. Can be called at any time.
+ */
+void useLatencyTracing(bool enable = true, const string& dump_file = "");
+
+/**
+ @brief Latency of each hop, over all data processed with latency tracing on.
+ */
+vector<LatencyTracer::HopStats> getHopLatencies();
+
 /**
  @brief Only warn (highlight the confusion score) if the true positive rate is
  smaller than the threshold. True positive rate is the probability that this
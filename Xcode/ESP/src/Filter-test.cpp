@@ -0,0 +1,41 @@
+#include "Filter.h"
+#include "gtest/gtest.h"
+
+#include <cmath>
+
+using namespace GRT;
+
+TEST(FilterTest, SumOfSquaresStaysNonNegativeAfterBurst) {
+    const UINT kFilterSize = 100;
+    Filter filter("SumOfSquares", kFilterSize, 1, Filter::SUM_OF_SQUARES);
+
+    // The squares of the small values are lost to rounding next to the loud
+    // one, so once it leaves the window the running sum would be short of
+    // them: 0 in the first window after the burst, then below zero.
+    for (UINT i = 0; i < 3 * kFilterSize; i++) {
+        const double x = i == 0 ? 1e8 : i <= 10 ? 1 : 0;
+        const double energy = filter.filter(x);
+        ASSERT_GE(energy, 0) << "after " << i << " values";
+        if (i >= kFilterSize && i <= kFilterSize + 10) {
+            ASSERT_EQ(kFilterSize + 10 - i, energy);  // the ones left
+        }
+        ASSERT_FALSE(std::isnan(std::log(energy)));
+    }
+    EXPECT_EQ(0, filter.filter(0));
+}
+
+TEST(FilterTest, SumAndMeanRecoverFromBurst) {
+    const UINT kFilterSize = 100;
+    Filter sum("Sum", kFilterSize, 1, Filter::SUM);
+    Filter mean("Mean", kFilterSize, 1, Filter::MEAN);
+
+    for (UINT i = 0; i < 2 * kFilterSize; i++) {
+        const double x = i == 0 ? 1e17 : i <= 10 ? 1 : 0;
+        const double total = sum.filter(x);
+        const double average = mean.filter(x);
+        if (i >= kFilterSize && i <= kFilterSize + 10) {
+            ASSERT_EQ(kFilterSize + 10 - i, total) << "after " << i << " values";
+            ASSERT_DOUBLE_EQ(total / kFilterSize, average);
+        }
+    }
+}
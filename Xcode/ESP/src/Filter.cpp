@@ -20,14 +20,23 @@
 
 #include "Filter.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 namespace GRT{
     
+//The running sum is recomputed when the value leaving the window is this much larger than what remains, which keeps
+//its relative error within about 1e-10
+static const double kCancellationRatio = 1e-6;
+    
 //Register the Filter module with the PreProcessing base class
 //RegisterPreProcessingModule< Filter > Filter::registerModule("Filter");
 
-Filter::Filter(const char *classType, UINT filterSize,UINT numDimensions){
+Filter::Filter(const char *classType, UINT filterSize,UINT numDimensions,Aggregate aggregate){
     
     this->classType = classType;
+    this->aggregate = aggregate;
     preProcessingType = classType;
     debugLog.setProceedingText("[DEBUG Filter]");
     errorLog.setProceedingText("[ERROR Filter]");
@@ -46,6 +55,7 @@ Filter::Filter(const Filter &rhs){
     //Zero this instance
     this->filterSize = 0;
     this->inputSampleCounter = 0;
+    this->aggregate = rhs.aggregate;
     
 	//Copy the settings from the rhs instance
 	*this = rhs;
@@ -60,12 +70,22 @@ Filter& Filter::operator=(const Filter &rhs){
         //Clear this instance
         this->filterSize = 0;
         this->inputSampleCounter = 0;
-        this->dataBuffer.clear();
+        this->aggregate = rhs.aggregate;
+        this->window.clear();
         
         //Copy from the rhs instance
         if( rhs.initialized ){
             this->init( rhs.filterSize, rhs.numInputDimensions );
-            this->dataBuffer = rhs.dataBuffer;
+            this->inputSampleCounter = rhs.inputSampleCounter;
+            this->window = rhs.window;
+            this->windowPosition = rhs.windowPosition;
+            this->sampleCount = rhs.sampleCount;
+            this->runningSum = rhs.runningSum;
+            this->valuesSinceResum = rhs.valuesSinceResum;
+            this->deque = rhs.deque;
+            this->dequeHead = rhs.dequeHead;
+            this->dequeSize = rhs.dequeSize;
+            this->sorted = rhs.sorted;
         }
         
         //Copy the preprocessing base variables
@@ -235,11 +255,24 @@ bool Filter::init(UINT filterSize,UINT numDimensions){
     this->numOutputDimensions = numDimensions;
     processedData.clear();
     processedData.resize(numDimensions,0);
-    initialized = dataBuffer.resize( filterSize, VectorDouble(numInputDimensions,0) );
     
-    if( !initialized ){
-        errorLog << "init(UINT filterSize,UINT numDimensions) - Failed to resize dataBuffer!" << endl;
-    }
+    //The window starts out full of zeros
+    window.assign( filterSize * numDimensions, 0 );
+    windowPosition = 0;
+    sampleCount = 0;
+    scratch.reserve( filterSize );
+    
+    //Only allocate the state of the aggregate in use
+    const bool usesSum = aggregate == MEAN || aggregate == SUM || aggregate == SUM_OF_SQUARES;
+    const bool usesDeque = aggregate == MIN || aggregate == MAX;
+    runningSum.assign( usesSum ? numDimensions : 0, 0 );
+    valuesSinceResum = 0;
+    deque.assign( usesDeque ? filterSize * numDimensions : 0, 0 );
+    dequeHead.assign( usesDeque ? numDimensions : 0, 0 );
+    dequeSize.assign( usesDeque ? numDimensions : 0, 0 );
+    sorted.assign( aggregate == MEDIAN ? filterSize * numDimensions : 0, 0 );
+    
+    initialized = true;
     
     return initialized;
 }
@@ -265,32 +298,169 @@ VectorDouble Filter::filter(const VectorDouble &x){
         return VectorDouble();
     }
     
+    const bool evict = inputSampleCounter == filterSize;
     if( ++inputSampleCounter > filterSize ) inputSampleCounter = filterSize;
     
-    //Add the new value to the buffer
-    dataBuffer.push_back( x );
-    
-    vector< double > tmp( inputSampleCounter );
-    for(unsigned int j=0; j<numInputDimensions; j++){
-        for(unsigned int i=0; i<inputSampleCounter; i++) {
-            tmp[i] = dataBuffer[i][j];
+    //Add the new value to the window, x[j] replaces the oldest value (or a zero) in the window of dimension j
+    const UINT slot = windowPosition;
+    if( aggregate == CUSTOM ){
+        //The last inputSampleCounter values, oldest first, end at slot and may wrap around the end of the window
+        const UINT first = (slot + filterSize + 1 - inputSampleCounter) % filterSize;
+        const UINT tail = std::min( inputSampleCounter, filterSize - first );
+        scratch.resize( inputSampleCounter );
+        for(unsigned int j=0; j<numInputDimensions; j++){
+            double *values = &window[ j * filterSize ];
+            values[slot] = x[j];
+            std::copy( values + first, values + first + tail, scratch.begin() );
+            std::copy( values, values + inputSampleCounter - tail, scratch.begin() + tail );
+            processedData[j] = computeFilter( scratch );
         }
-        processedData[j] = computeFilter(tmp);
+    }else{
+        for(unsigned int j=0; j<numInputDimensions; j++){
+            processedData[j] = computeFilterFromAggregate( updateAggregate( j, slot, x[j], evict ) );
+        }
+    }
+    
+    if( ++windowPosition == filterSize ) windowPosition = 0;
+    sampleCount++;
+    
+    //Recompute the running sums every filterSize values, which costs O(1) per value
+    if( !runningSum.empty() && ++valuesSinceResum == filterSize ){
+        for(unsigned int j=0; j<numInputDimensions; j++) resum( j );
+        valuesSinceResum = 0;
     }
     
     return processedData;
 }
     
+double Filter::updateAggregate(UINT j,UINT slot,double x,bool evict){
+    
+    double *values = &window[ j * filterSize ];
+    const double old = values[slot];
+    values[slot] = x;
+    const UINT n = inputSampleCounter;
+    
+    switch( aggregate ){
+        case MEAN:
+        case SUM:
+        case SUM_OF_SQUARES:{
+            const double term = aggregate == SUM_OF_SQUARES ? x * x : x;
+            const double oldTerm = evict ? (aggregate == SUM_OF_SQUARES ? old * old : old) : 0;
+            runningSum[j] += term - oldTerm;
+            //Values added next to a much larger one are lost to rounding, so once it leaves the window the sum is
+            //mostly rounding error (0, or even below zero for squares, where e.g. a log isn't defined): sum the
+            //window exactly whenever the value that left dwarfs what remains
+            if( oldTerm != 0 && std::fabs( oldTerm ) * kCancellationRatio >= std::fabs( runningSum[j] ) ) resum( j );
+            else if( aggregate == SUM_OF_SQUARES && runningSum[j] < 0 ) resum( j );
+            return aggregate == MEAN ? runningSum[j] / n : runningSum[j];
+        }
+        case MIN:
+        case MAX:{
+            unsigned long long *q = &deque[ j * filterSize ];
+            UINT &head = dequeHead[j];
+            UINT &size = dequeSize[j];
+            
+            //Drop the value that just left the window
+            if( size > 0 && q[head] + filterSize <= sampleCount ){
+                if( ++head == filterSize ) head = 0;
+                size--;
+            }
+            
+            //Drop the values that can no longer be the extreme, as x is newer and at least as extreme
+            while( size > 0 ){
+                const double back = values[ q[ (head + size - 1) % filterSize ] % filterSize ];
+                if( aggregate == MAX ? back <= x : back >= x ) size--;
+                else break;
+            }
+            
+            q[ (head + size) % filterSize ] = sampleCount;
+            size++;
+            return values[ q[head] % filterSize ];
+        }
+        case MEDIAN:{
+            double *s = &sorted[ j * filterSize ];
+            UINT count = n - 1;
+            
+            if( evict ){
+                double *end = s + filterSize;
+                double *pos = std::lower_bound( s, end, old );
+                if( pos == end || *pos != old ){
+                    //Only NaNs don't compare equal to themselves
+                    pos = std::find_if( s, end, [](double v){ return v != v; } );
+                }
+                if( pos != end ){
+                    std::memmove( pos, pos + 1, (end - pos - 1) * sizeof(double) );
+                }
+                count = filterSize - 1;
+            }
+            
+            double *pos = std::upper_bound( s, s + count, x );
+            std::memmove( pos + 1, pos, (s + count - pos) * sizeof(double) );
+            *pos = x;
+            return s[ n / 2 ];
+        }
+        case CUSTOM:
+            break;
+    }
+    return 0;
+}
+    
+void Filter::resum(UINT j){
+    
+    //Values that haven't been written yet are zero, so the whole window can be summed
+    const double *values = &window[ j * filterSize ];
+    double sum = 0;
+    for(UINT i=0; i<filterSize; i++){
+        sum += aggregate == SUM_OF_SQUARES ? values[i] * values[i] : values[i];
+    }
+    runningSum[j] = sum;
+}
+    
+double Filter::computeFilter(const VectorDouble &buf){
+    
+    if( buf.size() == 0 ) return 0;
+    
+    switch( aggregate ){
+        case MEAN:
+        case SUM:{
+            double sum = 0;
+            for(UINT i=0; i<buf.size(); i++) sum += buf[i];
+            return aggregate == MEAN ? sum / buf.size() : sum;
+        }
+        case SUM_OF_SQUARES:{
+            double sum = 0;
+            for(UINT i=0; i<buf.size(); i++) sum += buf[i] * buf[i];
+            return sum;
+        }
+        case MIN:
+            return *std::min_element( buf.begin(), buf.end() );
+        case MAX:
+            return *std::max_element( buf.begin(), buf.end() );
+        case MEDIAN:{
+            VectorDouble values = buf;
+            std::sort( values.begin(), values.end() );
+            return values[ values.size() / 2 ];
+        }
+        case CUSTOM:
+            break;
+    }
+    
+    errorLog << "computeFilter(const VectorDouble &buf) - Filters with a CUSTOM aggregate must implement computeFilter!" << endl;
+    return 0;
+}
+    
 vector< VectorDouble > Filter::getDataBuffer() const {
     
     if( !initialized ){
         return vector< VectorDouble >();
     }
     
+    //The last inputSampleCounter values end just before windowPosition
+    const UINT first = (windowPosition + filterSize - inputSampleCounter) % filterSize;
     vector< VectorDouble > data(numInputDimensions,VectorDouble(inputSampleCounter));
     for(unsigned int j=0; j<numInputDimensions; j++){
         for(unsigned int i=0; i<inputSampleCounter; i++){
-            data[j][i] = dataBuffer[i][j];
+            data[j][i] = window[ j * filterSize + (first + i) % filterSize ];
         }
     }
     return data;
@@ -37,14 +37,23 @@ namespace GRT{
 
 class Filter : public PreProcessing {
 public:
+    /**
+     The sliding window aggregates the Filter can maintain itself. A sub-class that uses one of these is updated incrementally as
+     each value enters and leaves the window: O(1) per dimension for MEAN, SUM and SUM_OF_SQUARES (running sums), amortized O(1)
+     for MIN and MAX (monotonic deques) and a binary search plus a move of at most filterSize values for MEDIAN (a sorted copy of
+     the window). CUSTOM sub-classes implement computeFilter() instead, which is called on a copy of the window.
+     */
+    enum Aggregate{ CUSTOM=0, MEAN, SUM, SUM_OF_SQUARES, MIN, MAX, MEDIAN };
+    
     /**
      Constructor, sets the size of the median filter and the dimensionality of the data it will filter.
     
      @param char *classType: the name of the sub-class being instantiated.
      @param UINT filterSize: the size of the median filter, should be a value greater than zero. Default filterSize = 5
      @param UINT numDimensions: the dimensionality of the data to filter.  Default numDimensions = 1
+     @param Aggregate aggregate: the aggregate the filter computes over its window, or CUSTOM to use computeFilter(). Default aggregate = CUSTOM
      */
-    Filter(const char *classType, UINT filterSize = 5,UINT numDimensions = 1);
+    Filter(const char *classType, UINT filterSize = 5,UINT numDimensions = 1,Aggregate aggregate = CUSTOM);
     
     /**
      Copy Constructor, copies the Filter from the rhs instance to this instance
@@ -157,12 +166,29 @@ public:
     VectorDouble filter(const VectorDouble &x);
     
     /**
-     Compute the filter. This is implemented by the derived class and called separately on each dimension of the input data.
+     Compute the filter. This is implemented by CUSTOM derived classes and called separately on each dimension of the input data.
+     For the other aggregates it is not called by filter(); the default implementation computes the aggregate from scratch.
+     
+     @param const VectorDouble buf: the values to filter, i.e. the last filterSize (or fewer) values read within a particular dimension, oldest first
+     @return the filtered value
+     */
+    virtual double computeFilter(const VectorDouble &buf);
+    
+    /**
+     Turns the aggregate of a window into the filtered value, for derived classes that use a built-in aggregate.
+     By default the filtered value is the aggregate itself.
      
-     @param const VectorDouble buf: the values to filter, i.e. the last filterSize (or fewer) values read within a particular dimension
+     @param double aggregate: the aggregate of the last filterSize (or fewer) values read within a particular dimension
      @return the filtered value
      */
-    virtual double computeFilter(const VectorDouble &buf) = 0;
+    virtual double computeFilterFromAggregate(double aggregate) const { return aggregate; }
+    
+    /**
+     Gets the aggregate the filter computes over its window.
+     
+     @return returns the aggregate
+     */
+    Aggregate getAggregate() const { return aggregate; }
 
 	/**
      Gets the current filter size.
@@ -189,9 +215,40 @@ public:
     vector< VectorDouble > getDataBuffer() const;
     
 protected:
+    /**
+     Writes x to slot `slot` of the window of dimension j and updates the aggregate of dimension j.
+     If evict is true the window was full and the value x replaces leaves it.
+     
+     @return the new aggregate
+     */
+    double updateAggregate(UINT j,UINT slot,double x,bool evict);
+    
+    /**
+     Recomputes the running sum of dimension j from the window, so that rounding errors don't build up.
+     */
+    void resum(UINT j);
+    
     UINT filterSize;                                        ///< The size of the filter
     UINT inputSampleCounter;                                ///< A counter to keep track of the number of input samples
-    CircularBuffer< VectorDouble > dataBuffer;          	///< A buffer to store the previous N values, N = filterSize
+    Aggregate aggregate;                                    ///< The aggregate computed over the window
+    
+    //The previous N values, N = filterSize, as one circular buffer per dimension: dimension j is window[j*filterSize, (j+1)*filterSize)
+    VectorDouble window;
+    UINT windowPosition;                                    ///< The slot the next value is written to
+    unsigned long long sampleCount;                         ///< The number of values written so far
+    VectorDouble scratch;                                   ///< The copy of the window passed to computeFilter()
+    
+    //MEAN, SUM and SUM_OF_SQUARES: the running sum per dimension, recomputed every filterSize values
+    VectorDouble runningSum;
+    UINT valuesSinceResum;
+    
+    //MIN and MAX: per dimension, a circular deque of the sample numbers of the values that can still become the extreme
+    vector< unsigned long long > deque;
+    vector< UINT > dequeHead;
+    vector< UINT > dequeSize;
+    
+    //MEDIAN: per dimension, the values in the window in ascending order
+    VectorDouble sorted;
     
     //static RegisterPreProcessingModule< Filter > registerModule;
 };
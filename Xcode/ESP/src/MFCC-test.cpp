@@ -0,0 +1,133 @@
+#include "MFCC.h"
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace GRT;
+
+namespace {
+
+const uint32_t kFFTSize = 128;
+const uint32_t kNumCoefficients = 12;
+const uint32_t kLifter = 22;
+
+MFCC::Options mfccOptions() {
+    MFCC::Options options;
+    options.sample_rate = 8820;
+    options.fft_size = kFFTSize;
+    options.start_freq = 300;
+    options.end_freq = 3700;
+    options.num_tri_filter = 26;
+    options.num_cepstral_coeff = kNumCoefficients;
+    options.lifter_param = kLifter;
+    return options;
+}
+
+// Random spectra, then the edge cases of the log: a silent frame, where every
+// filterbank energy is 0 and left as is, and frames with energy in only a few
+// bins, where most are.
+std::vector<VectorDouble> spectra() {
+    std::mt19937 random(3);
+    std::uniform_real_distribution<double> magnitude(0, 2);
+    std::vector<VectorDouble> frames;
+    for (uint32_t f = 0; f < 50; f++) {
+        VectorDouble frame(kFFTSize);
+        for (double& x : frame) x = magnitude(random);
+        frames.push_back(frame);
+    }
+    frames.push_back(VectorDouble(kFFTSize, 0));
+    for (uint32_t bin : {10, 40, 100}) {
+        VectorDouble frame(kFFTSize, 0);
+        frame[bin] = frame[bin + 1] = 3;
+        frames.push_back(frame);
+    }
+    return frames;
+}
+
+void expectNear(const VectorDouble& expected, const VectorDouble& actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (uint32_t i = 0; i < expected.size(); i++) {
+        EXPECT_NEAR(expected[i], actual[i],
+                    1e-4 * std::max(1.0, std::fabs(expected[i])))
+            << "coefficient " << i;
+    }
+}
+
+}  // namespace
+
+TEST(MFCCTest, FastMatchesReference) {
+    MFCC fast(mfccOptions());
+    MFCC reference(mfccOptions());
+    ASSERT_EQ(MFCC::kFast, fast.getComputeMode());
+    reference.setComputeMode(MFCC::kReference);
+
+    for (const VectorDouble& frame : spectra()) {
+        ASSERT_TRUE(fast.computeFeatures(frame));
+        ASSERT_TRUE(reference.computeFeatures(frame));
+        ASSERT_TRUE(fast.getFeatureDataReady());
+        expectNear(reference.getFeatureVector(), fast.getFeatureVector());
+    }
+}
+
+TEST(MFCCTest, AppliesTheLifterAndLeavesSilenceAtZero) {
+    for (MFCC::ComputeMode mode : {MFCC::kFast, MFCC::kReference}) {
+        MFCC mfcc(mfccOptions());
+        mfcc.setComputeMode(mode);
+
+        for (const VectorDouble& frame : spectra()) {
+            // The filterbank energies, their log where they aren't 0, the
+            // DCT and the lifter, step by step.
+            std::vector<double> lfbe(26);
+            mfcc.getFilters().filter(frame, lfbe);
+            for (double& x : lfbe) {
+                if (x != 0) x = std::log(x);
+            }
+            std::vector<double> expected = mfcc.getCC(lfbe);
+            for (uint32_t i = 0; i < kNumCoefficients; i++) {
+                expected[i] *= 1 + kLifter / 2.0 * sin(PI * i / kLifter);
+            }
+
+            ASSERT_TRUE(mfcc.computeFeatures(frame));
+            expectNear(VectorDouble(expected), mfcc.getFeatureVector());
+        }
+
+        ASSERT_TRUE(mfcc.computeFeatures(VectorDouble(kFFTSize, 0)));
+        for (double x : mfcc.getFeatureVector()) EXPECT_EQ(0, x);
+    }
+}
+
+TEST(MFCCTest, BatchMatchesFrameByFrameInBothModes) {
+    MFCC::Options options = mfccOptions();
+    options.use_vad = true;
+    options.noise_level = 5;
+    const std::vector<VectorDouble> frames = spectra();
+
+    for (MFCC::ComputeMode mode : {MFCC::kFast, MFCC::kReference}) {
+        MFCC frame_by_frame(options);
+        MFCC batch(options);
+        frame_by_frame.setComputeMode(mode);
+        batch.setComputeMode(mode);
+
+        std::vector<double> fft;
+        for (const VectorDouble& frame : frames) {
+            fft.insert(fft.end(), frame.begin(), frame.end());
+        }
+        std::vector<double> features(frames.size() * kNumCoefficients);
+        std::vector<bool> ready;
+        batch.computeFeaturesBatch(fft.data(), frames.size(), features.data(),
+                                   ready);
+
+        for (uint32_t f = 0; f < frames.size(); f++) {
+            ASSERT_TRUE(frame_by_frame.computeFeatures(frames[f]));
+            ASSERT_EQ(frame_by_frame.getFeatureDataReady(), ready[f]);
+            if (!ready[f]) continue;
+            VectorDouble row(features.begin() + f * kNumCoefficients,
+                             features.begin() + (f + 1) * kNumCoefficients);
+            expectNear(frame_by_frame.getFeatureVector(), row);
+        }
+        // The silent frame is dropped by the VAD.
+        EXPECT_FALSE(ready[50]);
+    }
+}
@@ -6,6 +6,8 @@
 #include <numeric>
 #include <vector>
 
+#include "simd.h"
+
 #if __APPLE__
 #include <Accelerate/Accelerate.h>
 #elif __linux__
@@ -18,13 +20,16 @@ using std::vector;
 
 RegisterFeatureExtractionModule<MFCC> MFCC::registerModule("MFCC");
 
-TriFilterBanks::TriFilterBanks() : initialized_(false) {
+TriFilterBanks::TriFilterBanks()
+        : initialized_(false), num_filter_(0), filter_size_(0) {
 }
 
 void TriFilterBanks::initialize(uint32_t num_filter, uint32_t filter_size) {
     num_filter_ = num_filter;
     filter_size_ = filter_size;
-    filter_ = new double[num_filter_ * filter_size_];
+    filter_.assign(num_filter_ * filter_size_, 0.0);
+    begin_.assign(num_filter_, 0);
+    weights_.assign(num_filter_, vector<float>());
     initialized_ = true;
 }
 
@@ -48,12 +53,17 @@ void TriFilterBanks::setFilter(uint32_t idx, double left, double middle,
                    "TriFilterBanks argument wrong or implementation bug");
         }
     }
+    updateSparseFilter(idx);
 }
 
-TriFilterBanks::~TriFilterBanks() {
-    if (initialized_) {
-        delete filter_;
-    }
+void TriFilterBanks::updateSparseFilter(uint32_t idx) {
+    const double* row = &filter_[idx * filter_size_];
+    uint32_t begin = 0, end = filter_size_;
+    while (begin < end && row[begin] == 0) begin++;
+    while (end > begin && row[end - 1] == 0) end--;
+
+    begin_[idx] = begin;
+    weights_[idx].assign(row + begin, row + end);
 }
 
 void TriFilterBanks::filter(const vector<double>& input,
@@ -63,7 +73,22 @@ void TriFilterBanks::filter(const vector<double>& input,
 
     // Perform matrix multiplication
     cblas_dgemv(CblasRowMajor, CblasNoTrans, num_filter_, filter_size_, 1.0,
-                filter_, filter_size_, input.data(), 1, 1.0, output.data(), 1);
+                filter_.data(), filter_size_, input.data(), 1, 1.0,
+                output.data(), 1);
+}
+
+void TriFilterBanks::filter(const float* input, float* output) const {
+    for (uint32_t i = 0; i < num_filter_; i++) {
+        output[i] = simd::dot(weights_[i].data(), input + begin_[i],
+                              weights_[i].size());
+    }
+}
+
+void TriFilterBanks::filter(const double* input, uint32_t num_frames,
+                            double* output) const {
+    cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasTrans, num_frames,
+                num_filter_, filter_size_, 1.0, input, filter_size_,
+                filter_.data(), filter_size_, 0.0, output, num_filter_);
 }
 
 MFCC::MFCC(Options options) : initialized_(false), options_(options) {
@@ -112,19 +137,32 @@ void MFCC::initialize() {
     //--------------------------------------------------------------------------
     uint32_t row = options_.num_cepstral_coeff;
     uint32_t col = options_.num_tri_filter;
-    dct_matrix_ = new double[row * col];
+    dct_matrix_.resize(row * col);
+    dct_matrix_float_.resize(row * col);
     for (uint32_t i = 0; i < row; i++) {
         for (uint32_t j = 0; j < col; j++) {
             // In the matlab reference implementation, it's using (j - 0.5),
             // that's because j is 1:M not 0:(M-1). In C++, we use (j + 0.5).
             dct_matrix_[i * col + j] =
                 sqrt(2.0 / col) * cos(PI * i / col * (j + 0.5));
+            dct_matrix_float_[i * col + j] = dct_matrix_[i * col + j];
         }
     }
 
+    //---------------------------------------------
+    //  Prepare the lifter weights
+    //---------------------------------------------
+    lifter_.resize(row);
+    uint32_t L = options_.lifter_param;
+    for (uint32_t i = 0; i < row; i++) {
+        lifter_[i] = 1 + 1.0f * L / 2 * sin(PI * i / L);
+    }
+
     // Vector allocation
     tmp_lfbe_.resize(options_.num_tri_filter);
     tmp_cc_.resize(options_.num_cepstral_coeff);
+    tmp_fft_float_.resize(options_.fft_size);
+    tmp_lfbe_float_.resize(options_.num_tri_filter);
 
     initialized_ = true;
 }
@@ -144,6 +182,7 @@ MFCC& MFCC::operator=(const MFCC& rhs) {
     if (this != &rhs) {
         this->classType = rhs.getClassType();
         this->options_ = rhs.getOptions();
+        this->compute_mode_ = rhs.compute_mode_;
         this->initialize();
         copyBaseVariables((FeatureExtraction*)&rhs);
     }
@@ -184,7 +223,7 @@ void MFCC::computeLFBE(const vector<double>& fft, vector<double>& lfbe) {
 
 void MFCC::computeCC(const vector<double>& lfbe, vector<double>& cc) {
     cblas_dgemv(CblasRowMajor, CblasNoTrans, options_.num_cepstral_coeff,
-                options_.num_tri_filter, 1.0, dct_matrix_,
+                options_.num_tri_filter, 1.0, dct_matrix_.data(),
                 options_.num_tri_filter, lfbe.data(), 1, 1.0, cc.data(), 1);
 }
 
@@ -203,13 +242,29 @@ vector<double> MFCC::getCC(const vector<double>& lfbe) {
 
 vector<double> MFCC::lifterCC(const vector<double>& cc) {
     vector<double> liftered(options_.num_cepstral_coeff);
-    uint32_t L = options_.lifter_param;
     for (uint32_t i = 0; i < options_.num_cepstral_coeff; i++) {
-        liftered[i] = (1 + 1.0f * L / 2 * sin(PI * i / L)) * cc[i];
+        liftered[i] = lifter_[i] * cc[i];
     }
     return liftered;
 }
 
+void MFCC::computeFeaturesFast(const double* fft, double* features) {
+    uint32_t M = options_.num_tri_filter;
+    simd::toFloat(fft, tmp_fft_float_.data(), options_.fft_size);
+    filters_.filter(tmp_fft_float_.data(), tmp_lfbe_float_.data());
+
+    for (uint32_t i = 0; i < M; i++) {
+        if (tmp_lfbe_float_[i] != 0) {
+            tmp_lfbe_float_[i] = std::log(tmp_lfbe_float_[i]);
+        }
+    }
+
+    for (uint32_t i = 0; i < options_.num_cepstral_coeff; i++) {
+        float cc = simd::dot(&dct_matrix_float_[i * M], tmp_lfbe_float_.data(), M);
+        features[i] = lifter_[i] * cc;
+    }
+}
+
 bool MFCC::computeFeatures(const VectorDouble& inputVector) {
     featureVector.resize(options_.num_cepstral_coeff);
 
@@ -226,6 +281,14 @@ bool MFCC::computeFeatures(const VectorDouble& inputVector) {
         }
     }
 
+    if (compute_mode_ == kFast) {
+        assert(inputVector.size() == options_.fft_size &&
+               "Dimension mismatch in MFCC computeFeaturesFast");
+        computeFeaturesFast(inputVector.data(), featureVector.data());
+        featureDataReady = true;
+        return true;
+    }
+
     // Clear the memory (if not, garbage memory will cause us issue. This should
     // be faster than allocating a vector every time (maybe?)
     std::fill(tmp_lfbe_.begin(), tmp_lfbe_.end(), 0);
@@ -239,6 +302,73 @@ bool MFCC::computeFeatures(const VectorDouble& inputVector) {
     return true;
 }
 
+void MFCC::computeFeaturesBatchReference(const double* fft,
+                                         uint32_t num_frames,
+                                         double* features) {
+    const uint32_t K = options_.fft_size;
+    const uint32_t M = options_.num_tri_filter;
+    const uint32_t C = options_.num_cepstral_coeff;
+    tmp_lfbe_batch_.resize(kBatchBlockSize * M);
+
+    for (uint32_t first = 0; first < num_frames; first += kBatchBlockSize) {
+        const uint32_t n = std::min(kBatchBlockSize, num_frames - first);
+        const double* in = fft + (size_t) first * K;
+        double* out = features + (size_t) first * C;
+        double* lfbe = tmp_lfbe_batch_.data();
+
+        // LFBE = log(FFT * filters^T), as in computeLFBE().
+        filters_.filter(in, n, lfbe);
+        for (uint32_t i = 0; i < n * M; i++) {
+            if (lfbe[i] != 0) lfbe[i] = log(lfbe[i]);
+        }
+
+        // CC = LFBE * DCT^T, as in computeCC(), then liftered.
+        cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasTrans, n, C, M, 1.0,
+                    lfbe, M, dct_matrix_.data(), M, 0.0, out, C);
+        for (uint32_t f = 0; f < n; f++) {
+            for (uint32_t i = 0; i < C; i++) out[f * C + i] *= lifter_[i];
+        }
+    }
+}
+
+void MFCC::computeFeaturesBatch(const double* fft, uint32_t num_frames,
+                                double* features, vector<bool>& ready) {
+    const uint32_t K = options_.fft_size;
+    const uint32_t C = options_.num_cepstral_coeff;
+    ready.assign(num_frames, true);
+    if (options_.use_vad) {
+        for (uint32_t f = 0; f < num_frames; f++) {
+            const double* in = fft + (size_t) f * K;
+            double sum = std::accumulate(in, in + K, 0.0);
+            ready[f] = sum >= options_.noise_level;
+        }
+    }
+
+    if (compute_mode_ == kFast) {
+        // The sparse float32 path has no matrix-matrix form.
+        for (uint32_t f = 0; f < num_frames; f++) {
+            if (ready[f]) {
+                computeFeaturesFast(fft + (size_t) f * K,
+                                    features + (size_t) f * C);
+            }
+        }
+    } else {
+        computeFeaturesBatchReference(fft, num_frames, features);
+    }
+
+    // Leave the module as computeFeatures() would have: the last frame decides
+    // readiness, and the feature vector is that of the last ready frame.
+    if (num_frames == 0) return;
+    featureDataReady = ready[num_frames - 1];
+    for (uint32_t f = num_frames; f-- > 0;) {
+        if (ready[f]) {
+            featureVector.assign(features + (size_t) f * C,
+                                 features + (size_t) (f + 1) * C);
+            break;
+        }
+    }
+}
+
 bool MFCC::saveModelToFile(string filename) const{
     std::fstream file;
     file.open(filename.c_str(), std::ios::out);
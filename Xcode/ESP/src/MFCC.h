@@ -19,10 +19,13 @@ using std::vector;
 //   [   ...........   ]      fft
 //   [   ...........   ]
 //   [  filter bank N  ]     |____|
+//
+// Each triangular filter is non-zero over only a few FFT bins, so besides the
+// dense matrix (used by the double-precision reference path), every filter is
+// also kept as the range of bins it covers and its weights over that range.
 class TriFilterBanks {
   public:
     TriFilterBanks();
-    ~TriFilterBanks();
 
     void initialize(uint32_t num_filter, uint32_t filter_size);
     void setFilter(uint32_t idx, double left, double middle, double right,
@@ -40,13 +43,28 @@ class TriFilterBanks {
         return num_filter_;
     }
 
+    // Dense double-precision filtering: output += filter * input.
     void filter(const vector<double>& input, vector<double>& output);
 
+    // Sparse single-precision filtering: output = filter * input.
+    void filter(const float* input, float* output) const;
+
+    // Dense double-precision filtering of num_frames frames, stored row by
+    // row, with one matrix-matrix product: output = input * filter^T.
+    void filter(const double* input, uint32_t num_frames, double* output) const;
+
   private:
+    // Rebuilds the sparse form of filter idx from the dense matrix.
+    void updateSparseFilter(uint32_t idx);
+
     bool initialized_;
-    double* filter_;
+    vector<double> filter_;
     uint32_t num_filter_;
     uint32_t filter_size_;
+
+    // Filter i covers bins [begin_[i], begin_[i] + weights_[i].size()).
+    vector<uint32_t> begin_;
+    vector<vector<float>> weights_;
 };
 
 /* @brief MFCC class implements a variant of the Mel Frequency Cepstral
@@ -77,8 +95,10 @@ class TriFilterBanks {
  * implementation closely follows that's presented in the book and cross verfied
  * by the Matlab implementation.
  *
- * Note: This class has been optimized to use BLAS for matrix/vector
- * multiplication.
+ * By default, features are computed in single precision with a sparse
+ * filterbank and SIMD dot products (see simd.h). setComputeMode(kReference)
+ * switches to the original double-precision dense BLAS computation, which is
+ * kept to validate the fast path against.
  *
  * [1] Young, S., Evermann, G., Gales, M., Hain, T., Kershaw, D., Liu, X.,
  *     Moore, G., Odell, J., Ollason, D., Povey, D., Valtchev, V., Woodland, P.,
@@ -117,26 +137,51 @@ class MFCC : public FeatureExtraction {
         }
     };
 
+    enum ComputeMode {
+        // Sparse filterbank and DCT in float32 with SIMD dot products.
+        kFast,
+        // Dense filterbank and DCT in double precision with BLAS.
+        kReference,
+    };
+
     MFCC(struct Options options = Options());
 
     MFCC(const MFCC& rhs);
     MFCC& operator=(const MFCC& rhs);
     bool deepCopyFrom(const FeatureExtraction* featureExtraction) override;
-    ~MFCC() override {
-        delete[] dct_matrix_;
-    }
+    ~MFCC() override {}
 
     void initialize();
 
     bool computeFeatures(const VectorDouble& inputVector) override;
     bool reset() override;
 
+    /**
+     Compute the features of many FFT frames at once, for offline use over
+     whole recordings, in the module's compute mode. With kReference the
+     frames go through matrix-matrix products (the same arithmetic as
+     computeFeatures(), summed in a different order); with kFast each frame
+     takes the same float32 path as computeFeatures(), so the features match
+     live prediction exactly. Afterwards the module is in the same state as if
+     the frames had gone through computeFeatures() one by one.
+
+     @param fft: num_frames rows of fft_size values.
+     @param features: num_frames rows of num_cepstral_coeff values. Rows whose
+     frame is rejected by the VAD are left unspecified.
+     @param ready: set to whether each frame passed the VAD.
+     */
+    void computeFeaturesBatch(const double* fft, uint32_t num_frames,
+                              double* features, vector<bool>& ready);
+
     // Configurable Parameters
     bool setNoiseLevel(double noise_level) {
         options_.noise_level = noise_level;
         return true;
     }
 
+    void setComputeMode(ComputeMode mode) { compute_mode_ = mode; }
+    ComputeMode getComputeMode() const { return compute_mode_; }
+
     // Save and Load from file
     bool saveModelToFile(string filename) const override;
     bool loadModelFromFile(string filename) override;
@@ -156,17 +201,37 @@ class MFCC : public FeatureExtraction {
     vector<double> getCC(const vector<double>& lfbe);
     vector<double> lifterCC(const vector<double>& cc);
 
+    // The float32 counterpart of computeLFBE(), computeCC() and lifterCC(),
+    // from fft_size values to num_cepstral_coeff features. Doesn't touch the
+    // module's feature vector, so other modules can use it as a kernel.
+    void computeFeaturesFast(const double* fft, double* features);
+
   protected:
+    // computeFeaturesBatch() with kReference, for every frame whether or not
+    // it passes the VAD.
+    void computeFeaturesBatchReference(const double* fft, uint32_t num_frames,
+                                       double* features);
+
+    // Frames per matrix-matrix product in computeFeaturesBatch() with
+    // kReference; keeps the intermediate filterbank energies in cache.
+    static const uint32_t kBatchBlockSize = 256;
+
     bool initialized_;
     Options options_;
+    ComputeMode compute_mode_ = kFast;
 
     // The information below can be generated with options_. We fill them during
     // the initialize() function.
-    double* dct_matrix_;
+    vector<double> dct_matrix_;
+    vector<float> dct_matrix_float_;
+    vector<double> lifter_;
     TriFilterBanks filters_;
 
     vector<double> tmp_lfbe_;
     vector<double> tmp_cc_;
+    vector<float> tmp_fft_float_;
+    vector<float> tmp_lfbe_float_;
+    vector<double> tmp_lfbe_batch_;
 
     static RegisterFeatureExtractionModule<MFCC> registerModule;
 };
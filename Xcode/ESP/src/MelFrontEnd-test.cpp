@@ -0,0 +1,130 @@
+#include "MelFrontEnd.h"
+#include "gtest/gtest.h"
+
+#include <GRT/GRT.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace GRT;
+
+namespace {
+
+const uint32_t kWindowSize = 256;
+const uint32_t kHopSize = 128;
+
+MelFrontEnd::Options frontEndOptions(bool use_power) {
+    MelFrontEnd::Options options;
+    options.sample_rate = 8820;
+    options.window_size = kWindowSize;
+    options.hop_size = kHopSize;
+    options.window = MelFrontEnd::kHammingWindow;
+    options.use_power = use_power;
+    options.start_freq = 300;
+    options.end_freq = 3700;
+    options.num_tri_filter = 26;
+    options.num_cepstral_coeff = 12;
+    options.lifter_param = 22;
+    return options;
+}
+
+// A tone with noise, and a stretch of silence for the VAD to drop.
+std::vector<double> audio(uint32_t num_samples) {
+    std::mt19937 random(7);
+    std::normal_distribution<double> noise(0, 0.05);
+    std::vector<double> samples(num_samples);
+    for (uint32_t i = 0; i < num_samples; i++) {
+        const bool silent = i >= num_samples / 2 && i < num_samples * 3 / 4;
+        samples[i] = silent ? 0 : 0.5 * sin(0.3 * i) + noise(random);
+    }
+    return samples;
+}
+
+void expectMatchesFftAndMfcc(bool use_power) {
+    MelFrontEnd front_end(frontEndOptions(use_power));
+
+    FFT fft(kWindowSize, kHopSize, 1, FFT::HAMMING_WINDOW, true, false);
+    MFCC::Options options;
+    options.sample_rate = 8820;
+    options.fft_size = kWindowSize / 2;
+    options.start_freq = 300;
+    options.end_freq = 3700;
+    options.num_tri_filter = 26;
+    options.num_cepstral_coeff = 12;
+    options.lifter_param = 22;
+    MFCC mfcc(options);
+
+    uint32_t frames = 0;
+    for (double sample : audio(20 * kWindowSize)) {
+        VectorDouble input(1, sample);
+        ASSERT_TRUE(front_end.computeFeatures(input));
+        ASSERT_TRUE(fft.computeFeatures(input));
+        ASSERT_EQ(fft.getFeatureDataReady(), front_end.getFeatureDataReady());
+        if (!fft.getFeatureDataReady()) continue;
+
+        VectorDouble spectrum = fft.getFeatureVector();
+        if (use_power) {
+            for (double& x : spectrum) x *= x;
+        }
+        ASSERT_TRUE(mfcc.computeFeatures(spectrum));
+        VectorDouble expected = mfcc.getFeatureVector();
+        VectorDouble actual = front_end.getFeatureVector();
+        ASSERT_EQ(expected.size(), actual.size());
+        for (uint32_t i = 0; i < expected.size(); i++) {
+            EXPECT_NEAR(expected[i], actual[i],
+                        1e-4 * std::max(1.0, std::fabs(expected[i])))
+                << "coefficient " << i << " of frame " << frames;
+        }
+        frames++;
+    }
+    EXPECT_EQ(20 * kWindowSize / kHopSize, frames);
+}
+
+}  // namespace
+
+TEST(MelFrontEndTest, MatchesFftAndMfccOnMagnitude) {
+    expectMatchesFftAndMfcc(false);
+}
+
+TEST(MelFrontEndTest, MatchesFftAndMfccOnPower) {
+    expectMatchesFftAndMfcc(true);
+}
+
+TEST(MelFrontEndTest, BatchMatchesFrameByFrame) {
+    MelFrontEnd::Options options = frontEndOptions(false);
+    options.delta_window = 2;
+    options.use_vad = true;
+    options.noise_level = 5;
+    MelFrontEnd frame_by_frame(options);
+    MelFrontEnd batch(options);
+
+    const std::vector<double> samples = audio(40 * kWindowSize);
+    const uint32_t P = batch.getNumOutputDimensions();
+    ASSERT_EQ(24, P);
+    std::vector<double> features(samples.size() * P);
+    std::vector<bool> ready;
+    batch.computeFeaturesBatch(samples.data(), samples.size(),
+                               features.data(), ready);
+    ASSERT_EQ(samples.size(), ready.size());
+
+    uint32_t num_ready = 0, num_dropped = 0;
+    for (uint32_t i = 0; i < samples.size(); i++) {
+        VectorDouble input(1, samples[i]);
+        ASSERT_TRUE(frame_by_frame.computeFeatures(input));
+        ASSERT_EQ(frame_by_frame.getFeatureDataReady(), ready[i])
+            << "sample " << i;
+        if (!ready[i]) {
+            if ((i + 1) % kHopSize == 0) num_dropped++;
+            continue;
+        }
+        VectorDouble expected = frame_by_frame.getFeatureVector();
+        for (uint32_t k = 0; k < P; k++) {
+            ASSERT_EQ(expected[k], features[i * P + k]) << "sample " << i;
+        }
+        num_ready++;
+    }
+    // Both the VAD and the delta history held some frames back.
+    EXPECT_GT(num_ready, 40);
+    EXPECT_GT(num_dropped, 10);
+}
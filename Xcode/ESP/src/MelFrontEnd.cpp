@@ -0,0 +1,441 @@
+#include "MelFrontEnd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "grt-util.h"
+
+using grt_util::readValue;
+
+namespace GRT {
+
+RegisterFeatureExtractionModule<MelFrontEnd>
+    MelFrontEnd::registerModule("MelFrontEnd");
+
+namespace {
+
+const char kFileHeader[] = "GRT_MEL_FRONT_END_FILE_V1.0";
+
+}  // namespace
+
+MelFrontEnd::MelFrontEnd(Options options)
+        : initialized_(false), options_(options), ring_pos_(0),
+          hop_counter_(0), history_pos_(0), history_count_(0) {
+    classType = "MelFrontEnd";
+    featureExtractionType = classType;
+    debugLog.setProceedingText("[DEBUG MelFrontEnd]");
+    errorLog.setProceedingText("[ERROR MelFrontEnd]");
+    warningLog.setProceedingText("[WARNING MelFrontEnd]");
+
+    if (options_.window_size == 0) { // Default values
+        return;
+    }
+
+    initialize();
+}
+
+MelFrontEnd::MelFrontEnd(const MelFrontEnd& rhs)
+        : initialized_(false), ring_pos_(0), hop_counter_(0), history_pos_(0),
+          history_count_(0) {
+    classType = "MelFrontEnd";
+    featureExtractionType = classType;
+    debugLog.setProceedingText("[DEBUG MelFrontEnd]");
+    errorLog.setProceedingText("[ERROR MelFrontEnd]");
+    warningLog.setProceedingText("[WARNING MelFrontEnd]");
+
+    *this = rhs;
+}
+
+MelFrontEnd& MelFrontEnd::operator=(const MelFrontEnd& rhs) {
+    if (this != &rhs) {
+        this->classType = rhs.getClassType();
+        this->options_ = rhs.getOptions();
+        if (rhs.initialized_) {
+            this->initialize();
+        } else {
+            this->initialized_ = false;
+        }
+        copyBaseVariables((FeatureExtraction*)&rhs);
+    }
+    return *this;
+}
+
+bool MelFrontEnd::deepCopyFrom(const FeatureExtraction* featureExtraction) {
+    if (featureExtraction == nullptr) {
+        return false;
+    }
+
+    if (this->getFeatureExtractionType() ==
+        featureExtraction->getFeatureExtractionType()) {
+        *this = *(MelFrontEnd*)featureExtraction;
+        return true;
+    }
+
+    errorLog << "clone(MelFrontEnd *featureExtraction)"
+             << "-  FeatureExtraction Types Do Not Match!" << std::endl;
+    return false;
+}
+
+bool MelFrontEnd::initialize() {
+    initialized_ = false;
+
+    const uint32_t N = options_.window_size;
+    if (N < 4 || (N & (N - 1)) != 0) {
+        errorLog << "initialize() - window_size must be a power of two of at "
+                 << "least 4, not " << N << std::endl;
+        return false;
+    }
+    if (options_.hop_size == 0 || options_.num_tri_filter == 0 ||
+        options_.num_cepstral_coeff == 0 || options_.lifter_param == 0) {
+        errorLog << "initialize() - hop_size, num_tri_filter, "
+                 << "num_cepstral_coeff and lifter_param must be positive"
+                 << std::endl;
+        return false;
+    }
+
+    const uint32_t H = N / 2;
+    const uint32_t C = options_.num_cepstral_coeff;
+
+    numInputDimensions = 1;
+    numOutputDimensions = options_.delta_window > 0 ? 2 * C : C;
+
+    //---------------------------------------------
+    //  Window function, as defined by GRT::FFT
+    //---------------------------------------------
+    window_.resize(N);
+    for (uint32_t i = 0; i < N; i++) {
+        switch (options_.window) {
+            case kRectangularWindow:
+                window_[i] = 1.0;
+                break;
+            case kHammingWindow:
+                window_[i] = 0.54 - 0.46 * cos(2 * PI * i / (N - 1));
+                break;
+            case kHanningWindow:
+                window_[i] = 0.5 * (1 - cos(2 * PI * i / (N - 1)));
+                break;
+        }
+    }
+
+    //---------------------------------------------
+    //  FFT tables for the H point complex FFT and the split into N real bins
+    //---------------------------------------------
+    uint32_t bits = 0;
+    while ((1u << bits) < H) bits++;
+    bit_reverse_.resize(H);
+    for (uint32_t i = 0; i < H; i++) {
+        uint32_t r = 0;
+        for (uint32_t b = 0; b < bits; b++) {
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        bit_reverse_[i] = r;
+    }
+
+    twiddle_re_.resize(H / 2);
+    twiddle_im_.resize(H / 2);
+    for (uint32_t k = 0; k < H / 2; k++) {
+        twiddle_re_[k] = cos(2 * PI * k / H);
+        twiddle_im_[k] = -sin(2 * PI * k / H);
+    }
+
+    split_re_.resize(H);
+    split_im_.resize(H);
+    for (uint32_t k = 0; k < H; k++) {
+        split_re_[k] = cos(2 * PI * k / N);
+        split_im_[k] = -sin(2 * PI * k / N);
+    }
+
+    //---------------------------------------------
+    //  Filterbank, DCT and lifter: those of MFCC over the H bins
+    //---------------------------------------------
+    MFCC::Options mfcc_options;
+    mfcc_options.sample_rate = options_.sample_rate;
+    mfcc_options.fft_size = H;
+    mfcc_options.start_freq = options_.start_freq;
+    mfcc_options.end_freq = options_.end_freq;
+    mfcc_options.num_tri_filter = options_.num_tri_filter;
+    mfcc_options.num_cepstral_coeff = C;
+    mfcc_options.lifter_param = options_.lifter_param;
+    mfcc_ = MFCC(mfcc_options);
+
+    // Buffers
+    ring_.resize(N);
+    frame_.resize(N);
+    re_.resize(H);
+    im_.resize(H);
+    spectrum_.resize(H);
+    cepstrum_.resize(C);
+    history_.resize((2 * options_.delta_window + 1) * C);
+    featureVector.resize(numOutputDimensions);
+
+    initialized_ = true;
+    return reset();
+}
+
+bool MelFrontEnd::reset() {
+    std::fill(ring_.begin(), ring_.end(), 0.0);
+    ring_pos_ = 0;
+    hop_counter_ = 0;
+    history_pos_ = 0;
+    history_count_ = 0;
+    featureDataReady = false;
+    return true;
+}
+
+bool MelFrontEnd::computeFeatures(const VectorDouble& inputVector) {
+    if (!initialized_) {
+        errorLog << "computeFeatures(const VectorDouble &inputVector)"
+                 << " - Not initialized!" << std::endl;
+        return false;
+    }
+    if (inputVector.size() != numInputDimensions) {
+        errorLog << "computeFeatures(const VectorDouble &inputVector)"
+                 << " - The size of the inputVector (" << inputVector.size()
+                 << ") does not match that of the FeatureExtraction ("
+                 << numInputDimensions << ")!" << std::endl;
+        return false;
+    }
+
+    featureDataReady = processSample(inputVector[0]);
+    return true;
+}
+
+void MelFrontEnd::computeFeaturesBatch(const double* samples,
+                                       uint32_t num_samples, double* features,
+                                       vector<bool>& ready) {
+    ready.assign(num_samples, false);
+    if (!initialized_) return;
+
+    const uint32_t P = numOutputDimensions;
+    for (uint32_t i = 0; i < num_samples; i++) {
+        featureDataReady = processSample(samples[i]);
+        if (featureDataReady) {
+            std::copy(featureVector.begin(), featureVector.end(),
+                      features + (size_t) i * P);
+            ready[i] = true;
+        }
+    }
+}
+
+bool MelFrontEnd::processSample(double sample) {
+    ring_[ring_pos_] = sample;
+    if (++ring_pos_ == ring_.size()) ring_pos_ = 0;
+    if (++hop_counter_ < options_.hop_size) return false;
+    hop_counter_ = 0;
+
+    fillFrame();
+    computeSpectrum();
+
+    if (options_.use_vad) {
+        double sum = std::accumulate(spectrum_.begin(), spectrum_.end(), 0.0);
+        if (sum < options_.noise_level) return false;
+    }
+
+    mfcc_.computeFeaturesFast(spectrum_.data(), cepstrum_.data());
+
+    if (options_.delta_window == 0) {
+        std::copy(cepstrum_.begin(), cepstrum_.end(), featureVector.begin());
+        return true;
+    }
+    return computeDeltas();
+}
+
+void MelFrontEnd::fillFrame() {
+    const uint32_t N = options_.window_size;
+    const uint32_t tail = N - ring_pos_;
+    for (uint32_t i = 0; i < tail; i++) {
+        frame_[i] = ring_[ring_pos_ + i] * window_[i];
+    }
+    for (uint32_t i = tail; i < N; i++) {
+        frame_[i] = ring_[i - tail] * window_[i];
+    }
+}
+
+void MelFrontEnd::complexFFT() {
+    const uint32_t H = re_.size();
+    for (uint32_t i = 0; i < H; i++) {
+        uint32_t j = bit_reverse_[i];
+        if (i < j) {
+            std::swap(re_[i], re_[j]);
+            std::swap(im_[i], im_[j]);
+        }
+    }
+
+    for (uint32_t size = 2; size <= H; size *= 2) {
+        const uint32_t half = size / 2;
+        const uint32_t step = H / size;
+        for (uint32_t start = 0; start < H; start += size) {
+            for (uint32_t j = 0; j < half; j++) {
+                const double wr = twiddle_re_[j * step];
+                const double wi = twiddle_im_[j * step];
+                const uint32_t a = start + j, b = a + half;
+                const double tr = wr * re_[b] - wi * im_[b];
+                const double ti = wr * im_[b] + wi * re_[b];
+                re_[b] = re_[a] - tr;
+                im_[b] = im_[a] - ti;
+                re_[a] += tr;
+                im_[a] += ti;
+            }
+        }
+    }
+}
+
+void MelFrontEnd::computeSpectrum() {
+    const uint32_t H = re_.size();
+
+    // Pack the even samples as real and the odd ones as imaginary parts.
+    for (uint32_t k = 0; k < H; k++) {
+        re_[k] = frame_[2 * k];
+        im_[k] = frame_[2 * k + 1];
+    }
+    complexFFT();
+
+    // Split Z into the spectra of the even (E) and odd (O) samples, then
+    // X[k] = E[k] + exp(-2 pi i k / N) O[k].
+    for (uint32_t k = 0; k < H; k++) {
+        const uint32_t c = (H - k) & (H - 1);
+        const double er = 0.5 * (re_[k] + re_[c]);
+        const double ei = 0.5 * (im_[k] - im_[c]);
+        const double or_ = 0.5 * (im_[k] + im_[c]);
+        const double oi = -0.5 * (re_[k] - re_[c]);
+        const double xr = er + split_re_[k] * or_ - split_im_[k] * oi;
+        const double xi = ei + split_re_[k] * oi + split_im_[k] * or_;
+        const double power = xr * xr + xi * xi;
+        spectrum_[k] = options_.use_power ? power : sqrt(power);
+    }
+}
+
+bool MelFrontEnd::computeDeltas() {
+    const uint32_t C = options_.num_cepstral_coeff;
+    const uint32_t D = options_.delta_window;
+    const uint32_t size = 2 * D + 1;
+
+    std::copy(cepstrum_.begin(), cepstrum_.end(),
+              history_.begin() + history_pos_ * C);
+    history_pos_ = (history_pos_ + 1) % size;
+    if (history_count_ < size) history_count_++;
+    if (history_count_ < size) return false;
+
+    // history_pos_ is now the oldest frame, t - 2D; the output is for t - D.
+    auto frame = [&](uint32_t age_from_oldest) {
+        return &history_[((history_pos_ + age_from_oldest) % size) * C];
+    };
+
+    const double* center = frame(D);
+    std::copy(center, center + C, featureVector.begin());
+
+    double norm = 0;
+    for (uint32_t theta = 1; theta <= D; theta++) norm += theta * theta;
+    norm *= 2;
+
+    for (uint32_t i = 0; i < C; i++) {
+        double delta = 0;
+        for (uint32_t theta = 1; theta <= D; theta++) {
+            delta += theta * (frame(D + theta)[i] - frame(D - theta)[i]);
+        }
+        featureVector[C + i] = delta / norm;
+    }
+    return true;
+}
+
+bool MelFrontEnd::saveModelToFile(string filename) const {
+    std::fstream file;
+    file.open(filename.c_str(), std::ios::out);
+
+    return saveModelToFile(file);
+}
+
+bool MelFrontEnd::loadModelFromFile(string filename) {
+    std::fstream file;
+    file.open(filename.c_str(), std::ios::in);
+
+    return loadModelFromFile(file);
+}
+
+bool MelFrontEnd::saveModelToFile(fstream &file) const {
+    if (!file.is_open()) {
+        errorLog << "saveModelToFile(fstream &file) - The file is not open!"
+                 << std::endl;
+        return false;
+    }
+
+    file << kFileHeader << std::endl;
+
+    if (!saveFeatureExtractionSettingsToFile(file)) {
+        errorLog << "saveFeatureExtractionSettingsToFile(fstream &file)"
+                 << " - Failed to save base feature extraction settings to file!"
+                 << std::endl;
+        return false;
+    }
+
+    file << "SampleRate: " << options_.sample_rate << std::endl;
+    file << "WindowSize: " << options_.window_size << std::endl;
+    file << "HopSize: " << options_.hop_size << std::endl;
+    file << "WindowFunction: " << options_.window << std::endl;
+    file << "UsePower: " << options_.use_power << std::endl;
+    file << "StartFrequency: " << options_.start_freq << std::endl;
+    file << "EndFrequency: " << options_.end_freq << std::endl;
+    file << "NumTriFilter: " << options_.num_tri_filter << std::endl;
+    file << "NumCepstralCoeff: " << options_.num_cepstral_coeff << std::endl;
+    file << "LifterParam: " << options_.lifter_param << std::endl;
+    file << "DeltaWindow: " << options_.delta_window << std::endl;
+    file << "UseVad: " << options_.use_vad << std::endl;
+    file << "NoiseLevel: " << options_.noise_level << std::endl;
+
+    return true;
+}
+
+bool MelFrontEnd::loadModelFromFile(fstream &file) {
+    if (!file.is_open()) {
+        errorLog << "loadModelFromFile(fstream &file) - The file is not open!"
+                 << std::endl;
+        return false;
+    }
+
+    string word;
+    file >> word;
+    if (word != kFileHeader) {
+        errorLog << "loadModelFromFile(fstream &file) - Invalid file format!"
+                 << std::endl;
+        return false;
+    }
+
+    if (!loadFeatureExtractionSettingsFromFile(file)) {
+        errorLog << "loadFeatureExtractionSettingsFromFile(fstream &file) "
+                 << "- Failed to load base feature extraction settings from file!"
+                 << std::endl;
+        return false;
+    }
+
+    Options options;
+    int window = 0;
+    if (!readValue(file, "SampleRate:", options.sample_rate) ||
+        !readValue(file, "WindowSize:", options.window_size) ||
+        !readValue(file, "HopSize:", options.hop_size) ||
+        !readValue(file, "WindowFunction:", window) ||
+        !readValue(file, "UsePower:", options.use_power) ||
+        !readValue(file, "StartFrequency:", options.start_freq) ||
+        !readValue(file, "EndFrequency:", options.end_freq) ||
+        !readValue(file, "NumTriFilter:", options.num_tri_filter) ||
+        !readValue(file, "NumCepstralCoeff:", options.num_cepstral_coeff) ||
+        !readValue(file, "LifterParam:", options.lifter_param) ||
+        !readValue(file, "DeltaWindow:", options.delta_window) ||
+        !readValue(file, "UseVad:", options.use_vad) ||
+        !readValue(file, "NoiseLevel:", options.noise_level)) {
+        errorLog << "loadModelFromFile(fstream &file) "
+                 << "- Failed to read the options!" << std::endl;
+        return false;
+    }
+    if (window < kRectangularWindow || window > kHanningWindow) {
+        errorLog << "loadModelFromFile(fstream &file) "
+                 << "- Unknown WindowFunction " << window << std::endl;
+        return false;
+    }
+    options.window = static_cast<WindowFunction>(window);
+
+    options_ = options;
+    return initialize();
+}
+
+}  // namespace GRT
@@ -0,0 +1,178 @@
+#ifndef ESP_MEL_FRONT_END_H_
+#define ESP_MEL_FRONT_END_H_
+
+#include "GRT/CoreModules/FeatureExtraction.h"
+
+#include <stdint.h>
+#include <vector>
+
+#include "MFCC.h"
+
+namespace GRT {
+
+using std::vector;
+
+/* @brief MelFrontEnd turns raw audio samples into MFCCs in a single feature
+ * extraction module. It replaces the usual GRT::FFT followed by MFCC:
+ *
+ *  GRT::FFT fft(256, 128, 1, GRT::FFT::HAMMING_WINDOW, true, false);
+ *  GRT::MFCC mfcc(options);  // with options.fft_size = 256 / 2
+ *
+ * Every hop_size samples, the last window_size samples (kept in a ring buffer)
+ * are windowed, transformed with a real-input FFT (computed as a complex FFT
+ * of half the size), and the resulting window_size / 2 bins go through the
+ * triangular mel filterbank, log, DCT and lifter of an MFCC module with
+ * fft_size = window_size / 2 (its kFast kernel). All buffers are allocated in
+ * initialize(), so computeFeatures() doesn't allocate.
+ *
+ * By default the filterbank is applied to the magnitude spectrum, like
+ * FFT + MFCC, so existing noise levels and training data carry over;
+ * use_power applies it to the power spectrum instead.
+ *
+ * With delta_window = D > 0, each output also has the delta coefficients of
+ * the HTK Book [1] (regression over D frames on either side), at the cost of
+ * D frames of latency: the output is [c(t - D), delta(t - D)].
+ *
+ * As with MFCC, the VAD drops frames whose spectrum sums to less than
+ * noise_level; those frames are not ready and don't enter the delta history.
+ *
+ *    GRT::MelFrontEnd::Options options;
+ *    options.sample_rate = 8820;
+ *    options.window_size = 256;
+ *    options.hop_size = 128;
+ *    options.start_freq = 300;
+ *    options.end_freq = 3700;
+ *    options.num_tri_filter = 26;
+ *    options.num_cepstral_coeff = 12;
+ *    options.lifter_param = 22;
+ *    options.use_vad = true;
+ *    options.noise_level = 5;
+ *    GRT::MelFrontEnd front_end(options);
+ *
+ * [1] Young, S., et al., 2006. The HTK Book (for HTK Version 3.4.1), section
+ *     5.9, Delta, Acceleration and Third Differential Coefficients.
+ */
+class MelFrontEnd : public FeatureExtraction {
+  public:
+    enum WindowFunction {
+        kRectangularWindow = 0,
+        kHammingWindow = 1,
+        kHanningWindow = 2,
+    };
+
+    struct Options {
+        uint32_t sample_rate;        // The sampling frequency (Hz)
+        uint32_t window_size;        // Samples per frame, a power of two
+        uint32_t hop_size;           // Samples between frames
+        WindowFunction window;       // Applied to each frame before the FFT
+        bool use_power;              // Power instead of magnitude spectrum
+        double start_freq;           // Lower frequency (Hz)
+        double end_freq;             // Upper frequency (Hz)
+        uint32_t num_tri_filter;     // Number of filter banks
+        uint32_t num_cepstral_coeff; // Number of coefficient produced
+        uint32_t lifter_param;       // Sinusoidal Lifter parameter
+        uint32_t delta_window;       // Frames on each side for deltas, 0: none
+        bool use_vad;                // Voice Activity Detector
+        double noise_level;          // Simple threshold for VAD
+        Options()
+            : sample_rate(0), window_size(0), hop_size(0),
+              window(kHammingWindow), use_power(false), start_freq(-1),
+              end_freq(-1), num_tri_filter(0), num_cepstral_coeff(0),
+              lifter_param(0), delta_window(0), use_vad(false),
+              noise_level(0) {
+        }
+    };
+
+    MelFrontEnd(struct Options options = Options());
+
+    MelFrontEnd(const MelFrontEnd& rhs);
+    MelFrontEnd& operator=(const MelFrontEnd& rhs);
+    bool deepCopyFrom(const FeatureExtraction* featureExtraction) override;
+    ~MelFrontEnd() override {}
+
+    // Validates the options and allocates every buffer. Returns false (and
+    // leaves the module uninitialized) if the options are invalid.
+    bool initialize();
+
+    // Takes one audio sample per call.
+    bool computeFeatures(const VectorDouble& inputVector) override;
+
+    /**
+     Run num_samples audio samples through the module, for offline use over
+     whole recordings, as if each had gone through computeFeatures().
+
+     @param features: num_samples rows of getNumOutputDimensions() values;
+     row i holds the output of sample i if it is ready, and is left
+     unspecified otherwise.
+     @param ready: set to whether each sample completed an output.
+     */
+    void computeFeaturesBatch(const double* samples, uint32_t num_samples,
+                              double* features, vector<bool>& ready);
+
+    // Clears the ring buffer and the delta history.
+    bool reset() override;
+
+    // Configurable Parameters
+    bool setNoiseLevel(double noise_level) {
+        options_.noise_level = noise_level;
+        return true;
+    }
+
+    // Save and Load from file
+    bool saveModelToFile(string filename) const override;
+    bool loadModelFromFile(string filename) override;
+    bool saveModelToFile(fstream &file) const override;
+    bool loadModelFromFile(fstream &file) override;
+
+    struct Options getOptions() const {
+        return options_;
+    }
+
+  protected:
+    // Pushes one sample; true if it completes an output in featureVector.
+    bool processSample(double sample);
+    // Windows the ring buffer into frame_, oldest sample first.
+    void fillFrame();
+    // Spectrum of frame_ into spectrum_ (window_size / 2 bins).
+    void computeSpectrum();
+    // In-place radix-2 complex FFT of re_ and im_.
+    void complexFFT();
+    // Pushes cepstrum_ into the delta history; true once featureVector holds
+    // a full [c, delta] output.
+    bool computeDeltas();
+
+    bool initialized_;
+    Options options_;
+
+    // Ring buffer of the last window_size samples; ring_pos_ is the oldest.
+    vector<double> ring_;
+    uint32_t ring_pos_;
+    uint32_t hop_counter_;
+
+    // Generated from options_ in initialize().
+    vector<double> window_;
+    vector<uint32_t> bit_reverse_;    // for the window_size / 2 point FFT
+    vector<double> twiddle_re_;       // exp(-2 pi i k / (window_size / 2))
+    vector<double> twiddle_im_;
+    vector<double> split_re_;         // exp(-2 pi i k / window_size)
+    vector<double> split_im_;
+    MFCC mfcc_;                       // filterbank, log, DCT and lifter
+
+    // Per-frame scratch.
+    vector<double> frame_;
+    vector<double> re_;
+    vector<double> im_;
+    vector<double> spectrum_;
+    vector<double> cepstrum_;
+
+    // The last 2 * delta_window + 1 cepstra, as a ring.
+    vector<double> history_;
+    uint32_t history_pos_;
+    uint32_t history_count_;
+
+    static RegisterFeatureExtractionModule<MelFrontEnd> registerModule;
+};
+
+} // namespace GRT
+
+#endif // ESP_MEL_FRONT_END_H_
@@ -0,0 +1,197 @@
+#include "PrunedDTW.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace GRT;
+
+namespace {
+
+const UINT kDimensions = 2;
+const double kBandWidth = 0.2;
+
+typedef std::vector<std::vector<double>> Series;
+
+// The full cost matrix of the DTW between a and b, within the same band as
+// PrunedDTW: band_width times the length of b, widened to the slope of the
+// diagonal.
+double bandedDtw(const Series& a, const Series& b) {
+    const UINT n = a.size();
+    const UINT m = b.size();
+    double band = std::round(kBandWidth * m);
+    band = band >= m ? m : std::max(1.0, band);
+    const double slope = n > 1 ? double(m - 1) / (n - 1) : 0;
+    const double width = n > 1 ? std::max(band, std::ceil(slope)) : m;
+
+    const double kInf = std::numeric_limits<double>::infinity();
+    std::vector<std::vector<double>> cost(n, std::vector<double>(m, kInf));
+    for (UINT i = 0; i < n; i++) {
+        for (UINT j = 0; j < m; j++) {
+            if (std::fabs(j - i * slope) > width + 1e-9) continue;
+            double d = 0;
+            for (UINT k = 0; k < kDimensions; k++) {
+                d += (a[i][k] - b[j][k]) * (a[i][k] - b[j][k]);
+            }
+            double best = i == 0 && j == 0 ? 0 : kInf;
+            if (i > 0) best = std::min(best, cost[i - 1][j]);
+            if (j > 0) best = std::min(best, cost[i][j - 1]);
+            if (i > 0 && j > 0) best = std::min(best, cost[i - 1][j - 1]);
+            cost[i][j] = best + d;
+        }
+    }
+    return cost[n - 1][m - 1];
+}
+
+struct Fixture {
+    std::mt19937 random{42};
+    TimeSeriesClassificationData data{kDimensions};
+    std::vector<Series> templates;
+    std::vector<UINT> labels;
+
+    Series randomWalk(UINT length) {
+        std::normal_distribution<double> step(0, 0.3);
+        Series series(length, std::vector<double>(kDimensions, 0));
+        for (UINT i = 1; i < length; i++) {
+            for (UINT k = 0; k < kDimensions; k++) {
+                series[i][k] = series[i - 1][k] + step(random);
+            }
+        }
+        return series;
+    }
+
+    Fixture() {
+        std::uniform_int_distribution<UINT> length(8, 30);
+        for (UINT label = 1; label <= 3; label++) {
+            for (UINT s = 0; s < 6; s++) {
+                Series series = randomWalk(length(random));
+                MatrixDouble sample(series.size(), kDimensions);
+                for (UINT i = 0; i < series.size(); i++) {
+                    for (UINT k = 0; k < kDimensions; k++) {
+                        sample[i][k] = series[i][k];
+                    }
+                }
+                data.addSample(label, sample);
+                templates.push_back(series);
+                labels.push_back(label);
+            }
+        }
+    }
+
+    // The distance of series to each class with a plain DTW against every
+    // template; with matchEnd, against the end of series.
+    std::vector<double> classDistances(const Series& series, bool matchEnd) {
+        std::vector<double> best(3, std::numeric_limits<double>::infinity());
+        for (UINT t = 0; t < templates.size(); t++) {
+            const Series& b = templates[t];
+            Series a = series;
+            if (matchEnd) {
+                if (b.size() > series.size()) continue;
+                a.assign(series.end() - b.size(), series.end());
+            }
+            double cost = bandedDtw(a, b) / std::max(a.size(), b.size());
+            best[labels[t] - 1] = std::min(best[labels[t] - 1], cost);
+        }
+        for (double& d : best) d = std::sqrt(d);
+        return best;
+    }
+};
+
+UINT nearestLabel(const std::vector<double>& distances) {
+    return std::min_element(distances.begin(), distances.end()) -
+           distances.begin() + 1;
+}
+
+}  // namespace
+
+TEST(PrunedDTWTest, StreamMatchesPlainDtw) {
+    Fixture fixture;
+    PrunedDTW dtw(false, false, 3.0, kBandWidth);
+    ASSERT_TRUE(dtw.train_(fixture.data));
+
+    // A random walk with training templates (shifted and noisy) in it, so
+    // that the pruning has both near and far templates to skip.
+    Series stream = fixture.randomWalk(100);
+    std::normal_distribution<double> noise(0, 0.05);
+    for (UINT t = 0; t < fixture.templates.size(); t += 4) {
+        for (const std::vector<double>& row : fixture.templates[t]) {
+            stream.push_back(row);
+            for (double& x : stream.back()) x += 1 + noise(fixture.random);
+        }
+    }
+
+    UINT compared = 0;
+    for (UINT i = 0; i < stream.size(); i++) {
+        VectorDouble sample = stream[i];
+        ASSERT_TRUE(dtw.predict_(sample));
+        if (i + 1 < 30) continue;  // the longest template
+
+        Series seen(stream.begin(), stream.begin() + i + 1);
+        std::vector<double> expected = fixture.classDistances(seen, true);
+        VectorDouble distances = dtw.getClassDistances();
+        ASSERT_EQ(3, distances.size()) << "after " << i << " samples";
+        for (UINT c = 0; c < 3; c++) {
+            ASSERT_NEAR(expected[c], distances[c], 1e-3 * expected[c] + 1e-4)
+                << "class " << c + 1 << " after " << i << " samples";
+        }
+        ASSERT_EQ(nearestLabel(expected), dtw.getPredictedClassLabel());
+        compared++;
+    }
+    EXPECT_GT(compared, 100);
+}
+
+TEST(PrunedDTWTest, TimeSeriesMatchesPlainDtw) {
+    Fixture fixture;
+    PrunedDTW dtw(false, false, 3.0, kBandWidth);
+    ASSERT_TRUE(dtw.train_(fixture.data));
+
+    for (UINT length : {5, 12, 25, 40}) {
+        Series series = fixture.randomWalk(length);
+        MatrixDouble input(length, kDimensions);
+        for (UINT i = 0; i < length; i++) {
+            for (UINT k = 0; k < kDimensions; k++) input[i][k] = series[i][k];
+        }
+        ASSERT_TRUE(dtw.predict_(input));
+
+        std::vector<double> expected = fixture.classDistances(series, false);
+        VectorDouble distances = dtw.getClassDistances();
+        ASSERT_EQ(3, distances.size());
+        for (UINT c = 0; c < 3; c++) {
+            EXPECT_NEAR(expected[c], distances[c], 1e-3 * expected[c] + 1e-4)
+                << "class " << c + 1 << ", length " << length;
+        }
+        EXPECT_EQ(nearestLabel(expected), dtw.getPredictedClassLabel());
+    }
+}
+
+TEST(PrunedDTWTest, ReportsNoDistancesUntilEveryClassIsCompared) {
+    Fixture fixture;
+    PrunedDTW dtw(false, true, 3.0, kBandWidth);
+    ASSERT_TRUE(dtw.train_(fixture.data));
+
+    VectorDouble sample(kDimensions, 0);
+    ASSERT_TRUE(dtw.predict_(sample));
+    EXPECT_TRUE(dtw.getClassDistances().empty());
+    for (UINT i = 0; i < 30; i++) ASSERT_TRUE(dtw.predict_(sample));
+    VectorDouble distances = dtw.getClassDistances();
+    ASSERT_EQ(3, distances.size());
+    for (double d : distances) EXPECT_LT(d, 1e10);
+}
+
+TEST(PrunedDTWTest, MapsDistancesToTheNullRejectionCoefficient) {
+    Fixture fixture;
+    PrunedDTW dtw(false, true, 2.0, kBandWidth);
+    ASSERT_TRUE(dtw.train_(fixture.data));
+    ASSERT_TRUE(dtw.getSupportsClassDistanceToNullRejectionCoefficient());
+
+    // A class's threshold is exactly nullRejectionCoeff deviations away.
+    VectorDouble thresholds = dtw.getNullRejectionThresholds();
+    for (UINT label = 1; label <= 3; label++) {
+        EXPECT_NEAR(2.0, dtw.classDistanceToNullRejectionCoefficient(
+                             label, thresholds[label - 1]),
+                    1e-9);
+    }
+}
@@ -0,0 +1,632 @@
+#include "PrunedDTW.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+
+#include "grt-util.h"
+#include "simd.h"
+
+using namespace grt_util;
+
+namespace GRT {
+
+RegisterClassifierModule<PrunedDTW> PrunedDTW::registerModule("PrunedDTW");
+
+namespace {
+
+const char kFileHeader[] = "GRT_PRUNED_DTW_MODEL_FILE_V1.0";
+const float kInfinity = std::numeric_limits<float>::infinity();
+
+inline float squaredDistance(const float* a, const float* b, UINT n) {
+    float sum = 0;
+    for (UINT k = 0; k < n; k++) {
+        float d = a[k] - b[k];
+        sum += d * d;
+    }
+    return sum;
+}
+
+}  // namespace
+
+PrunedDTW::PrunedDTW(bool useScaling, bool useNullRejection,
+                     double nullRejectionCoeff, double bandWidth)
+        : bandWidth_(bandWidth), trimTrainingData_(false), trimThreshold_(0.1),
+          maximumTrimPercentage_(90), maxTemplateLength_(0),
+          minTemplateLength_(0), streamPosition_(0), streamLength_(0) {
+    this->useScaling = useScaling;
+    this->useNullRejection = useNullRejection;
+    this->nullRejectionCoeff = nullRejectionCoeff;
+    supportsNullRejection = true;
+    supportsClassDistanceToNullRejectionCoefficient = true;
+    classType = "PrunedDTW";
+    classifierType = classType;
+    classifierMode = TIMESERIES_CLASSIFIER_MODE;
+    debugLog.setProceedingText("[DEBUG PrunedDTW]");
+    errorLog.setProceedingText("[ERROR PrunedDTW]");
+    trainingLog.setProceedingText("[TRAINING PrunedDTW]");
+    warningLog.setProceedingText("[WARNING PrunedDTW]");
+}
+
+PrunedDTW::PrunedDTW(const PrunedDTW& rhs)
+        : maxTemplateLength_(0), minTemplateLength_(0), streamPosition_(0),
+          streamLength_(0) {
+    supportsNullRejection = true;
+    supportsClassDistanceToNullRejectionCoefficient = true;
+    classType = "PrunedDTW";
+    classifierType = classType;
+    classifierMode = TIMESERIES_CLASSIFIER_MODE;
+    debugLog.setProceedingText("[DEBUG PrunedDTW]");
+    errorLog.setProceedingText("[ERROR PrunedDTW]");
+    trainingLog.setProceedingText("[TRAINING PrunedDTW]");
+    warningLog.setProceedingText("[WARNING PrunedDTW]");
+
+    *this = rhs;
+}
+
+PrunedDTW& PrunedDTW::operator=(const PrunedDTW& rhs) {
+    if (this != &rhs) {
+        this->bandWidth_ = rhs.bandWidth_;
+        this->trimTrainingData_ = rhs.trimTrainingData_;
+        this->trimThreshold_ = rhs.trimThreshold_;
+        this->maximumTrimPercentage_ = rhs.maximumTrimPercentage_;
+        this->templates_ = rhs.templates_;
+        this->maxTemplateLength_ = rhs.maxTemplateLength_;
+        this->minTemplateLength_ = rhs.minTemplateLength_;
+        this->trainingMu_ = rhs.trainingMu_;
+        this->trainingSigma_ = rhs.trainingSigma_;
+        this->stream_ = rhs.stream_;
+        this->streamPosition_ = rhs.streamPosition_;
+        this->streamLength_ = rhs.streamLength_;
+        copyBaseVariables((Classifier*)&rhs);
+    }
+    return *this;
+}
+
+bool PrunedDTW::deepCopyFrom(const Classifier* classifier) {
+    if (classifier == nullptr) {
+        return false;
+    }
+
+    if (this->getClassifierType() == classifier->getClassifierType()) {
+        *this = *(PrunedDTW*)classifier;
+        return true;
+    }
+
+    errorLog << "deepCopyFrom(const Classifier *classifier)"
+             << " - Classifier Types Do Not Match!" << std::endl;
+    return false;
+}
+
+bool PrunedDTW::enableTrimTrainingData(bool trimTrainingData,
+                                       double trimThreshold,
+                                       double maximumTrimPercentage) {
+    if (trimThreshold < 0 || trimThreshold > 1) {
+        warningLog << "enableTrimTrainingData(...) - The trim threshold must "
+                   << "be in the range of [0 1]" << std::endl;
+        return false;
+    }
+    if (maximumTrimPercentage < 0 || maximumTrimPercentage > 100) {
+        warningLog << "enableTrimTrainingData(...) - The maximum trim "
+                   << "percentage must be in the range of [0 100]" << std::endl;
+        return false;
+    }
+    trimTrainingData_ = trimTrainingData;
+    trimThreshold_ = trimThreshold;
+    maximumTrimPercentage_ = maximumTrimPercentage;
+    return true;
+}
+
+bool PrunedDTW::setBandWidth(double bandWidth) {
+    if (bandWidth <= 0) {
+        warningLog << "setBandWidth(double bandWidth) - The band width must "
+                   << "be greater than 0" << std::endl;
+        return false;
+    }
+    bandWidth_ = bandWidth;
+    // The envelopes depend on the band.
+    for (Template& t : templates_) prepareTemplate(t);
+    return true;
+}
+
+MatrixDouble PrunedDTW::trimSample(const MatrixDouble& sample) const {
+    const UINT rows = sample.getNumRows();
+    const UINT cols = sample.getNumCols();
+    if (rows < 3) return sample;
+
+    // How much each row moved from the previous one.
+    vector<double> movement(rows, 0);
+    double maxMovement = 0;
+    for (UINT i = 1; i < rows; i++) {
+        for (UINT j = 0; j < cols; j++) {
+            movement[i] += std::fabs(sample[i][j] - sample[i - 1][j]);
+        }
+        maxMovement = std::max(maxMovement, movement[i]);
+    }
+    if (maxMovement == 0) return sample;
+
+    UINT start = 1;
+    while (start < rows && movement[start] / maxMovement < trimThreshold_) {
+        start++;
+    }
+    UINT end = rows;
+    while (end > start && movement[end - 1] / maxMovement < trimThreshold_) {
+        end--;
+    }
+    // The row before the first movement is where the movement starts from.
+    start--;
+
+    const UINT kept = end - start;
+    if (kept < 2 ||
+        100.0 * (rows - kept) / rows > maximumTrimPercentage_) {
+        return sample;
+    }
+
+    MatrixDouble trimmed(kept, cols);
+    for (UINT i = 0; i < kept; i++) {
+        for (UINT j = 0; j < cols; j++) trimmed[i][j] = sample[start + i][j];
+    }
+    return trimmed;
+}
+
+void PrunedDTW::prepareTemplate(Template& t) const {
+    const UINT D = numInputDimensions;
+    const UINT L = t.length;
+
+    double band = std::round(bandWidth_ * L);
+    t.band = band >= L ? L : std::max<UINT>(1, static_cast<UINT>(band));
+
+    t.lower.resize(t.data.size());
+    t.upper.resize(t.data.size());
+    for (UINT i = 0; i < L; i++) {
+        const UINT first = i > t.band ? i - t.band : 0;
+        const UINT last = std::min(L - 1, i + t.band);
+        for (UINT k = 0; k < D; k++) {
+            float lo = t.data[first * D + k];
+            float hi = lo;
+            for (UINT j = first + 1; j <= last; j++) {
+                lo = std::min(lo, t.data[j * D + k]);
+                hi = std::max(hi, t.data[j * D + k]);
+            }
+            t.lower[i * D + k] = lo;
+            t.upper[i * D + k] = hi;
+        }
+    }
+}
+
+float PrunedDTW::dtw(const float* a, UINT n, const float* b, UINT m,
+                     UINT band, float cutoff) {
+    const UINT D = numInputDimensions;
+
+    // Row i may only visit the columns within band of its point on the
+    // diagonal from (0, 0) to (n - 1, m - 1). When the lengths differ, the
+    // band is widened to the slope so that consecutive rows stay connected.
+    const double slope = n > 1 ? double(m - 1) / (n - 1) : 0;
+    const double width = n > 1 ? std::max<double>(band, std::ceil(slope)) : m;
+
+    previousRow_.resize(m);
+    currentRow_.resize(m);
+    float* previous = previousRow_.data();
+    float* current = currentRow_.data();
+
+    UINT previousFirst = 0;
+    UINT previousLast = 0;
+    for (UINT i = 0; i < n; i++) {
+        const double center = i * slope;
+        const UINT first = static_cast<UINT>(std::max(0.0,
+                                                      std::ceil(center - width)));
+        const UINT last = static_cast<UINT>(std::min<double>(
+            m - 1, std::floor(center + width)));
+
+        float rowMin = kInfinity;
+        for (UINT j = first; j <= last; j++) {
+            float best;
+            if (i == 0 && j == 0) {
+                best = 0;
+            } else {
+                best = kInfinity;
+                if (i > 0 && j >= previousFirst && j <= previousLast) {
+                    best = previous[j];
+                }
+                if (i > 0 && j > previousFirst && j - 1 <= previousLast) {
+                    best = std::min(best, previous[j - 1]);
+                }
+                if (j > first) best = std::min(best, current[j - 1]);
+            }
+            current[j] = best + squaredDistance(a + i * D, b + j * D, D);
+            rowMin = std::min(rowMin, current[j]);
+        }
+        // Every path goes through this row and costs only add up.
+        if (rowMin >= cutoff) return kInfinity;
+
+        std::swap(previous, current);
+        previousFirst = first;
+        previousLast = last;
+    }
+    return previous[m - 1];
+}
+
+bool PrunedDTW::train_(TimeSeriesClassificationData& trainingData) {
+    clear();
+
+    if (trainingData.getNumSamples() == 0) {
+        errorLog << "train_(TimeSeriesClassificationData &trainingData) - "
+                 << "Can't train model as there are no samples in training data!"
+                 << std::endl;
+        return false;
+    }
+
+    numInputDimensions = trainingData.getNumDimensions();
+    numClasses = trainingData.getNumClasses();
+    classLabels = trainingData.getClassLabels();
+    ranges = trainingData.getRanges();
+    const UINT D = numInputDimensions;
+
+    for (UINT i = 0; i < trainingData.getNumSamples(); i++) {
+        MatrixDouble sample = trainingData[i].getData();
+        if (trimTrainingData_) sample = trimSample(sample);
+        if (sample.getNumRows() == 0) continue;
+
+        Template t;
+        t.classIndex = std::find(classLabels.begin(), classLabels.end(),
+                                 trainingData[i].getClassLabel()) -
+                       classLabels.begin();
+        t.length = sample.getNumRows();
+        t.data.resize(t.length * D);
+        for (UINT r = 0; r < t.length; r++) {
+            for (UINT k = 0; k < D; k++) {
+                double x = sample[r][k];
+                if (useScaling) {
+                    x = scale(x, ranges[k].minValue, ranges[k].maxValue, 0, 1);
+                }
+                t.data[r * D + k] = x;
+            }
+        }
+        prepareTemplate(t);
+        templates_.push_back(std::move(t));
+    }
+
+    // Every class needs a template, or it could never be compared.
+    for (UINT c = 0; c < numClasses; c++) {
+        bool found = false;
+        for (const Template& t : templates_) found = found || t.classIndex == c;
+        if (!found) {
+            errorLog << "train_(TimeSeriesClassificationData &trainingData) - "
+                     << "Class " << classLabels[c] << " has no samples with "
+                     << "any data!" << std::endl;
+            clear();
+            return false;
+        }
+    }
+
+    // Whole templates are compared as in predict_(MatrixDouble&), normalized
+    // by the longer one.
+    vector<UINT> classIndex;
+    for (const Template& t : templates_) classIndex.push_back(t.classIndex);
+    learnNearestTemplateStatistics(
+        numClasses, classIndex,
+        [this](UINT i, UINT j, double best) -> double {
+            const Template& a = templates_[i];
+            const Template& b = templates_[j];
+            const UINT normalizer = std::max(a.length, b.length);
+            float cost = dtw(a.data.data(), a.length, b.data.data(), b.length,
+                             std::max(a.band, b.band),
+                             static_cast<float>(best) * normalizer);
+            return cost / normalizer;
+        },
+        trainingMu_, trainingSigma_);
+
+    updateTemplateLengths();
+    trained = true;
+    recomputeNullRejectionThresholds();
+    reset();
+
+    trainingLog << "Trained " << templates_.size() << " templates, "
+                << minTemplateLength_ << " to " << maxTemplateLength_
+                << " samples long." << std::endl;
+    return true;
+}
+
+bool PrunedDTW::predict_(VectorDouble& inputVector) {
+    if (!trained) {
+        errorLog << "predict_(VectorDouble &inputVector) - The model has not "
+                 << "been trained!" << std::endl;
+        return false;
+    }
+    if (inputVector.size() != numInputDimensions) {
+        errorLog << "predict_(VectorDouble &inputVector) - The size of the "
+                 << "input vector (" << inputVector.size() << ") does not "
+                 << "match the num features in the model ("
+                 << numInputDimensions << std::endl;
+        return false;
+    }
+
+    pushSample(inputVector);
+
+    const UINT D = numInputDimensions;
+    const UINT capacity = maxTemplateLength_;
+    const float* tail =
+        stream_.data() + (streamPosition_ + capacity - streamLength_) * D;
+    searchTemplates(tail, streamLength_, true);
+    return true;
+}
+
+bool PrunedDTW::predict_(MatrixDouble& inputTimeSeries) {
+    if (!trained) {
+        errorLog << "predict_(MatrixDouble &inputTimeSeries) - The model has "
+                 << "not been trained!" << std::endl;
+        return false;
+    }
+    if (inputTimeSeries.getNumCols() != numInputDimensions) {
+        errorLog << "predict_(MatrixDouble &inputTimeSeries) - The number of "
+                 << "columns in the input time series ("
+                 << inputTimeSeries.getNumCols() << ") does not match the "
+                 << "num features in the model (" << numInputDimensions
+                 << std::endl;
+        return false;
+    }
+
+    const UINT D = numInputDimensions;
+    const UINT n = inputTimeSeries.getNumRows();
+    if (n == 0) {
+        errorLog << "predict_(MatrixDouble &inputTimeSeries) - The input "
+                 << "time series is empty!" << std::endl;
+        return false;
+    }
+    input_.resize(n * D);
+    for (UINT i = 0; i < n; i++) {
+        for (UINT k = 0; k < D; k++) {
+            double x = inputTimeSeries[i][k];
+            if (useScaling) {
+                x = scale(x, ranges[k].minValue, ranges[k].maxValue, 0, 1);
+            }
+            input_[i * D + k] = x;
+        }
+    }
+    searchTemplates(input_.data(), n, false);
+    return true;
+}
+
+void PrunedDTW::pushSample(const VectorDouble& sample) {
+    const UINT D = numInputDimensions;
+    const UINT capacity = maxTemplateLength_;
+    float* first = stream_.data() + streamPosition_ * D;
+    float* second = first + capacity * D;
+    for (UINT k = 0; k < D; k++) {
+        double x = sample[k];
+        if (useScaling) {
+            x = scale(x, ranges[k].minValue, ranges[k].maxValue, 0, 1);
+        }
+        first[k] = second[k] = x;
+    }
+    streamPosition_ = (streamPosition_ + 1) % capacity;
+    streamLength_ = std::min(streamLength_ + 1, capacity);
+}
+
+void PrunedDTW::searchTemplates(const float* series, UINT length,
+                                bool matchEnd) {
+    const UINT D = numInputDimensions;
+
+    // LB_Kim, normalized like the distances, for every template that can be
+    // compared.
+    candidates_.clear();
+    for (UINT i = 0; i < templates_.size(); i++) {
+        const Template& t = templates_[i];
+        if (matchEnd && t.length > length) continue;
+        const UINT n = matchEnd ? t.length : length;
+        const float* x = series + (length - n) * D;
+        float bound = squaredDistance(x, t.data.data(), D);
+        if (n > 1 && t.length > 1) {
+            bound += squaredDistance(x + (n - 1) * D,
+                                     t.data.data() + (t.length - 1) * D, D);
+        }
+        candidates_.push_back(
+            std::make_pair(bound / std::max(n, t.length), i));
+    }
+    std::sort(candidates_.begin(), candidates_.end());
+
+    // The normalized cost of the nearest template of each class.
+    classBest_.assign(numClasses, kInfinity);
+    for (const std::pair<float, UINT>& candidate : candidates_) {
+        const Template& t = templates_[candidate.second];
+        float& best = classBest_[t.classIndex];
+        if (candidate.first >= best) continue;
+
+        const UINT n = matchEnd ? t.length : length;
+        const UINT normalizer = std::max(n, t.length);
+        const float* x = series + (length - n) * D;
+        const float cutoff = best * normalizer;
+        if (n == t.length &&
+            simd::envelopeDistance(x, t.lower.data(), t.upper.data(), n * D,
+                                   cutoff) >= cutoff) {
+            continue;
+        }
+        float cost = dtw(x, n, t.data.data(), t.length, t.band, cutoff);
+        if (cost < cutoff) best = cost / normalizer;
+    }
+
+    bool compared = true;
+    classDistances.assign(numClasses, std::numeric_limits<double>::max());
+    for (UINT c = 0; c < numClasses; c++) {
+        if (classBest_[c] != kInfinity) {
+            classDistances[c] = std::sqrt(classBest_[c]);
+        } else {
+            compared = false;
+        }
+    }
+    const UINT bestIndex = computeClassLikelihoods(classDistances,
+                                                   classLikelihoods);
+    predictedClassLabel = GRT_DEFAULT_NULL_CLASS_LABEL;
+    maxLikelihood = 0;
+    bestDistance = std::numeric_limits<double>::max();
+    if (bestIndex < numClasses) {
+        bestDistance = classDistances[bestIndex];
+        maxLikelihood = classLikelihoods[bestIndex];
+        if (!useNullRejection ||
+            bestDistance <= nullRejectionThresholds[bestIndex]) {
+            predictedClassLabel = classLabels[bestIndex];
+        }
+    }
+
+    // Until the stream is long enough, don't report distances that only mean
+    // "not compared yet", as they would be plotted.
+    if (!compared) classDistances.clear();
+}
+
+bool PrunedDTW::recomputeNullRejectionThresholds() {
+    if (!trained) return false;
+
+    computeNullRejectionThresholds(trainingMu_, trainingSigma_,
+                                   nullRejectionCoeff, nullRejectionThresholds);
+    return true;
+}
+
+double PrunedDTW::classDistanceToNullRejectionCoefficient(
+    UINT classLabel, double classDistance) {
+    const UINT c = std::find(classLabels.begin(), classLabels.end(),
+                             classLabel) - classLabels.begin();
+    if (c >= trainingSigma_.size() || trainingSigma_[c] < 0) {
+        // There is no threshold: nothing is rejected.
+        return 0;
+    }
+    if (trainingSigma_[c] == 0) {
+        return classDistance <= trainingMu_[c]
+                   ? 0
+                   : std::numeric_limits<double>::max();
+    }
+    return (classDistance - trainingMu_[c]) / trainingSigma_[c];
+}
+
+bool PrunedDTW::reset() {
+    Classifier::reset();
+
+    const UINT D = numInputDimensions;
+    stream_.assign(2 * maxTemplateLength_ * D, 0);
+    streamPosition_ = 0;
+    streamLength_ = 0;
+    return true;
+}
+
+bool PrunedDTW::clear() {
+    Classifier::clear();
+
+    templates_.clear();
+    maxTemplateLength_ = 0;
+    minTemplateLength_ = 0;
+    trainingMu_.clear();
+    trainingSigma_.clear();
+    stream_.clear();
+    streamPosition_ = 0;
+    streamLength_ = 0;
+    return true;
+}
+
+void PrunedDTW::updateTemplateLengths() {
+    maxTemplateLength_ = 0;
+    minTemplateLength_ = templates_.empty() ? 0 : templates_[0].length;
+    for (const Template& t : templates_) {
+        maxTemplateLength_ = std::max(maxTemplateLength_, t.length);
+        minTemplateLength_ = std::min(minTemplateLength_, t.length);
+    }
+}
+
+bool PrunedDTW::saveModelToFile(fstream& file) const {
+    if (!file.is_open()) {
+        errorLog << "saveModelToFile(fstream &file) - The file is not open!"
+                 << std::endl;
+        return false;
+    }
+
+    file << kFileHeader << std::endl;
+
+    if (!saveBaseSettingsToFile(file)) {
+        errorLog << "saveModelToFile(fstream &file) - Failed to save the base "
+                 << "settings to file!" << std::endl;
+        return false;
+    }
+
+    file << "BandWidth: " << bandWidth_ << std::endl;
+    file << "TrimTrainingData: " << trimTrainingData_ << std::endl;
+    file << "TrimThreshold: " << trimThreshold_ << std::endl;
+    file << "MaximumTrimPercentage: " << maximumTrimPercentage_ << std::endl;
+
+    if (!trained) return true;
+
+    // Enough digits for the floats and doubles to read back the same.
+    const std::streamsize precision = file.precision(17);
+    file << "NumTemplates: " << templates_.size() << std::endl;
+    for (const Template& t : templates_) {
+        saveTemplate(file, t.classIndex, t.length, numInputDimensions, t.data);
+    }
+    saveTrainingStatistics(file, trainingMu_, trainingSigma_);
+    file.precision(precision);
+
+    return true;
+}
+
+bool PrunedDTW::loadModelFromFile(fstream& file) {
+    clear();
+
+    if (!file.is_open()) {
+        errorLog << "loadModelFromFile(fstream &file) - The file is not open!"
+                 << std::endl;
+        return false;
+    }
+
+    string word;
+    file >> word;
+    if (word != kFileHeader) {
+        errorLog << "loadModelFromFile(fstream &file) - Invalid file format!"
+                 << std::endl;
+        return false;
+    }
+
+    if (!loadBaseSettingsFromFile(file)) {
+        errorLog << "loadModelFromFile(fstream &file) - Failed to load the "
+                 << "base settings from file!" << std::endl;
+        return false;
+    }
+
+    if (!readValue(file, "BandWidth:", bandWidth_) ||
+        !readValue(file, "TrimTrainingData:", trimTrainingData_) ||
+        !readValue(file, "TrimThreshold:", trimThreshold_) ||
+        !readValue(file, "MaximumTrimPercentage:", maximumTrimPercentage_)) {
+        errorLog << "loadModelFromFile(fstream &file) - Failed to read the "
+                 << "settings!" << std::endl;
+        return false;
+    }
+
+    if (!trained) return true;
+
+    UINT numTemplates;
+    if (!readValue(file, "NumTemplates:", numTemplates)) {
+        errorLog << "loadModelFromFile(fstream &file) - Failed to read "
+                 << "NumTemplates!" << std::endl;
+        return false;
+    }
+    templates_.resize(numTemplates);
+    for (Template& t : templates_) {
+        if (!loadTemplate(file, numClasses, numInputDimensions, t.classIndex,
+                          t.length, t.data)) {
+            errorLog << "loadModelFromFile(fstream &file) - Failed to read a "
+                     << "template!" << std::endl;
+            return false;
+        }
+        prepareTemplate(t);
+    }
+
+    if (!loadTrainingStatistics(file, numClasses, trainingMu_,
+                                trainingSigma_)) {
+        errorLog << "loadModelFromFile(fstream &file) - Failed to read the "
+                 << "training statistics!" << std::endl;
+        return false;
+    }
+
+    updateTemplateLengths();
+    recomputeNullRejectionThresholds();
+    reset();
+    return true;
+}
+
+} // namespace GRT
@@ -0,0 +1,180 @@
+#ifndef ESP_PRUNED_DTW_H_
+#define ESP_PRUNED_DTW_H_
+
+#include "GRT/CoreModules/Classifier.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace GRT {
+
+using std::vector;
+
+/* @brief PrunedDTW is a nearest-neighbour dynamic time warping classifier for
+ * streaming data, built to scale to hundreds of templates. It can replace
+ * GRT::DTW in a pipeline:
+ *
+ *    GRT::PrunedDTW dtw(false, true, null_rej);
+ *    dtw.enableTrimTrainingData(true, 0.1, 75);
+ *    pipeline.setClassifier(dtw);
+ *
+ * Every training sample is kept as a template. On each input sample, each
+ * template is compared with the last template-length samples of the stream,
+ * and the distance to a class is the distance to its nearest template. Most
+ * templates never get a full DTW:
+ *
+ *  - Templates are visited in order of LB_Kim (the distance between the first
+ *    and between the last samples, which every warping path includes), and a
+ *    class stops as soon as LB_Kim reaches its best distance so far.
+ *  - LB_Keogh (the distance of the stream to the template's envelope over the
+ *    warping band) is computed with a SIMD kernel (see simd.h) that stops
+ *    once it reaches the class's best distance.
+ *  - The DTW itself is restricted to a Sakoe-Chiba band of band_width times
+ *    the template length and abandoned once a whole row of the cost matrix
+ *    exceeds the class's best distance.
+ *
+ * All three are exact: the class distances are the same as those of a full
+ * banded DTW against every template. The cost between two samples is their
+ * squared Euclidean distance, and a template's distance is the square root
+ * of the path cost divided by the longer of the two lengths, so that
+ * templates of different lengths are comparable.
+ *
+ * With null rejection, the threshold of each class is the mean plus
+ * nullRejectionCoeff standard deviations of the distance from each of its
+ * templates to the nearest other template of the class. Classes with a single
+ * template use the average of the other classes; if no class has two
+ * templates, nothing is rejected. Like GRT::DTW, it can express a class
+ * distance in those standard deviations (see
+ * classDistanceToNullRejectionCoefficient()), which ESP plots against the
+ * coefficient.
+ *
+ * [1] Rakthanmanon, T., et al., 2012. Searching and mining trillions of time
+ *     series subsequences under dynamic time warping. KDD '12.
+ */
+class PrunedDTW : public Classifier {
+  public:
+    PrunedDTW(bool useScaling = false, bool useNullRejection = false,
+              double nullRejectionCoeff = 3.0, double bandWidth = 0.2);
+
+    PrunedDTW(const PrunedDTW& rhs);
+    PrunedDTW& operator=(const PrunedDTW& rhs);
+    bool deepCopyFrom(const Classifier* classifier) override;
+    ~PrunedDTW() override {}
+
+    bool train_(TimeSeriesClassificationData& trainingData) override;
+
+    // Adds a sample to the stream and classifies the end of the stream.
+    bool predict_(VectorDouble& inputVector) override;
+
+    // Classifies a whole time series: unlike the stream, it is warped onto
+    // each whole template. The stream is left as is.
+    bool predict_(MatrixDouble& inputTimeSeries) override;
+
+    // Clears the stream but keeps the templates.
+    bool reset() override;
+    bool clear() override;
+
+    bool saveModelToFile(fstream& file) const override;
+    bool loadModelFromFile(fstream& file) override;
+
+    bool recomputeNullRejectionThresholds() override;
+
+    // How many standard deviations classDistance is above the mean distance
+    // between the templates of the class, which is compared with
+    // nullRejectionCoeff to reject it.
+    double classDistanceToNullRejectionCoefficient(
+        UINT classLabel, double classDistance) override;
+
+    /**
+     Trim the start and end of each training sample where there is little
+     movement, like GRT::DTW::enableTrimTrainingData().
+
+     @param trimThreshold: rows whose movement (summed absolute change from
+     the previous row, relative to the largest in the sample) is below this
+     are trimmed.
+     @param maximumTrimPercentage: samples that would lose more than this
+     percentage of their rows are kept whole.
+     */
+    bool enableTrimTrainingData(bool trimTrainingData, double trimThreshold,
+                                double maximumTrimPercentage);
+
+    // The Sakoe-Chiba band, as a fraction of the template length. 1 or more
+    // means no constraint.
+    bool setBandWidth(double bandWidth);
+    double getBandWidth() const { return bandWidth_; }
+
+    UINT getNumTemplates() const { return templates_.size(); }
+
+    using MLBase::saveModelToFile;
+    using MLBase::loadModelFromFile;
+    using MLBase::train;
+    using MLBase::train_;
+    using MLBase::predict;
+    using MLBase::predict_;
+
+  protected:
+    struct Template {
+        UINT classIndex;
+        UINT length;
+        UINT band;
+        vector<float> data;   // length x numInputDimensions, row-major
+        vector<float> lower;  // the envelope of data over the band
+        vector<float> upper;
+    };
+
+    // Rebuilds the band and envelope of t from its data.
+    void prepareTemplate(Template& t) const;
+
+    // Squared-distance DTW cost between a (n rows) and b (m rows) within a
+    // band of `band` rows around the diagonal. Returns infinity once a whole
+    // row exceeds cutoff.
+    float dtw(const float* a, UINT n, const float* b, UINT m, UINT band,
+              float cutoff);
+
+    // Adds a (scaled) sample to the stream.
+    void pushSample(const VectorDouble& sample);
+
+    // Finds the nearest template of each class to series (length rows) and
+    // sets the prediction. With matchEnd, each template is compared with the
+    // last template-length rows of series. While some class has no template
+    // that short, classDistances is left empty.
+    void searchTemplates(const float* series, UINT length, bool matchEnd);
+
+    void updateTemplateLengths();
+
+    // Removes the still start and end of a training sample.
+    MatrixDouble trimSample(const MatrixDouble& sample) const;
+
+    double bandWidth_;
+    bool trimTrainingData_;
+    double trimThreshold_;
+    double maximumTrimPercentage_;
+
+    vector<Template> templates_;
+    UINT maxTemplateLength_;
+    UINT minTemplateLength_;
+
+    // Per class: the mean and standard deviation of the distance from each
+    // template to the nearest other template of the class.
+    VectorDouble trainingMu_;
+    VectorDouble trainingSigma_;
+
+    // The stream is written twice, at i and i + capacity, so that its last
+    // samples are always contiguous.
+    vector<float> stream_;
+    UINT streamPosition_;
+    UINT streamLength_;
+
+    // Scratch.
+    vector<float> input_;
+    vector<float> previousRow_;
+    vector<float> currentRow_;
+    vector<float> classBest_;
+    vector<std::pair<float, UINT>> candidates_;
+
+    static RegisterClassifierModule<PrunedDTW> registerModule;
+};
+
+} // namespace GRT
+
+#endif // ESP_PRUNED_DTW_H_
@@ -0,0 +1,157 @@
+#include "SpringDTW.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace GRT;
+
+namespace {
+
+const UINT kDimensions = 2;
+const uint64_t kGestureStart = 150;
+const UINT kGestureLength = 21;
+
+struct Fixture {
+    std::mt19937 random{11};
+    std::normal_distribution<double> noise{0, 0.05};
+    TimeSeriesClassificationData data{kDimensions};
+
+    // Class 1 goes from (1, 0) to (2, 0) around a sine, class 2 from (-1, 1)
+    // to (-2, -1); both are far from the noise around (0, 0), so a match has
+    // clear ends.
+    std::vector<double> gesture(UINT label, double t) {
+        if (label == 1) return {1 + t, sin(2 * PI * t)};
+        return {-1 - t, cos(PI * t)};
+    }
+
+    MatrixDouble sample(UINT label, UINT length, double jitter) {
+        MatrixDouble m(length, kDimensions);
+        for (UINT i = 0; i < length; i++) {
+            std::vector<double> x = gesture(label, i / double(length - 1));
+            for (UINT k = 0; k < kDimensions; k++) {
+                m[i][k] = x[k] + jitter * noise(random);
+            }
+        }
+        return m;
+    }
+
+    Fixture() {
+        for (UINT label = 1; label <= 2; label++) {
+            for (UINT length : {18, 20, 23, 25}) {
+                data.addSample(label, sample(label, length, 0.5));
+            }
+        }
+    }
+
+    // Noise, with a gesture of label (if any) from kGestureStart, whose
+    // points are pushed off the template by offset.
+    MatrixDouble stream(UINT label, double offset = 0) {
+        MatrixDouble m(2 * kGestureStart + kGestureLength, kDimensions);
+        MatrixDouble g = sample(label == 0 ? 1 : label, kGestureLength, 0.2);
+        for (UINT i = 0; i < m.getNumRows(); i++) {
+            for (UINT k = 0; k < kDimensions; k++) {
+                const bool inGesture = label != 0 && i >= kGestureStart &&
+                                       i < kGestureStart + kGestureLength;
+                m[i][k] = inGesture ? g[i - kGestureStart][k] + offset
+                                    : noise(random);
+            }
+        }
+        return m;
+    }
+};
+
+// Streams the rows of series one by one and collects every match.
+std::vector<SpringDTW::Match> spot(SpringDTW& dtw, MatrixDouble& series) {
+    std::vector<SpringDTW::Match> matches;
+    dtw.reset();
+    for (UINT i = 0; i < series.getNumRows(); i++) {
+        VectorDouble x(series[i], series[i] + kDimensions);
+        EXPECT_TRUE(dtw.predict_(x));
+        matches.insert(matches.end(), dtw.getMatches().begin(),
+                       dtw.getMatches().end());
+    }
+    return matches;
+}
+
+}  // namespace
+
+TEST(SpringDTWTest, ReportsTheStartAndEndOfAGestureInNoise) {
+    Fixture fixture;
+    SpringDTW dtw;
+    ASSERT_TRUE(dtw.train_(fixture.data));
+
+    for (UINT label = 1; label <= 2; label++) {
+        MatrixDouble stream = fixture.stream(label);
+        std::vector<SpringDTW::Match> matches = spot(dtw, stream);
+        ASSERT_EQ(1, matches.size()) << "class " << label;
+        EXPECT_EQ(label, matches[0].classLabel);
+        EXPECT_EQ(kGestureStart, matches[0].start);
+        EXPECT_EQ(kGestureStart + kGestureLength - 1, matches[0].end);
+        EXPECT_LE(matches[0].distance,
+                  dtw.getNullRejectionThresholds()[label - 1]);
+
+        // The whole series at once finds the same match.
+        ASSERT_TRUE(dtw.predict_(stream));
+        ASSERT_EQ(1, dtw.getMatches().size());
+        EXPECT_EQ(kGestureStart, dtw.getMatches()[0].start);
+        EXPECT_EQ(label, dtw.getPredictedClassLabel());
+    }
+}
+
+TEST(SpringDTWTest, RejectsMatchesAboveTheClassThreshold) {
+    Fixture fixture;
+    SpringDTW dtw;
+    ASSERT_TRUE(dtw.train_(fixture.data));
+
+    // The distance of a gesture pushed away from the templates.
+    MatrixDouble stream = fixture.stream(1, 0.3);
+    dtw.enableNullRejection(false);
+    double distance = 1e9;
+    for (const SpringDTW::Match& match : spot(dtw, stream)) {
+        if (match.start >= kGestureStart - 2 &&
+            match.end <= kGestureStart + kGestureLength + 2) {
+            distance = std::min(distance, match.distance);
+        }
+    }
+    ASSERT_LT(distance, 1);
+    dtw.enableNullRejection(true);
+
+    // Set the class threshold just above, then just below that distance.
+    ASSERT_TRUE(dtw.setNullRejectionCoeff(0));
+    ASSERT_TRUE(dtw.recomputeNullRejectionThresholds());
+    const double mu = dtw.getNullRejectionThresholds()[0];
+    ASSERT_TRUE(dtw.setNullRejectionCoeff(1));
+    ASSERT_TRUE(dtw.recomputeNullRejectionThresholds());
+    const double sigma = dtw.getNullRejectionThresholds()[0] - mu;
+    ASSERT_GT(sigma, 0);
+
+    ASSERT_TRUE(dtw.setNullRejectionCoeff((distance * 1.01 - mu) / sigma));
+    ASSERT_TRUE(dtw.recomputeNullRejectionThresholds());
+    std::vector<SpringDTW::Match> matches = spot(dtw, stream);
+    ASSERT_EQ(1, matches.size());
+    EXPECT_DOUBLE_EQ(distance, matches[0].distance);
+
+    ASSERT_TRUE(dtw.setNullRejectionCoeff((distance * 0.99 - mu) / sigma));
+    ASSERT_TRUE(dtw.recomputeNullRejectionThresholds());
+    EXPECT_TRUE(spot(dtw, stream).empty());
+}
+
+TEST(SpringDTWTest, RejectsNoiseByDefault) {
+    Fixture fixture;
+    SpringDTW dtw;
+    ASSERT_TRUE(dtw.getNullRejectionEnabled());
+    ASSERT_TRUE(dtw.train_(fixture.data));
+
+    MatrixDouble noise = fixture.stream(0);
+    EXPECT_TRUE(spot(dtw, noise).empty());
+    ASSERT_TRUE(dtw.predict_(noise));
+    EXPECT_TRUE(dtw.getMatches().empty());
+    EXPECT_EQ(GRT_DEFAULT_NULL_CLASS_LABEL, dtw.getPredictedClassLabel());
+
+    // Without null rejection, the noise itself is matched.
+    dtw.enableNullRejection(false);
+    EXPECT_FALSE(spot(dtw, noise).empty());
+}
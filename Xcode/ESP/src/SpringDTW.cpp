@@ -0,0 +1,497 @@
+#include "SpringDTW.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "grt-util.h"
+
+using namespace grt_util;
+
+namespace GRT {
+
+RegisterClassifierModule<SpringDTW> SpringDTW::registerModule("SpringDTW");
+
+namespace {
+
+const char kFileHeader[] = "GRT_SPRING_DTW_MODEL_FILE_V1.0";
+const double kInfinity = std::numeric_limits<double>::infinity();
+
+inline double squaredDistance(const double* a, const double* b, UINT n) {
+    double sum = 0;
+    for (UINT k = 0; k < n; k++) {
+        double d = a[k] - b[k];
+        sum += d * d;
+    }
+    return sum;
+}
+
+bool byDistance(const SpringDTW::Match& a, const SpringDTW::Match& b) {
+    return a.distance < b.distance;
+}
+
+// Sorts matches best first and drops those that overlap a better match of
+// the same class, e.g. the same gesture found by several templates.
+void keepBestMatches(vector<SpringDTW::Match>& matches) {
+    std::sort(matches.begin(), matches.end(), byDistance);
+    UINT kept = 0;
+    for (UINT i = 0; i < matches.size(); i++) {
+        bool overlaps = false;
+        for (UINT j = 0; j < kept && !overlaps; j++) {
+            overlaps = matches[j].classLabel == matches[i].classLabel &&
+                       matches[j].start <= matches[i].end &&
+                       matches[i].start <= matches[j].end;
+        }
+        if (!overlaps) matches[kept++] = matches[i];
+    }
+    matches.resize(kept);
+}
+
+}  // namespace
+
+SpringDTW::SpringDTW(bool useScaling, bool useNullRejection,
+                     double nullRejectionCoeff)
+        : time_(0) {
+    this->useScaling = useScaling;
+    this->useNullRejection = useNullRejection;
+    this->nullRejectionCoeff = nullRejectionCoeff;
+    supportsNullRejection = true;
+    classType = "SpringDTW";
+    classifierType = classType;
+    classifierMode = TIMESERIES_CLASSIFIER_MODE;
+    debugLog.setProceedingText("[DEBUG SpringDTW]");
+    errorLog.setProceedingText("[ERROR SpringDTW]");
+    trainingLog.setProceedingText("[TRAINING SpringDTW]");
+    warningLog.setProceedingText("[WARNING SpringDTW]");
+}
+
+SpringDTW::SpringDTW(const SpringDTW& rhs) : time_(0) {
+    supportsNullRejection = true;
+    classType = "SpringDTW";
+    classifierType = classType;
+    classifierMode = TIMESERIES_CLASSIFIER_MODE;
+    debugLog.setProceedingText("[DEBUG SpringDTW]");
+    errorLog.setProceedingText("[ERROR SpringDTW]");
+    trainingLog.setProceedingText("[TRAINING SpringDTW]");
+    warningLog.setProceedingText("[WARNING SpringDTW]");
+
+    *this = rhs;
+}
+
+SpringDTW& SpringDTW::operator=(const SpringDTW& rhs) {
+    if (this != &rhs) {
+        this->templates_ = rhs.templates_;
+        this->trainingMu_ = rhs.trainingMu_;
+        this->trainingSigma_ = rhs.trainingSigma_;
+        this->time_ = rhs.time_;
+        this->matches_ = rhs.matches_;
+        copyBaseVariables((Classifier*)&rhs);
+    }
+    return *this;
+}
+
+bool SpringDTW::deepCopyFrom(const Classifier* classifier) {
+    if (classifier == nullptr) {
+        return false;
+    }
+
+    if (this->getClassifierType() == classifier->getClassifierType()) {
+        *this = *(SpringDTW*)classifier;
+        return true;
+    }
+
+    errorLog << "deepCopyFrom(const Classifier *classifier)"
+             << " - Classifier Types Do Not Match!" << std::endl;
+    return false;
+}
+
+double SpringDTW::dtw(const Template& a, const Template& b) const {
+    const UINT D = numInputDimensions;
+    vector<double> previous(b.length + 1, kInfinity);
+    vector<double> current(b.length + 1, kInfinity);
+    previous[0] = 0;
+    for (UINT i = 0; i < a.length; i++) {
+        current[0] = kInfinity;
+        for (UINT j = 0; j < b.length; j++) {
+            double best = std::min(std::min(previous[j], previous[j + 1]),
+                                   current[j]);
+            current[j + 1] = best + squaredDistance(&a.data[i * D],
+                                                    &b.data[j * D], D);
+        }
+        std::swap(previous, current);
+    }
+    return previous[b.length];
+}
+
+void SpringDTW::resetTemplate(Template& t) const {
+    // Point 0 stands for "not started yet": a path can leave it at any
+    // sample, which is what lets a match start anywhere in the stream.
+    t.cost.assign(t.length + 1, kInfinity);
+    t.cost[0] = 0;
+    t.start.assign(t.length + 1, 0);
+    t.candidateCost = kInfinity;
+    t.candidateStart = 0;
+    t.candidateEnd = 0;
+}
+
+bool SpringDTW::train_(TimeSeriesClassificationData& trainingData) {
+    clear();
+
+    if (trainingData.getNumSamples() == 0) {
+        errorLog << "train_(TimeSeriesClassificationData &trainingData) - "
+                 << "Can't train model as there are no samples in training data!"
+                 << std::endl;
+        return false;
+    }
+
+    numInputDimensions = trainingData.getNumDimensions();
+    numClasses = trainingData.getNumClasses();
+    classLabels = trainingData.getClassLabels();
+    ranges = trainingData.getRanges();
+    const UINT D = numInputDimensions;
+
+    for (UINT i = 0; i < trainingData.getNumSamples(); i++) {
+        const MatrixDouble& sample = trainingData[i].getData();
+        if (sample.getNumRows() == 0) continue;
+
+        Template t;
+        t.classIndex = std::find(classLabels.begin(), classLabels.end(),
+                                 trainingData[i].getClassLabel()) -
+                       classLabels.begin();
+        t.length = sample.getNumRows();
+        t.data.resize(t.length * D);
+        for (UINT r = 0; r < t.length; r++) {
+            for (UINT k = 0; k < D; k++) {
+                double x = sample[r][k];
+                if (useScaling) {
+                    x = scale(x, ranges[k].minValue, ranges[k].maxValue, 0, 1);
+                }
+                t.data[r * D + k] = x;
+            }
+        }
+        templates_.push_back(std::move(t));
+    }
+
+    // Each template is matched against the others as a stretch of the stream
+    // would be, so the path cost is normalized by the other's length.
+    vector<UINT> classIndex;
+    for (const Template& t : templates_) classIndex.push_back(t.classIndex);
+    learnNearestTemplateStatistics(
+        numClasses, classIndex,
+        [this](UINT a, UINT b, double) {
+            return dtw(templates_[a], templates_[b]) / templates_[b].length;
+        },
+        trainingMu_, trainingSigma_);
+
+    trained = true;
+    recomputeNullRejectionThresholds();
+    reset();
+
+    trainingLog << "Trained " << templates_.size() << " templates."
+                << std::endl;
+    if (useNullRejection && trainingSigma_[0] < 0) {
+        warningLog << "train_(TimeSeriesClassificationData &trainingData) - "
+                   << "No class has two templates to learn a null rejection "
+                   << "threshold from, so every sample will be matched!"
+                   << std::endl;
+    }
+    return true;
+}
+
+void SpringDTW::report(Template& t) {
+    Match match;
+    match.classLabel = classLabels[t.classIndex];
+    match.distance = std::sqrt(t.candidateCost / t.length);
+    match.start = t.candidateStart;
+    match.end = t.candidateEnd;
+    matches_.push_back(match);
+    t.candidateCost = kInfinity;
+}
+
+void SpringDTW::pushSample(const double* x) {
+    const UINT D = numInputDimensions;
+    const uint64_t now = time_++;
+
+    for (Template& t : templates_) {
+        double* cost = t.cost.data();
+        uint64_t* start = t.start.data();
+
+        // Update the column in place: before point i is overwritten,
+        // cost[i - 1] already holds this sample's value and diagonal the
+        // previous sample's.
+        double diagonal = cost[0];
+        uint64_t diagonalStart = start[0];
+        start[0] = now;
+        for (UINT i = 1; i <= t.length; i++) {
+            double best = cost[i - 1];
+            uint64_t bestStart = start[i - 1];
+            if (cost[i] < best) {
+                best = cost[i];
+                bestStart = start[i];
+            }
+            if (diagonal < best) {
+                best = diagonal;
+                bestStart = diagonalStart;
+            }
+            diagonal = cost[i];
+            diagonalStart = start[i];
+            cost[i] = best + squaredDistance(x, &t.data[(i - 1) * D], D);
+            start[i] = bestStart;
+        }
+
+        // The candidate is final once no path that overlaps it can still
+        // beat it.
+        if (t.candidateCost < kInfinity) {
+            bool final = true;
+            for (UINT i = 1; i <= t.length && final; i++) {
+                final = cost[i] >= t.candidateCost ||
+                        start[i] > t.candidateEnd;
+            }
+            if (final) {
+                const uint64_t end = t.candidateEnd;
+                report(t);
+                for (UINT i = 1; i <= t.length; i++) {
+                    if (start[i] <= end) cost[i] = kInfinity;
+                }
+            }
+        }
+
+        if ((!useNullRejection || cost[t.length] <= t.threshold) &&
+            cost[t.length] < t.candidateCost) {
+            t.candidateCost = cost[t.length];
+            t.candidateStart = start[t.length];
+            t.candidateEnd = now;
+        }
+    }
+}
+
+void SpringDTW::flush() {
+    for (Template& t : templates_) {
+        if (t.candidateCost < kInfinity) report(t);
+    }
+}
+
+bool SpringDTW::predict_(VectorDouble& inputVector) {
+    if (!trained) {
+        errorLog << "predict_(VectorDouble &inputVector) - The model has not "
+                 << "been trained!" << std::endl;
+        return false;
+    }
+    if (inputVector.size() != numInputDimensions) {
+        errorLog << "predict_(VectorDouble &inputVector) - The size of the "
+                 << "input vector (" << inputVector.size() << ") does not "
+                 << "match the num features in the model ("
+                 << numInputDimensions << std::endl;
+        return false;
+    }
+
+    input_ = inputVector;
+    if (useScaling) {
+        for (UINT k = 0; k < numInputDimensions; k++) {
+            input_[k] = scale(input_[k], ranges[k].minValue,
+                              ranges[k].maxValue, 0, 1);
+        }
+    }
+
+    matches_.clear();
+    pushSample(input_.data());
+    keepBestMatches(matches_);
+
+    classDistances.assign(numClasses, std::numeric_limits<double>::max());
+    for (const Template& t : templates_) {
+        double d = std::sqrt(t.cost[t.length] / t.length);
+        if (d < classDistances[t.classIndex]) classDistances[t.classIndex] = d;
+    }
+    const UINT bestIndex = computeClassLikelihoods(classDistances,
+                                                   classLikelihoods);
+    if (bestIndex == numClasses) {
+        bestDistance = std::numeric_limits<double>::max();
+        maxLikelihood = 0;
+    } else {
+        bestDistance = classDistances[bestIndex];
+        maxLikelihood = classLikelihoods[bestIndex];
+    }
+
+    predictedClassLabel = matches_.empty() ? GRT_DEFAULT_NULL_CLASS_LABEL
+                                           : matches_[0].classLabel;
+    return true;
+}
+
+bool SpringDTW::predict_(MatrixDouble& inputTimeSeries) {
+    if (!trained) {
+        errorLog << "predict_(MatrixDouble &inputTimeSeries) - The model has "
+                 << "not been trained!" << std::endl;
+        return false;
+    }
+    if (inputTimeSeries.getNumCols() != numInputDimensions) {
+        errorLog << "predict_(MatrixDouble &inputTimeSeries) - The number of "
+                 << "columns in the input time series ("
+                 << inputTimeSeries.getNumCols() << ") does not match the "
+                 << "num features in the model (" << numInputDimensions
+                 << std::endl;
+        return false;
+    }
+
+    reset();
+    const UINT D = numInputDimensions;
+    input_.resize(D);
+    vector<Match> matches;
+    for (UINT i = 0; i < inputTimeSeries.getNumRows(); i++) {
+        for (UINT k = 0; k < D; k++) {
+            double x = inputTimeSeries[i][k];
+            if (useScaling) {
+                x = scale(x, ranges[k].minValue, ranges[k].maxValue, 0, 1);
+            }
+            input_[k] = x;
+        }
+        matches_.clear();
+        pushSample(input_.data());
+        matches.insert(matches.end(), matches_.begin(), matches_.end());
+    }
+    matches_.clear();
+    flush();
+    matches_.insert(matches_.end(), matches.begin(), matches.end());
+    keepBestMatches(matches_);
+
+    // The distance of each class is that of its best match.
+    classDistances.assign(numClasses, std::numeric_limits<double>::max());
+    for (const Match& match : matches_) {
+        UINT c = std::find(classLabels.begin(), classLabels.end(),
+                           match.classLabel) - classLabels.begin();
+        classDistances[c] = std::min(classDistances[c], match.distance);
+    }
+    computeClassLikelihoods(classDistances, classLikelihoods);
+
+    if (matches_.empty()) {
+        predictedClassLabel = GRT_DEFAULT_NULL_CLASS_LABEL;
+        bestDistance = std::numeric_limits<double>::max();
+        maxLikelihood = 0;
+    } else {
+        predictedClassLabel = matches_[0].classLabel;
+        bestDistance = matches_[0].distance;
+        maxLikelihood = *std::max_element(classLikelihoods.begin(),
+                                          classLikelihoods.end());
+    }
+    return true;
+}
+
+bool SpringDTW::recomputeNullRejectionThresholds() {
+    if (!trained) return false;
+
+    computeNullRejectionThresholds(trainingMu_, trainingSigma_,
+                                   nullRejectionCoeff, nullRejectionThresholds);
+
+    for (Template& t : templates_) {
+        double threshold = nullRejectionThresholds[t.classIndex];
+        if (threshold == std::numeric_limits<double>::max()) {
+            t.threshold = kInfinity;
+        } else {
+            t.threshold = threshold * threshold * t.length;
+        }
+    }
+    return true;
+}
+
+bool SpringDTW::reset() {
+    Classifier::reset();
+
+    for (Template& t : templates_) resetTemplate(t);
+    time_ = 0;
+    matches_.clear();
+    return true;
+}
+
+bool SpringDTW::clear() {
+    Classifier::clear();
+
+    templates_.clear();
+    trainingMu_.clear();
+    trainingSigma_.clear();
+    time_ = 0;
+    matches_.clear();
+    return true;
+}
+
+bool SpringDTW::saveModelToFile(fstream& file) const {
+    if (!file.is_open()) {
+        errorLog << "saveModelToFile(fstream &file) - The file is not open!"
+                 << std::endl;
+        return false;
+    }
+
+    file << kFileHeader << std::endl;
+
+    if (!saveBaseSettingsToFile(file)) {
+        errorLog << "saveModelToFile(fstream &file) - Failed to save the base "
+                 << "settings to file!" << std::endl;
+        return false;
+    }
+
+    if (!trained) return true;
+
+    // Enough digits for the doubles to read back the same.
+    const std::streamsize precision = file.precision(17);
+    file << "NumTemplates: " << templates_.size() << std::endl;
+    for (const Template& t : templates_) {
+        saveTemplate(file, t.classIndex, t.length, numInputDimensions, t.data);
+    }
+    saveTrainingStatistics(file, trainingMu_, trainingSigma_);
+    file.precision(precision);
+
+    return true;
+}
+
+bool SpringDTW::loadModelFromFile(fstream& file) {
+    clear();
+
+    if (!file.is_open()) {
+        errorLog << "loadModelFromFile(fstream &file) - The file is not open!"
+                 << std::endl;
+        return false;
+    }
+
+    string word;
+    file >> word;
+    if (word != kFileHeader) {
+        errorLog << "loadModelFromFile(fstream &file) - Invalid file format!"
+                 << std::endl;
+        return false;
+    }
+
+    if (!loadBaseSettingsFromFile(file)) {
+        errorLog << "loadModelFromFile(fstream &file) - Failed to load the "
+                 << "base settings from file!" << std::endl;
+        return false;
+    }
+
+    if (!trained) return true;
+
+    UINT numTemplates;
+    if (!readValue(file, "NumTemplates:", numTemplates)) {
+        errorLog << "loadModelFromFile(fstream &file) - Failed to read "
+                 << "NumTemplates!" << std::endl;
+        return false;
+    }
+    templates_.resize(numTemplates);
+    for (Template& t : templates_) {
+        if (!loadTemplate(file, numClasses, numInputDimensions, t.classIndex,
+                          t.length, t.data)) {
+            errorLog << "loadModelFromFile(fstream &file) - Failed to read a "
+                     << "template!" << std::endl;
+            return false;
+        }
+    }
+
+    if (!loadTrainingStatistics(file, numClasses, trainingMu_,
+                                trainingSigma_)) {
+        errorLog << "loadModelFromFile(fstream &file) - Failed to read the "
+                 << "training statistics!" << std::endl;
+        return false;
+    }
+
+    recomputeNullRejectionThresholds();
+    reset();
+    return true;
+}
+
+} // namespace GRT
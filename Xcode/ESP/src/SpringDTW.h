@@ -0,0 +1,158 @@
+#ifndef ESP_SPRING_DTW_H_
+#define ESP_SPRING_DTW_H_
+
+#include "GRT/CoreModules/Classifier.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace GRT {
+
+using std::vector;
+
+/* @brief SpringDTW spots gestures in a continuous stream with subsequence
+ * DTW, using the SPRING algorithm [1]. Rather than re-matching a window of
+ * the stream against every template on each sample, it keeps, for every
+ * template, the column of cumulative costs of the best warping path from any
+ * start in the stream to each template point, and updates it with each new
+ * sample. A sample costs O(total template length), however long the stream
+ * or the gestures in it.
+ *
+ * Each template reports the best match within each run of overlapping
+ * candidates, once no later sample can improve on it, together with the
+ * stream indices of the first and last matched samples. Matches are thus
+ * reported a little after the gesture ends, once the stream has moved far
+ * enough away from the template. Overlapping matches of the same class, e.g.
+ * the same gesture matched by several templates, are merged into the best.
+ *
+ *    GRT::SpringDTW dtw(false, true, null_rej);
+ *    pipeline.setClassifier(dtw);
+ *    ...
+ *    for (const GRT::SpringDTW::Match& match : dtw.getMatches()) {
+ *        // match.classLabel, match.start, match.end
+ *    }
+ *
+ * The cost between two samples is their squared Euclidean distance, and the
+ * distance of a match is the square root of the path cost divided by the
+ * template length. A template only matches below its class's threshold: the
+ * mean plus nullRejectionCoeff standard deviations of the distance from each
+ * training template to the nearest other one of its class, measured the same
+ * way, i.e. divided by the length of the template matched against (classes
+ * with a single template use the average of the other classes).
+ *
+ * Null rejection is what tells gestures from the rest of the stream, so it is
+ * on by default. Without it, or if no class has two templates, nothing is
+ * rejected: every stretch of the stream is the best match of some run, and a
+ * match is reported every few samples whatever the stream holds. That is only
+ * useful to look at the distances of getMatches().
+ *
+ * After each sample, the predicted class label is that of the best match
+ * reported on that sample, or GRT_DEFAULT_NULL_CLASS_LABEL if there is none,
+ * and the class distances are those of the best path of each class ending
+ * at the sample.
+ *
+ * [1] Sakurai, Y., Faloutsos, C., Yamamuro, M., 2007. Stream monitoring
+ *     under the time warping distance. ICDE 2007.
+ */
+class SpringDTW : public Classifier {
+  public:
+    struct Match {
+        UINT classLabel;
+        double distance;
+        uint64_t start;  // Index in the stream of the first matched sample
+        uint64_t end;    // Index in the stream of the last matched sample
+    };
+
+    SpringDTW(bool useScaling = false, bool useNullRejection = true,
+              double nullRejectionCoeff = 3.0);
+
+    SpringDTW(const SpringDTW& rhs);
+    SpringDTW& operator=(const SpringDTW& rhs);
+    bool deepCopyFrom(const Classifier* classifier) override;
+    ~SpringDTW() override {}
+
+    bool train_(TimeSeriesClassificationData& trainingData) override;
+
+    // Adds a sample to the stream.
+    bool predict_(VectorDouble& inputVector) override;
+
+    // Spots the gestures in a whole time series, as if it had been streamed
+    // after a reset(), then reports the matches still pending at its end.
+    bool predict_(MatrixDouble& inputTimeSeries) override;
+
+    // Restarts the stream (and its sample indices) but keeps the templates.
+    bool reset() override;
+    bool clear() override;
+
+    bool saveModelToFile(fstream& file) const override;
+    bool loadModelFromFile(fstream& file) override;
+
+    bool recomputeNullRejectionThresholds() override;
+
+    // The matches reported by the last predict(), best first.
+    const vector<Match>& getMatches() const { return matches_; }
+
+    // The number of samples since the last reset(); the index of the next
+    // sample.
+    uint64_t getNumSamplesSeen() const { return time_; }
+
+    UINT getNumTemplates() const { return templates_.size(); }
+
+    using MLBase::saveModelToFile;
+    using MLBase::loadModelFromFile;
+    using MLBase::train;
+    using MLBase::train_;
+    using MLBase::predict;
+    using MLBase::predict_;
+
+  protected:
+    struct Template {
+        UINT classIndex;
+        UINT length;
+        vector<double> data;  // length x numInputDimensions, row-major
+
+        // SPRING state. cost[i] is the cost of the best path ending at the
+        // last sample and template point i, and start[i] where it started.
+        vector<double> cost;
+        vector<uint64_t> start;
+        // The best candidate match not reported yet.
+        double candidateCost;
+        uint64_t candidateStart;
+        uint64_t candidateEnd;
+        double threshold;  // Maximum path cost of a match with null rejection
+    };
+
+    // Updates every template with a sample and reports their matches.
+    void pushSample(const double* x);
+
+    // Reports the pending candidate of every template.
+    void flush();
+
+    void report(Template& t);
+
+    // Squared-distance DTW cost between two templates.
+    double dtw(const Template& a, const Template& b) const;
+
+    // Clears the SPRING state of t.
+    void resetTemplate(Template& t) const;
+
+    vector<Template> templates_;
+
+    // Per class: the mean and standard deviation of the distance from each
+    // template to the nearest other template of the class; the standard
+    // deviation is negative if there is none.
+    VectorDouble trainingMu_;
+    VectorDouble trainingSigma_;
+
+    uint64_t time_;
+    vector<Match> matches_;
+
+    // Scratch.
+    VectorDouble input_;
+
+    static RegisterClassifierModule<SpringDTW> registerModule;
+};
+
+} // namespace GRT
+
+#endif // ESP_SPRING_DTW_H_
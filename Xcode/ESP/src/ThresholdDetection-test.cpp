@@ -0,0 +1,103 @@
+#include "ThresholdDetection.h"
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <random>
+
+using namespace GRT;
+
+TEST(ThresholdDetectionTest, SkipsNonFiniteInputs) {
+    const UINT kBufferLength = 8;
+    ThresholdDetection withSilence(kBufferLength, 1, 10, 1);
+    ThresholdDetection withoutSilence(kBufferLength, 1, 10, 1);
+
+    // The log energy of digital silence is -inf; it shouldn't change the
+    // statistics of the inputs around it.
+    for (UINT i = 0; i < 3 * kBufferLength; i++) {
+        const double x = -0.1 * (i % 3);
+        if (i == kBufferLength / 2) {
+            VectorDouble silence =
+                withSilence.update(-std::numeric_limits<double>::infinity());
+            ASSERT_TRUE(std::isfinite(silence[2]));  // mean
+            ASSERT_TRUE(std::isfinite(silence[3]));  // std dev
+        }
+        EXPECT_EQ(withoutSilence.update(x), withSilence.update(x))
+            << "after " << i << " inputs";
+    }
+
+    CircularBuffer<VectorDouble> buffer = withSilence.getBufferData();
+    ASSERT_TRUE(buffer.getBufferFilled());
+    for (UINT i = 0; i < kBufferLength; i++) {
+        EXPECT_EQ(-0.1 * ((2 * kBufferLength + i) % 3), buffer[i][0]);
+    }
+}
+
+TEST(ThresholdDetectionTest, MatchesNaiveRecomputationWithLargeOffset) {
+    const UINT kBufferLength = 50;
+    const UINT kDimensions = 2;
+    const double kAlpha = 4, kBeta = 1.2;
+    const double kOffset[kDimensions] = {1e6, -3e5};
+    ThresholdDetection detection(kBufferLength, kDimensions, kAlpha, kBeta);
+
+    // The same detector, with the mean and std dev recomputed from the whole
+    // buffer on every input.
+    std::deque<VectorDouble> buffer(kBufferLength,
+                                    VectorDouble(kDimensions, 0));
+    bool inNoise = true;
+
+    // Noise around a large offset, with bursts that leave it and stop the
+    // buffer from being updated, over many times the buffer length.
+    std::mt19937 random(5);
+    std::normal_distribution<double> noise(0, 1);
+    UINT bursts = 0;
+    for (UINT i = 0; i < 40 * kBufferLength; i++) {
+        const bool burst = i % 300 >= 250 && i % 300 < 270;
+        VectorDouble x(kDimensions);
+        for (UINT n = 0; n < kDimensions; n++) {
+            x[n] = kOffset[n] + noise(random) + (burst ? 50 : 0);
+        }
+
+        if (inNoise) {
+            buffer.pop_front();
+            buffer.push_back(x);
+        }
+        VectorDouble expected(5 * kDimensions + 1);
+        for (UINT n = 0; n < kDimensions; n++) {
+            double mean = 0;
+            for (const VectorDouble& y : buffer) mean += y[n];
+            mean /= kBufferLength;
+            double squaredDeviations = 0;
+            for (const VectorDouble& y : buffer) {
+                squaredDeviations += (y[n] - mean) * (y[n] - mean);
+            }
+            const double stdDev = sqrt(squaredDeviations / (kBufferLength - 1));
+            if (x[n] > mean + kAlpha * stdDev) inNoise = false;
+            if (x[n] < mean + kBeta * stdDev) inNoise = true;
+            expected[1 + 5 * n] = x[n];
+            expected[2 + 5 * n] = mean;
+            expected[3 + 5 * n] = stdDev;
+            expected[4 + 5 * n] = mean + kAlpha * stdDev;
+            expected[5 + 5 * n] = mean + kBeta * stdDev;
+        }
+        expected[0] = inNoise ? 0 : 1;
+        if (!inNoise) bursts++;
+
+        VectorDouble actual = detection.update(x);
+        ASSERT_EQ(expected.size(), actual.size());
+        ASSERT_EQ(expected[0], actual[0]) << "after " << i << " inputs";
+        for (UINT k = 1; k < expected.size(); k++) {
+            ASSERT_NEAR(expected[k], actual[k], 1e-6)
+                << "feature " << k << " after " << i << " inputs";
+        }
+    }
+    EXPECT_GT(bursts, 0);
+
+    const CircularBuffer<VectorDouble>& data =
+        static_cast<const ThresholdDetection&>(detection).getBufferData();
+    ASSERT_TRUE(data.getBufferFilled());
+    for (UINT i = 0; i < kBufferLength; i++) {
+        EXPECT_EQ(buffer[i], data[i]);
+    }
+}
@@ -19,6 +19,7 @@
  */
 
 #include "ThresholdDetection.h"
+#include <cmath>
 
 namespace GRT{
     
@@ -57,7 +58,16 @@ ThresholdDetection& ThresholdDetection::operator=(const ThresholdDetection &rhs)
         this->bufferLength = rhs.bufferLength;
         this->alpha = rhs.alpha;
         this->beta = rhs.beta;
-        this->dataBuffer = rhs.dataBuffer;
+        this->inNoise = rhs.inNoise;
+        this->ring = rhs.ring;
+        this->ringPosition = rhs.ringPosition;
+        this->ringFilled = rhs.ringFilled;
+        this->pushesSinceAnchor = rhs.pushesSinceAnchor;
+        this->shift = rhs.shift;
+        this->sum = rhs.sum;
+        this->sumOfSquares = rhs.sumOfSquares;
+        this->meanFeatures = rhs.meanFeatures;
+        this->stdDevFeatures = rhs.stdDevFeatures;
         
         //Copy the base variables
         copyBaseVariables( (FeatureExtraction*)&rhs );
@@ -226,8 +236,16 @@ bool ThresholdDetection::init(UINT bufferLength,UINT numDimensions,double alpha,
     //Resize the feature vector
     featureVector.resize(numOutputDimensions);
     
-    //Resize the raw data buffer
-    dataBuffer.resize( bufferLength, VectorDouble(numInputDimensions,0) );
+    //The buffer starts out full of zeros, and so do the running statistics
+    ring.assign( bufferLength * numInputDimensions, 0 );
+    ringPosition = 0;
+    ringFilled = false;
+    pushesSinceAnchor = 0;
+    shift.assign( numInputDimensions, 0 );
+    sum.assign( numInputDimensions, 0 );
+    sumOfSquares.assign( numInputDimensions, 0 );
+    meanFeatures.assign( numInputDimensions, 0 );
+    stdDevFeatures.assign( numInputDimensions, 0 );
 
     //Flag that the time domain features has been initialized
     initialized = true;
@@ -252,33 +270,29 @@ VectorDouble ThresholdDetection::update(const VectorDouble &x){
         return vector<double>();
     }
     
-    if (inNoise) {
+    //Non-finite inputs (e.g. the log energy of silence) are left out of the statistics, which they would otherwise turn into
+    //NaN until the next reanchor
+    bool finite = true;
+    for(UINT n=0; n<numInputDimensions; n++){
+        if( !std::isfinite( x[n] ) ) finite = false;
+    }
+    
+    if (inNoise && finite) {
         //Add the new data to the data buffer
-        dataBuffer.push_back( x );
+        pushSample( x );
     }
     
     //Only flag that the feature data is ready if the data is full
-    if( dataBuffer.getBufferFilled() ){
+    if( ringFilled ){
         featureDataReady = true;
     }else featureDataReady = false;
     
-    VectorDouble meanFeatures(numInputDimensions,0);
-    VectorDouble stdDevFeatures(numInputDimensions,0);
-    
+    //The mean and std dev of the buffer, from the running sums
+    const double norm = bufferLength>1 ? bufferLength-1 : 1;
     for(UINT n=0; n<numInputDimensions; n++){
-        for(UINT i=0; i<bufferLength; i++){
-            //Update the mean
-            meanFeatures[n] += dataBuffer[i][n];
-        }
-        
-        meanFeatures[n] /= bufferLength;
-        
-        //Update the std dev
-        for(UINT i=0; i<bufferLength; i++){
-            stdDevFeatures[n] += (dataBuffer[i][n]-meanFeatures[n]) * (dataBuffer[i][n]-meanFeatures[n]);
-        }
-        double norm = bufferLength>1 ? bufferLength-1 : 1;
-        stdDevFeatures[n] = sqrt( stdDevFeatures[n]/norm );
+        meanFeatures[n] = shift[n] + sum[n] / bufferLength;
+        double squaredDeviations = sumOfSquares[n] - sum[n] * sum[n] / bufferLength;
+        stdDevFeatures[n] = sqrt( squaredDeviations > 0 ? squaredDeviations/norm : 0 );
     }
     
     // TODO(damellis): do something intelligent when numInputDimensions > 1
@@ -305,14 +319,70 @@ VectorDouble ThresholdDetection::update(const VectorDouble &x){
     return featureVector;
 }
     
+void ThresholdDetection::pushSample(const VectorDouble &x){
+    
+    //The slot at ringPosition holds the oldest input, which x replaces
+    double *slot = &ring[ ringPosition * numInputDimensions ];
+    for(UINT n=0; n<numInputDimensions; n++){
+        const double evicted = slot[n] - shift[n];
+        const double added = x[n] - shift[n];
+        sum[n] += added - evicted;
+        sumOfSquares[n] += added * added - evicted * evicted;
+        slot[n] = x[n];
+    }
+    
+    if( ++ringPosition == bufferLength ){
+        ringPosition = 0;
+        ringFilled = true;
+    }
+    if( ++pushesSinceAnchor == bufferLength ) reanchor();
+}
+    
+void ThresholdDetection::reanchor(){
+    
+    pushesSinceAnchor = 0;
+    
+    //Exact mean, then the sums of the deviations from it
+    std::fill( sum.begin(), sum.end(), 0 );
+    for(UINT i=0; i<bufferLength; i++){
+        const double *slot = &ring[ i * numInputDimensions ];
+        for(UINT n=0; n<numInputDimensions; n++) sum[n] += slot[n];
+    }
+    for(UINT n=0; n<numInputDimensions; n++) shift[n] = sum[n] / bufferLength;
+    
+    std::fill( sum.begin(), sum.end(), 0 );
+    std::fill( sumOfSquares.begin(), sumOfSquares.end(), 0 );
+    for(UINT i=0; i<bufferLength; i++){
+        const double *slot = &ring[ i * numInputDimensions ];
+        for(UINT n=0; n<numInputDimensions; n++){
+            const double d = slot[n] - shift[n];
+            sum[n] += d;
+            sumOfSquares[n] += d * d;
+        }
+    }
+}
+    
 CircularBuffer< VectorDouble > ThresholdDetection::getBufferData(){
     if( initialized ){
-        return dataBuffer;
+        return static_cast< const ThresholdDetection* >( this )->getBufferData();
     }
     return CircularBuffer< VectorDouble >();
 }
     
 const CircularBuffer< VectorDouble > &ThresholdDetection::getBufferData() const {
+    if( !initialized ){
+        dataBuffer.clear();
+        return dataBuffer;
+    }
+    
+    //Until the ring has wrapped around, its oldest inputs are the initial zeros, which weren't pushed
+    dataBuffer.resize( bufferLength, VectorDouble(numInputDimensions,0) );
+    const UINT first = ringFilled ? ringPosition : 0;
+    const UINT count = ringFilled ? bufferLength : ringPosition;
+    for(UINT i=0; i<count; i++){
+        const double *slot = &ring[ ((first + i) % bufferLength) * numInputDimensions ];
+        dataBuffer.push_back( VectorDouble( slot, slot + numInputDimensions ) );
+    }
     return dataBuffer;
 }
     
@@ -145,16 +145,17 @@ public:
     VectorDouble update(const VectorDouble &x);
     
     /**
-     Get the circular buffer.
+     Gets a copy of the buffer of the last bufferLength inputs that were added to the statistics.
      
-     @return a copy of the circular buffer
+     @return a copy of the buffer, oldest input first, or an empty buffer if the module has not been initialized
      */
     CircularBuffer< VectorDouble > getBufferData();
     
     /**
-     Gets a reference to the circular buffer.
+     Gets a reference to the buffer of the last bufferLength inputs that were added to the statistics. The inputs are kept
+     in a flat ring, which each call copies into the buffer.
      
-     @return a reference to the circular buffer
+     @return a reference to the buffer, oldest input first
      */
     const CircularBuffer< VectorDouble > &getBufferData() const;
     
@@ -165,11 +166,36 @@ public:
     using MLBase::predict_;
 
 protected:
+    /**
+     Adds x to the running statistics, replacing the oldest input.
+     */
+    void pushSample(const VectorDouble &x);
+    
+    /**
+     Recomputes the running sums exactly from the ring, relative to the current mean, so that rounding errors don't build up.
+     */
+    void reanchor();
+    
     UINT bufferLength;
-    CircularBuffer< VectorDouble > dataBuffer;
     double alpha, beta;
     bool inNoise;
     
+    //The last bufferLength inputs, and running statistics over them, so that each update is O(numInputDimensions).
+    //The sums are of (value - shift), which keeps them small and the variance accurate.
+    //Each quantity is one array over the dimensions, and the ring holds one row of numInputDimensions values per input.
+    VectorDouble ring;
+    UINT ringPosition;
+    bool ringFilled;
+    UINT pushesSinceAnchor;
+    VectorDouble shift;
+    VectorDouble sum;
+    VectorDouble sumOfSquares;
+    VectorDouble meanFeatures;
+    VectorDouble stdDevFeatures;
+    
+    //The ring as returned by getBufferData()
+    mutable CircularBuffer< VectorDouble > dataBuffer;
+    
     static RegisterFeatureExtractionModule< ThresholdDetection > registerModule;
 };
 
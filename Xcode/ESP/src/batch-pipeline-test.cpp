@@ -0,0 +1,238 @@
+#include "batch-pipeline.h"
+#include "gtest/gtest.h"
+
+#include "Filter.h"
+#include "MFCC.h"
+#include "PrunedDTW.h"
+
+#include <atomic>
+#include <cmath>
+
+using namespace GRT;
+
+namespace {
+
+const UINT kFFTSize = 64;
+
+// A spectrum with its energy around bin, or a quiet one that MFCC's VAD
+// drops.
+VectorDouble spectrum(UINT bin, bool quiet) {
+    VectorDouble x(kFFTSize, 0.01);
+    if (!quiet) {
+        for (UINT i = 0; i < kFFTSize; i++) {
+            x[i] += 2 * std::exp(-0.1 * (i - bin) * (i - bin));
+        }
+    }
+    return x;
+}
+
+// MFCC on spectra, then PrunedDTW: MFCC takes the batch path.
+void setUpMfccPipeline(GestureRecognitionPipeline& pipeline) {
+    MFCC::Options options;
+    options.sample_rate = 8000;
+    options.fft_size = kFFTSize;
+    options.start_freq = 300;
+    options.end_freq = 3700;
+    options.num_tri_filter = 20;
+    options.num_cepstral_coeff = 12;
+    options.lifter_param = 22;
+    options.use_vad = true;
+    options.noise_level = 5;
+    pipeline.addFeatureExtractionModule(MFCC(options));
+    pipeline.setClassifier(PrunedDTW());
+
+    TimeSeriesClassificationData data(kFFTSize);
+    for (UINT label = 1; label <= 2; label++) {
+        for (UINT length : {6, 8, 10}) {
+            MatrixDouble sample;
+            for (UINT i = 0; i < length; i++) {
+                sample.push_back(spectrum(label * 20 + i, false));
+            }
+            data.addSample(label, sample);
+        }
+    }
+    ASSERT_TRUE(pipeline.train(data));
+}
+
+// Spectra of both classes, with quiet stretches in between; one of them is
+// where extractFeaturesBatch is split below.
+MatrixDouble spectra() {
+    MatrixDouble input;
+    for (UINT i = 0; i < 200; i++) {
+        const UINT label = i / 40 % 2 + 1;
+        input.push_back(spectrum(label * 20 + i % 10, i % 40 >= 20));
+    }
+    return input;
+}
+
+// Filter itself isn't registered, and the pipeline recreates its modules by
+// name.
+class MovingAverage : public Filter {
+  public:
+    MovingAverage(UINT filterSize = 5, UINT numDimensions = 2)
+        : Filter("MovingAverage", filterSize, numDimensions, MEAN) {}
+
+  private:
+    static RegisterPreProcessingModule<MovingAverage> registerModule;
+};
+
+RegisterPreProcessingModule<MovingAverage> MovingAverage::registerModule(
+    "MovingAverage");
+
+// A moving average, then PrunedDTW: every module runs row by row.
+void setUpFilterPipeline(GestureRecognitionPipeline& pipeline) {
+    pipeline.addPreProcessingModule(MovingAverage());
+    pipeline.setClassifier(PrunedDTW());
+
+    TimeSeriesClassificationData data(2);
+    for (UINT label = 1; label <= 2; label++) {
+        for (UINT length : {10, 12, 14}) {
+            MatrixDouble sample(length, 2);
+            for (UINT i = 0; i < length; i++) {
+                sample[i][0] = label == 1 ? i / double(length) : 0;
+                sample[i][1] = label == 2 ? sin(i * PI / length) : 0;
+            }
+            data.addSample(label, sample);
+        }
+    }
+    ASSERT_TRUE(pipeline.train(data));
+}
+
+MatrixDouble movements() {
+    MatrixDouble input(150, 2);
+    for (UINT i = 0; i < input.getNumRows(); i++) {
+        input[i][0] = i / 50 % 2 == 0 ? (i % 50) / 12.0 : 0;
+        input[i][1] = i / 50 % 2 == 1 ? sin((i % 50) * PI / 12) : 0;
+    }
+    return input;
+}
+
+void expectPredictBatchMatchesPredict(
+    void (*setUp)(GestureRecognitionPipeline&), const MatrixDouble& input) {
+    GestureRecognitionPipeline batch, row_by_row;
+    setUp(batch);
+    setUp(row_by_row);
+
+    BatchPrediction prediction;
+    ASSERT_TRUE(predictBatch(batch, input, prediction));
+    ASSERT_EQ(input.getNumRows(), prediction.labels.size());
+
+    UINT num_labeled = 0;
+    for (UINT i = 0; i < input.getNumRows(); i++) {
+        ASSERT_TRUE(row_by_row.predict(input.getRowVector(i)));
+        ASSERT_EQ(row_by_row.getPredictedClassLabel(), prediction.labels[i])
+            << "row " << i;
+        ASSERT_EQ(row_by_row.getClassLikelihoods(), prediction.likelihoods[i])
+            << "row " << i;
+        ASSERT_EQ(row_by_row.getClassDistances(), prediction.distances[i])
+            << "row " << i;
+        if (prediction.labels[i] != 0) num_labeled++;
+    }
+    EXPECT_GT(num_labeled, 0);
+}
+
+void expectExtractFeaturesBatchMatchesPreProcessData(
+    void (*setUp)(GestureRecognitionPipeline&), const MatrixDouble& input) {
+    GestureRecognitionPipeline batch, row_by_row;
+    setUp(batch);
+    setUp(row_by_row);
+
+    // In two parts, which carry the module state, and the output of the last
+    // ready row, across.
+    const UINT n = input.getNumRows();
+    MatrixDouble first, second;
+    ASSERT_TRUE(extractFeaturesBatch(batch, input, 0, n / 2, first));
+    ASSERT_TRUE(extractFeaturesBatch(batch, input, n / 2, n, second));
+    ASSERT_EQ(n / 2, first.getNumRows());
+    ASSERT_EQ(n - n / 2, second.getNumRows());
+
+    for (UINT i = 0; i < n; i++) {
+        ASSERT_TRUE(row_by_row.preProcessData(input.getRowVector(i)));
+        VectorDouble expected =
+            row_by_row.getNumFeatureExtractionModules() > 0
+                ? row_by_row.getFeatureExtractionData(0)
+                : row_by_row.getPreProcessedData(0);
+        VectorDouble actual = i < n / 2 ? first.getRowVector(i)
+                                        : second.getRowVector(i - n / 2);
+        ASSERT_EQ(expected, actual) << "row " << i;
+    }
+}
+
+// PrunedDTW, but it asks for the batch to be cancelled after a number of
+// predictions.
+std::atomic_bool cancelled(false);
+UINT predictions = 0;
+UINT cancelAfter = 0;
+
+class CancellingDTW : public PrunedDTW {
+  public:
+    CancellingDTW() {
+        classType = "CancellingDTW";
+        classifierType = classType;
+    }
+
+    bool predict_(VectorDouble& inputVector) override {
+        if (++predictions == cancelAfter) cancelled = true;
+        return PrunedDTW::predict_(inputVector);
+    }
+    using PrunedDTW::predict_;
+
+  private:
+    static RegisterClassifierModule<CancellingDTW> registerModule;
+};
+
+RegisterClassifierModule<CancellingDTW> CancellingDTW::registerModule(
+    "CancellingDTW");
+
+}  // namespace
+
+TEST(BatchPipelineTest, PredictBatchMatchesPredictWithMfcc) {
+    expectPredictBatchMatchesPredict(setUpMfccPipeline, spectra());
+}
+
+TEST(BatchPipelineTest, PredictBatchMatchesPredictWithoutMfcc) {
+    expectPredictBatchMatchesPredict(setUpFilterPipeline, movements());
+}
+
+TEST(BatchPipelineTest, ExtractFeaturesBatchMatchesPreProcessData) {
+    expectExtractFeaturesBatchMatchesPreProcessData(setUpMfccPipeline,
+                                                    spectra());
+    expectExtractFeaturesBatchMatchesPreProcessData(setUpFilterPipeline,
+                                                    movements());
+}
+
+TEST(BatchPipelineTest, CancellingStopsPredictBatch) {
+    GestureRecognitionPipeline pipeline;
+    pipeline.addPreProcessingModule(MovingAverage());
+    pipeline.setClassifier(CancellingDTW());
+    TimeSeriesClassificationData data(2);
+    MatrixDouble sample(10, 2);
+    for (UINT i = 0; i < 10; i++) sample[i][0] = i;
+    data.addSample(1, sample);
+    ASSERT_TRUE(pipeline.train(data));
+
+    const MatrixDouble input = movements();
+    BatchPrediction prediction;
+
+    // Cancelled before it starts: nothing is predicted.
+    cancelled = true;
+    predictions = 0;
+    EXPECT_FALSE(predictBatch(pipeline, input, prediction, &cancelled));
+    EXPECT_EQ(0, predictions);
+
+    // Cancelled while predicting: no row is predicted after that.
+    cancelled = false;
+    predictions = 0;
+    cancelAfter = 20;
+    EXPECT_FALSE(predictBatch(pipeline, input, prediction, &cancelled));
+    EXPECT_EQ(20, predictions);
+    EXPECT_FALSE(prediction.likelihoods[19].empty());
+    EXPECT_TRUE(prediction.likelihoods[20].empty());
+
+    // Not cancelled: every row is predicted.
+    cancelled = false;
+    predictions = 0;
+    cancelAfter = 0;
+    EXPECT_TRUE(predictBatch(pipeline, input, prediction, &cancelled));
+    EXPECT_EQ(input.getNumRows(), predictions);
+}
@@ -0,0 +1,235 @@
+#include "batch-pipeline.h"
+
+#include <algorithm>
+
+#include "MFCC.h"
+#include "MelFrontEnd.h"
+
+using namespace GRT;
+
+namespace {
+
+bool isCancelled(const std::atomic_bool* cancelled) {
+    return cancelled != nullptr && *cancelled;
+}
+
+// The data flowing between two stages, row-major, with the input row each
+// row came from.
+struct Rows {
+    UINT cols = 0;
+    vector<double> values;
+    vector<uint32_t> source;
+
+    uint32_t size() const { return source.size(); }
+    const double* row(uint32_t i) const {
+        return values.data() + (size_t) i * cols;
+    }
+    double* row(uint32_t i) { return values.data() + (size_t) i * cols; }
+};
+
+bool runPreProcessing(GestureRecognitionPipeline& pipeline, Rows& rows) {
+    VectorDouble data;
+    for (UINT j = 0; j < pipeline.getNumPreProcessingModules(); j++) {
+        PreProcessing* module = pipeline.getPreProcessingModule(j);
+        Rows out;
+        out.cols = module->getNumOutputDimensions();
+        out.source = rows.source;
+        out.values.reserve((size_t) out.cols * rows.size());
+        for (uint32_t i = 0; i < rows.size(); i++) {
+            data.assign(rows.row(i), rows.row(i) + rows.cols);
+            if (!module->process(data)) return false;
+            VectorDouble processed = module->getProcessedData();
+            if (processed.size() != out.cols) return false;
+            out.values.insert(out.values.end(), processed.begin(),
+                              processed.end());
+        }
+        rows = std::move(out);
+    }
+    return true;
+}
+
+// Run one feature extraction module over every row. ready[i] is set to
+// whether the module has features for row i; other rows of out are
+// unspecified.
+bool computeFeatures(FeatureExtraction* module, const Rows& in, Rows& out,
+                     vector<bool>& ready) {
+    out.cols = module->getNumOutputDimensions();
+    out.source = in.source;
+    out.values.assign((size_t) out.cols * in.size(), 0.0);
+
+    if (MFCC* mfcc = dynamic_cast<MFCC*>(module)) {
+        if (in.cols != mfcc->getNumInputDimensions()) return false;
+        mfcc->computeFeaturesBatch(in.values.data(), in.size(),
+                                   out.values.data(), ready);
+        return true;
+    }
+    if (MelFrontEnd* front_end = dynamic_cast<MelFrontEnd*>(module)) {
+        if (in.cols != front_end->getNumInputDimensions()) return false;
+        front_end->computeFeaturesBatch(in.values.data(), in.size(),
+                                        out.values.data(), ready);
+        return true;
+    }
+
+    ready.assign(in.size(), false);
+    VectorDouble data;
+    for (uint32_t i = 0; i < in.size(); i++) {
+        data.assign(in.row(i), in.row(i) + in.cols);
+        if (!module->computeFeatures(data)) return false;
+        if (!module->getFeatureDataReady()) continue;
+        VectorDouble features = module->getFeatureVector();
+        if (features.size() != out.cols) return false;
+        std::copy(features.begin(), features.end(), out.row(i));
+        ready[i] = true;
+    }
+    return true;
+}
+
+// Fill the rows that aren't ready with the last ready one, starting from
+// previous (the module's output before this batch).
+void carryForward(const VectorDouble& previous, const vector<bool>& ready,
+                  Rows& rows) {
+    vector<double> last(rows.cols, 0.0);
+    if (previous.size() == rows.cols) last = previous;
+    for (uint32_t i = 0; i < rows.size(); i++) {
+        if (ready[i]) {
+            std::copy(rows.row(i), rows.row(i) + rows.cols, last.begin());
+        } else {
+            std::copy(last.begin(), last.end(), rows.row(i));
+        }
+    }
+}
+
+// Drop the rows that aren't ready.
+void compact(const vector<bool>& ready, Rows& rows) {
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < rows.size(); i++) {
+        if (!ready[i]) continue;
+        if (n != i) {
+            std::copy(rows.row(i), rows.row(i) + rows.cols, rows.row(n));
+            rows.source[n] = rows.source[i];
+        }
+        n++;
+    }
+    rows.values.resize((size_t) n * rows.cols);
+    rows.source.resize(n);
+}
+
+// Pre-processing and feature extraction. Rows that aren't ready are either
+// dropped (for prediction) or repeat the previous output (for preProcessData).
+bool runStages(GestureRecognitionPipeline& pipeline, Rows& rows,
+               bool drop_if_not_ready,
+               const std::atomic_bool* cancelled = nullptr) {
+    if (!runPreProcessing(pipeline, rows)) return false;
+
+    vector<bool> ready;
+    for (UINT j = 0; j < pipeline.getNumFeatureExtractionModules(); j++) {
+        if (isCancelled(cancelled)) return false;
+        FeatureExtraction* module = pipeline.getFeatureExtractionModule(j);
+        VectorDouble previous = module->getFeatureVector();
+        Rows out;
+        if (!computeFeatures(module, rows, out, ready)) return false;
+        if (drop_if_not_ready) {
+            compact(ready, out);
+        } else {
+            carryForward(previous, ready, out);
+        }
+        rows = std::move(out);
+    }
+    return true;
+}
+
+Rows inputRows(const MatrixDouble& input, uint32_t start, uint32_t end) {
+    Rows rows;
+    rows.cols = input.getNumCols();
+    rows.values.reserve((size_t) rows.cols * (end - start));
+    for (uint32_t i = start; i < end; i++) {
+        rows.values.insert(rows.values.end(), input[i], input[i] + rows.cols);
+        rows.source.push_back(i);
+    }
+    return rows;
+}
+
+// The predicted class label of the classifier's last prediction, after
+// post-processing, like PipelineProfiler::predict().
+bool runPostProcessing(GestureRecognitionPipeline& pipeline, UINT& label) {
+    Classifier* classifier = pipeline.getClassifier();
+    label = classifier->getPredictedClassLabel();
+
+    VectorDouble data;
+    for (UINT j = 0; j < pipeline.getNumPostProcessingModules(); j++) {
+        PostProcessing* module = pipeline.getPostProcessingModule(j);
+        if (module->getIsPostProcessingInputModePredictedClassLabel()) {
+            data.assign(1, label);
+        } else {
+            data = classifier->getClassLikelihoods();
+        }
+        if (!module->process(data)) return false;
+        if (module->getIsPostProcessingOutputModeClassLabel()) {
+            VectorDouble out = module->getProcessedData();
+            if (!out.empty()) label = static_cast<UINT>(out[0]);
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+bool extractFeaturesBatch(GestureRecognitionPipeline& pipeline,
+                          const MatrixDouble& input, uint32_t start,
+                          uint32_t end, MatrixDouble& features) {
+    Rows rows = inputRows(input, start, end);
+    if (!runStages(pipeline, rows, false)) return false;
+
+    features.resize(rows.size(), rows.cols);
+    for (uint32_t i = 0; i < rows.size(); i++) {
+        std::copy(rows.row(i), rows.row(i) + rows.cols, features[i]);
+    }
+    return true;
+}
+
+bool predictBatch(GestureRecognitionPipeline& pipeline,
+                  const MatrixDouble& input, BatchPrediction& prediction,
+                  const std::atomic_bool* cancelled) {
+    const uint32_t num_rows = input.getNumRows();
+    prediction.labels.assign(num_rows, 0);
+    prediction.likelihoods.assign(num_rows, VectorDouble());
+    prediction.distances.assign(num_rows, VectorDouble());
+
+    if (pipeline.getIsContextSet() || !pipeline.getIsClassifierSet()) {
+        bool ok = true;
+        for (uint32_t i = 0; i < num_rows; i++) {
+            if (isCancelled(cancelled)) return false;
+            ok = pipeline.predict(input.getRowVector(i)) && ok;
+            prediction.labels[i] = pipeline.getPredictedClassLabel();
+            prediction.likelihoods[i] = pipeline.getClassLikelihoods();
+            prediction.distances[i] = pipeline.getClassDistances();
+        }
+        return ok;
+    }
+
+    Classifier* classifier = pipeline.getClassifier();
+    UINT label = pipeline.getPredictedClassLabel();
+    VectorDouble likelihoods = classifier->getClassLikelihoods();
+    VectorDouble distances = classifier->getClassDistances();
+
+    Rows rows = inputRows(input, 0, num_rows);
+    if (!runStages(pipeline, rows, true, cancelled)) return false;
+
+    // rows now holds only the input rows that reach the classifier, in order.
+    uint32_t next = 0;
+    for (uint32_t i = 0; i < num_rows; i++) {
+        if (next < rows.size() && rows.source[next] == i) {
+            if (isCancelled(cancelled)) return false;
+            VectorDouble data(rows.row(next), rows.row(next) + rows.cols);
+            next++;
+            if (!classifier->predict(data)) return false;
+            if (!runPostProcessing(pipeline, label)) return false;
+            likelihoods = classifier->getClassLikelihoods();
+            distances = classifier->getClassDistances();
+        }
+        prediction.labels[i] = label;
+        prediction.likelihoods[i] = likelihoods;
+        prediction.distances[i] = distances;
+    }
+    return true;
+}
@@ -0,0 +1,53 @@
+/** @file batch-pipeline.h
+ *  @brief Run a GestureRecognitionPipeline over a whole recording at once,
+ *  one stage at a time, for offline use (plots, scoring, test data).
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <GRT/GRT.h>
+
+/**
+ Like calling GestureRecognitionPipeline::preProcessData() on rows [start,
+ end) of input one by one, but each stage processes every row before the next
+ stage starts. MFCC and MelFrontEnd modules compute all their frames in one
+ call (see their computeFeaturesBatch()); other modules still see one row at a
+ time.
+
+ @param features: set to one row per input row, holding the output of the
+ last feature extraction module (or, without feature extraction, of the last
+ pre-processing module). As with preProcessData(), a row for which a module
+ has no data ready repeats that module's previous output.
+ @return false if any module fails, in which case features is unspecified.
+ */
+bool extractFeaturesBatch(GRT::GestureRecognitionPipeline& pipeline,
+                          const GRT::MatrixDouble& input, uint32_t start,
+                          uint32_t end, GRT::MatrixDouble& features);
+
+// The prediction for every row of a recording, as read back from the pipeline
+// after predict()ing that row.
+struct BatchPrediction {
+    vector<GRT::UINT> labels;
+    vector<GRT::VectorDouble> likelihoods;
+    vector<GRT::VectorDouble> distances;
+};
+
+/**
+ Like calling GestureRecognitionPipeline::predict() on every row of input,
+ with the stages run as in extractFeaturesBatch(). Rows that don't reach the
+ classifier (because a feature extraction module has no data ready) repeat the
+ previous prediction. The pipeline must be trained.
+
+ As with PipelineProfiler, the pipeline's own predicted class label is not
+ updated, and pipelines with context modules are run row by row.
+
+ @param cancelled: if given, checked between stages and before every row
+ that is predicted; once it is set, predictBatch() stops and returns false.
+ */
+bool predictBatch(GRT::GestureRecognitionPipeline& pipeline,
+                  const GRT::MatrixDouble& input, BatchPrediction& prediction,
+                  const std::atomic_bool* cancelled = nullptr);
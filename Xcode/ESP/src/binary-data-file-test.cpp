@@ -0,0 +1,94 @@
+#include "binary-data-file.h"
+#include "gtest/gtest.h"
+
+#include <fstream>
+
+static GRT::MatrixDouble makeMatrix(uint32_t rows, uint32_t cols) {
+    GRT::MatrixDouble matrix(rows, cols);
+    for (uint32_t r = 0; r < rows; r++) {
+        for (uint32_t c = 0; c < cols; c++) matrix[r][c] = r * 10 + c + 0.5;
+    }
+    return matrix;
+}
+
+static void truncateFile(const std::string& filename, size_t size) {
+    std::ifstream in(filename, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), std::min(size, bytes.size()));
+}
+
+TEST(BinaryDataFileTest, FilenameExtension) {
+    EXPECT_TRUE(isBinaryDataFilename("TrainingData.espb"));
+    EXPECT_FALSE(isBinaryDataFilename("TrainingData.grt"));
+    EXPECT_FALSE(isBinaryDataFilename("espb"));
+}
+
+TEST(BinaryDataFileTest, MatrixRoundTrip) {
+    GRT::MatrixDouble matrix = makeMatrix(5, 3);
+    ASSERT_TRUE(saveMatrixBinary("matrix.espb", matrix));
+
+    GRT::MatrixDouble loaded;
+    ASSERT_TRUE(loadMatrixBinary("matrix.espb", loaded));
+    ASSERT_EQ(5, loaded.getNumRows());
+    ASSERT_EQ(3, loaded.getNumCols());
+    for (uint32_t r = 0; r < 5; r++) {
+        for (uint32_t c = 0; c < 3; c++) EXPECT_EQ(matrix[r][c], loaded[r][c]);
+    }
+}
+
+TEST(BinaryDataFileTest, SamplesAndMetadata) {
+    GRT::MatrixDouble a = makeMatrix(2, 4), b = makeMatrix(7, 4);
+    std::string name = "named";
+    double score = 0.25;
+    vector<double> likelihoods = {0.1, 0.9};
+
+    BinaryDataFile::Writer writer(4, "Dataset");
+    writer.setLabelNames({"", "One", "Two"});
+    writer.addSample(2, a, &name, &score);
+    writer.addSample(1, b, nullptr, nullptr, &likelihoods);
+    ASSERT_TRUE(writer.save("samples.espb"));
+
+    BinaryDataFile file;
+    ASSERT_TRUE(file.open("samples.espb"));
+    ASSERT_EQ(4, file.getNumDimensions());
+    ASSERT_EQ(2, file.getNumSamples());
+    ASSERT_EQ(2, file.getNumLabels());
+    EXPECT_EQ("Two", file.getLabelName(2));
+    EXPECT_EQ("Dataset", file.getDatasetName());
+
+    EXPECT_EQ(2, file.getLabel(0));
+    EXPECT_EQ(2, file.getNumRows(0));
+    EXPECT_TRUE(file.hasName(0));
+    EXPECT_EQ("named", file.getName(0));
+    EXPECT_TRUE(file.hasScore(0));
+    EXPECT_EQ(0.25, file.getScore(0));
+    EXPECT_FALSE(file.hasLikelihoods(0));
+
+    EXPECT_EQ(1, file.getLabel(1));
+    EXPECT_FALSE(file.hasName(1));
+    EXPECT_FALSE(file.hasScore(1));
+    EXPECT_EQ(likelihoods, file.getLikelihoods(1));
+
+    GRT::MatrixDouble loaded;
+    file.copySample(1, loaded);
+    ASSERT_EQ(7, loaded.getNumRows());
+    EXPECT_EQ(b[6][3], loaded[6][3]);
+}
+
+TEST(BinaryDataFileTest, RejectsBadFiles) {
+    BinaryDataFile file;
+    EXPECT_FALSE(file.open("does-not-exist.espb"));
+
+    {
+        std::ofstream out("garbage.espb", std::ios::binary);
+        out << std::string(512, 'x');
+    }
+    EXPECT_FALSE(file.open("garbage.espb"));
+
+    GRT::MatrixDouble matrix = makeMatrix(100, 2);
+    ASSERT_TRUE(saveMatrixBinary("truncated.espb", matrix));
+    truncateFile("truncated.espb", 1000);
+    EXPECT_FALSE(file.open("truncated.espb"));
+}
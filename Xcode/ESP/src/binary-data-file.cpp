@@ -0,0 +1,454 @@
+#include "binary-data-file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char kMagic[4] = {'E', 'S', 'P', 'B'};
+const uint32_t kVersion = 1;
+
+// magic, version, header size, dimensions, labels, samples (4 bytes each),
+// rows (8 bytes), then an (offset, size) pair of uint64s per section.
+const uint32_t kSectionTableOffset = 32;
+
+// Per-sample flags.
+const uint8_t kHasName = 1 << 0;
+const uint8_t kHasScore = 1 << 1;
+const uint8_t kHasLikelihoods = 1 << 2;
+
+bool isLittleEndian() {
+    const uint16_t one = 1;
+    return *reinterpret_cast<const uint8_t*>(&one) == 1;
+}
+
+template <typename T>
+T fromLittleEndian(const uint8_t* p) {
+    T value;
+    if (isLittleEndian()) {
+        memcpy(&value, p, sizeof(T));
+    } else {
+        uint8_t bytes[sizeof(T)];
+        for (size_t i = 0; i < sizeof(T); i++) bytes[i] = p[sizeof(T) - 1 - i];
+        memcpy(&value, bytes, sizeof(T));
+    }
+    return value;
+}
+
+// Writes little-endian values to an ofstream, counting bytes for align().
+class LittleEndianWriter {
+  public:
+    explicit LittleEndianWriter(std::ofstream& file) : file_(file) {}
+
+    template <typename T>
+    void put(T value) {
+        uint8_t bytes[sizeof(T)];
+        memcpy(bytes, &value, sizeof(T));
+        if (!isLittleEndian()) std::reverse(bytes, bytes + sizeof(T));
+        file_.write(reinterpret_cast<const char*>(bytes), sizeof(T));
+        written_ += sizeof(T);
+    }
+
+    void putDoubles(const double* values, size_t n) {
+        if (isLittleEndian()) {
+            file_.write(reinterpret_cast<const char*>(values),
+                        n * sizeof(double));
+            written_ += n * sizeof(double);
+        } else {
+            for (size_t i = 0; i < n; i++) put(values[i]);
+        }
+    }
+
+    void putBytes(const std::string& s) {
+        file_.write(s.data(), s.size());
+        written_ += s.size();
+    }
+
+    // Pad with zeros to the next multiple of 8 bytes.
+    void align() {
+        while (written_ % 8 != 0) put<uint8_t>(0);
+    }
+
+  private:
+    std::ofstream& file_;
+    uint64_t written_ = 0;
+};
+
+uint64_t align8(uint64_t n) { return (n + 7) & ~uint64_t(7); }
+
+}  // namespace
+
+bool isBinaryDataFilename(const std::string& filename) {
+    const size_t n = strlen(kBinaryDataExtension);
+    return filename.size() >= n &&
+           filename.compare(filename.size() - n, n, kBinaryDataExtension) == 0;
+}
+
+bool BinaryDataFile::open(const std::string& filename) {
+    close();
+
+#ifndef _WIN32
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    size_t size = st.st_size;
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return false;
+
+    map_ = map;
+    data_ = static_cast<const uint8_t*>(map);
+#else
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file) return false;
+    size_t size = file.tellg();
+    buffer_.resize(size);
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(buffer_.data()), size)) {
+        buffer_.clear();
+        return false;
+    }
+    data_ = buffer_.data();
+#endif
+
+    if (!validate(size)) {
+        close();
+        return false;
+    }
+    size_ = size;
+    return true;
+}
+
+void BinaryDataFile::close() {
+#ifndef _WIN32
+    if (map_ != nullptr) munmap(map_, size_);
+#endif
+    map_ = nullptr;
+    buffer_.clear();
+    data_ = nullptr;
+    size_ = 0;
+    num_dimensions_ = num_labels_ = num_samples_ = 0;
+    num_rows_ = 0;
+}
+
+bool BinaryDataFile::validate(size_t size) {
+    // size_ is what close() unmaps, so set it before any early return.
+    size_ = size;
+
+    const uint64_t header_size = kSectionTableOffset + kNumSections * 16;
+    if (size < header_size) return false;
+    if (memcmp(data_, kMagic, sizeof(kMagic)) != 0) return false;
+    if (fromLittleEndian<uint32_t>(data_ + 4) != kVersion) return false;
+    if (fromLittleEndian<uint32_t>(data_ + 8) < header_size) return false;
+
+    num_dimensions_ = fromLittleEndian<uint32_t>(data_ + 12);
+    num_labels_ = fromLittleEndian<uint32_t>(data_ + 16);
+    num_samples_ = fromLittleEndian<uint32_t>(data_ + 20);
+    num_rows_ = fromLittleEndian<uint64_t>(data_ + 24);
+
+    for (int s = 0; s < kNumSections; s++) {
+        const uint8_t* entry = data_ + kSectionTableOffset + s * 16;
+        sections_[s] = fromLittleEndian<uint64_t>(entry);
+        section_sizes_[s] = fromLittleEndian<uint64_t>(entry + 8);
+        if (sections_[s] % 8 != 0) return false;
+        if (sections_[s] > size || section_sizes_[s] > size - sections_[s]) {
+            return false;
+        }
+    }
+
+    // Sizes of the fixed-width columns. num_rows_ * num_dimensions_ must not
+    // overflow before it is compared with the size of the values.
+    const uint64_t n = num_samples_;
+    if (num_dimensions_ != 0 &&
+        num_rows_ > std::numeric_limits<uint64_t>::max() / 8 / num_dimensions_) {
+        return false;
+    }
+    if (section_sizes_[kLabels] != 4 * n ||
+        section_sizes_[kFlags] != n ||
+        section_sizes_[kScores] != 8 * n ||
+        section_sizes_[kRowOffsets] != 8 * (n + 1) ||
+        section_sizes_[kLikelihoodOffsets] != 8 * (n + 1) ||
+        section_sizes_[kLikelihoods] % 8 != 0 ||
+        section_sizes_[kNameOffsets] != 8 * (n + 1) ||
+        section_sizes_[kLabelNameOffsets] != 8 * (uint64_t(num_labels_) + 1) ||
+        section_sizes_[kValues] != 8 * num_rows_ * num_dimensions_) {
+        return false;
+    }
+
+    // Readers size per-label tables by the label count, so every sample's
+    // label must be within it.
+    for (uint64_t i = 0; i < n; i++) {
+        if (fromLittleEndian<uint32_t>(section(kLabels) + 4 * i) > num_labels_) {
+            return false;
+        }
+    }
+
+    // Variable-length columns are addressed by offsets, which must start at 0,
+    // never decrease, and end at the end of the column.
+    return checkOffsets(kRowOffsets, n, num_rows_) &&
+           checkOffsets(kLikelihoodOffsets, n, section_sizes_[kLikelihoods] / 8) &&
+           checkOffsets(kNameOffsets, n, section_sizes_[kNames]) &&
+           checkOffsets(kLabelNameOffsets, num_labels_, section_sizes_[kLabelNames]);
+}
+
+bool BinaryDataFile::checkOffsets(Section offsets, uint64_t count,
+                                  uint64_t end) const {
+    uint64_t previous = 0;
+    for (uint64_t i = 0; i <= count; i++) {
+        uint64_t offset = readU64(offsets, i);
+        if (offset < previous || (i == 0 && offset != 0)) return false;
+        previous = offset;
+    }
+    return previous == end;
+}
+
+uint64_t BinaryDataFile::readU64(Section s, uint64_t i) const {
+    return fromLittleEndian<uint64_t>(section(s) + 8 * i);
+}
+
+double BinaryDataFile::readDouble(Section s, uint64_t i) const {
+    return fromLittleEndian<double>(section(s) + 8 * i);
+}
+
+std::string BinaryDataFile::readString(Section offsets, Section chars,
+                                       uint64_t i) const {
+    uint64_t begin = readU64(offsets, i);
+    uint64_t end = readU64(offsets, i + 1);
+    return std::string(reinterpret_cast<const char*>(section(chars)) + begin,
+                       end - begin);
+}
+
+std::string BinaryDataFile::getLabelName(uint32_t label) const {
+    if (label < 1 || label > num_labels_) return std::string();
+    return readString(kLabelNameOffsets, kLabelNames, label - 1);
+}
+
+std::string BinaryDataFile::getDatasetName() const {
+    return std::string(reinterpret_cast<const char*>(section(kDatasetName)),
+                       section_sizes_[kDatasetName]);
+}
+
+uint32_t BinaryDataFile::getLabel(uint32_t i) const {
+    return fromLittleEndian<uint32_t>(section(kLabels) + 4 * i);
+}
+
+uint32_t BinaryDataFile::getNumRows(uint32_t i) const {
+    return readU64(kRowOffsets, i + 1) - readU64(kRowOffsets, i);
+}
+
+void BinaryDataFile::copySample(uint32_t i, GRT::MatrixDouble& sample) const {
+    const uint64_t first_row = readU64(kRowOffsets, i);
+    const uint32_t num_rows = getNumRows(i);
+    sample.resize(num_rows, num_dimensions_);
+
+    const uint8_t* values = section(kValues) + 8 * first_row * num_dimensions_;
+    const size_t row_bytes = 8 * num_dimensions_;
+    for (uint32_t r = 0; r < num_rows; r++, values += row_bytes) {
+        if (isLittleEndian()) {
+            memcpy(sample[r], values, row_bytes);
+        } else {
+            for (uint32_t c = 0; c < num_dimensions_; c++) {
+                sample[r][c] = fromLittleEndian<double>(values + 8 * c);
+            }
+        }
+    }
+}
+
+bool BinaryDataFile::hasName(uint32_t i) const {
+    return section(kFlags)[i] & kHasName;
+}
+
+std::string BinaryDataFile::getName(uint32_t i) const {
+    return readString(kNameOffsets, kNames, i);
+}
+
+bool BinaryDataFile::hasScore(uint32_t i) const {
+    return section(kFlags)[i] & kHasScore;
+}
+
+double BinaryDataFile::getScore(uint32_t i) const {
+    return readDouble(kScores, i);
+}
+
+bool BinaryDataFile::hasLikelihoods(uint32_t i) const {
+    return section(kFlags)[i] & kHasLikelihoods;
+}
+
+vector<double> BinaryDataFile::getLikelihoods(uint32_t i) const {
+    uint64_t begin = readU64(kLikelihoodOffsets, i);
+    uint64_t end = readU64(kLikelihoodOffsets, i + 1);
+    vector<double> likelihoods;
+    likelihoods.reserve(end - begin);
+    for (uint64_t k = begin; k < end; k++) {
+        likelihoods.push_back(readDouble(kLikelihoods, k));
+    }
+    return likelihoods;
+}
+
+void BinaryDataFile::Writer::addSample(uint32_t label,
+                                       const GRT::MatrixDouble& data,
+                                       const std::string* name,
+                                       const double* score,
+                                       const vector<double>* likelihoods) {
+    samples_.push_back({label, &data, name, score, likelihoods});
+}
+
+bool BinaryDataFile::Writer::save(const std::string& filename) const {
+    const uint64_t n = samples_.size();
+
+    // Every label gets a name entry, empty if it wasn't given one.
+    uint64_t num_labels = label_names_.empty() ? 0 : label_names_.size() - 1;
+    for (const Sample& sample : samples_) {
+        num_labels = std::max<uint64_t>(num_labels, sample.label);
+    }
+    auto label_name_of = [this](uint64_t label) {
+        return label < label_names_.size() ? label_names_[label] : std::string();
+    };
+
+    uint64_t num_rows = 0, num_likelihoods = 0, names_size = 0;
+    for (const Sample& sample : samples_) {
+        if (sample.data->getNumRows() > 0 &&
+            sample.data->getNumCols() != num_dimensions_) {
+            return false;
+        }
+        num_rows += sample.data->getNumRows();
+        if (sample.likelihoods) num_likelihoods += sample.likelihoods->size();
+        if (sample.name) names_size += sample.name->size();
+    }
+    uint64_t label_names_size = 0;
+    for (uint64_t l = 1; l <= num_labels; l++) {
+        label_names_size += label_name_of(l).size();
+    }
+
+    uint64_t sizes[kNumSections];
+    sizes[kLabels] = 4 * n;
+    sizes[kFlags] = n;
+    sizes[kScores] = 8 * n;
+    sizes[kRowOffsets] = 8 * (n + 1);
+    sizes[kLikelihoodOffsets] = 8 * (n + 1);
+    sizes[kLikelihoods] = 8 * num_likelihoods;
+    sizes[kNameOffsets] = 8 * (n + 1);
+    sizes[kNames] = names_size;
+    sizes[kLabelNameOffsets] = 8 * (num_labels + 1);
+    sizes[kLabelNames] = label_names_size;
+    sizes[kDatasetName] = dataset_name_.size();
+    sizes[kValues] = 8 * num_rows * num_dimensions_;
+
+    uint64_t offsets[kNumSections];
+    uint64_t offset = kSectionTableOffset + kNumSections * 16;
+    for (int s = 0; s < kNumSections; s++) {
+        offsets[s] = offset;
+        offset = align8(offset + sizes[s]);
+    }
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+    LittleEndianWriter out(file);
+
+    out.putBytes(std::string(kMagic, sizeof(kMagic)));
+    out.put<uint32_t>(kVersion);
+    out.put<uint32_t>(kSectionTableOffset + kNumSections * 16);
+    out.put<uint32_t>(num_dimensions_);
+    out.put<uint32_t>(num_labels);
+    out.put<uint32_t>(n);
+    out.put<uint64_t>(num_rows);
+    for (int s = 0; s < kNumSections; s++) {
+        out.put<uint64_t>(offsets[s]);
+        out.put<uint64_t>(sizes[s]);
+    }
+
+    for (const Sample& sample : samples_) out.put<uint32_t>(sample.label);
+    out.align();
+
+    for (const Sample& sample : samples_) {
+        uint8_t flags = 0;
+        if (sample.name) flags |= kHasName;
+        if (sample.score) flags |= kHasScore;
+        if (sample.likelihoods) flags |= kHasLikelihoods;
+        out.put<uint8_t>(flags);
+    }
+    out.align();
+
+    for (const Sample& sample : samples_) {
+        out.put<double>(sample.score ? *sample.score : 0.0);
+    }
+
+    uint64_t row = 0;
+    out.put<uint64_t>(0);
+    for (const Sample& sample : samples_) {
+        row += sample.data->getNumRows();
+        out.put<uint64_t>(row);
+    }
+
+    uint64_t likelihood = 0;
+    out.put<uint64_t>(0);
+    for (const Sample& sample : samples_) {
+        if (sample.likelihoods) likelihood += sample.likelihoods->size();
+        out.put<uint64_t>(likelihood);
+    }
+    for (const Sample& sample : samples_) {
+        if (sample.likelihoods) {
+            out.putDoubles(sample.likelihoods->data(), sample.likelihoods->size());
+        }
+    }
+
+    uint64_t name = 0;
+    out.put<uint64_t>(0);
+    for (const Sample& sample : samples_) {
+        if (sample.name) name += sample.name->size();
+        out.put<uint64_t>(name);
+    }
+    for (const Sample& sample : samples_) {
+        if (sample.name) out.putBytes(*sample.name);
+    }
+    out.align();
+
+    uint64_t label_name = 0;
+    out.put<uint64_t>(0);
+    for (uint64_t l = 1; l <= num_labels; l++) {
+        label_name += label_name_of(l).size();
+        out.put<uint64_t>(label_name);
+    }
+    for (uint64_t l = 1; l <= num_labels; l++) out.putBytes(label_name_of(l));
+    out.align();
+
+    out.putBytes(dataset_name_);
+    out.align();
+
+    for (const Sample& sample : samples_) {
+        const GRT::MatrixDouble& data = *sample.data;
+        for (uint32_t r = 0; r < data.getNumRows(); r++) {
+            out.putDoubles(data[r], num_dimensions_);
+        }
+    }
+
+    return static_cast<bool>(file);
+}
+
+bool saveMatrixBinary(const std::string& filename,
+                      const GRT::MatrixDouble& matrix) {
+    BinaryDataFile::Writer writer(matrix.getNumCols(), "");
+    writer.addSample(0, matrix);
+    return writer.save(filename);
+}
+
+bool loadMatrixBinary(const std::string& filename, GRT::MatrixDouble& matrix) {
+    BinaryDataFile file;
+    if (!file.open(filename) || file.getNumSamples() != 1) return false;
+    file.copySample(0, matrix);
+    return true;
+}
@@ -0,0 +1,156 @@
+/** @file binary-data-file.h
+ *  @brief Reading and writing ESP's binary (.espb) format for training and
+ *  test data.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <GRT/GRT.h>
+
+using std::vector;
+
+// Extension of the binary format; other extensions are GRT's text format.
+const char kBinaryDataExtension[] = ".espb";
+
+// Whether filename should be read or written in the binary format.
+bool isBinaryDataFilename(const std::string& filename);
+
+/**
+ @brief A set of labelled time series samples with optional per-sample
+ metadata, in a versioned, little-endian, columnar file.
+
+ The file starts with a fixed header (magic "ESPB", version, counts and the
+ offset and size of each section), followed by one section per column: sample
+ labels, per-sample flags, scores, row ranges, class likelihoods, sample
+ names, label names, the dataset name, and finally the sample values as one
+ row-major array of doubles. Sections are 8-byte aligned, so once the file is
+ mapped into memory every column can be used in place.
+
+ Reading maps the file (on POSIX systems; elsewhere it is read into memory in
+ one go) and checks that every section lies within the file and agrees with
+ the counts in the header. After that, accessors only index into the mapping;
+ nothing is parsed.
+
+ Test data is stored as a single sample with label 0.
+ */
+class BinaryDataFile {
+  public:
+    BinaryDataFile() = default;
+    ~BinaryDataFile() { close(); }
+
+    /**
+     Map and validate a file.
+     @return false if the file can't be read or isn't a valid binary data file
+     of a supported version.
+     */
+    bool open(const std::string& filename);
+    void close();
+
+    uint32_t getNumDimensions() const { return num_dimensions_; }
+    uint32_t getNumSamples() const { return num_samples_; }
+
+    // Label names are stored for labels 1 to getNumLabels().
+    uint32_t getNumLabels() const { return num_labels_; }
+    std::string getLabelName(uint32_t label) const;
+    std::string getDatasetName() const;
+
+    uint32_t getLabel(uint32_t i) const;
+    uint32_t getNumRows(uint32_t i) const;
+
+    // Copy the values of sample i into sample, resizing it.
+    void copySample(uint32_t i, GRT::MatrixDouble& sample) const;
+
+    bool hasName(uint32_t i) const;
+    std::string getName(uint32_t i) const;
+    bool hasScore(uint32_t i) const;
+    double getScore(uint32_t i) const;
+    bool hasLikelihoods(uint32_t i) const;
+    vector<double> getLikelihoods(uint32_t i) const;
+
+    // Incrementally builds a file. Samples are referenced, not copied, until
+    // save() returns.
+    class Writer {
+      public:
+        Writer(uint32_t num_dimensions, const std::string& dataset_name)
+                : num_dimensions_(num_dimensions), dataset_name_(dataset_name) {}
+
+        // Names for labels 1 to label_names.size() - 1; index 0 is ignored.
+        void setLabelNames(const vector<std::string>& label_names) {
+            label_names_ = label_names;
+        }
+
+        // The pointers may be null if the sample doesn't have the metadata.
+        void addSample(uint32_t label, const GRT::MatrixDouble& data,
+                       const std::string* name = nullptr,
+                       const double* score = nullptr,
+                       const vector<double>* likelihoods = nullptr);
+
+        bool save(const std::string& filename) const;
+
+      private:
+        struct Sample {
+            uint32_t label;
+            const GRT::MatrixDouble* data;
+            const std::string* name;
+            const double* score;
+            const vector<double>* likelihoods;
+        };
+
+        uint32_t num_dimensions_;
+        std::string dataset_name_;
+        vector<std::string> label_names_;
+        vector<Sample> samples_;
+    };
+
+  private:
+    enum Section {
+        kLabels,            // uint32 per sample
+        kFlags,             // uint8 per sample, see kHas* in the .cpp
+        kScores,            // double per sample
+        kRowOffsets,        // uint64 per sample + 1, into the values
+        kLikelihoodOffsets, // uint64 per sample + 1, into kLikelihoods
+        kLikelihoods,       // double
+        kNameOffsets,       // uint64 per sample + 1, into kNames
+        kNames,             // UTF-8, not terminated
+        kLabelNameOffsets,  // uint64 per label + 1, into kLabelNames
+        kLabelNames,        // UTF-8, not terminated
+        kDatasetName,       // UTF-8, not terminated
+        kValues,            // double, row-major, num_dimensions per row
+        kNumSections
+    };
+
+    const uint8_t* section(Section s) const { return data_ + sections_[s]; }
+    uint64_t readU64(Section s, uint64_t i) const;
+    double readDouble(Section s, uint64_t i) const;
+    std::string readString(Section offsets, Section chars, uint64_t i) const;
+
+    bool validate(size_t size);
+    bool checkOffsets(Section offsets, uint64_t count, uint64_t end) const;
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+
+    // Set if the file is mapped; otherwise data_ points into buffer_.
+    void* map_ = nullptr;
+    vector<uint8_t> buffer_;
+
+    uint32_t num_dimensions_ = 0;
+    uint32_t num_labels_ = 0;
+    uint32_t num_samples_ = 0;
+    uint64_t num_rows_ = 0;
+    uint64_t sections_[kNumSections];
+    uint64_t section_sizes_[kNumSections];
+
+    BinaryDataFile(const BinaryDataFile&) = delete;
+    void operator=(const BinaryDataFile&) = delete;
+};
+
+// Save or load a single matrix (e.g. test data) in the binary format.
+bool saveMatrixBinary(const std::string& filename,
+                      const GRT::MatrixDouble& matrix);
+bool loadMatrixBinary(const std::string& filename, GRT::MatrixDouble& matrix);
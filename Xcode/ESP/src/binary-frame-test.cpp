@@ -0,0 +1,154 @@
+#include "binary-frame.h"
+#include "gtest/gtest.h"
+
+#include <cstring>
+
+namespace {
+
+std::vector<uint8_t> frame(uint16_t stream_id, uint32_t sequence,
+                           const std::vector<float>& values,
+                           uint16_t num_dimensions = 2) {
+    FrameHeader header;
+    header.stream_id = stream_id;
+    header.num_dimensions = num_dimensions;
+    header.num_samples = values.size() / num_dimensions;
+    header.sequence = sequence;
+    std::vector<uint8_t> out;
+    EXPECT_TRUE(encodeFrame(header, values.data(), &out));
+    return out;
+}
+
+void append(std::vector<uint8_t>* a, const std::vector<uint8_t>& b) {
+    a->insert(a->end(), b.begin(), b.end());
+}
+
+}  // namespace
+
+TEST(BinaryFrameTest, Crc32MatchesZlib) {
+    const char* text = "123456789";
+    EXPECT_EQ(0xCBF43926u,
+              crc32(reinterpret_cast<const uint8_t*>(text), strlen(text)));
+    EXPECT_EQ(0u, crc32(nullptr, 0));
+}
+
+TEST(BinaryFrameTest, EncodesLittleEndianLayout) {
+    std::vector<uint8_t> bytes = frame(0x0102, 0x03040506, {1.0f, -2.0f});
+    ASSERT_EQ(kFrameHeaderSize + 8 + kFrameTrailerSize, bytes.size());
+    EXPECT_EQ('E', bytes[0]);
+    EXPECT_EQ('S', bytes[1]);
+    EXPECT_EQ(kFrameVersion, bytes[2]);
+    EXPECT_EQ(0x02, bytes[4]);
+    EXPECT_EQ(0x01, bytes[5]);
+    EXPECT_EQ(2, bytes[6]);
+    EXPECT_EQ(1, bytes[8]);
+    EXPECT_EQ(0x06, bytes[12]);
+    EXPECT_EQ(0x03, bytes[15]);
+    // 1.0f is 0x3f800000.
+    EXPECT_EQ(0x00, bytes[24]);
+    EXPECT_EQ(0x80, bytes[26]);
+    EXPECT_EQ(0x3f, bytes[27]);
+
+    FrameHeader empty;
+    std::vector<uint8_t> out;
+    EXPECT_FALSE(encodeFrame(empty, nullptr, &out));
+    EXPECT_TRUE(out.empty());
+}
+
+TEST(BinaryFrameTest, DecodesFramesSplitAnywhere) {
+    std::vector<uint8_t> bytes = frame(1, 0, {1, 2, 3, 4});
+    append(&bytes, frame(1, 2, {5.5f, -6}));
+
+    for (size_t split = 0; split <= bytes.size(); split++) {
+        FrameDecoder decoder(2);
+        std::vector<double> samples;
+        size_t consumed = decoder.decode(bytes.data(), split, &samples);
+        std::vector<uint8_t> rest(bytes.begin() + consumed, bytes.end());
+        EXPECT_EQ(rest.size(), decoder.decode(rest.data(), rest.size(), &samples))
+            << "split at " << split;
+        EXPECT_EQ(std::vector<double>({1, 2, 3, 4, 5.5, -6}), samples);
+        EXPECT_EQ(2u, decoder.getStats().frames);
+        EXPECT_EQ(3u, decoder.getStats().samples);
+        EXPECT_EQ(0u, decoder.getStats().lost_samples);
+        EXPECT_EQ(0u, decoder.getStats().skipped_bytes);
+    }
+}
+
+TEST(BinaryFrameTest, CountsLostAndLateSamplesPerStream) {
+    std::vector<uint8_t> bytes = frame(1, 10, {1, 1});
+    append(&bytes, frame(2, 0, {2, 2}));
+    append(&bytes, frame(1, 14, {3, 3, 4, 4}));  // 11..13 lost
+    append(&bytes, frame(1, 12, {5, 5}));        // late
+    append(&bytes, frame(2, 1, {6, 6}));
+    append(&bytes, frame(1, 16, {7, 7}));
+
+    FrameDecoder decoder(2);
+    std::vector<double> samples;
+    EXPECT_EQ(bytes.size(), decoder.decode(bytes.data(), bytes.size(), &samples));
+    EXPECT_EQ(std::vector<double>({1, 1, 2, 2, 3, 3, 4, 4, 6, 6, 7, 7}),
+              samples);
+    FrameStats stats = decoder.getStats();
+    EXPECT_EQ(6u, stats.frames);
+    EXPECT_EQ(6u, stats.samples);
+    EXPECT_EQ(3u, stats.lost_samples);
+    EXPECT_EQ(1u, stats.late_frames);
+}
+
+TEST(BinaryFrameTest, HandlesSequenceWrapAround) {
+    std::vector<uint8_t> bytes = frame(0, 0xFFFFFFFE, {1, 1, 2, 2});
+    append(&bytes, frame(0, 1, {3, 3}));  // 0 lost
+
+    FrameDecoder decoder(2);
+    std::vector<double> samples;
+    decoder.decode(bytes.data(), bytes.size(), &samples);
+    EXPECT_EQ(3u, decoder.getStats().samples);
+    EXPECT_EQ(1u, decoder.getStats().lost_samples);
+    EXPECT_EQ(0u, decoder.getStats().late_frames);
+}
+
+TEST(BinaryFrameTest, FollowsSenderRestarts) {
+    // A far jump back restarts the stream at once.
+    std::vector<uint8_t> bytes = frame(1, 100000, {1, 1});
+    append(&bytes, frame(1, 0, {2, 2}));
+    append(&bytes, frame(1, 1, {3, 3}));
+
+    FrameDecoder decoder(2);
+    std::vector<double> samples;
+    decoder.decode(bytes.data(), bytes.size(), &samples);
+    EXPECT_EQ(std::vector<double>({1, 1, 2, 2, 3, 3}), samples);
+    EXPECT_EQ(1u, decoder.getStats().restarts);
+    EXPECT_EQ(0u, decoder.getStats().late_frames);
+    EXPECT_EQ(0u, decoder.getStats().lost_samples);
+
+    // A short one is taken for reordering until too many frames are late.
+    bytes = frame(2, 500, {1, 1});
+    for (uint32_t i = 0; i < kMaxLateFrames; i++) {
+        append(&bytes, frame(2, i, {2, 2}));
+    }
+    append(&bytes, frame(2, kMaxLateFrames, {3, 3}));
+    samples.clear();
+    decoder.decode(bytes.data(), bytes.size(), &samples);
+    EXPECT_EQ(std::vector<double>({1, 1, 2, 2, 3, 3}), samples);
+    EXPECT_EQ(2u, decoder.getStats().restarts);
+    EXPECT_EQ(kMaxLateFrames - 1, decoder.getStats().late_frames);
+    EXPECT_EQ(0u, decoder.getStats().lost_samples);
+}
+
+TEST(BinaryFrameTest, ResynchronizesAfterGarbageAndBadChecksums) {
+    std::vector<uint8_t> bytes = {'x', 'E', 'y', 'E', 'S'};
+    std::vector<uint8_t> corrupt = frame(0, 0, {1, 1});
+    corrupt[kFrameHeaderSize] ^= 0x40;
+    append(&bytes, corrupt);
+    append(&bytes, frame(0, 1, {2, 2}));
+    append(&bytes, frame(0, 2, {3, 3, 3}, 3));  // wrong dimensions
+    append(&bytes, frame(0, 3, {4, 4}));
+
+    FrameDecoder decoder(2);
+    std::vector<double> samples;
+    EXPECT_EQ(bytes.size(), decoder.decode(bytes.data(), bytes.size(), &samples));
+    EXPECT_EQ(std::vector<double>({2, 2, 4, 4}), samples);
+    FrameStats stats = decoder.getStats();
+    EXPECT_EQ(1u, stats.checksum_errors);
+    EXPECT_EQ(1u, stats.dimension_errors);
+    EXPECT_EQ(5u + corrupt.size(), stats.skipped_bytes);
+    EXPECT_EQ(1u, stats.lost_samples);
+}
@@ -0,0 +1,190 @@
+#include "binary-frame.h"
+
+#include <cstring>
+
+namespace {
+
+const uint8_t kMagic[2] = {'E', 'S'};
+
+const uint32_t* crcTable() {
+    static const struct Table {
+        uint32_t entries[256];
+        Table() {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                entries[i] = c;
+            }
+        }
+    } table;
+    return table.entries;
+}
+
+void put16(uint8_t* p, uint16_t v) {
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+void put32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (v >> (8 * i)) & 0xff;
+}
+
+void put64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (v >> (8 * i)) & 0xff;
+}
+
+uint16_t get16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+uint32_t get32(const uint8_t* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) |
+           (uint32_t(p[3]) << 24);
+}
+
+float getFloat(const uint8_t* p) {
+    uint32_t bits = get32(p);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+}  // namespace
+
+uint32_t crc32(const uint8_t* data, size_t size) {
+    const uint32_t* table = crcTable();
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++) {
+        c = table[(c ^ data[i]) & 0xff] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFFu;
+}
+
+bool encodeFrame(const FrameHeader& header, const float* samples,
+                 vector<uint8_t>* out) {
+    const uint32_t num_values =
+        uint32_t(header.num_dimensions) * header.num_samples;
+    if (num_values == 0 || num_values > kMaxFrameValues) return false;
+
+    const size_t start = out->size();
+    out->resize(start + kFrameHeaderSize + 4 * num_values + kFrameTrailerSize);
+    uint8_t* p = &(*out)[start];
+    p[0] = kMagic[0];
+    p[1] = kMagic[1];
+    p[2] = kFrameVersion;
+    p[3] = 0;
+    put16(p + 4, header.stream_id);
+    put16(p + 6, header.num_dimensions);
+    put16(p + 8, header.num_samples);
+    put16(p + 10, 0);
+    put32(p + 12, header.sequence);
+    put64(p + 16, 0);
+    for (uint32_t i = 0; i < num_values; i++) {
+        uint32_t bits;
+        std::memcpy(&bits, &samples[i], sizeof(bits));
+        put32(p + kFrameHeaderSize + 4 * i, bits);
+    }
+    const size_t body = kFrameHeaderSize + 4 * num_values;
+    put32(p + body, crc32(p, body));
+    return true;
+}
+
+void FrameStats::add(const FrameStats& other) {
+    frames += other.frames;
+    samples += other.samples;
+    lost_samples += other.lost_samples;
+    late_frames += other.late_frames;
+    restarts += other.restarts;
+    checksum_errors += other.checksum_errors;
+    dimension_errors += other.dimension_errors;
+    skipped_bytes += other.skipped_bytes;
+}
+
+size_t FrameDecoder::decode(const uint8_t* data, size_t size,
+                            vector<double>* samples) {
+    size_t pos = 0;
+    while (pos < size) {
+        // Find the next frame start.
+        const uint8_t* magic = static_cast<const uint8_t*>(
+            std::memchr(data + pos, kMagic[0], size - pos));
+        if (magic == nullptr) {
+            stats_.skipped_bytes += size - pos;
+            return size;
+        }
+        stats_.skipped_bytes += magic - (data + pos);
+        pos = magic - data;
+
+        const uint8_t* p = data + pos;
+        const size_t available = size - pos;
+        // Wait for the rest of the header unless what we have already rules
+        // it out.
+        if ((available > 1 && p[1] != kMagic[1]) ||
+            (available > 2 && p[2] != kFrameVersion)) {
+            stats_.skipped_bytes++;
+            pos++;
+            continue;
+        }
+        if (available < kFrameHeaderSize) return pos;
+
+        const uint32_t num_dimensions = get16(p + 6);
+        const uint32_t num_samples = get16(p + 8);
+        const uint32_t num_values = num_dimensions * num_samples;
+        if (num_values == 0 || num_values > kMaxFrameValues) {
+            stats_.skipped_bytes++;
+            pos++;
+            continue;
+        }
+        const size_t body = kFrameHeaderSize + 4 * num_values;
+        if (available < body + kFrameTrailerSize) return pos;
+
+        if (crc32(p, body) != get32(p + body)) {
+            stats_.checksum_errors++;
+            stats_.skipped_bytes++;
+            pos++;
+            continue;
+        }
+        pos += body + kFrameTrailerSize;
+        stats_.frames++;
+
+        if (num_dimensions != num_dimensions_) {
+            stats_.dimension_errors++;
+            continue;
+        }
+
+        const uint16_t stream_id = get16(p + 4);
+        const uint32_t sequence = get32(p + 12);
+        auto stream = streams_.find(stream_id);
+        if (stream != streams_.end()) {
+            StreamState& state = stream->second;
+            // Differences of sequence numbers, which wrap around.
+            const int32_t gap = static_cast<int32_t>(sequence - state.next_sequence);
+            if (gap >= 0) {
+                stats_.lost_samples += gap;
+            } else if (-static_cast<int64_t>(gap) <= kFrameReorderWindow &&
+                       ++state.late_frames < kMaxLateFrames) {
+                stats_.late_frames++;
+                continue;
+            } else {
+                stats_.restarts++;
+            }
+        }
+        streams_[stream_id] = StreamState{sequence + num_samples, 0};
+
+        const uint8_t* values = p + kFrameHeaderSize;
+        const size_t old_size = samples->size();
+        samples->resize(old_size + num_values);
+        double* out = samples->data() + old_size;
+        for (uint32_t i = 0; i < num_values; i++) {
+            out[i] = getFloat(values + 4 * i);
+        }
+        stats_.samples += num_samples;
+    }
+    return pos;
+}
+
+void FrameDecoder::reset() {
+    streams_.clear();
+    stats_ = FrameStats();
+}
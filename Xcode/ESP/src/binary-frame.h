@@ -0,0 +1,127 @@
+/** @file binary-frame.h
+ *  @brief A compact binary framing for samples sent over the network, with
+ *  its encoder and a decoder that accounts for lost samples.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+using std::vector;
+
+/**
+ A frame carries num_samples consecutive samples of one stream. All fields
+ are little-endian:
+
+     offset  type       field
+      0      uint8[2]   magic, "ES"
+      2      uint8      version, kFrameVersion
+      3      uint8      flags, 0 (reserved)
+      4      uint16     stream id
+      6      uint16     number of dimensions
+      8      uint16     number of samples
+     10      uint16     reserved, 0
+     12      uint32     sequence number of the first sample
+     16      uint8[8]   reserved, 0
+     24      float32[]  the samples, row-major
+     ...     uint32     CRC-32 of everything before it
+
+ Sequence numbers count samples, not frames, so that the receiver knows
+ exactly how many samples went missing between two frames. There is no
+ timestamp: the receiver stamps samples with their arrival time on its own
+ clock, which a sender's clock can't be compared with.
+ */
+const uint8_t kFrameVersion = 1;
+const size_t kFrameHeaderSize = 24;
+const size_t kFrameTrailerSize = 4;
+// Largest number of values (samples x dimensions) in one frame.
+const uint32_t kMaxFrameValues = 64 * 1024;
+// A frame at most this many samples behind the sequence expected is taken to
+// have been reordered; one further behind means the sender has restarted.
+const uint32_t kFrameReorderWindow = 1024;
+// Consecutive late frames after which a stream is taken to have restarted
+// within the reorder window.
+const uint32_t kMaxLateFrames = 4;
+
+struct FrameHeader {
+    uint16_t stream_id = 0;
+    uint16_t num_dimensions = 0;
+    uint16_t num_samples = 0;
+    uint32_t sequence = 0;
+};
+
+// CRC-32 (as in zlib) of size bytes.
+uint32_t crc32(const uint8_t* data, size_t size);
+
+/**
+ Append one frame holding header.num_samples samples of
+ header.num_dimensions values each to out.
+ @return false (and leave out unchanged) if the frame would be empty or have
+ more than kMaxFrameValues values.
+ */
+bool encodeFrame(const FrameHeader& header, const float* samples,
+                 vector<uint8_t>* out);
+
+struct FrameStats {
+    uint64_t frames = 0;           // valid frames received
+    uint64_t samples = 0;          // samples delivered
+    uint64_t lost_samples = 0;     // sequence numbers skipped over
+    uint64_t late_frames = 0;      // duplicate or out-of-order frames dropped
+    uint64_t restarts = 0;         // sequence numbers that started over
+    uint64_t checksum_errors = 0;  // frames with a bad CRC
+    uint64_t dimension_errors = 0; // frames with the wrong number of dimensions
+    uint64_t skipped_bytes = 0;    // bytes that weren't part of a valid frame
+
+    void add(const FrameStats& other);
+};
+
+/**
+ *  @brief Decodes frames from a byte stream and checks their sequence
+ *  numbers, per stream id.
+ *
+ *  The decoder resynchronizes on its own: bytes before a frame header, and
+ *  the first byte of a frame whose CRC doesn't match, are skipped. A frame
+ *  whose sequence number is ahead of the one expected counts the gap as
+ *  lost; one slightly behind (a duplicate, or reordered by UDP) is dropped.
+ *  A stream whose sequence numbers jump back further than
+ *  kFrameReorderWindow, or that sends kMaxLateFrames late frames in a row,
+ *  is taken to have restarted (e.g. the sender rebooted): the decoder
+ *  resynchronizes to its new sequence numbers and counts a restart.
+ */
+class FrameDecoder {
+  public:
+    explicit FrameDecoder(uint32_t num_dimensions)
+        : num_dimensions_(num_dimensions) {
+    }
+
+    /**
+     Decode the complete frames at the start of [data, data + size) and append
+     their samples, converted to double, to samples.
+     @return the number of bytes consumed. The rest is the start of a frame
+     that isn't complete yet; pass it again, followed by more data.
+     */
+    size_t decode(const uint8_t* data, size_t size, vector<double>* samples);
+
+    // Count the bytes of an incomplete frame that will never be completed,
+    // e.g. at the end of a UDP datagram.
+    void discard(size_t size) { stats_.skipped_bytes += size; }
+
+    // Forget the expected sequence numbers and the counters.
+    void reset();
+
+    uint32_t getNumDimensions() const { return num_dimensions_; }
+    const FrameStats& getStats() const { return stats_; }
+
+  private:
+    struct StreamState {
+        uint32_t next_sequence;
+        uint32_t late_frames;  // in a row
+    };
+
+    uint32_t num_dimensions_;
+    std::map<uint16_t, StreamState> streams_;
+    FrameStats stats_;
+};
@@ -1,5 +1,8 @@
-#include "MFCC.h"
+#include "MelFrontEnd.h"
+#include "batch-pipeline.h"
+#include "binary-data-file.h"
 #include "matplotlibcpp.h"
+#include "session.h"
 #include "training-data-manager.h"
 #include <GRT/GRT.h>
 #include <assert.h>
@@ -10,15 +13,17 @@
 namespace plt = matplotlibcpp;
 
 constexpr uint32_t kNumMaxLabels = 9;
-constexpr char kTrainingDataFilename[] = "TrainingData.grt";
-constexpr char kTestDataFilename[] = "TestData.grt";
-constexpr char kPipelineFilename[] = "Pipeline.grt";
 constexpr uint32_t downsample_rate = 5;
 constexpr uint32_t sample_rate = 44100 / downsample_rate;
 // frame duration = 23 ms (512 samples)
 constexpr uint32_t kFFT_WindowSize = 256;
 constexpr uint32_t kFFT_HopSize = 128;
-constexpr uint32_t DIM = 1;
+
+// Prefer the binary data files of a session; older sessions only have GRT
+// text files.
+static std::string sessionFile(const char* binary, const char* text) {
+    return access(binary, F_OK) == 0 ? binary : text;
+}
 
 int main(int argc, char* argv[]) {
     bool draw_sample = false;
@@ -37,13 +42,11 @@ int main(int argc, char* argv[]) {
     // TODO(benzh) Convert this to user code loading
     GRT::GestureRecognitionPipeline pipeline;
 
-    pipeline.addFeatureExtractionModule(
-        GRT::FFT(kFFT_WindowSize, kFFT_HopSize,
-                 DIM, GRT::FFT::HAMMING_WINDOW, true, false));
-
-    GRT::MFCC::Options options;
+    GRT::MelFrontEnd::Options options;
     options.sample_rate = sample_rate;
-    options.fft_size = kFFT_WindowSize / 2;
+    options.window_size = kFFT_WindowSize;
+    options.hop_size = kFFT_HopSize;
+    options.window = GRT::MelFrontEnd::kHammingWindow;
     options.start_freq = 300;
     options.end_freq = 8000;
     options.num_tri_filter = 26;
@@ -52,15 +55,20 @@ int main(int argc, char* argv[]) {
     options.use_vad = true;
     options.noise_level = 5;
 
-    pipeline.addFeatureExtractionModule(GRT::MFCC(options));
+    pipeline.addFeatureExtractionModule(GRT::MelFrontEnd(options));
     pipeline.setClassifier(GRT::GMM(16, true, false, 1, 100, 0.001));
     pipeline.addPostProcessingModule(GRT::ClassLabelFilter(25, 40));
 
     TrainingDataManager training_data_manager(kNumMaxLabels);
 
+    const std::string training_data_file =
+        sessionFile(kTrainingDataBinaryFilename, kTrainingDataFilename);
+    const std::string test_data_file =
+        sessionFile(kTestDataBinaryFilename, kTestDataFilename);
+
     if (!load_pipeline) {
         // We load the training data and train the model
-        if (training_data_manager.load(kTrainingDataFilename)) {
+        if (training_data_manager.load(training_data_file)) {
             auto d = training_data_manager.getSample(1, 2);
 
             if (draw_sample) {
@@ -81,8 +89,11 @@ int main(int argc, char* argv[]) {
     }
 
     GRT::MatrixDouble test_data;
-    if (!test_data.load(kTestDataFilename)) {
-        std::cout << "Failed to load test data from " << kTestDataFilename
+    bool loaded = isBinaryDataFilename(test_data_file) ?
+        loadMatrixBinary(test_data_file, test_data) :
+        test_data.load(test_data_file);
+    if (!loaded) {
+        std::cout << "Failed to load test data from " << test_data_file
                   << std::endl;
         return -1;
     }
@@ -97,15 +108,18 @@ int main(int argc, char* argv[]) {
     std::cout << "Running testing" << std::endl;
 
     // Run test data through
+    BatchPrediction prediction;
+    if (!predictBatch(pipeline, test_data, prediction)) {
+        std::cout << "Failed to run the test data" << std::endl;
+        return -1;
+    }
+
     for (uint32_t i = 0; i < test_data.getNumRows(); i++) {
-        auto td = test_data.getRowVector(i);
-        pipeline.predict(td);
-        uint32_t predicted_label = pipeline.getPredictedClassLabel();
-        auto ds = pipeline.getClassDistances();
+        const auto& ds = prediction.distances[i];
 
-        audio[i] = td[0];
+        audio[i] = test_data[i][0];
         x[i] = i;
-        preds[i] = static_cast<double>(predicted_label);
+        preds[i] = static_cast<double>(prediction.labels[i]);
         distances1[i] = ds[0];
         distances2[i] = ds[1];
     }
@@ -2,6 +2,7 @@
  * Gesture detection using accelerometers. See the <a href="https://create.arduino.cc/projecthub/mellis/gesture-recognition-using-accelerometer-and-esp-mac-only-71faa1">associated tutorial</a>.
  */
 #include <ESP.h>
+#include <PrunedDTW.h>
 
 ASCIISerialStream stream(115200, 3);
 GestureRecognitionPipeline pipeline;
@@ -125,7 +126,7 @@ void setup()
         "Rest accelerometer upside down on flat surface.", upsideDownDataCollected);
     useCalibrator(calibrator);
 
-    DTW dtw(false, true, null_rej);
+    PrunedDTW dtw(false, true, null_rej);
     dtw.enableTrimTrainingData(true, 0.1, 75);
 
     pipeline.setClassifier(dtw);
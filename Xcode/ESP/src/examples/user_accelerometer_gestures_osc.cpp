@@ -1,6 +1,7 @@
 /** @example user_accelerometer_gestures_osc.cpp
  */
 #include <ESP.h>
+#include <PrunedDTW.h>
 
 OscInputStream stream(8001, "/gyrosc/accel", 3);
 GestureRecognitionPipeline pipeline;
@@ -12,7 +13,7 @@ void setup() {
     stream.setLabelsForAllDimensions({"x", "y", "z"});
     useInputStream(stream);
 
-    DTW dtw(false, true, null_rej);
+    PrunedDTW dtw(false, true, null_rej);
     dtw.enableTrimTrainingData(true, 0.1, 75);
 
     pipeline.setClassifier(dtw);
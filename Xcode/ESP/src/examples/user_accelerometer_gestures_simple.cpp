@@ -1,4 +1,5 @@
 #include <ESP.h>
+#include <PrunedDTW.h>
 
 ASCIISerialStream iStream(115200, 3);
 TcpOStream oStream("localhost", 5204);
@@ -52,7 +53,7 @@ void setup() {
         "Rest accelerometer on flat surface.", restingDataCollected);
     useCalibrator(calibrator);
   
-    DTW dtw(false, true, null_rej);
+    PrunedDTW dtw(false, true, null_rej);
 
     pipeline.setClassifier(dtw);
     usePipeline(pipeline);
@@ -2,13 +2,12 @@
  * Speaker identification with MFCC and GMM.
  */
 #include <ESP.h>
-#include <MFCC.h>
+#include <MelFrontEnd.h>
 
 constexpr uint32_t kDownsample = 5;
 constexpr uint32_t kSampleRate = 44100 / 5;  // 8820
 constexpr uint32_t kFftWindowSize = 256;     // 256 samples => 30 ms, frame size
 constexpr uint32_t kFftHopSize = 128;        // 128 samples => 15 ms, hop size
-constexpr uint32_t DIM = 1;
 
 AudioStream stream(kDownsample);
 GestureRecognitionPipeline pipeline;
@@ -22,13 +21,12 @@ double noise_level = 5.0f;   // Noise level, the unit is not yet standardized)
 void setup() {
     stream.setLabelsForAllDimensions({"audio"});
 
-    pipeline.addFeatureExtractionModule(
-        FFT(kFftWindowSize, kFftHopSize,
-            DIM, FFT::HAMMING_WINDOW, true, false));
-
-    MFCC::Options options;
+    // Windowing, FFT and MFCC in one module.
+    MelFrontEnd::Options options;
     options.sample_rate = kSampleRate;
-    options.fft_size = kFftWindowSize / 2;
+    options.window_size = kFftWindowSize;
+    options.hop_size = kFftHopSize;
+    options.window = MelFrontEnd::kHammingWindow;
     options.start_freq = 300;
     options.end_freq = 3700;
     options.num_tri_filter = 26;
@@ -37,7 +35,7 @@ void setup() {
     options.use_vad = true;
     options.noise_level = noise_level;
 
-    pipeline.addFeatureExtractionModule(MFCC(options));
+    pipeline.addFeatureExtractionModule(MelFrontEnd(options));
 
     pipeline.setClassifier(SVM());
     // GMM(16, true, false, 1, 100, 0.001));
@@ -71,8 +69,9 @@ void setup() {
     };
 
     auto noise_updater = [](int new_noise_level) {
-        MFCC *mfcc = dynamic_cast<MFCC*>(pipeline.getFeatureExtractionModule(1));
-        mfcc->setNoiseLevel(new_noise_level);
+        MelFrontEnd *front_end =
+            dynamic_cast<MelFrontEnd*>(pipeline.getFeatureExtractionModule(0));
+        front_end->setNoiseLevel(new_noise_level);
     };
 
     registerTuneable(noise_level, 0, 20,
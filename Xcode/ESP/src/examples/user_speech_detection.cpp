@@ -9,14 +9,11 @@
 class LogEnergy : public Filter {
 public:
     LogEnergy(UINT filterSize = 5,UINT numDimensions = 1)
-        : Filter("LogEnergy", filterSize, numDimensions)
+        : Filter("LogEnergy", filterSize, numDimensions, SUM_OF_SQUARES)
     {}
     
-    double computeFilter(const VectorDouble &buf) {
-        double energy = 0;
-        for (int i = 0; i < buf.size(); i++) {
-            energy += buf[i] * buf[i];
-        }
+    // The aggregate is the energy of the window.
+    double computeFilterFromAggregate(double energy) const {
         return log(energy);
     }
     
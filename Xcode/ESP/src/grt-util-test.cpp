@@ -0,0 +1,87 @@
+#include "grt-util.h"
+#include "gtest/gtest.h"
+
+#include <cfloat>
+#include <cmath>
+
+using namespace grt_util;
+
+TEST(GrtUtilTest, SummarizesNearestTemplates) {
+    // Class 0 has nearest costs 4 and 16 (distances 2 and 4); class 1 has a
+    // single template, which borrows class 0's statistics.
+    vector<UINT> classIndex = {0, 0, 1};
+    vector<double> nearest = {4, 16, INFINITY};
+    vector<double> mu, sigma;
+    summarizeNearestTemplates(2, classIndex, nearest, mu, sigma);
+    ASSERT_EQ(2, mu.size());
+    EXPECT_DOUBLE_EQ(3, mu[0]);
+    EXPECT_DOUBLE_EQ(std::sqrt(2.0), sigma[0]);
+    EXPECT_DOUBLE_EQ(mu[0], mu[1]);
+    EXPECT_DOUBLE_EQ(sigma[0], sigma[1]);
+
+    vector<double> thresholds;
+    computeNullRejectionThresholds(mu, sigma, 2, thresholds);
+    EXPECT_DOUBLE_EQ(3 + 2 * std::sqrt(2.0), thresholds[0]);
+
+    // No class with two templates: nothing can be rejected.
+    summarizeNearestTemplates(2, {0, 1}, {INFINITY, INFINITY}, mu, sigma);
+    EXPECT_LT(sigma[0], 0);
+    computeNullRejectionThresholds(mu, sigma, 2, thresholds);
+    EXPECT_EQ(DBL_MAX, thresholds[1]);
+}
+
+TEST(GrtUtilTest, LearnsFromTheNearestTemplateOfEachClass) {
+    vector<UINT> classIndex = {0, 0, 0};
+    const double position[] = {0, 1, 3};
+    vector<double> mu, sigma;
+    learnNearestTemplateStatistics(
+        1, classIndex,
+        [&](UINT a, UINT b, double) {
+            double d = position[a] - position[b];
+            return d * d;
+        },
+        mu, sigma);
+    // Nearest distances are 1, 1 and 2.
+    EXPECT_DOUBLE_EQ(4.0 / 3, mu[0]);
+    EXPECT_DOUBLE_EQ(std::sqrt(1.0 / 3), sigma[0]);
+}
+
+TEST(GrtUtilTest, ComputesClassLikelihoods) {
+    vector<double> likelihoods;
+    EXPECT_EQ(1, computeClassLikelihoods({3, 1, DBL_MAX}, likelihoods));
+    ASSERT_EQ(3, likelihoods.size());
+    EXPECT_NEAR(0.25, likelihoods[0], 1e-5);
+    EXPECT_NEAR(0.75, likelihoods[1], 1e-5);
+    EXPECT_EQ(0, likelihoods[2]);
+
+    EXPECT_EQ(2, computeClassLikelihoods({DBL_MAX, DBL_MAX}, likelihoods));
+    EXPECT_EQ(0, likelihoods[0]);
+}
+
+TEST(GrtUtilTest, SavesAndLoadsTemplates) {
+    {
+        fstream file("grt-util.txt", std::ios::out);
+        file << "NumClasses: " << 2 << std::endl;
+        saveTemplate(file, 1, 2, 2, vector<float>{1, 2, 3.5f, -4});
+        saveTrainingStatistics(file, {1, 2}, {0.5, -1});
+    }
+    fstream file("grt-util.txt", std::ios::in);
+    UINT numClasses = 0, classIndex = 0, length = 0;
+    ASSERT_TRUE(readValue(file, "NumClasses:", numClasses));
+    EXPECT_EQ(2, numClasses);
+    vector<float> data;
+    ASSERT_TRUE(loadTemplate(file, numClasses, 2, classIndex, length, data));
+    EXPECT_EQ(1, classIndex);
+    EXPECT_EQ(2, length);
+    EXPECT_EQ((vector<float>{1, 2, 3.5f, -4}), data);
+    vector<double> mu, sigma;
+    ASSERT_TRUE(loadTrainingStatistics(file, numClasses, mu, sigma));
+    EXPECT_EQ((vector<double>{1, 2}), mu);
+    EXPECT_EQ((vector<double>{0.5, -1}), sigma);
+
+    // Template class indices must be below the number of classes.
+    fstream again("grt-util.txt", std::ios::in);
+    ASSERT_TRUE(readValue(again, "NumClasses:", numClasses));
+    EXPECT_FALSE(loadTemplate(again, 1, 2, classIndex, length, data));
+    EXPECT_FALSE(readValue(again, "Missing:", numClasses));
+}
@@ -0,0 +1,108 @@
+#include "grt-util.h"
+
+#include <cmath>
+
+namespace grt_util {
+
+void summarizeNearestTemplates(UINT numClasses, const vector<UINT>& classIndex,
+                               const vector<double>& nearest,
+                               vector<double>& mu, vector<double>& sigma) {
+    mu.assign(numClasses, 0);
+    sigma.assign(numClasses, -1);
+    for (UINT c = 0; c < numClasses; c++) {
+        vector<double> distances;
+        for (UINT i = 0; i < classIndex.size(); i++) {
+            if (classIndex[i] != c) continue;
+            if (nearest[i] < std::numeric_limits<double>::infinity()) {
+                distances.push_back(std::sqrt(nearest[i]));
+            }
+        }
+        if (distances.size() < 2) continue;
+
+        double mean = 0;
+        for (double d : distances) mean += d;
+        mean /= distances.size();
+        double variance = 0;
+        for (double d : distances) variance += (d - mean) * (d - mean);
+        mu[c] = mean;
+        sigma[c] = std::sqrt(variance / (distances.size() - 1));
+    }
+
+    // Classes with too few templates borrow the average of the others.
+    double meanMu = 0;
+    double meanSigma = 0;
+    UINT counted = 0;
+    for (UINT c = 0; c < numClasses; c++) {
+        if (sigma[c] < 0) continue;
+        meanMu += mu[c];
+        meanSigma += sigma[c];
+        counted++;
+    }
+    if (counted == 0) return;
+    for (UINT c = 0; c < numClasses; c++) {
+        if (sigma[c] >= 0) continue;
+        mu[c] = meanMu / counted;
+        sigma[c] = meanSigma / counted;
+    }
+}
+
+void computeNullRejectionThresholds(const vector<double>& mu,
+                                    const vector<double>& sigma,
+                                    double coeff,
+                                    vector<double>& thresholds) {
+    thresholds.resize(mu.size());
+    for (UINT c = 0; c < mu.size(); c++) {
+        if (sigma[c] < 0) {
+            // No class has two templates to learn a threshold from.
+            thresholds[c] = std::numeric_limits<double>::max();
+        } else {
+            thresholds[c] = mu[c] + coeff * sigma[c];
+        }
+    }
+}
+
+UINT computeClassLikelihoods(const vector<double>& distances,
+                             vector<double>& likelihoods) {
+    const UINT numClasses = distances.size();
+    likelihoods.assign(numClasses, 0);
+
+    UINT best = numClasses;
+    double sum = 0;
+    for (UINT c = 0; c < numClasses; c++) {
+        if (distances[c] == std::numeric_limits<double>::max()) continue;
+        likelihoods[c] = 1.0 / (distances[c] + 1.0e-5);
+        sum += likelihoods[c];
+        if (best == numClasses || distances[c] < distances[best]) best = c;
+    }
+    if (sum > 0) {
+        for (UINT c = 0; c < numClasses; c++) likelihoods[c] /= sum;
+    }
+    return best;
+}
+
+void saveTrainingStatistics(fstream& file, const vector<double>& mu,
+                            const vector<double>& sigma) {
+    file << "TrainingMu:";
+    for (double x : mu) file << " " << x;
+    file << std::endl;
+    file << "TrainingSigma:";
+    for (double x : sigma) file << " " << x;
+    file << std::endl;
+}
+
+bool loadTrainingStatistics(fstream& file, UINT numClasses,
+                            vector<double>& mu, vector<double>& sigma) {
+    string word;
+    file >> word;
+    if (word != "TrainingMu:") return false;
+    mu.resize(numClasses);
+    for (double& x : mu) file >> x;
+
+    file >> word;
+    if (word != "TrainingSigma:") return false;
+    sigma.resize(numClasses);
+    for (double& x : sigma) file >> x;
+    return !file.fail();
+}
+
+}  // namespace grt_util
@@ -0,0 +1,132 @@
+/** @file grt-util.h
+ *  @brief Helpers shared by ESP's own GRT modules (PrunedDTW, SpringDTW and
+ *  MelFrontEnd): reading model files, saving templates, and the statistics
+ *  and likelihoods of template classifiers.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <GRT/GRT.h>
+
+namespace grt_util {
+
+using GRT::UINT;
+using std::fstream;
+using std::string;
+using std::vector;
+
+// Reads "header value", as written by `file << header << " " << value`.
+// False if the header doesn't match or the value can't be read.
+template <typename T>
+bool readValue(fstream& file, const string& header, T& value) {
+    string word;
+    file >> word;
+    if (word != header) return false;
+    file >> value;
+    return !file.fail();
+}
+
+/**
+ The statistics null rejection thresholds are learned from: per class, the
+ mean and standard deviation of the distance from each of its templates to
+ the nearest other template of the class.
+
+ @param classIndex: the class of each template.
+ @param cost: cost(a, b, best) is the squared distance from template a to
+ template b, normalized as the classifier normalizes its matches against
+ template b. It may return anything not below best once it can't beat it.
+ @param mu, sigma: set per class. Classes with fewer than two templates that
+ have a nearest one borrow the average of the other classes; if no class has
+ two, every sigma is -1.
+ */
+template <typename Cost>
+void learnNearestTemplateStatistics(UINT numClasses,
+                                    const vector<UINT>& classIndex, Cost cost,
+                                    vector<double>& mu,
+                                    vector<double>& sigma);
+
+// The second half of learnNearestTemplateStatistics(), from the cost of the
+// nearest template to each one (infinity if its class has no other).
+void summarizeNearestTemplates(UINT numClasses, const vector<UINT>& classIndex,
+                               const vector<double>& nearest,
+                               vector<double>& mu, vector<double>& sigma);
+
+// Per class, mu + coeff * sigma, or the largest double (nothing rejected)
+// where sigma is negative.
+void computeNullRejectionThresholds(const vector<double>& mu,
+                                    const vector<double>& sigma,
+                                    double coeff,
+                                    vector<double>& thresholds);
+
+/**
+ Sets likelihoods to 1 / distance, normalized to sum to 1, for the classes
+ whose distance isn't the largest double; the others get 0.
+ @return the index of the nearest class, or distances.size() if there is
+ none.
+ */
+UINT computeClassLikelihoods(const vector<double>& distances,
+                             vector<double>& likelihoods);
+
+// Writes a template of length x numDimensions values, row-major.
+template <typename T>
+void saveTemplate(fstream& file, UINT classIndex, UINT length,
+                  UINT numDimensions, const vector<T>& data);
+
+// Reads a template written by saveTemplate(). False if it can't be read or
+// its class index isn't below numClasses.
+template <typename T>
+bool loadTemplate(fstream& file, UINT numClasses, UINT numDimensions,
+                  UINT& classIndex, UINT& length, vector<T>& data);
+
+void saveTrainingStatistics(fstream& file, const vector<double>& mu,
+                            const vector<double>& sigma);
+bool loadTrainingStatistics(fstream& file, UINT numClasses,
+                            vector<double>& mu, vector<double>& sigma);
+
+template <typename Cost>
+void learnNearestTemplateStatistics(UINT numClasses,
+                                    const vector<UINT>& classIndex, Cost cost,
+                                    vector<double>& mu,
+                                    vector<double>& sigma) {
+    vector<double> nearest(classIndex.size(),
+                           std::numeric_limits<double>::infinity());
+    for (UINT a = 0; a < classIndex.size(); a++) {
+        for (UINT b = 0; b < classIndex.size(); b++) {
+            if (a == b || classIndex[a] != classIndex[b]) continue;
+            nearest[a] = std::min(nearest[a], cost(a, b, nearest[a]));
+        }
+    }
+    summarizeNearestTemplates(numClasses, classIndex, nearest, mu, sigma);
+}
+
+template <typename T>
+void saveTemplate(fstream& file, UINT classIndex, UINT length,
+                  UINT numDimensions, const vector<T>& data) {
+    file << "Template: " << classIndex << " " << length << std::endl;
+    for (UINT i = 0; i < length; i++) {
+        for (UINT k = 0; k < numDimensions; k++) {
+            file << data[i * numDimensions + k] << "\t";
+        }
+        file << std::endl;
+    }
+}
+
+template <typename T>
+bool loadTemplate(fstream& file, UINT numClasses, UINT numDimensions,
+                  UINT& classIndex, UINT& length, vector<T>& data) {
+    if (!readValue(file, "Template:", classIndex) || !(file >> length) ||
+        classIndex >= numClasses || length == 0) {
+        return false;
+    }
+    data.resize(length * numDimensions);
+    for (T& x : data) file >> x;
+    return !file.fail();
+}
+
+}  // namespace grt_util
@@ -0,0 +1,305 @@
+#include "headless.h"
+
+#include <algorithm>
+#include <csignal>
+#include <fstream>
+
+#include "user.h"
+
+// Defined in ofApp.cpp; calibration sample names are stored encoded.
+string decodeName(const string &name);
+
+// Set from the signal handler; polled in update().
+static volatile std::sig_atomic_t exit_requested = 0;
+
+static void onExitSignal(int) {
+    exit_requested = 1;
+}
+
+HeadlessApp::HeadlessApp(const string& session_dir, int serial_port)
+        : session_dir_(session_dir), serial_port_(serial_port),
+          inference_(input_queue_) {
+}
+
+HeadlessApp* HeadlessApp::get() {
+    return dynamic_cast<HeadlessApp*>(ofGetAppPtr());
+}
+
+void HeadlessApp::useCalibrator(Calibrator &calibrator) {
+    calibrator_ = &calibrator;
+    inference_.setCalibrator(calibrator_);
+}
+
+void HeadlessApp::useIStream(InputStream &stream) {
+    if (!setup_finished_) istream_ = &stream;
+}
+
+void HeadlessApp::usePipeline(GRT::GestureRecognitionPipeline &pipeline) {
+    pipeline_ = &pipeline;
+    inference_.setPipeline(pipeline_);
+}
+
+void HeadlessApp::useOStream(OStream &stream) {
+    if (!setup_finished_) ostreams_.push_back(&stream);
+}
+
+void HeadlessApp::useOStream(OStreamVector &stream) {
+    if (!setup_finished_) ostreamvectors_.push_back(&stream);
+}
+
+void HeadlessApp::setInputQueueSize(uint32_t capacity) {
+    if (setup_finished_) return;
+    input_queue_capacity_ = std::max<uint32_t>(capacity, 1);
+}
+
+void HeadlessApp::setInputQueueOverflowPolicy(SampleQueue::OverflowPolicy policy) {
+    if (!setup_finished_) input_queue_policy_ = policy;
+}
+
+void HeadlessApp::reloadPipelineModules() {
+    InferenceWorker::PipelineLock lock = inference_.lockPipeline();
+    pipeline_->clearAll();
+    ::setup();
+}
+
+void HeadlessApp::setup() {
+    // Without a window, update() would otherwise spin as fast as it can.
+    ofSetFrameRate(60);
+    std::signal(SIGINT, onExitSignal);
+    std::signal(SIGTERM, onExitSignal);
+
+    ::setup(); setup_finished_ = true;
+
+    if (istream_ == nullptr || pipeline_ == nullptr) {
+        ofLog(OF_LOG_FATAL_ERROR) << "setup() must call useInputStream() and "
+                                  << "usePipeline()";
+        ofExit(1);
+        return;
+    }
+
+    for (OStream *ostream : ostreams_) {
+        if (!(ostream->start())) {
+            ofLog(OF_LOG_ERROR) << "failed to connect to ostream";
+        }
+    }
+
+    for (OStreamVector *ostream : ostreamvectors_) {
+        if (!(ostream->start())) {
+            ofLog(OF_LOG_ERROR) << "failed to connect to ostream";
+        }
+    }
+
+    // Same order as ofApp::loadAll(): loading the tuneables resets the
+    // pipeline, so the trained pipeline has to be loaded after them. The
+    // training and test data aren't needed to run a trained pipeline.
+    const string dir = session_dir_ + "/";
+    if (!loadCalibrationData(dir + kCalibrationDataFilename) ||
+        !loadTuneables(dir + kTuneablesFilename) ||
+        !loadPipeline(dir + kPipelineFilename)) {
+        ofLog(OF_LOG_FATAL_ERROR) << "Failed to load ESP session from " << dir;
+        ofExit(1);
+        return;
+    }
+
+    input_queue_.reset(istream_->getNumOutputDimensions(), input_queue_capacity_);
+    input_queue_.setOverflowPolicy(input_queue_policy_);
+    istream_->onSampleBlockEvent(this, &HeadlessApp::onDataIn);
+
+    inference_.setOutputStreams(ostreams_, ostreamvectors_);
+    inference_.start();
+
+    if (!startInputStream()) {
+        ofExit(1);
+        return;
+    }
+
+    start_time_ = last_stats_time_ = ofGetElapsedTimeMillis();
+    ofLog(OF_LOG_NOTICE) << "ESP is running headless with session " << dir;
+}
+
+bool HeadlessApp::startInputStream() {
+    if (istream_->start()) return true;
+
+    // Serial streams created without a port are normally set up from a
+    // dropdown in the GUI; here the port has to come from the command line.
+    if (BaseSerialInputStream* ss = dynamic_cast<BaseSerialInputStream*>(istream_)) {
+        if (serial_port_ >= 0 && ss->selectSerialDevice(serial_port_)) {
+            return true;
+        }
+
+        vector<string> serials = ss->getSerialDeviceList();
+        ofLog(OF_LOG_FATAL_ERROR) << "Failed to open serial port " << serial_port_
+                                  << ". Pass one of these with --serial:";
+        for (uint32_t i = 0; i < serials.size(); i++) {
+            ofLog(OF_LOG_FATAL_ERROR) << "  " << i << ": " << serials[i];
+        }
+        return false;
+    }
+
+    ofLog(OF_LOG_FATAL_ERROR) << "Failed to start the input stream";
+    return false;
+}
+
+bool HeadlessApp::loadCalibrationData(const string& filename) {
+    if (calibrator_ == nullptr) return true;
+
+    vector<CalibrateProcess>& calibrators = calibrator_->getCalibrateProcesses();
+    GRT::TimeSeriesClassificationData data;
+
+    if (!data.load(filename)) {
+        ofLog(OF_LOG_ERROR) << "Failed to load calibration data from " << filename;
+        return false;
+    }
+
+    if (data.getNumSamples() != calibrators.size() ||
+        data.getNumDimensions() != istream_->getNumOutputDimensions()) {
+        ofLog(OF_LOG_ERROR) << "Calibration data in " << filename
+                            << " doesn't match the calibrator in setup()";
+        return false;
+    }
+
+    InferenceWorker::PipelineLock lock = inference_.lockPipeline();
+    for (int i = 0; i < data.getNumSamples(); i++) {
+        string name = decodeName(data.getClassNameForCorrespondingClassLabel(i));
+        if (name != calibrators[i].getName()) {
+            ofLog(OF_LOG_WARNING) << "Name of saved calibration sample " << (i + 1)
+                                  << " ('" << name << "') differs from current "
+                                  << "calibration sample name ('"
+                                  << calibrators[i].getName() << "')";
+        }
+        calibrators[i].clear();
+        if (calibrators[i].calibrate(data[i].getData()).getResult() ==
+            CalibrateResult::FAILURE) {
+            ofLog(OF_LOG_WARNING) << "Failed to calibrate saved "
+                                  << "calibration sample " << (i + 1) << ": "
+                                  << calibrators[i].getName();
+        }
+    }
+
+    if (!calibrator_->isCalibrated()) {
+        ofLog(OF_LOG_ERROR) << "Calibration data in " << filename
+                            << " doesn't calibrate the calibrator";
+        return false;
+    }
+    return true;
+}
+
+bool HeadlessApp::loadTuneables(const string& filename) {
+    // A session saved before any tuneables were registered may not have the
+    // file; the defaults from setup() then apply.
+    if (tuneable_parameters_.empty()) return true;
+
+    std::ifstream file(filename);
+    if (!file) {
+        ofLog(OF_LOG_ERROR) << "Failed to open tuneables file " << filename;
+        return false;
+    }
+
+    std::string line;
+    for (Tuneable* t : tuneable_parameters_) {
+        std::getline(file, line);
+        t->fromString(line);
+    }
+    reloadPipelineModules();
+    return true;
+}
+
+bool HeadlessApp::loadPipeline(const string& filename) {
+    InferenceWorker::PipelineLock lock = inference_.lockPipeline();
+    if (!pipeline_->load(filename)) {
+        ofLog(OF_LOG_ERROR) << "Failed to load pipeline from " << filename;
+        return false;
+    }
+    if (!pipeline_->getTrained()) {
+        ofLog(OF_LOG_WARNING) << "Pipeline in " << filename << " is not "
+                              << "trained; no predictions will be made";
+    }
+    return true;
+}
+
+void HeadlessApp::onDataIn(const SampleBlock& input) {
+    if (input.getNumDimensions() != input_queue_.getNumDimensions()) {
+        ofLog(OF_LOG_ERROR) << "Input stream sent " << input.getNumDimensions()
+                            << "-dimensional data; expected "
+                            << input_queue_.getNumDimensions();
+        return;
+    }
+    for (uint32_t i = 0; i < input.getNumRows(); i++)
+        input_queue_.push(input.getRow(i), input.getTimestamp(i));
+}
+
+void HeadlessApp::update() {
+    if (exit_requested) {
+        exit_requested = 0;
+        ofExit(0);
+        return;
+    }
+
+    // Once a replay has been processed to the end there's nothing left to
+    // do, so exit, which also makes replays easy to time. The replay has been
+    // processed once the worker is idle, not just the queue empty: the last
+    // batch may still be going through the pipeline.
+    ReplayStream* replay = dynamic_cast<ReplayStream*>(istream_);
+    const bool replayed = replay != nullptr && replay->hasFinished() &&
+                          inference_.isIdle();
+
+    // Results only matter to the GUI; drain them so they don't pile up.
+    inference_.takeResults(inference_results_);
+    for (const InferenceResult& result : inference_results_) {
+        num_results_++;
+        if (result.predicted && result.predicted_label != 0) num_predictions_++;
+    }
+
+    uint64_t now = ofGetElapsedTimeMillis();
+
+    if (replayed) {
+        const double seconds = std::max<uint64_t>(now - start_time_, 1) / 1000.0;
+        ofLog(OF_LOG_NOTICE) << "Replayed " << replay->getPosition()
+                             << " samples in " << seconds << " s ("
+                             << replay->getPosition() / seconds << " samples/s)";
+        ofExit(0);
+        return;
+    }
+
+    if (now - last_stats_time_ >= kStatsIntervalMs) {
+        logStats();
+        last_stats_time_ = now;
+    }
+}
+
+void HeadlessApp::logStats() {
+    SampleQueue::Stats queue_stats = input_queue_.getStats();
+    ofLog(OF_LOG_NOTICE) << "Processed " << num_results_ << " samples, "
+                         << num_predictions_ << " non-null predictions";
+    if (inference_.isProfiling()) {
+        for (const PipelineProfiler::StageStats& stage : getStageLatencies()) {
+            ofLog(OF_LOG_NOTICE) << "  " << stage.name << ": "
+                                 << stage.latency.toString();
+        }
+    }
+    if (inference_.isTracing()) {
+        ofLog(OF_LOG_NOTICE) << "Latency from arrival on the input stream:";
+        for (const LatencyTracer::HopStats& hop : getHopLatencies()) {
+            if (hop.latency.count == 0) continue;
+            ofLog(OF_LOG_NOTICE) << "  " << hop.name << ": "
+                                 << hop.latency.toString();
+        }
+    }
+    if (queue_stats.dropped > input_queue_reported_drops_) {
+        ofLog(OF_LOG_WARNING) << "Input queue full, dropped "
+                              << queue_stats.dropped - input_queue_reported_drops_
+                              << " samples (" << queue_stats.dropped << " total)";
+        input_queue_reported_drops_ = queue_stats.dropped;
+    }
+}
+
+void HeadlessApp::exit() {
+    if (istream_ != nullptr) istream_->stop();
+    inference_.stop();
+    logStats();
+
+    if (!latency_dump_file_.empty() &&
+        !inference_.getTracer().dump(latency_dump_file_)) {
+        ofLog(OF_LOG_ERROR) << "Can't write latencies to " << latency_dump_file_;
+    }
+}
@@ -0,0 +1,120 @@
+/** @file headless.h
+ *  @brief HeadlessApp runs a saved ESP session without a window or GUI.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "ofMain.h"
+#include <GRT/GRT.h>
+
+#include "calibrator.h"
+#include "inference-worker.h"
+#include "iostream.h"
+#include "sample-queue.h"
+#include "session.h"
+#include "tuneable.h"
+
+/**
+ @brief The live part of ESP (input stream, calibration, prediction and output
+ streams) without any of the GUI.
+
+ The pipeline is configured by the same user setup() as the GUI, and then the
+ calibration data, tuneable parameters and trained pipeline are loaded from a
+ session directory written by ofApp::saveAll(). Training and data collection
+ are not available; the session must already contain a trained pipeline.
+
+ Run it with ofAppNoWindow so that no GL context is created. The app runs
+ until the process receives SIGINT or SIGTERM, or, if the input stream is a
+ ReplayStream, until the whole replay has been processed.
+ */
+class HeadlessApp : public ofBaseApp {
+  public:
+    /**
+     @param session_dir: directory written by ofApp::saveAll().
+     @param serial_port: index of the serial port to use if the input stream
+     is a serial stream that wasn't given a port in setup(). Ignored if
+     negative.
+     */
+    HeadlessApp(const string& session_dir, int serial_port = -1);
+
+    void setup() final;
+    void update() final;
+    void exit() final;
+
+    // Returns the running HeadlessApp, or nullptr if ESP runs with a GUI.
+    static HeadlessApp* get();
+
+    // The counterparts of the ofApp functions used by the API in ESP.h.
+    void useCalibrator(Calibrator &calibrator);
+    void useIStream(InputStream &stream);
+    void usePipeline(GRT::GestureRecognitionPipeline &pipeline);
+    void useOStream(OStream &stream);
+    void useOStream(OStreamVector &stream);
+    void setInputQueueSize(uint32_t capacity);
+    void setInputQueueOverflowPolicy(SampleQueue::OverflowPolicy policy);
+
+    void useStageProfiling(bool enable) { inference_.setProfiling(enable); }
+    vector<PipelineProfiler::StageStats> getStageLatencies() const {
+        return inference_.getProfiler().getStageStats();
+    }
+
+    void useLatencyTracing(bool enable, const string& dump_file) {
+        inference_.setTracing(enable);
+        latency_dump_file_ = dump_file;
+    }
+    vector<LatencyTracer::HopStats> getHopLatencies() const {
+        return inference_.getTracer().getHopStats();
+    }
+
+    void registerTuneable(Tuneable* t) {
+        tuneable_parameters_.push_back(t);
+    }
+
+    void reloadPipelineModules();
+
+    InferenceWorker::PipelineLock lockPipeline() {
+        return inference_.lockPipeline();
+    }
+
+  private:
+    // How often statistics are written to the log.
+    static const uint32_t kStatsIntervalMs = 10000;
+
+    bool loadCalibrationData(const string& filename);
+    bool loadTuneables(const string& filename);
+    bool loadPipeline(const string& filename);
+    bool startInputStream();
+
+    void onDataIn(const SampleBlock& input);
+    void logStats();
+
+    string session_dir_;
+    int serial_port_;
+    bool setup_finished_ = false;
+
+    InputStream *istream_ = nullptr;
+    GRT::GestureRecognitionPipeline *pipeline_ = nullptr;
+    Calibrator *calibrator_ = nullptr;
+    vector<OStream *> ostreams_;
+    vector<OStreamVector *> ostreamvectors_;
+    vector<Tuneable*> tuneable_parameters_;
+
+    SampleQueue input_queue_;
+    uint32_t input_queue_capacity_ = 4096;
+    SampleQueue::OverflowPolicy input_queue_policy_ = SampleQueue::kDropOldest;
+    uint64_t input_queue_reported_drops_ = 0;
+
+    InferenceWorker inference_;
+    string latency_dump_file_;  // latencies are written here on exit, if set
+    std::deque<InferenceResult> inference_results_;
+    uint64_t num_results_ = 0;
+    uint64_t num_predictions_ = 0;
+    uint64_t start_time_ = 0;
+    uint64_t last_stats_time_ = 0;
+};
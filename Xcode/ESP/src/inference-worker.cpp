@@ -0,0 +1,255 @@
+#include "inference-worker.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "ofMain.h"
+#include "sample-block.h"
+
+namespace {
+
+uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+}  // namespace
+
+InferenceWorker::InferenceWorker(SampleQueue& queue) : queue_(queue) {
+    queue_hop_ = tracer_.getHop("queue");
+    calibration_hop_ = tracer_.getHop("calibration");
+    pipeline_hop_ = tracer_.getHop("pipeline");
+    output_hop_ = tracer_.getHop("sensor to output");
+}
+
+InferenceWorker::~InferenceWorker() {
+    stop();
+}
+
+void InferenceWorker::setPipeline(GRT::GestureRecognitionPipeline* pipeline) {
+    PipelineLock lock = lockPipeline();
+    pipeline_ = pipeline;
+}
+
+void InferenceWorker::setCalibrator(Calibrator* calibrator) {
+    PipelineLock lock = lockPipeline();
+    calibrator_ = calibrator;
+}
+
+void InferenceWorker::setOutputStreams(
+        const vector<OStream*>& ostreams,
+        const vector<OStreamVector*>& ostreamvectors) {
+    PipelineLock lock = lockPipeline();
+    ostreams_ = ostreams;
+    ostreamvectors_ = ostreamvectors;
+
+    stream_hops_.clear();
+    for (size_t i = 0; i < ostreams_.size(); i++) {
+        stream_hops_.push_back(
+            tracer_.getHop("output " + std::to_string(i + 1)));
+    }
+    for (size_t i = 0; i < ostreamvectors_.size(); i++) {
+        stream_hops_.push_back(
+            tracer_.getHop("vector output " + std::to_string(i + 1)));
+    }
+}
+
+bool InferenceWorker::start() {
+    if (running_) return true;
+    if (pipeline_ == nullptr) {
+        ofLog(OF_LOG_ERROR) << "InferenceWorker started without a pipeline";
+        return false;
+    }
+
+    running_ = true;
+    thread_.reset(new std::thread(&InferenceWorker::run, this));
+    return true;
+}
+
+void InferenceWorker::stop() {
+    running_ = false;
+    if (thread_ != nullptr && thread_->joinable()) {
+        thread_->join();
+    }
+    thread_.reset();
+}
+
+void InferenceWorker::takeResults(std::deque<InferenceResult>& results) {
+    results.clear();
+    std::lock_guard<std::mutex> guard(results_mutex_);
+    results.swap(results_);
+}
+
+void InferenceWorker::publish(std::deque<InferenceResult>& results) {
+    std::lock_guard<std::mutex> guard(results_mutex_);
+    for (InferenceResult& r : results) {
+        results_.push_back(std::move(r));
+    }
+    while (results_.size() > max_pending_results_) {
+        results_.pop_front();
+    }
+    results.clear();
+}
+
+void InferenceWorker::run() {
+    vector<double> raw(queue_.getNumDimensions());
+    uint64_t arrival_us = 0;
+    std::deque<InferenceResult> batch;
+
+    while (running_) {
+        if (clear_requested_.exchange(false)) {
+            queue_.clear();
+        }
+
+        if (!queue_.waitForData(kMaxWaitMs)) continue;
+
+        busy_ = true;
+        {
+            PipelineLock lock = lockPipeline();
+            for (uint32_t n = 0;
+                 n < kMaxBatchSize && queue_.pop(raw, &arrival_us); n++) {
+                trace_.clear();
+                traceSinceArrival(queue_hop_, arrival_us);
+                batch.emplace_back();
+                process(raw, arrival_us, batch.back());
+                if (!trace_.empty()) tracer_.record(trace_);
+            }
+        }
+
+        publish(batch);
+        busy_ = false;
+    }
+}
+
+void InferenceWorker::traceSinceArrival(uint32_t hop, uint64_t arrival_us) {
+    if (!tracing_ || arrival_us == 0) return;
+    uint64_t now_us = SampleBlock::now();
+    if (now_us >= arrival_us) trace_.emplace_back(hop, (now_us - arrival_us) * 1000);
+}
+
+void InferenceWorker::sendLabel(uint32_t label, uint64_t arrival_us) {
+    size_t i = 0;
+    for (OStream *ostream : ostreams_) {
+        ostream->onReceive(label);
+        traceSinceArrival(stream_hops_[i++], arrival_us);
+    }
+    for (OStream *ostream : ostreamvectors_) {
+        ostream->onReceive(label);
+        traceSinceArrival(stream_hops_[i++], arrival_us);
+    }
+    if (i > 0) traceSinceArrival(output_hop_, arrival_us);
+}
+
+void InferenceWorker::process(const vector<double>& raw, uint64_t arrival_us,
+                              InferenceResult& result) {
+    const bool tracing = tracing_;
+    std::chrono::steady_clock::time_point start;
+    if (tracing) start = std::chrono::steady_clock::now();
+
+    result.raw = raw;
+    if (calibrator_ == nullptr) {
+        result.data = raw;
+    } else if (calibrator_->isCalibrated()) {
+        result.data = calibrator_->calibrate(raw);
+        if (tracing) {
+            trace_.emplace_back(calibration_hop_, nanosecondsSince(start));
+            start = std::chrono::steady_clock::now();
+        }
+    } else {
+        result.calibrated = false;
+        return;
+    }
+
+    GRT::GestureRecognitionPipeline& pipeline = *pipeline_;
+
+    bool profiling = profiling_;
+
+    if (pipeline.getTrained()) {
+        GRT::UINT label = 0;
+        bool ok;
+        if (profiling) {
+            ok = profiler_.predict(pipeline, result.data, label);
+        } else {
+            ok = pipeline.predict(result.data);
+            label = pipeline.getPredictedClassLabel();
+        }
+        if (tracing) trace_.emplace_back(pipeline_hop_, nanosecondsSince(start));
+        if (!ok) {
+            ofLog(OF_LOG_ERROR) << "ERROR: Failed to run prediction!";
+        }
+        result.predicted = true;
+        result.predicted_label = label;
+
+        if (result.predicted_label != 0) {
+            sendLabel(result.predicted_label, arrival_us);
+        }
+
+        result.class_labels = pipeline.getClassLabels();
+        result.class_likelihoods = pipeline.getClassLikelihoods();
+        result.class_distances = pipeline.getClassDistances();
+
+        GRT::Classifier* classifier = pipeline.getClassifier();
+        size_t num_classes = std::min(result.class_distances.size(),
+                                      result.class_labels.size());
+        result.class_distance_thresholds.assign(num_classes, 0.0);
+        if (classifier->getSupportsClassDistanceToNullRejectionCoefficient()) {
+            double coeff = classifier->getNullRejectionCoeff();
+            for (size_t k = 0; k < num_classes; k++) {
+                result.class_distances[k] =
+                    classifier->classDistanceToNullRejectionCoefficient(
+                        result.class_labels[k], result.class_distances[k]);
+                result.class_distance_thresholds[k] = coeff;
+            }
+        } else {
+            vector<double> thresholds = classifier->getNullRejectionThresholds();
+            for (size_t k = 0; k < num_classes && k < thresholds.size(); k++) {
+                result.class_distance_thresholds[k] = thresholds[k];
+            }
+        }
+    } else {
+        // Still run the data through pre-processing and feature extraction
+        // so that the live plots show something before training.
+        bool ok = profiling ? profiler_.preProcessData(pipeline, result.data)
+                            : pipeline.preProcessData(result.data);
+        if (tracing) trace_.emplace_back(pipeline_hop_, nanosecondsSince(start));
+        if (!ok) {
+            ofLog(OF_LOG_ERROR) << "ERROR: Failed to compute features!";
+        }
+    }
+
+    uint32_t num_pre_processing = pipeline.getNumPreProcessingModules();
+    uint32_t num_features = pipeline.getNumFeatureExtractionModules();
+    if (num_features > 0) {
+        result.last_stage = pipeline.getFeatureExtractionData(num_features - 1);
+    } else if (num_pre_processing > 0) {
+        result.last_stage = pipeline.getPreProcessedData(num_pre_processing - 1);
+    }
+
+    if (capture_all_stages_) {
+        result.pre_processed.reserve(num_pre_processing);
+        for (uint32_t j = 0; j < num_pre_processing; j++) {
+            result.pre_processed.push_back(pipeline.getPreProcessedData(j));
+        }
+        result.features.reserve(num_features);
+        for (uint32_t j = 0; j < num_features; j++) {
+            result.features.push_back(pipeline.getFeatureExtractionData(j));
+        }
+    }
+
+    // If there's no classifier set, we've got a signal processing pipeline
+    // and we should send the results of the pipeline to any OStreamVector
+    // instances that are listening for it.
+    // TODO(damellis): this logic will need updating when / if we support
+    // regression and clustering pipelines.
+    if (!pipeline.getIsClassifierSet()) {
+        const vector<double>& output =
+            result.last_stage.empty() ? result.data : result.last_stage;
+        size_t i = ostreams_.size();
+        for (OStreamVector *stream : ostreamvectors_) {
+            stream->onReceive(output);
+            traceSinceArrival(stream_hops_[i++], arrival_us);
+        }
+        if (!ostreamvectors_.empty()) traceSinceArrival(output_hop_, arrival_us);
+    }
+}
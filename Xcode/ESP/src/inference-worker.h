@@ -0,0 +1,193 @@
+/** @file inference-worker.h
+ *  @brief InferenceWorker runs the live pipeline on its own thread, so that
+ *  label output doesn't wait for the GUI to finish drawing a frame.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <GRT/GRT.h>
+
+#include "calibrator.h"
+#include "latency-tracer.h"
+#include "ostream.h"
+#include "pipeline-profiler.h"
+#include "sample-queue.h"
+
+/**
+ @brief Everything the GUI needs to know about one live sample after it went
+ through calibration and the pipeline.
+ */
+struct InferenceResult {
+    // The sample as it came off the input stream.
+    vector<double> raw;
+
+    // False if a calibrator is in use but hasn't been calibrated yet; the
+    // sample was not run through the pipeline and only raw is set.
+    bool calibrated = true;
+
+    // The sample after calibration (the input to the pipeline).
+    vector<double> data;
+
+    // True if the pipeline was trained and predict() ran on this sample.
+    bool predicted = false;
+    uint32_t predicted_label = 0;
+    vector<GRT::UINT> class_labels;
+    vector<double> class_likelihoods;
+
+    // Class distances, parallel to class_labels, and the threshold each one is
+    // compared against for null rejection. If the classifier supports it,
+    // distances are expressed in units of the null rejection coefficient and
+    // every threshold is the coefficient itself.
+    vector<double> class_distances;
+    vector<double> class_distance_thresholds;
+
+    // Output of the last pre-processing or feature extraction stage. Empty if
+    // the pipeline has no such stage.
+    vector<double> last_stage;
+
+    // Output of every pre-processing and feature extraction stage. Only
+    // captured while setCaptureAllStages(true) is in effect.
+    vector<vector<double>> pre_processed;
+    vector<vector<double>> features;
+};
+
+/**
+ @brief Consumes samples from a SampleQueue on a dedicated thread, runs them
+ through the calibrator and pipeline, and sends predictions to the output
+ streams right away.
+
+ Per-sample results are published to the GUI through a double buffer: the
+ worker appends to one side and the GUI swaps it out with takeResults(), so
+ the GUI never holds a lock for longer than a swap and drawing never delays
+ inference.
+
+ While the worker is running it owns the pipeline and the calibrator. Any
+ other thread that wants to touch them (training, saving, feature previews,
+ tuneable callbacks) must hold the lock returned by lockPipeline(). The lock
+ is recursive, so code paths that already hold it may take it again.
+ */
+class InferenceWorker {
+  public:
+    using PipelineLock = std::unique_lock<std::recursive_mutex>;
+
+    explicit InferenceWorker(SampleQueue& queue);
+    ~InferenceWorker();
+
+    void setPipeline(GRT::GestureRecognitionPipeline* pipeline);
+    void setCalibrator(Calibrator* calibrator);
+    void setOutputStreams(const vector<OStream*>& ostreams,
+                          const vector<OStreamVector*>& ostreamvectors);
+
+    bool start();
+    void stop();
+    bool isRunning() const { return running_; }
+
+    /**
+     True if no sample is queued or being processed, i.e. every sample pushed
+     so far has been sent to the output streams and its result published.
+     */
+    bool isIdle() const { return !busy_ && queue_.size() == 0; }
+
+    PipelineLock lockPipeline() { return PipelineLock(pipeline_mutex_); }
+
+    /**
+     Ask the worker to discard samples that are still queued. Safe to call
+     from any thread; the queue itself is only touched by the worker.
+     */
+    void clearPendingSamples() { clear_requested_ = true; }
+
+    /**
+     Whether to copy out the data of every pipeline stage (for the pipeline
+     view) rather than only the last one.
+     */
+    void setCaptureAllStages(bool capture) { capture_all_stages_ = capture; }
+
+    /**
+     Whether to time each pipeline stage (see PipelineProfiler). Off by
+     default; turning it on costs a couple of clock reads per stage.
+     */
+    void setProfiling(bool profiling) { profiling_ = profiling; }
+    bool isProfiling() const { return profiling_; }
+    const PipelineProfiler& getProfiler() const { return profiler_; }
+    PipelineProfiler& getProfiler() { return profiler_; }
+
+    /**
+     Whether to trace the latency of each hop a sample makes from its arrival
+     on the input stream: waiting in the queue, calibration, the pipeline, and
+     until each output stream has been sent the prediction (see LatencyTracer).
+     Off by default; like profiling, it costs a few clock reads per sample.
+     */
+    void setTracing(bool tracing) { tracing_ = tracing; }
+    bool isTracing() const { return tracing_; }
+    const LatencyTracer& getTracer() const { return tracer_; }
+    LatencyTracer& getTracer() { return tracer_; }
+
+    /**
+     Limit how many results are kept for the GUI. If the GUI falls further
+     behind than this, the oldest results are discarded.
+     */
+    void setMaxPendingResults(uint32_t n) { max_pending_results_ = n; }
+
+    /**
+     Move all results published since the last call into results (replacing
+     its contents), oldest first.
+     */
+    void takeResults(std::deque<InferenceResult>& results);
+
+  private:
+    // Max number of samples processed per pass (and thus the longest another
+    // thread waits for lockPipeline()).
+    static const uint32_t kMaxBatchSize = 64;
+    // Max time the worker sleeps on an empty queue before checking whether
+    // it has been stopped.
+    static const uint32_t kMaxWaitMs = 50;
+
+    void run();
+    // arrival_us is when the sample arrived on the input stream, or 0.
+    void process(const vector<double>& raw, uint64_t arrival_us,
+                 InferenceResult& result);
+    // Send the predicted label to the output streams.
+    void sendLabel(uint32_t label, uint64_t arrival_us);
+    // Record the time since arrival_us for hop, if tracing.
+    void traceSinceArrival(uint32_t hop, uint64_t arrival_us);
+    void publish(std::deque<InferenceResult>& results);
+
+    SampleQueue& queue_;
+
+    std::recursive_mutex pipeline_mutex_;
+    GRT::GestureRecognitionPipeline* pipeline_ = nullptr;
+    Calibrator* calibrator_ = nullptr;
+    vector<OStream*> ostreams_;
+    vector<OStreamVector*> ostreamvectors_;
+
+    std::atomic_bool running_{false};
+    // Set before a batch is popped off the queue and cleared once it's
+    // published; isIdle() reads it before the queue size, so that a batch is
+    // always in one or the other.
+    std::atomic_bool busy_{false};
+    std::atomic_bool clear_requested_{false};
+    std::atomic_bool capture_all_stages_{false};
+    std::atomic_bool profiling_{false};
+    PipelineProfiler profiler_;
+
+    std::atomic_bool tracing_{false};
+    LatencyTracer tracer_;
+    uint32_t queue_hop_, calibration_hop_, pipeline_hop_, output_hop_;
+    // One hop per output stream, in ostreams_ then ostreamvectors_ order.
+    vector<uint32_t> stream_hops_;
+    // Measurements of the sample being processed, recorded all at once.
+    vector<LatencyTracer::Measurement> trace_;
+    std::unique_ptr<std::thread> thread_;
+
+    std::mutex results_mutex_;
+    std::deque<InferenceResult> results_;
+    std::atomic<uint32_t> max_pending_results_{8192};
+};
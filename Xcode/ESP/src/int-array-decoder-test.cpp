@@ -0,0 +1,76 @@
+#include "int-array-decoder.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+// Encode a packet the way Touche.ino's sendData() does.
+std::vector<uint8_t> packet(const std::vector<int>& values) {
+    std::vector<uint8_t> out = {0};
+    uint8_t checksum = 0;
+    auto put = [&](int x) {
+        uint8_t lsb = (x & 0x7f) | 0x80, msb = ((x >> 7) & 0x7f) | 0x80;
+        out.push_back(lsb);
+        out.push_back(msb);
+        checksum += lsb + msb;
+    };
+    put(values.size());
+    for (int v : values) put(v);
+    out.push_back(checksum | 0x80);
+    return out;
+}
+
+void append(std::vector<uint8_t>* a, const std::vector<uint8_t>& b) {
+    a->insert(a->end(), b.begin(), b.end());
+}
+
+}  // namespace
+
+TEST(IntArrayDecoderTest, DecodesEveryCompletePacket) {
+    std::vector<int> first(160), second(160);
+    for (int i = 0; i < 160; i++) {
+        first[i] = i * 97 % 16384;
+        second[i] = 16383 - i;
+    }
+    std::vector<uint8_t> bytes = packet(first);
+    append(&bytes, packet(second));
+
+    for (size_t split = 0; split <= bytes.size(); split += 7) {
+        IntArrayPacketDecoder decoder(160);
+        std::vector<double> samples;
+        size_t consumed = decoder.decode(bytes.data(), split, &samples);
+        std::vector<uint8_t> rest(bytes.begin() + consumed, bytes.end());
+        EXPECT_EQ(rest.size(), decoder.decode(rest.data(), rest.size(), &samples));
+
+        ASSERT_EQ(320u, samples.size()) << "split at " << split;
+        for (int i = 0; i < 160; i++) {
+            EXPECT_EQ(first[i], samples[i]);
+            EXPECT_EQ(second[i], samples[160 + i]);
+        }
+        EXPECT_EQ(2u, decoder.getStats().packets);
+        EXPECT_EQ(0u, decoder.getStats().skipped_bytes);
+    }
+}
+
+TEST(IntArrayDecoderTest, ResynchronizesAfterCorruption) {
+    std::vector<uint8_t> bytes = {0x85, 0x90};  // the tail of a lost packet
+    std::vector<uint8_t> corrupt = packet({1, 2, 3});
+    corrupt[4] ^= 0x01;
+    append(&bytes, corrupt);
+    append(&bytes, packet({4, 5}));  // wrong number of values
+    append(&bytes, packet({6, 7, 8}));
+    std::vector<uint8_t> truncated = packet({9, 9, 9});
+    truncated.resize(6);
+    append(&bytes, truncated);
+    append(&bytes, packet({10, 11, 12}));
+
+    IntArrayPacketDecoder decoder(3);
+    std::vector<double> samples;
+    EXPECT_EQ(bytes.size(), decoder.decode(bytes.data(), bytes.size(), &samples));
+    EXPECT_EQ(std::vector<double>({6, 7, 8, 10, 11, 12}), samples);
+    IntArrayPacketStats stats = decoder.getStats();
+    EXPECT_EQ(2u, stats.packets);
+    EXPECT_EQ(2u, stats.checksum_errors);  // the corrupt and truncated ones
+    EXPECT_EQ(1u, stats.bad_headers);
+    EXPECT_EQ(2 + corrupt.size() + packet({4, 5}).size() + truncated.size(),
+              stats.skipped_bytes);
+}
@@ -0,0 +1,48 @@
+#include "int-array-decoder.h"
+
+#include <cstring>
+
+#include "simd.h"
+
+size_t IntArrayPacketDecoder::decode(const uint8_t* data, size_t size,
+                                     vector<double>* samples) {
+    const size_t packet_size = 4 + 2 * num_dimensions_;
+    size_t pos = 0;
+    while (pos < size) {
+        const uint8_t* start = static_cast<const uint8_t*>(
+            std::memchr(data + pos, 0, size - pos));
+        if (start == nullptr) {
+            stats_.skipped_bytes += size - pos;
+            return size;
+        }
+        stats_.skipped_bytes += start - (data + pos);
+        pos = start - data;
+
+        const uint8_t* p = data + pos;
+        const size_t available = size - pos;
+        if (available < 3) return pos;
+        uint32_t n = ((p[2] & 0x7f) << 7) | (p[1] & 0x7f);
+        if (n != num_dimensions_) {
+            stats_.bad_headers++;
+            stats_.skipped_bytes++;
+            pos++;
+            continue;
+        }
+        if (available < packet_size) return pos;
+
+        const size_t old_size = samples->size();
+        samples->resize(old_size + n);
+        uint32_t sum = p[1] + p[2] +
+                       simd::decode7BitPairs(p + 3, n, samples->data() + old_size);
+        if (((sum & 0xff) | 0x80) != p[3 + 2 * n]) {
+            samples->resize(old_size);
+            stats_.checksum_errors++;
+            stats_.skipped_bytes++;
+            pos++;
+            continue;
+        }
+        stats_.packets++;
+        pos += packet_size;
+    }
+    return pos;
+}
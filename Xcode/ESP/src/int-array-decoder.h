@@ -0,0 +1,59 @@
+/** @file int-array-decoder.h
+ *  @brief Decoder for the binary packets of 14-bit integers sent by the
+ *  Arduino sketches (e.g. Touche.ino) to BinaryIntArraySerialStream.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using std::vector;
+
+/**
+ A packet holds n 14-bit values:
+
+     0x00, LSB(n), MSB(n), LSB(v[0]), MSB(v[0]), ..., MSB(v[n-1]), checksum
+
+ where LSB(x) is the low seven bits of x and MSB(x) the next seven, each with
+ the high bit set so that only the start of a packet is a zero byte. The
+ checksum is the 8-bit sum of the bytes between the zero and it, with the high
+ bit set.
+ */
+struct IntArrayPacketStats {
+    uint64_t packets = 0;          // valid packets decoded
+    uint64_t checksum_errors = 0;  // packets with a bad checksum
+    uint64_t bad_headers = 0;      // packet starts with the wrong n
+    uint64_t skipped_bytes = 0;    // bytes that weren't part of a valid packet
+};
+
+/**
+ *  @brief Decodes every complete packet in a buffer, in place.
+ *
+ *  Only packets with num_dimensions values are accepted, so a corrupted
+ *  length is caught from the header alone, without waiting for the bytes it
+ *  claims. After a bad header or checksum the decoder moves one byte on and
+ *  resynchronizes at the next zero byte.
+ */
+class IntArrayPacketDecoder {
+  public:
+    explicit IntArrayPacketDecoder(uint32_t num_dimensions)
+        : num_dimensions_(num_dimensions) {
+    }
+
+    /**
+     Decode the complete packets at the start of [data, data + size) and append
+     their values to samples, one row of num_dimensions values per packet.
+     @return the number of bytes consumed. The rest is the start of a packet
+     that isn't complete yet; pass it again, followed by more data.
+     */
+    size_t decode(const uint8_t* data, size_t size, vector<double>* samples);
+
+    uint32_t getNumDimensions() const { return num_dimensions_; }
+    const IntArrayPacketStats& getStats() const { return stats_; }
+
+  private:
+    uint32_t num_dimensions_;
+    IntArrayPacketStats stats_;
+};
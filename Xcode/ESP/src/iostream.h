@@ -1,8 +1,12 @@
 #pragma once
 
+#include "int-array-decoder.h"
 #include "istream.h"
+#include "number-parser.h"
 #include "ostream.h"
 
+#include <mutex>
+
 class IOStream : public virtual InputStream, public OStream {};
 class IOStreamVector : public virtual InputStream, public OStreamVector {};
 
@@ -10,9 +14,11 @@ class IOStreamVector : public virtual InputStream, public OStreamVector {};
  @brief Input stream for reading ASCII data from a (USB) serial port.
 
  Data should be formatted as ASCII text, in newline-terminated lines. Each line
- consists of whitespace-separated numbers, e.g.
+ consists of numbers separated by whitespace or commas, e.g.
  @verbatim 123 45 678 90 @endverbatim
- The numbers in each line of text are turned into a single data sample.
+ The numbers in each line of text are turned into a single data sample; lines
+ that don't hold exactly numDimensions numbers are dropped. Every complete
+ line read in one wakeup is passed on at once, as the rows of one matrix.
 
  To use an ASCIISerialStream in your application, pass it to useStream() in
  your setup() function.
@@ -26,8 +32,18 @@ class ASCIISerialStream : public BaseSerialInputStream, public IOStreamVector {
 
   private:
     virtual void parseSerial(vector<unsigned char> &buffer);
+
+    // The base class is constructed first, so the dimensions are known here.
+    LineParser parser_{static_cast<uint32_t>(getNumInputDimensions())};
+    vector<double> samples_;
 };
 
+/**
+ @brief Input stream for reading packets of 14-bit integers from a (USB)
+ serial port, as sent by e.g. Touche.ino (see int-array-decoder.h for the
+ format). Each packet of numDimensions values is one data sample; all the
+ packets read in one wakeup are passed on at once, as the rows of one matrix.
+ */
 class BinaryIntArraySerialStream : public BaseSerialInputStream, public IOStreamVector {
   public:
     using BaseSerialInputStream::BaseSerialInputStream; // inherit constructors
@@ -35,6 +51,19 @@ class BinaryIntArraySerialStream : public BaseSerialInputStream, public IOStream
     virtual void onReceive(uint32_t label);
     virtual void onReceive(vector<double> data);
 
+    // Get packet, checksum error and resync counters.
+    IntArrayPacketStats getPacketStats() const {
+        std::lock_guard<std::mutex> guard(stats_mutex_);
+        return stats_;
+    }
+
   private:
     virtual void parseSerial(vector<unsigned char> &buffer);
+
+    // The base class is constructed first, so the dimensions are known here.
+    IntArrayPacketDecoder decoder_{static_cast<uint32_t>(getNumInputDimensions())};
+    vector<double> samples_;
+
+    mutable std::mutex stats_mutex_;
+    IntArrayPacketStats stats_;
 };
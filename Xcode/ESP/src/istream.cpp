@@ -12,14 +12,22 @@
 #include "istream.h"
 
 #include <GRT/GRT.h>
+#include <atomic>
 #include <chrono>         // std::chrono::milliseconds
 #include <thread>         // std::this_thread::sleep_for
 
+#if !defined( __WIN32__ ) && !defined( _WIN32 )
+#include <poll.h>         // poll
+#include <cerrno>
+#include <cstring>        // strerror
+#endif
 
-#include "ofxNetwork.h"  
 
+namespace {
+std::atomic<uint32_t> next_source_id{1};
+}  // namespace
 
-InputStream::InputStream() : data_ready_callback_(nullptr) {}
+InputStream::InputStream() : source_id_(next_source_id++) {}
 
 vector<double> InputStream::normalize(vector<double> input) {
     if (vectorNormalizer_ != nullptr) {
@@ -33,6 +41,65 @@ vector<double> InputStream::normalize(vector<double> input) {
     }
 }
 
+void InputStream::passOnSamples(const double* samples, uint32_t num_samples,
+                                uint64_t timestamp_us) {
+    // Nothing to deliver; block_ still holds the previous samples.
+    if (num_samples == 0) return;
+    if (sample_block_callback_ == nullptr && data_ready_callback_ == nullptr) {
+        next_sequence_ += num_samples;
+        return;
+    }
+
+    const uint32_t dim = getNumInputDimensions();
+    block_.setSourceId(source_id_);
+    if (vectorNormalizer_ == nullptr) {
+        // A per-value normalizer is applied in place, without building a
+        // vector per sample.
+        block_.reset(dim);
+        for (uint32_t i = 0; i < num_samples; i++) {
+            double* row = block_.addRow(timestamp_us, next_sequence_++);
+            std::copy(samples + i * dim, samples + (i + 1) * dim, row);
+            if (normalizer_ != nullptr) {
+                for (uint32_t j = 0; j < dim; j++) row[j] = normalizer_(row[j]);
+            }
+        }
+    } else {
+        // The normalizer may change the number of dimensions, but a row that
+        // doesn't come out as wide as the stream's output is dropped.
+        if (normalized_dim_ == 0) normalized_dim_ = getNumOutputDimensions();
+        block_.reset(normalized_dim_);
+        uint32_t dropped = 0;
+        for (uint32_t i = 0; i < num_samples; i++) {
+            vector<double> row = normalize(
+                vector<double>(samples + i * dim, samples + (i + 1) * dim));
+            if (row.size() != normalized_dim_) {
+                next_sequence_++;
+                dropped++;
+                continue;
+            }
+            std::copy(row.begin(), row.end(),
+                      block_.addRow(timestamp_us, next_sequence_++));
+        }
+        if (dropped > 0) {
+            ofLog(OF_LOG_WARNING) << "Normalizer returned " << dropped
+                                  << " sample(s) without the expected "
+                                  << normalized_dim_ << " dimensions; "
+                                  << "dropping them";
+        }
+    }
+    if (block_.empty()) return;
+
+    if (sample_block_callback_ != nullptr) sample_block_callback_(block_);
+    if (data_ready_callback_ != nullptr) {
+        const uint32_t cols = block_.getNumDimensions();
+        matrix_.resize(block_.getNumRows(), cols);
+        for (uint32_t i = 0; i < block_.getNumRows(); i++) {
+            std::copy(block_.getRow(i), block_.getRow(i) + cols, matrix_[i]);
+        }
+        data_ready_callback_(matrix_);
+    }
+}
+
 void InputStream::setLabelsForAllDimensions(const vector<string> labels) {
     InputStream_labels_ = labels;
 }
@@ -78,17 +145,14 @@ int AudioStream::getNumInputDimensions() {
 }
 
 void AudioStream::audioIn(float* input, int buffer_size, int nChannel) {
-    // set nChannelOut as 1 to load only a single channel (left).
-    int nChannelOut = 1;
-    GRT::MatrixDouble data(buffer_size / nChannel / downsample_rate_, nChannelOut);
+    uint64_t now = SampleBlock::now();
+    // Only a single channel (left) is used.
+    int num_samples = buffer_size / nChannel / downsample_rate_;
+    samples_.resize(num_samples);
+    for (int i = 0; i < num_samples; i++)
+        samples_[i] = input[i * nChannel * downsample_rate_];
 
-    for (int i = 0; i < buffer_size / nChannel / downsample_rate_; i++)
-        for (int j = 0; j < nChannelOut; j++)
-            data[i][j] = input[i * nChannel * downsample_rate_ + j];
-
-    if (data_ready_callback_ != nullptr) {
-        data_ready_callback_(data);
-    }
+    passOnSamples(samples_.data(), num_samples, now);
 }
 
 AudioFileStream::AudioFileStream(char *file, bool loop) {
@@ -118,9 +182,8 @@ void AudioFileStream::readSpectrum() {
     while (has_started_) {
         std::this_thread::sleep_for(std::chrono::milliseconds(1000 / (44100 / 1024)));
         float *spectrum = ofSoundGetSpectrum(512);
-        GRT::VectorDouble data(spectrum, spectrum + 512);
-        GRT::MatrixDouble out; out.push_back(data);
-        if (data_ready_callback_ != nullptr) data_ready_callback_(out);
+        samples_.assign(spectrum, spectrum + 512);
+        passOnSamples(samples_.data(), 1);
     }
 }
 
@@ -128,14 +191,137 @@ int AudioFileStream::getNumInputDimensions() {
     return 512;
 }
 
+ReplayStream::ReplayStream(const string& filename, double speed)
+        : filename_(filename), speed_(speed) {
+    if (!recording_.open(ofToDataPath(filename))) {
+        ofLog(OF_LOG_ERROR) << recording_.getLastError();
+    }
+}
+
+ReplayStream::ReplayStream(const string& filename, uint32_t num_dimensions,
+                           double sample_rate, double speed)
+        : filename_(filename), speed_(speed) {
+    if (!recording_.openRaw(ofToDataPath(filename), num_dimensions, sample_rate)) {
+        ofLog(OF_LOG_ERROR) << recording_.getLastError();
+    }
+}
+
+bool ReplayStream::start() {
+    if (has_started_) return true;
+    if (recording_.getNumSamples() == 0) {
+        ofLog(OF_LOG_ERROR) << "Nothing to replay in " << filename_;
+        return false;
+    }
+    if (speed_ != kReplayMaxSpeed && recording_.getSampleRate() <= 0) {
+        ofLog(OF_LOG_WARNING) << filename_ << " has no sample rate; "
+                              << "replaying it at maximum speed";
+    }
+
+    has_started_ = true;
+    replay_thread_.reset(new std::thread(&ReplayStream::replay, this));
+    return true;
+}
+
+void ReplayStream::stop() {
+    has_started_ = false;
+    if (replay_thread_ != nullptr && replay_thread_->joinable()) {
+        replay_thread_->join();
+    }
+}
+
+int ReplayStream::getNumInputDimensions() {
+    return recording_.getNumDimensions();
+}
+
+uint64_t ReplayStream::getReplayTime() const {
+    if (recording_.getSampleRate() <= 0) return 0;
+    return position_ * 1e6 / recording_.getSampleRate();
+}
+
+void ReplayStream::replay() {
+    using std::chrono::steady_clock;
+
+    // Longest sleep between checks of has_started_, so stop() isn't held up
+    // by a slow replay.
+    const steady_clock::duration kMaxSleep = std::chrono::milliseconds(100);
+
+    const uint64_t num_samples = recording_.getNumSamples();
+    const double rate = recording_.getSampleRate() * speed_;
+    const steady_clock::time_point start_time = steady_clock::now();
+    // Samples delivered since start(), which set the virtual clock.
+    uint64_t replayed = 0;
+
+    while (has_started_ && !finished_) {
+        uint64_t position = position_;
+        if (position >= num_samples) {
+            if (!loop_) {
+                finished_ = true;
+                ofLog(OF_LOG_NOTICE) << "Finished replaying " << filename_;
+                break;
+            }
+            position = 0;
+        }
+        const uint32_t count = std::min<uint64_t>(block_size_, num_samples - position);
+        replayed += count;
+
+        if (rate > 0) {
+            // The block is due once its last sample would have been captured.
+            // Deadlines are relative to the start, so sleeps don't add up.
+            const steady_clock::time_point due = start_time +
+                std::chrono::duration_cast<steady_clock::duration>(
+                    std::chrono::duration<double>(replayed / rate));
+            for (steady_clock::time_point now = steady_clock::now();
+                 has_started_ && now < due; now = steady_clock::now()) {
+                std::this_thread::sleep_until(std::min(due, now + kMaxSleep));
+            }
+            if (!has_started_) break;
+        }
+
+        passOnSamples(recording_.getSample(position), count);
+        position_ = position + count;
+    }
+}
+
+bool WaitableSerial::waitForData(uint32_t timeout_ms) {
+#if defined( __WIN32__ ) || defined( _WIN32 )
+    // No descriptor to wait on; check in 1 ms steps instead.
+    for (uint32_t waited = 0; waited < timeout_ms; waited++) {
+        if (available() > 0) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return available() > 0;
+#else
+    if (!bInited) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+        return false;
+    }
+
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    int result = ::poll(&pfd, 1, static_cast<int>(timeout_ms));
+    if (result < 0) {
+        if (errno != EINTR) {
+            ofLog(OF_LOG_ERROR) << "poll() on serial port failed: " << strerror(errno);
+            // Avoid spinning if the descriptor has gone bad.
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+        }
+        return false;
+    }
+    return result > 0 && (pfd.revents & POLLIN);
+#endif
+}
+
 BaseSerialInputStream::BaseSerialInputStream(uint32_t baud, int dimensions)
-        : port_(-1), baud_(baud), dimensions_(dimensions), serial_(new ofSerial()) {
+        : port_(-1), baud_(baud), dimensions_(dimensions), serial_(new WaitableSerial()) {
     // Print all devices for convenience.
     // serial_->listDevices();
 }
 
 BaseSerialInputStream::BaseSerialInputStream(uint32_t port, uint32_t baud, int dimensions)
-        : port_(port), baud_(baud), dimensions_(dimensions), serial_(new ofSerial()) {
+        : port_(port), baud_(baud), dimensions_(dimensions), serial_(new WaitableSerial()) {
     // Print all devices for convenience.
     // serial_->listDevices();
 }
@@ -167,24 +353,32 @@ int BaseSerialInputStream::getNumInputDimensions() {
 }
 
 void BaseSerialInputStream::readSerial() {
-    // TODO(benzh) This readSerial is running in a different thread
-    // and performing a busy polling (100% CPU usage). Should be
-    // optimized.
-    int sleep_time = 1000 / (baud_ / 10); // sleep about long enough to receive a byte
-    ofLog() << "Serial port will be read every " << sleep_time << " ms";
+    // Block on the serial descriptor rather than sleeping for a fixed
+    // interval: we wake up as soon as bytes arrive and then drain everything
+    // the driver has buffered in large chunks before parsing once.
     while (has_started_) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time));
-        const int kBufSize = 32;
-        unsigned char buf[kBufSize];
+        if (!serial_->waitForData(max_read_wait_ms_)) {
+            read_timeouts_++;
+            continue;
+        }
+        read_wakeups_++;
+
         while (serial_->available() > 0) {
-            int result = serial_->readBytes(buf, kBufSize);
+            size_t old_size = buffer_.size();
+            buffer_.resize(old_size + kReadChunkSize);
+            int result = serial_->readBytes(&buffer_[old_size], kReadChunkSize);
 
             if ( result == OF_SERIAL_ERROR ) {
+                buffer_.resize(old_size);
                 ofLog( OF_LOG_ERROR, "unrecoverable error reading from serial" );
                 break;
-            } else if ( result != OF_SERIAL_NO_DATA ) {
-                buffer_.insert(buffer_.end(), buf, buf + result);
+            } else if ( result == OF_SERIAL_NO_DATA ) {
+                buffer_.resize(old_size);
+                break;
             }
+
+            buffer_.resize(old_size + result);
+            read_bytes_ += result;
         }
 
         parseSerial(buffer_);
@@ -192,7 +386,7 @@ void BaseSerialInputStream::readSerial() {
 }
 
 SerialStream::SerialStream(uint32_t port, uint32_t baud = 115200)
-        : port_(port), baud_(baud), serial_(new ofSerial()) {
+        : port_(port), baud_(baud), serial_(new WaitableSerial()) {
     // Print all devices for convenience.
     // serial_->listDevices();
 }
@@ -224,51 +418,21 @@ int SerialStream::getNumInputDimensions() {
 }
 
 void SerialStream::readSerial() {
-    // TODO(benzh) This readSerial is running in a different thread
-    // and performing a busy polling (100% CPU usage). Should be
-    // optimized.
-    int sleep_time = kBufferSize_ * 1000 / (baud_ / 10);
-    ofLog() << "Serial port will be read every " << sleep_time << " ms";
+    // Block on the serial descriptor instead of spinning on available(), and
+    // read whatever has arrived into a buffer that's kept across wakeups.
+    bytes_.resize(kReadChunkSize);
     while (has_started_) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time));
+        if (!serial_->waitForData(max_read_wait_ms_)) continue;
 
-        int local_buffer_size = kBufferSize_;
-        int bytesRequired = kBufferSize_;
-        uint8_t *bytes = new uint8_t[bytesRequired];
-        int bytesRemaining = bytesRequired;
-        while (bytesRemaining > 0) {
-            // check for data
-            if (serial_->available() > 0) {
-                // try to read - note offset into the bytes[] array, this is so
-                // that we don't overwrite the bytes we already have
-                int bytesArrayOffset = bytesRequired - bytesRemaining;
-                int result = serial_->readBytes(&bytes[bytesArrayOffset],
-                    bytesRemaining);
-
-                // check for error code
-                if (result == OF_SERIAL_ERROR) {
-                    // something bad happened
-                    ofLog(OF_LOG_ERROR) << "Error reading from serial";
-                    break;
-                }
-                else if (result == OF_SERIAL_NO_DATA) {
-                    // nothing was read, try again
-                }
-                else {
-                    // we read some data!
-                    bytesRemaining -= result;
-                }
-            }
-        }
-        delete[] bytes;
-        GRT::MatrixDouble data(local_buffer_size, 1);
-        for (int i = 0; i < local_buffer_size; i++) {
-            int b = bytes[i];
-            data[i][0] = (normalizer_ != nullptr) ? normalizer_(b) : b;
-        }
-        if (data_ready_callback_ != nullptr) {
-            data_ready_callback_(data);
+        int result = serial_->readBytes(&bytes_[0], bytes_.size());
+        if (result == OF_SERIAL_ERROR) {
+            ofLog(OF_LOG_ERROR) << "Error reading from serial";
+            continue;
         }
+        if (result <= 0) continue;  // OF_SERIAL_NO_DATA
+
+        samples_.assign(bytes_.begin(), bytes_.begin() + result);
+        passOnSamples(samples_.data(), result);
     }
 }
 
@@ -324,13 +488,10 @@ void FirmataStream::update() {
         arduino_.update();
 
         if (configured_arduino_) {
-            vector<double> data(pins_.size());
-            for (int i = 0; pins_.size(); i++)
-                data[i] = arduino_.getAnalog(pins_[i]);
-            data = normalize(data);
-            GRT::MatrixDouble matrix;
-            matrix.push_back(data);
-            if (data_ready_callback_ != nullptr) data_ready_callback_(matrix);
+            samples_.resize(pins_.size());
+            for (int i = 0; i < pins_.size(); i++)
+                samples_[i] = arduino_.getAnalog(pins_[i]);
+            passOnSamples(samples_.data(), 1);
         } else if (arduino_.isInitialized()) {
             ofLog() << "Configuring Arduino.";
             for (int i = 0; i < pins_.size(); i++)
@@ -341,61 +502,76 @@ void FirmataStream::update() {
 }
 
 bool TcpInputStream::start() {
-	server_ = new ofxTCPServer();
-    server_->setup(port_num_);
-    server_->setMessageDelimiter("\n");
-    has_started_ = true;
+    if (has_started_) return true;
 
-    reading_thread_.reset(new std::thread([this]() {
-        int sleep_time = 10;
-        ofLog() << "TCP inputs are checked every " << sleep_time << " ms";
-        while (has_started_) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(sleep_time));
-            for (int i = 0; i < server_->getLastID(); i++) {
-                if (server_->isClientConnected(i)) {
-                    string str = server_->receive(i);
-                    if (str != "") {
-                        parseInput(str);
-                    }
-                }
-            }
-        }
-    }));
+    if (!server_.start(port_num_, [this](const double* samples, uint32_t n) {
+            passOnSamples(samples, n);
+        })) {
+        ofLog(OF_LOG_ERROR) << "TcpInputStream: " << server_.getLastError();
+        return false;
+    }
+    ofLog() << "Listening for TCP inputs on port " << server_.getPort();
+    has_started_ = true;
     return true;
 }
 
-void TcpInputStream::parseInput(const string& buffer) {
-    if (data_ready_callback_ != nullptr) {
-        istringstream iss(buffer);
-        vector<double> data;
-        double d;
-
-        while (iss >> d)
-            data.push_back(d);
+void TcpInputStream::stop() {
+    has_started_.store(false);
+    server_.stop();
+}
 
-        if (data.size() > 0) {
-            data = normalize(data);
+int TcpInputStream::getNumInputDimensions() {
+    return dim_;
+}
 
-            GRT::MatrixDouble matrix;
-            matrix.push_back(data);
+bool BinaryInputStream::start() {
+    if (has_started_) return true;
 
-            data_ready_callback_(matrix);
+    auto callback = [this](const double* samples, uint32_t n) {
+        passOnSamples(samples, n);
+    };
+    if (transport_ == kTcp) {
+        if (!tcp_server_.start(port_num_, callback)) {
+            ofLog(OF_LOG_ERROR) << "BinaryInputStream: "
+                                << tcp_server_.getLastError();
+            return false;
         }
+        ofLog() << "Listening for binary TCP inputs on port "
+                << tcp_server_.getPort();
+    } else {
+        if (!udp_receiver_.start(port_num_, callback)) {
+            ofLog(OF_LOG_ERROR) << "BinaryInputStream: "
+                                << udp_receiver_.getLastError();
+            return false;
+        }
+        ofLog() << "Listening for binary UDP inputs on port "
+                << udp_receiver_.getPort();
     }
+    has_started_ = true;
+    return true;
 }
 
-void TcpInputStream::stop() {
+void BinaryInputStream::stop() {
     has_started_.store(false);
-    server_->close();
-    if (reading_thread_ != nullptr && reading_thread_->joinable()) {
-        reading_thread_->join();
-    }
+    tcp_server_.stop();
+    udp_receiver_.stop();
 }
 
-int TcpInputStream::getNumInputDimensions() {
+int BinaryInputStream::getNumInputDimensions() {
     return dim_;
 }
 
+FrameStats BinaryInputStream::getFrameStats() const {
+    if (transport_ == kUdp) return udp_receiver_.getStats();
+
+    FrameStats total = tcp_server_.getDisconnectedClientStats().frame_stats;
+    for (const TcpSampleServer::ClientStats& client :
+         tcp_server_.getClientStats()) {
+        total.add(client.frame_stats);
+    }
+    return total;
+}
+
 bool OscInputStream::start() {
     receiver_.setup(port_num_);
     has_started_ = true;
@@ -418,14 +594,12 @@ bool OscInputStream::start() {
 
 void OscInputStream::handleMessage(ofxOscMessage& m) {
     // check for mouse moved message
-    if (data_ready_callback_ != nullptr && m.getAddress() == addr_) {
-        vector<double> data;
-        GRT::MatrixDouble matrix;
+    if (m.getAddress() == addr_) {
+        samples_.resize(dim_);
         for (int i = 0; i < dim_; i++) {
-            data.push_back(m.getArgAsFloat(i));
+            samples_[i] = m.getArgAsFloat(i);
         }
-        matrix.push_back(data);
-        data_ready_callback_(matrix);
+        passOnSamples(samples_.data(), 1);
     }
 }
 
@@ -11,7 +11,11 @@
 #include "GRT/GRT.h"
 #include "ofMain.h"
 #include "ofxOsc.h"
+#include "recording-file.h"
+#include "sample-block.h"
 #include "stream.h"
+#include "tcp-sample-server.h"
+#include "udp-sample-receiver.h"
 
 #include <cstdint>
 
@@ -21,6 +25,9 @@ const uint32_t kOfSoundStream_SamplingRate = 44100;
 const uint32_t kOfSoundStream_BufferSize = 256;
 const uint32_t kOfSoundStream_nBuffers = 4;
 
+// Replay speed for a ReplayStream that doesn't wait between blocks.
+const double kReplayMaxSpeed = 0;
+
 /**
  @brief Base class for input streams that provide live sensor data to the ESP
  system.
@@ -58,8 +65,28 @@ class InputStream : public virtual Stream {
     void useNormalizer(vectorNormalizeFunc f) {
         normalizer_ = nullptr;
         vectorNormalizer_ = f;
+        normalized_dim_ = 0;
+    }
+
+    typedef std::function<void(const SampleBlock&)> onSampleBlockCallback;
+
+    /**
+     Receive the samples as SampleBlocks, with capture timestamps and sequence
+     numbers. Called on the stream's own thread; the block is only valid
+     during the call.
+     */
+    void onSampleBlockEvent(onSampleBlockCallback callback) {
+        sample_block_callback_ = callback;
     }
 
+    template<class T>
+    void onSampleBlockEvent(T* owner, void (T::*listenerMethod)(const SampleBlock&)) {
+        using namespace std::placeholders;
+        sample_block_callback_ = std::bind(listenerMethod, owner, _1);
+    }
+
+    // Receive the samples as the rows of a matrix instead. This is an adapter
+    // over the sample blocks, which copies every delivery once more.
     typedef std::function<void(GRT::MatrixDouble)> onDataReadyCallback;
 
     void onDataReadyEvent(onDataReadyCallback callback) {
@@ -72,6 +99,9 @@ class InputStream : public virtual Stream {
         data_ready_callback_ = std::bind(listenerMethod, owner, _1);
     }
 
+    // Identifies this stream in the SampleBlocks it delivers.
+    uint32_t getSourceId() const { return source_id_; }
+
     // Set labels on all input dimension. This function takes either a vector of
     // strings, or an initialization list (such as {"left", "right"}).
     void setLabelsForAllDimensions(const vector<string> labels);
@@ -81,11 +111,31 @@ class InputStream : public virtual Stream {
 
   protected:
     vector<string> InputStream_labels_;
-    onDataReadyCallback data_ready_callback_;
     normalizeFunc normalizer_;
     vectorNormalizeFunc vectorNormalizer_;
+    // getNumOutputDimensions() with the vector normalizer, or 0 until
+    // passOnSamples() first needs it.
+    uint32_t normalized_dim_ = 0;
 
     vector<double> normalize(vector<double>);
+
+    /**
+     Normalize num_samples row-major samples of getNumInputDimensions() values,
+     captured at timestamp_us (see SampleBlock::now()), and deliver them to the
+     callbacks as one block. Must be called from a single thread at a time.
+     */
+    void passOnSamples(const double* samples, uint32_t num_samples,
+                       uint64_t timestamp_us = SampleBlock::now());
+
+  private:
+    const uint32_t source_id_;
+    onSampleBlockCallback sample_block_callback_;
+    onDataReadyCallback data_ready_callback_;
+
+    // Reused from one delivery to the next.
+    SampleBlock block_;
+    GRT::MatrixDouble matrix_;
+    uint64_t next_sequence_ = 0;
 };
 
 /**
@@ -102,6 +152,7 @@ class AudioStream : public ofBaseApp, public InputStream {
     uint32_t downsample_rate_;
     unique_ptr<ofSoundStream> sound_stream_;
     bool setup_successful_;
+    vector<double> samples_;
 };
 
 /**
@@ -121,6 +172,103 @@ class AudioFileStream : public InputStream {
 
     ofSoundPlayer player_;
     unique_ptr<std::thread> update_thread_;
+    vector<double> samples_;
+};
+
+/**
+ @brief Input stream that replays a recording from disk in place of a live
+ sensor, e.g. to measure the throughput of a pipeline or to check that its
+ predictions haven't changed.
+ The recording (a WAV, binary data or raw file; see RecordingFile) is decoded
+ up front and delivered in blocks of setBlockSize() samples, paced by a
+ virtual clock that runs speed times as fast as the recording's sample rate:
+ 1 replays in real time, 10 ten times as fast, and kReplayMaxSpeed as fast as
+ the samples are taken. The blocks depend only on the file and the block
+ size, so every replay delivers exactly the same data.
+ A replay faster than the pipeline fills the input queue; to have every
+ sample processed, also call setInputQueueOverflowPolicy(SampleQueue::kBlock).
+ */
+class ReplayStream : public InputStream {
+  public:
+    /**
+     Replay a WAV or binary data file. Relative paths are in the data folder.
+     Binary data files don't store a sample rate; replay them at
+     kReplayMaxSpeed or call setSampleRate().
+     */
+    ReplayStream(const string& filename, double speed = 1.0);
+
+    // Replay a raw file of num_dimensions float32 values per sample.
+    ReplayStream(const string& filename, uint32_t num_dimensions,
+                 double sample_rate, double speed = 1.0);
+
+    virtual bool start() final;
+    virtual void stop() final;
+    virtual int getNumInputDimensions() final;
+
+    // The following take effect at the next start().
+    void setBlockSize(uint32_t num_samples) {
+        block_size_ = std::max<uint32_t>(num_samples, 1);
+    }
+    void setSampleRate(double sample_rate) {
+        recording_.setSampleRate(sample_rate);
+    }
+    // Start over at the end of the recording instead of finishing.
+    void setLoop(bool loop) { loop_ = loop; }
+    // Go back to the start; otherwise a stopped replay resumes where it was.
+    void rewind() {
+        position_ = 0;
+        finished_ = false;
+    }
+
+    // Index of the next sample to be delivered.
+    uint64_t getPosition() const { return position_; }
+    // Time into the recording on the virtual clock, in microseconds.
+    uint64_t getReplayTime() const;
+    // Whether the end of the recording was reached (never when looping).
+    bool hasFinished() const { return finished_; }
+
+  private:
+    void replay();
+
+    string filename_;
+    RecordingFile recording_;
+    double speed_;
+    uint32_t block_size_ = kOfSoundStream_BufferSize;
+    bool loop_ = false;
+    std::atomic<uint64_t> position_{0};
+    std::atomic<bool> finished_{false};
+    unique_ptr<std::thread> replay_thread_;
+};
+
+/**
+ @brief An ofSerial that can block until bytes arrive on the port.
+ ofSerial only offers a non-blocking available(), which forces readers to
+ sleep and poll. This waits on the underlying descriptor instead, so a reading
+ thread wakes as soon as data is ready.
+ */
+class WaitableSerial : public ofSerial {
+  public:
+    /**
+     Block until the port has bytes to read or timeout_ms elapses.
+     @return true if data is ready to be read.
+     */
+    bool waitForData(uint32_t timeout_ms);
+};
+
+/**
+ @brief Counters describing how a serial reading thread has been woken up.
+ */
+struct SerialReadStats {
+    // Number of times the reader woke up with data to read.
+    uint64_t wakeups = 0;
+    // Number of times the reader woke up because the max wait expired.
+    uint64_t timeouts = 0;
+    // Total number of bytes read from the port.
+    uint64_t bytes = 0;
+
+    double getBytesPerWakeup() const {
+        return wakeups == 0 ? 0 : static_cast<double>(bytes) / wakeups;
+    }
 };
 
 class BaseSerialInputStream : public virtual InputStream {
@@ -173,14 +321,40 @@ class BaseSerialInputStream : public virtual InputStream {
         return true;
     }
 
+    /**
+     Set the longest time the reading thread blocks waiting for serial data
+     before re-checking whether the stream has been stopped. This bounds how
+     long stop() takes; it does not add latency to data that arrives.
+     */
+    void setMaxReadWait(uint32_t ms) { max_read_wait_ms_ = ms; }
+
+    /**
+     Get wakeup and byte counters for the reading thread.
+     */
+    SerialReadStats getReadStats() const {
+        SerialReadStats stats;
+        stats.wakeups = read_wakeups_;
+        stats.timeouts = read_timeouts_;
+        stats.bytes = read_bytes_;
+        return stats;
+    }
+
   protected:
     virtual void parseSerial(vector<unsigned char> &buffer) = 0;
-    unique_ptr<ofSerial> serial_;
+    unique_ptr<WaitableSerial> serial_;
 
   private:
+    // Largest number of bytes pulled from the port per read call.
+    static const size_t kReadChunkSize = 4096;
+
     uint32_t port_ = -1;
     uint32_t baud_;
     int dimensions_;
+    std::atomic<uint32_t> max_read_wait_ms_{100};
+
+    std::atomic<uint64_t> read_wakeups_{0};
+    std::atomic<uint64_t> read_timeouts_{0};
+    std::atomic<uint64_t> read_bytes_{0};
 
     vector<unsigned char> buffer_;
 
@@ -189,19 +363,35 @@ class BaseSerialInputStream : public virtual InputStream {
     void readSerial();
 };
 
+/**
+ @brief Input stream for reading raw bytes from a (USB) serial port, each byte
+ being one sample of one dimension.
+ The reading thread blocks until bytes arrive, then passes on everything that
+ has arrived at once, as the rows of one matrix.
+ */
 class SerialStream : public InputStream {
   public:
     SerialStream(uint32_t usb_port_num, uint32_t baud);
     virtual bool start() final;
     virtual void stop() final;
     virtual int getNumInputDimensions() final;
+
+    // See BaseSerialInputStream::setMaxReadWait().
+    void setMaxReadWait(uint32_t ms) { max_read_wait_ms_ = ms; }
+
   private:
+    // Largest number of bytes read, and passed on, per wakeup.
+    static const size_t kReadChunkSize = 4096;
+
     uint32_t port_ = -1;
     uint32_t baud_;
-    // Serial buffer size
-    uint32_t kBufferSize_ = 64;
+    std::atomic<uint32_t> max_read_wait_ms_{100};
+
+    unique_ptr<WaitableSerial> serial_;
 
-    unique_ptr<ofSerial> serial_;
+    // Reused from one wakeup to the next by the reading thread.
+    vector<unsigned char> bytes_;
+    vector<double> samples_;
 
     // A separate reading thread to read data from Serial.
     unique_ptr<std::thread> reading_thread_;
@@ -243,31 +433,82 @@ class FirmataStream : public InputStream {
 
     ofArduino arduino_;
     unique_ptr<std::thread> update_thread_;
+    vector<double> samples_;
     void update();
 };
 
-// Forward declaration.
-class ofxTCPServer;
 
 /**
  @brief Listening for data inputs over a TCP socket.
+ Each client sends one sample per line, as dimension numbers separated by
+ spaces, tabs or commas. All the samples received in one wakeup of the server
+ are passed on together, as the rows of one matrix.
  */
 class TcpInputStream : public InputStream {
   public:
     TcpInputStream(int port_num, int dimension)
-        : port_num_(port_num), dim_(dimension) {
+        : port_num_(port_num), dim_(dimension), server_(dimension) {
+    }
+
+    virtual bool start() final;
+    virtual void stop() final;
+    virtual int getNumInputDimensions() final;
+
+    /**
+     Get byte, line and parse error counters for every connected client.
+     */
+    vector<TcpSampleServer::ClientStats> getClientStats() const {
+        return server_.getClientStats();
+    }
+
+    /**
+     Get the counters of every client that has disconnected since start(),
+     added up.
+     */
+    TcpSampleServer::ClientStats getDisconnectedClientStats() const {
+        return server_.getDisconnectedClientStats();
+    }
+
+  private:
+    int port_num_;
+    int dim_;
+    TcpSampleServer server_;
+};
+
+/**
+ @brief Listening for data inputs sent as binary frames (see binary-frame.h),
+ over TCP or UDP.
+ Frames are much cheaper to receive than lines of text, and their sequence
+ numbers tell how many samples went missing on the way (see getFrameStats()).
+ All the samples received in one wakeup are passed on together, as the rows
+ of one matrix.
+ */
+class BinaryInputStream : public InputStream {
+  public:
+    enum Transport { kTcp, kUdp };
+
+    BinaryInputStream(Transport transport, int port_num, int dimension)
+        : transport_(transport), port_num_(port_num), dim_(dimension),
+          tcp_server_(dimension, TcpSampleServer::kFrames),
+          udp_receiver_(dimension) {
     }
 
     virtual bool start() final;
     virtual void stop() final;
     virtual int getNumInputDimensions() final;
 
+    /**
+     Get frame, loss and error counters since start(), summed over every
+     client for TCP.
+     */
+    FrameStats getFrameStats() const;
+
   private:
-    void parseInput(const string& buffer);
-    ofxTCPServer* server_;
-    unique_ptr<std::thread> reading_thread_;
+    Transport transport_;
     int port_num_;
     int dim_;
+    TcpSampleServer tcp_server_;
+    UdpSampleReceiver udp_receiver_;
 };
 
 /**
@@ -291,4 +532,5 @@ class OscInputStream : public InputStream {
     int port_num_;
     string addr_;
     int dim_;
+    vector<double> samples_;
 };
@@ -0,0 +1,68 @@
+#include "latency-histogram.h"
+#include "gtest/gtest.h"
+
+#include <cmath>
+
+TEST(LatencyHistogramTest, Empty) {
+    LatencyHistogram h;
+    ASSERT_EQ(0, h.getCount());
+    ASSERT_EQ(0, h.getMin());
+    ASSERT_EQ(0, h.getMax());
+    ASSERT_EQ(0, h.getMean());
+    ASSERT_EQ(0, h.getValueAtPercentile(50));
+}
+
+TEST(LatencyHistogramTest, SmallValuesAreExact) {
+    LatencyHistogram h;
+    for (uint64_t v = 1; v <= 10; v++) h.record(v);
+
+    ASSERT_EQ(10, h.getCount());
+    ASSERT_EQ(1, h.getMin());
+    ASSERT_EQ(10, h.getMax());
+    ASSERT_DOUBLE_EQ(5.5, h.getMean());
+    ASSERT_EQ(5, h.getValueAtPercentile(50));
+    ASSERT_EQ(9, h.getValueAtPercentile(90));
+    ASSERT_EQ(10, h.getValueAtPercentile(100));
+}
+
+TEST(LatencyHistogramTest, BucketsCoverTheRangeInOrder) {
+    uint64_t last = 0;
+    for (uint32_t i = 1; i < LatencyHistogram::kNumBuckets; i++) {
+        uint64_t upper = LatencyHistogram::bucketUpperBound(i);
+        ASSERT_GT(upper, last);
+        ASSERT_EQ(i, LatencyHistogram::bucketIndex(upper));
+        ASSERT_EQ(i, LatencyHistogram::bucketIndex(last + 1));
+        last = upper;
+    }
+    ASSERT_EQ(UINT64_MAX, last);
+}
+
+TEST(LatencyHistogramTest, PercentilesWithinRelativeError) {
+    LatencyHistogram h;
+    // 1us .. 10ms in 1us steps.
+    const uint64_t kN = 10000;
+    for (uint64_t i = 1; i <= kN; i++) h.record(i * 1000);
+
+    const double kMaxError = 2.0 / LatencyHistogram::kSubBuckets;
+    for (double p : {50.0, 90.0, 99.0, 99.9}) {
+        double expected = std::ceil(p / 100 * kN) * 1000;
+        double actual = h.getValueAtPercentile(p);
+        ASSERT_GE(actual, expected);
+        ASSERT_LE(actual, expected * (1 + kMaxError)) << "p" << p;
+    }
+    ASSERT_EQ(kN * 1000, h.getValueAtPercentile(100));
+}
+
+TEST(LatencyHistogramTest, Reset) {
+    LatencyHistogram h;
+    h.record(123456);
+    h.reset();
+    ASSERT_EQ(0, h.getCount());
+    ASSERT_EQ(0, h.getMax());
+
+    h.record(7);
+    LatencyHistogram::Summary s = h.getSummary();
+    ASSERT_EQ(1, s.count);
+    ASSERT_EQ(7, s.min);
+    ASSERT_EQ(7, s.p999);
+}
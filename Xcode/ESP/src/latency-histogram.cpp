@@ -0,0 +1,95 @@
+#include "latency-histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+static uint32_t highestBit(uint64_t value) {
+    uint32_t bit = 0;
+    while (value >>= 1) bit++;
+    return bit;
+}
+
+LatencyHistogram::LatencyHistogram() : counts_(kNumBuckets, 0) {}
+
+uint32_t LatencyHistogram::bucketIndex(uint64_t value) {
+    if (value < kSubBuckets) return static_cast<uint32_t>(value);
+
+    // value lies in [2^msb, 2^(msb + 1)); keep its top kSubBucketBits bits.
+    uint32_t shift = highestBit(value) - kSubBucketBits + 1;
+    uint64_t sub = value >> shift;  // in [kSubBuckets / 2, kSubBuckets)
+    return kSubBuckets + (shift - 1) * (kSubBuckets / 2) +
+           static_cast<uint32_t>(sub - kSubBuckets / 2);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(uint32_t index) {
+    if (index < kSubBuckets) return index;
+
+    uint32_t k = index - kSubBuckets;
+    uint32_t shift = k / (kSubBuckets / 2) + 1;
+    uint64_t sub = k % (kSubBuckets / 2) + kSubBuckets / 2;
+    uint64_t lower = sub << shift;
+    return lower + ((uint64_t(1) << shift) - 1);
+}
+
+void LatencyHistogram::record(uint64_t value_ns) {
+    counts_[bucketIndex(value_ns)]++;
+    count_++;
+    sum_ += value_ns;
+    min_ = std::min(min_, value_ns);
+    max_ = std::max(max_, value_ns);
+}
+
+void LatencyHistogram::reset() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    count_ = 0;
+    min_ = UINT64_MAX;
+    max_ = 0;
+    sum_ = 0;
+}
+
+double LatencyHistogram::getMean() const {
+    return count_ == 0 ? 0 : static_cast<double>(sum_ / count_);
+}
+
+uint64_t LatencyHistogram::getValueAtPercentile(double percentile) const {
+    if (count_ == 0) return 0;
+
+    percentile = std::min(std::max(percentile, 0.0), 100.0);
+    uint64_t target = static_cast<uint64_t>(std::ceil(percentile / 100 * count_));
+    target = std::max<uint64_t>(target, 1);
+
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < kNumBuckets; i++) {
+        seen += counts_[i];
+        if (seen >= target) return std::min(bucketUpperBound(i), max_);
+    }
+    return max_;
+}
+
+LatencyHistogram::Summary LatencyHistogram::getSummary() const {
+    Summary s;
+    s.count = count_;
+    s.min = getMin();
+    s.max = max_;
+    s.mean = getMean();
+    s.p50 = getValueAtPercentile(50);
+    s.p90 = getValueAtPercentile(90);
+    s.p99 = getValueAtPercentile(99);
+    s.p999 = getValueAtPercentile(99.9);
+    return s;
+}
+
+string LatencyHistogram::Summary::toString() const {
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1)
+       << "n=" << count
+       << " mean=" << mean / 1000
+       << " p50=" << p50 / 1000.0
+       << " p90=" << p90 / 1000.0
+       << " p99=" << p99 / 1000.0
+       << " p99.9=" << p999 / 1000.0
+       << " max=" << max / 1000.0 << " us";
+    return ss.str();
+}
@@ -0,0 +1,80 @@
+/** @file latency-histogram.h
+ *  @brief LatencyHistogram, a fixed-size log-linear histogram of durations.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+/**
+ *  @brief Histogram of durations (in nanoseconds) with bounded relative error,
+ *  in the style of HdrHistogram.
+ *
+ *  Values below kSubBuckets are counted exactly. Above that, each power of two
+ *  is split into kSubBuckets / 2 equal buckets, so any reported value is
+ *  within 1 / (kSubBuckets / 2) (about 6%) of the recorded one. Recording is
+ *  O(1) and never allocates; the whole 64-bit range fits in kNumBuckets
+ *  counters.
+ *
+ *  Not thread-safe; callers that record and read from different threads must
+ *  provide their own locking.
+ */
+class LatencyHistogram {
+  public:
+    static const uint32_t kSubBucketBits = 5;
+    static const uint32_t kSubBuckets = 1 << kSubBucketBits;
+    static const uint32_t kNumBuckets =
+        kSubBuckets + (64 - kSubBucketBits) * (kSubBuckets / 2);
+
+    struct Summary {
+        uint64_t count = 0;
+        uint64_t min = 0;
+        uint64_t max = 0;
+        double mean = 0;
+        uint64_t p50 = 0;
+        uint64_t p90 = 0;
+        uint64_t p99 = 0;
+        uint64_t p999 = 0;
+
+        // One line, with durations in microseconds.
+        string toString() const;
+    };
+
+    LatencyHistogram();
+
+    void record(uint64_t value_ns);
+    void reset();
+
+    uint64_t getCount() const { return count_; }
+    uint64_t getMin() const { return count_ == 0 ? 0 : min_; }
+    uint64_t getMax() const { return max_; }
+    double getMean() const;
+
+    /**
+     * The smallest value such that at least percentile % of the recorded
+     * values are less than or equal to it (rounded up to the end of its
+     * bucket, but never above the largest recorded value).
+     *
+     * @param percentile: in [0, 100].
+     */
+    uint64_t getValueAtPercentile(double percentile) const;
+
+    Summary getSummary() const;
+
+    static uint32_t bucketIndex(uint64_t value);
+    // Largest value that falls into bucket index.
+    static uint64_t bucketUpperBound(uint32_t index);
+
+  private:
+    vector<uint64_t> counts_;
+    uint64_t count_ = 0;
+    uint64_t min_ = UINT64_MAX;
+    uint64_t max_ = 0;
+    // Long double keeps the mean exact enough over billions of samples.
+    long double sum_ = 0;
+};
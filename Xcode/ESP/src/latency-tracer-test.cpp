@@ -0,0 +1,48 @@
+#include "latency-tracer.h"
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+TEST(LatencyTracerTest, RecordsPerHop) {
+    LatencyTracer tracer;
+    uint32_t queue = tracer.getHop("queue");
+    uint32_t output = tracer.getHop("output");
+    EXPECT_EQ(queue, tracer.getHop("queue"));
+    EXPECT_NE(queue, output);
+
+    tracer.record(queue, 1000);
+    tracer.record({{queue, 3000}, {output, 50000}});
+
+    vector<LatencyTracer::HopStats> stats = tracer.getHopStats();
+    ASSERT_EQ(2u, stats.size());
+    EXPECT_EQ("queue", stats[0].name);
+    EXPECT_EQ(2u, stats[0].latency.count);
+    EXPECT_EQ(1000u, stats[0].latency.min);
+    EXPECT_EQ(3000u, stats[0].latency.max);
+    EXPECT_EQ("output", stats[1].name);
+    EXPECT_EQ(1u, stats[1].latency.count);
+
+    tracer.reset();
+    stats = tracer.getHopStats();
+    ASSERT_EQ(2u, stats.size());
+    EXPECT_EQ(0u, stats[0].latency.count);
+}
+
+TEST(LatencyTracerTest, DumpsCsv) {
+    LatencyTracer tracer;
+    tracer.record(tracer.getHop("pipeline"), 2000);
+    const char* filename = "latency-tracer-test.csv";
+    ASSERT_TRUE(tracer.dump(filename));
+
+    std::ifstream file(filename);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    EXPECT_EQ("hop,count,min_us,mean_us,p50_us,p90_us,p99_us,p999_us,max_us\n"
+              "pipeline,1,2,2,2,2,2,2,2\n",
+              contents.str());
+    std::remove(filename);
+
+    EXPECT_FALSE(tracer.dump("/nonexistent-directory/latency.csv"));
+}
@@ -0,0 +1,55 @@
+#include "latency-tracer.h"
+
+#include <fstream>
+
+uint32_t LatencyTracer::getHop(const string& name) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (uint32_t i = 0; i < hops_.size(); i++) {
+        if (hops_[i].name == name) return i;
+    }
+    hops_.emplace_back();
+    hops_.back().name = name;
+    return hops_.size() - 1;
+}
+
+void LatencyTracer::record(uint32_t hop, uint64_t value_ns) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (hop < hops_.size()) hops_[hop].histogram.record(value_ns);
+}
+
+void LatencyTracer::record(const vector<Measurement>& measurements) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (const Measurement& m : measurements) {
+        if (m.first < hops_.size()) hops_[m.first].histogram.record(m.second);
+    }
+}
+
+vector<LatencyTracer::HopStats> LatencyTracer::getHopStats() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    vector<HopStats> stats(hops_.size());
+    for (size_t i = 0; i < hops_.size(); i++) {
+        stats[i].name = hops_[i].name;
+        stats[i].latency = hops_[i].histogram.getSummary();
+    }
+    return stats;
+}
+
+void LatencyTracer::reset() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (Hop& hop : hops_) hop.histogram.reset();
+}
+
+bool LatencyTracer::dump(const string& filename) const {
+    std::ofstream file(filename);
+    if (!file) return false;
+
+    file << "hop,count,min_us,mean_us,p50_us,p90_us,p99_us,p999_us,max_us\n";
+    for (const HopStats& hop : getHopStats()) {
+        const LatencyHistogram::Summary& s = hop.latency;
+        file << hop.name << "," << s.count << "," << s.min / 1e3 << ","
+             << s.mean / 1e3 << "," << s.p50 / 1e3 << "," << s.p90 / 1e3 << ","
+             << s.p99 / 1e3 << "," << s.p999 / 1e3 << "," << s.max / 1e3
+             << "\n";
+    }
+    return static_cast<bool>(file);
+}
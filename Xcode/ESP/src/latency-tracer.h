@@ -0,0 +1,64 @@
+/** @file latency-tracer.h
+ *  @brief LatencyTracer keeps a latency histogram for each hop a live sample
+ *  makes, from its arrival on an input stream to the output streams.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "latency-histogram.h"
+
+using std::string;
+using std::vector;
+
+/**
+ @brief Named latency histograms, one per hop, that one thread records into
+ while others read them.
+
+ Hops are identified by an index obtained once from getHop(), so recording
+ doesn't look names up. A sample's hops are usually recorded together with
+ record(const vector<Measurement>&), which takes the lock once.
+ */
+class LatencyTracer {
+  public:
+    struct HopStats {
+        string name;
+        LatencyHistogram::Summary latency;
+    };
+
+    // A duration, in nanoseconds, spent on hop.
+    typedef std::pair<uint32_t, uint64_t> Measurement;
+
+    // Index of the hop called name, which is added if it's new.
+    uint32_t getHop(const string& name);
+
+    void record(uint32_t hop, uint64_t value_ns);
+    void record(const vector<Measurement>& measurements);
+
+    // Latency of every hop, in the order the hops were added.
+    vector<HopStats> getHopStats() const;
+
+    // Forget everything recorded, but keep the hops.
+    void reset();
+
+    /**
+     Write the latency of every hop to filename as CSV, one line per hop, with
+     durations in microseconds.
+     @return false if the file can't be written.
+     */
+    bool dump(const string& filename) const;
+
+  private:
+    struct Hop {
+        string name;
+        LatencyHistogram histogram;
+    };
+
+    mutable std::mutex mutex_;
+    vector<Hop> hops_;
+};
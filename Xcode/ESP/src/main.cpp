@@ -1,9 +1,22 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "headless.h"
 #include "ofApp.h"
+#include "ofAppNoWindow.h"
 #include "ofMain.h"
 
-int main() {
-    ofSetupOpenGL(1024, 768, OF_WINDOW);
+static void printUsage(const char* name) {
+    std::cerr << "Usage: " << name << " [--headless SESSION_DIR [--serial PORT]]"
+              << std::endl
+              << "  --headless SESSION_DIR  run the saved session in SESSION_DIR "
+              << "without a window" << std::endl
+              << "  --serial PORT           index of the serial port to use "
+              << "in headless mode" << std::endl;
+}
 
+static void setDataPathRoot() {
 #ifdef __APPLE__
     ofSetDataPathRoot("../Resources/data/");
 #elif _WIN32
@@ -11,6 +24,36 @@ int main() {
 #else
     ofSetDataPathRoot(".");
 #endif
+}
+
+int main(int argc, char* argv[]) {
+    const char* session_dir = nullptr;
+    int serial_port = -1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0 && i + 1 < argc) {
+            session_dir = argv[++i];
+        } else if (strcmp(argv[i], "--serial") == 0 && i + 1 < argc) {
+            serial_port = atoi(argv[++i]);
+        } else if (strncmp(argv[i], "-psn", 4) == 0) {
+            // Process serial number added by macOS when launched from Finder.
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (session_dir != nullptr) {
+        // No GL context and no window: the headless app only runs the
+        // input stream, pipeline and output streams.
+        ofAppNoWindow window;
+        ofSetupOpenGL(&window, 0, 0, OF_WINDOW);
+        setDataPathRoot();
+        ofRunApp(new HeadlessApp(session_dir, serial_port));
+        return 0;
+    }
+
+    ofSetupOpenGL(1024, 768, OF_WINDOW);
+    setDataPathRoot();
 
     ofxDatGui::setAssetPath("./");
 
@@ -0,0 +1,65 @@
+#include "model-trainer.h"
+
+#include "ofMain.h"
+
+ModelTrainer::~ModelTrainer() {
+    cancel();
+    for (Abandoned& a : abandoned_) {
+        if (a.thread.joinable()) a.thread.join();
+    }
+}
+
+void ModelTrainer::start(const GRT::GestureRecognitionPipeline& pipeline,
+                         const TrainingDataSnapshot& data) {
+    cancel();
+    reap();
+
+    job_.reset(new Job());
+    job_->pipeline = pipeline;
+    job_->data = data;
+    job_->start_time = ofGetElapsedTimeMillis();
+    thread_ = std::thread(&ModelTrainer::run, job_.get());
+}
+
+void ModelTrainer::run(Job* job) {
+    job->succeeded = job->pipeline.train(job->data.materialize());
+    job->data = TrainingDataSnapshot();
+    job->done = true;
+}
+
+void ModelTrainer::cancel() {
+    if (job_ == nullptr) return;
+
+    Abandoned a;
+    a.job = std::move(job_);
+    a.thread = std::move(thread_);
+    abandoned_.push_back(std::move(a));
+    reap();
+}
+
+void ModelTrainer::reap() {
+    for (auto it = abandoned_.begin(); it != abandoned_.end();) {
+        if (it->job->done) {
+            it->thread.join();
+            it = abandoned_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+uint64_t ModelTrainer::getElapsedMillis() const {
+    if (job_ == nullptr) return 0;
+    return ofGetElapsedTimeMillis() - job_->start_time;
+}
+
+bool ModelTrainer::takeResult(GRT::GestureRecognitionPipeline& pipeline) {
+    if (!isDone()) return false;
+
+    thread_.join();
+    bool succeeded = job_->succeeded;
+    if (succeeded) pipeline = job_->pipeline;
+    job_.reset();
+    reap();
+    return succeeded;
+}
@@ -0,0 +1,81 @@
+/** @file model-trainer.h
+ *  @brief ModelTrainer trains a copy of a pipeline on a background thread.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <GRT/GRT.h>
+
+#include "training-data-snapshot.h"
+
+/**
+ @brief Trains a copy of a pipeline on a snapshot of the training data, so the
+ live pipeline keeps serving predictions while training runs.
+
+ The caller polls isDone() and then takes the trained pipeline with
+ takeResult() and swaps it in. The training data is only copied into GRT's
+ format on the training thread, and freed as soon as training finishes. GRT training cannot be interrupted, so cancel()
+ only abandons the running job: its thread finishes in the background and its
+ result is thrown away, while a new job may start right away. Abandoned jobs
+ are joined once they finish, or in the destructor.
+ */
+class ModelTrainer {
+  public:
+    ModelTrainer() = default;
+    ~ModelTrainer();
+
+    /**
+     Start training a copy of pipeline on data, abandoning any job in
+     progress. The pipeline is copied before start() returns.
+     */
+    void start(const GRT::GestureRecognitionPipeline& pipeline,
+               const TrainingDataSnapshot& data);
+
+    // Abandon the current job, if any.
+    void cancel();
+
+    // True from start() until the result is taken or the job is cancelled.
+    bool isTraining() const { return job_ != nullptr; }
+
+    // True once the current job has finished, successfully or not.
+    bool isDone() const { return job_ != nullptr && job_->done; }
+
+    // Time since the current job started.
+    uint64_t getElapsedMillis() const;
+
+    /**
+     Hand over the result of a finished job and go back to idle.
+     @param pipeline: set to the trained pipeline if training succeeded.
+     @return whether training succeeded; false if no job has finished.
+     */
+    bool takeResult(GRT::GestureRecognitionPipeline& pipeline);
+
+  private:
+    struct Job {
+        GRT::GestureRecognitionPipeline pipeline;
+        TrainingDataSnapshot data;
+        uint64_t start_time;
+        std::atomic_bool done{false};
+        bool succeeded = false;
+    };
+
+    static void run(Job* job);
+
+    // Join abandoned jobs that have finished.
+    void reap();
+
+    std::unique_ptr<Job> job_;
+    std::thread thread_;
+
+    struct Abandoned {
+        std::unique_ptr<Job> job;
+        std::thread thread;
+    };
+    std::vector<Abandoned> abandoned_;
+};
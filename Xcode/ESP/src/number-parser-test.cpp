@@ -0,0 +1,134 @@
+#include "number-parser.h"
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+namespace {
+
+double parse(const std::string& s, size_t* consumed = nullptr) {
+    double value = -12345;
+    const char* end = parseDouble(s.data(), s.data() + s.size(), &value);
+    if (consumed != nullptr) {
+        *consumed = end == nullptr ? 0 : end - s.data();
+    }
+    return value;
+}
+
+}  // namespace
+
+TEST(NumberParserTest, MatchesStrtod) {
+    const char* inputs[] = {
+        "0", "-0", "1", "-1", "+7", "42", "3.25", "-0.5", ".5", "5.",
+        "1e3", "1E-3", "2.5e+10", "123456789012345678", "0.1", "0.7",
+        "1.7976931348623157e308", "4.9e-324", "2.2250738585072014e-308",
+        "9007199254740993", "123456789012345678901234567890",
+        "0.000000000000000000000000000001", "1e-400", "3.14159265358979323846",
+    };
+    for (const char* input : inputs) {
+        size_t consumed;
+        double value = parse(input, &consumed);
+        EXPECT_EQ(std::strtod(input, nullptr), value) << input;
+        EXPECT_EQ(std::strlen(input), consumed) << input;
+    }
+}
+
+TEST(NumberParserTest, MatchesStrtodOnRandomNumbers) {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> mantissa(-1000, 1000);
+    std::uniform_int_distribution<int> exponent(-30, 30);
+    char buffer[64];
+    for (int i = 0; i < 10000; i++) {
+        double x = mantissa(rng) * std::pow(10.0, exponent(rng));
+        snprintf(buffer, sizeof(buffer), (i % 2) ? "%.17g" : "%.6f", x);
+        EXPECT_EQ(std::strtod(buffer, nullptr), parse(buffer)) << buffer;
+    }
+}
+
+TEST(NumberParserTest, StopsAtTheEndOfTheNumber) {
+    size_t consumed;
+    EXPECT_EQ(2.0, parse("2e", &consumed));
+    EXPECT_EQ(1u, consumed);
+    EXPECT_EQ(2.0, parse("2e+x", &consumed));
+    EXPECT_EQ(1u, consumed);
+    EXPECT_EQ(1.5, parse("1.5.3", &consumed));
+    EXPECT_EQ(3u, consumed);
+
+    // Never reads past end, even when the text goes on.
+    std::string s = "12345";
+    double value;
+    EXPECT_EQ(s.data() + 2, parseDouble(s.data(), s.data() + 2, &value));
+    EXPECT_EQ(12.0, value);
+}
+
+TEST(NumberParserTest, RejectsNonNumbers) {
+    const char* inputs[] = {"", "-", "+", ".", "-.", "e5", "abc", "nan", "inf"};
+    for (const char* input : inputs) {
+        double value = 1;
+        EXPECT_EQ(nullptr, parseDouble(input, input + std::strlen(input), &value))
+            << input;
+        EXPECT_EQ(1, value);
+    }
+}
+
+TEST(NumberParserTest, ParsesLines) {
+    double values[4];
+    uint32_t n;
+    std::string line = " 1\t-2.5, 3e2 \r";
+    EXPECT_TRUE(parseNumbers(line.data(), line.data() + line.size(), values, 4, &n));
+    ASSERT_EQ(3u, n);
+    EXPECT_EQ(1.0, values[0]);
+    EXPECT_EQ(-2.5, values[1]);
+    EXPECT_EQ(300.0, values[2]);
+
+    line = "";
+    EXPECT_TRUE(parseNumbers(line.data(), line.data() + line.size(), values, 4, &n));
+    EXPECT_EQ(0u, n);
+}
+
+TEST(NumberParserTest, ReportsBadLines) {
+    double values[2];
+    uint32_t n;
+    std::string line = "1 2 x";
+    EXPECT_FALSE(parseNumbers(line.data(), line.data() + line.size(), values, 2, &n));
+    EXPECT_EQ(2u, n);
+
+    line = "1 2 3";
+    EXPECT_FALSE(parseNumbers(line.data(), line.data() + line.size(), values, 2, &n));
+    EXPECT_EQ(2u, n);
+
+    line = "1 2x";
+    EXPECT_FALSE(parseNumbers(line.data(), line.data() + line.size(), values, 2, &n));
+    EXPECT_EQ(1u, n);
+}
+
+TEST(NumberParserTest, LineParserConsumesEveryCompleteLine) {
+    LineParser parser(2);
+    std::vector<double> samples;
+    std::string data = "1 2\n\n3,4\r\nx y\n5 6 7\n8\t9";
+    size_t consumed = parser.parse(data.data(), data.size(), &samples);
+    EXPECT_EQ(data.size() - 3, consumed);
+    EXPECT_EQ(std::vector<double>({1, 2, 3, 4}), samples);
+    EXPECT_EQ(5u, parser.getNumLines());
+    EXPECT_EQ(2u, parser.getNumErrors());
+
+    // The caller keeps the incomplete line and appends to it.
+    data = data.substr(consumed) + "\n";
+    EXPECT_EQ(data.size(), parser.parse(data.data(), data.size(), &samples));
+    EXPECT_EQ(std::vector<double>({1, 2, 3, 4, 8, 9}), samples);
+}
+
+TEST(NumberParserTest, LineParserDropsOverlongLines) {
+    LineParser parser(1);
+    std::vector<double> samples;
+    std::string data(LineParser::kMaxLineLength + 1, '1');
+    EXPECT_EQ(data.size(), parser.parse(data.data(), data.size(), &samples));
+    data = "11\n7\n";
+    EXPECT_EQ(data.size(), parser.parse(data.data(), data.size(), &samples));
+    EXPECT_EQ(std::vector<double>({7}), samples);
+    EXPECT_EQ(2u, parser.getNumLines());
+    EXPECT_EQ(1u, parser.getNumErrors());
+}
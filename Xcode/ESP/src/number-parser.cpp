@@ -0,0 +1,184 @@
+#include "number-parser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <locale>
+#include <sstream>
+#include <string>
+
+namespace {
+
+// Every power of ten up to 1e22 is exactly representable as a double.
+const double kPowersOfTen[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+const int kMaxExactPowerOfTen = 22;
+const uint64_t kMaxExactMantissa = uint64_t(1) << 53;
+const int kMaxSignificantDigits = 19;
+
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+inline bool isSeparator(char c) {
+    return c == ' ' || c == '\t' || c == ',';
+}
+
+// Correctly rounded conversion of the number in [begin, end) for the cases
+// the fast path can't do exactly.
+double parseSlowly(const char* begin, const char* end) {
+    std::istringstream stream(std::string(begin, end));
+    stream.imbue(std::locale::classic());
+    double value = 0;
+    // On overflow, value is set to the largest double (with the right sign)
+    // even though the extraction fails.
+    stream >> value;
+    return value;
+}
+
+}  // namespace
+
+const char* parseDouble(const char* begin, const char* end, double* value) {
+    const char* p = begin;
+    bool negative = false;
+    if (p != end && (*p == '+' || *p == '-')) {
+        negative = *p == '-';
+        p++;
+    }
+    const char* unsigned_begin = p;
+
+    // The first kMaxSignificantDigits significant digits go into mantissa;
+    // the value is mantissa * 10^exponent.
+    uint64_t mantissa = 0;
+    int significant = 0;
+    int exponent = 0;
+    bool truncated = false;
+    bool has_digits = false;
+
+    for (; p != end && isDigit(*p); p++) {
+        has_digits = true;
+        if (significant < kMaxSignificantDigits) {
+            mantissa = mantissa * 10 + (*p - '0');
+            if (mantissa != 0) significant++;
+        } else {
+            exponent++;
+            truncated = truncated || *p != '0';
+        }
+    }
+    if (p != end && *p == '.') {
+        p++;
+        for (; p != end && isDigit(*p); p++) {
+            has_digits = true;
+            if (significant < kMaxSignificantDigits) {
+                mantissa = mantissa * 10 + (*p - '0');
+                exponent--;
+                if (mantissa != 0) significant++;
+            } else {
+                truncated = truncated || *p != '0';
+            }
+        }
+    }
+    if (!has_digits) return nullptr;
+
+    // An exponent only counts if it has digits: "2e" is the number 2
+    // followed by "e".
+    if (p != end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool negative_exponent = false;
+        if (q != end && (*q == '+' || *q == '-')) {
+            negative_exponent = *q == '-';
+            q++;
+        }
+        if (q != end && isDigit(*q)) {
+            int e = 0;
+            for (; q != end && isDigit(*q); q++) {
+                if (e < 100000) e = e * 10 + (*q - '0');
+            }
+            exponent += negative_exponent ? -e : e;
+            p = q;
+        }
+    }
+
+    double result;
+    if (mantissa == 0 && !truncated) {
+        result = 0;
+    } else if (!truncated && mantissa <= kMaxExactMantissa &&
+               exponent >= -kMaxExactPowerOfTen &&
+               exponent <= kMaxExactPowerOfTen) {
+        // Both operands are exact, so the one rounding of the multiplication
+        // or division gives the correctly rounded result.
+        result = static_cast<double>(mantissa);
+        if (exponent < 0) {
+            result /= kPowersOfTen[-exponent];
+        } else {
+            result *= kPowersOfTen[exponent];
+        }
+    } else {
+        result = parseSlowly(unsigned_begin, p);
+    }
+    *value = negative ? -result : result;
+    return p;
+}
+
+bool parseNumbers(const char* begin, const char* end, double* values,
+                  uint32_t max_values, uint32_t* num_values) {
+    if (begin != end && end[-1] == '\r') end--;
+
+    uint32_t n = 0;
+    const char* p = begin;
+    while (true) {
+        while (p != end && isSeparator(*p)) p++;
+        if (p == end) break;
+
+        double value;
+        const char* next = parseDouble(p, end, &value);
+        if (next == nullptr || n == max_values ||
+            (next != end && !isSeparator(*next))) {
+            *num_values = n;
+            return false;
+        }
+        values[n++] = value;
+        p = next;
+    }
+    *num_values = n;
+    return true;
+}
+
+size_t LineParser::parse(const char* data, size_t size,
+                         std::vector<double>* samples) {
+    size_t start = 0;
+    while (true) {
+        size_t from = std::max(start, scanned_);
+        const char* newline = static_cast<const char*>(
+            std::memchr(data + from, '\n', size - from));
+        if (newline == nullptr) break;
+        size_t end = newline - data;
+
+        lines_++;
+        if (discarding_) {
+            discarding_ = false;
+        } else if (end - start > kMaxLineLength) {
+            errors_++;
+        } else {
+            const size_t old_size = samples->size();
+            samples->resize(old_size + num_dimensions_);
+            uint32_t n;
+            bool ok = parseNumbers(data + start, data + end,
+                                   samples->data() + old_size, num_dimensions_,
+                                   &n);
+            if (!ok || n != num_dimensions_) {
+                samples->resize(old_size);
+                if (!ok || n != 0) errors_++;
+            }
+        }
+        start = end + 1;
+    }
+
+    if (size - start > kMaxLineLength) {
+        if (!discarding_) errors_++;
+        discarding_ = true;
+        scanned_ = 0;
+        return size;
+    }
+    scanned_ = size - start;
+    return start;
+}
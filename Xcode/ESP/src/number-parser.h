@@ -0,0 +1,81 @@
+/** @file number-parser.h
+ *  @brief Fast, locale-independent parsing of decimal numbers from text, for
+ *  input streams that receive lines of numbers.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ Parse one decimal number, such as "-12", "3.25" or "1e-3", starting exactly
+ at begin and without reading past end. The syntax is that of strtod() in the
+ "C" locale, except that hexadecimal numbers, infinities and NaNs are not
+ accepted. Numbers with at most 19 significant digits and a small enough
+ exponent (the common case) are converted exactly without any library call;
+ others fall back to the standard library, still in the "C" locale.
+
+ @return a pointer just past the number, or nullptr if [begin, end) doesn't
+ start with a number (in which case value is left unchanged).
+ */
+const char* parseDouble(const char* begin, const char* end, double* value);
+
+/**
+ Parse a line of numbers separated by spaces, tabs or commas; a trailing '\r'
+ is ignored.
+
+ @param values: receives up to max_values numbers.
+ @param num_values: set to the number of values stored, including on failure
+ (the numbers before the first problem).
+ @return false if the line holds anything other than numbers and separators,
+ or more than max_values numbers.
+ */
+bool parseNumbers(const char* begin, const char* end, double* values,
+                  uint32_t max_values, uint32_t* num_values);
+
+/**
+ *  @brief Splits a byte stream into lines and parses each one as a sample of
+ *  num_dimensions numbers (see parseNumbers()).
+ *
+ *  The parser works in place on the caller's buffer: parse() consumes the
+ *  complete lines at its start and tells how many bytes that was, so the
+ *  caller only has to move the incomplete last line to the front once per
+ *  read, rather than erasing every line from the front of the buffer.
+ *
+ *  Lines that aren't exactly num_dimensions numbers are dropped and counted
+ *  as errors; so are lines longer than kMaxLineLength, which could otherwise
+ *  grow the caller's buffer without bound. Empty lines are ignored.
+ */
+class LineParser {
+  public:
+    // Longest line accepted, in bytes.
+    static const size_t kMaxLineLength = 64 * 1024;
+
+    explicit LineParser(uint32_t num_dimensions)
+        : num_dimensions_(num_dimensions) {
+    }
+
+    /**
+     Parse the complete lines at the start of [data, data + size) and append
+     their samples to samples, row-major.
+     @return the number of bytes consumed. The rest is the start of a line
+     that isn't complete yet; pass it again, followed by more data.
+     */
+    size_t parse(const char* data, size_t size, std::vector<double>* samples);
+
+    uint32_t getNumDimensions() const { return num_dimensions_; }
+    // Complete lines seen, including bad ones.
+    uint64_t getNumLines() const { return lines_; }
+    // Lines dropped.
+    uint64_t getNumErrors() const { return errors_; }
+
+  private:
+    uint32_t num_dimensions_;
+    // Bytes at the start of the incomplete line known not to hold a newline.
+    size_t scanned_ = 0;
+    bool discarding_ = false;  // dropping the rest of an overlong line
+    uint64_t lines_ = 0;
+    uint64_t errors_ = 0;
+};
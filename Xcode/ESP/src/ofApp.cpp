@@ -7,6 +7,9 @@
 #include <sstream>
 #include <string>
 
+#include "batch-pipeline.h"
+#include "binary-data-file.h"
+#include "headless.h"
 #include "user.h"
 #include "ofxParagraph.h"
 #include "ofYesNoDialog.h"
@@ -15,9 +18,6 @@
 // single output will be more visual.
 const uint32_t kTooManyFeaturesThreshold = 32;
 
-// This delay is needed so that UI can update to reflect the training status.
-const uint32_t kDelayBeforeTraining = 50;  // milliseconds
-
 // Instructions for each tab.
 static const char* kCalibrateInstruction =
     "Collect the specified samples to calibrate ESP to your sensor. Must be completed before using the rest of the system.";
@@ -54,6 +54,7 @@ string decodeName(const string &name);
 
 void ofApp::useCalibrator(Calibrator &calibrator) {
     calibrator_ = &calibrator;
+    inference_.setCalibrator(calibrator_);
 }
 
 void ofApp::useIStream(InputStream &stream) {
@@ -62,6 +63,8 @@ void ofApp::useIStream(InputStream &stream) {
 
 void ofApp::usePipeline(GRT::GestureRecognitionPipeline &pipeline) {
     pipeline_ = &pipeline;
+    pipeline_generation_++;
+    inference_.setPipeline(pipeline_);
 }
 
 void ofApp::useOStream(OStream &stream) {
@@ -86,11 +89,11 @@ ofApp::ofApp() : fragment_(TRAINING),
                  num_feature_modules_(0),
                  calibrator_(nullptr),
                  training_data_manager_(kNumMaxLabels_),
+                 inference_(input_queue_),
                  should_save_calibration_data_(false),
                  should_save_pipeline_(false),
                  should_save_training_data_(false),
                  should_save_test_data_(false),
-                 is_training_scheduled_(false),
                  is_recording_(false),
                  true_positive_threshold_(0),
                  false_negative_threshold_(0) {
@@ -168,7 +171,12 @@ void ofApp::setup() {
         state_ = AppState::kPipeline;
     }
 
-    istream_->onDataReadyEvent(this, &ofApp::onDataIn);
+    input_queue_.reset(istream_->getNumOutputDimensions(), input_queue_capacity_);
+    input_queue_.setOverflowPolicy(input_queue_policy_);
+    istream_->onSampleBlockEvent(this, &ofApp::onDataIn);
+
+    inference_.setOutputStreams(ostreams_, ostreamvectors_);
+    inference_.start();
 
     predicted_label_buffer_.resize(buffer_size_);
     predicted_class_labels_buffer_.resize(buffer_size_);
@@ -549,23 +557,11 @@ void ofApp::updatePlotSamplesSnapshot(int num, int row) {
     }
 }
 
-vector<double> ofApp::getLastStageProcessedData() const {
-    // This could be get last stage of feature extraction if there is feature
-    // extraction or last stage of pre-processing if there is no feature
-    // extraction data
-    if (num_feature_modules_ > 0) {
-        return pipeline_->getFeatureExtractionData(num_feature_modules_ - 1);
-    } else if (num_preprocessing_modules_ > 0) {
-        return pipeline_->getPreProcessedData(num_preprocessing_modules_ - 1);
-    } else {
-        // we should have never been here for pipeline without any processing
-        assert(false);
-    }
-}
-
 void ofApp::populateSampleFeatures(uint32_t sample_index) {
     if (num_preprocessing_modules_ + num_feature_modules_ == 0) { return; }
 
+    InferenceWorker::PipelineLock lock = inference_.lockPipeline();
+
     // Clean up historical data/caches.
     pipeline_->reset();
 
@@ -584,16 +580,16 @@ void ofApp::populateSampleFeatures(uint32_t sample_index) {
         }
     }
 
-    // 2. get processed data by flowing samples through
-    for (uint32_t i = start; i < end; i++) {
-        vector<double> data_point = sample.getRowVector(i);
-        if (!pipeline_->preProcessData(data_point)) {
-            ofLog(OF_LOG_ERROR) << "ERROR: Failed to compute features!";
-            continue;
-        }
+    // 2. get processed data by flowing samples through, a stage at a time
+    MatrixDouble features;
+    if (!extractFeaturesBatch(*pipeline_, sample, start, end, features)) {
+        ofLog(OF_LOG_ERROR) << "ERROR: Failed to compute features!";
+        return;
+    }
 
+    for (uint32_t i = 0; i < features.getNumRows(); i++) {
         // Last stage of processing
-        vector<double> feature = getLastStageProcessedData();
+        vector<double> feature = features.getRowVector(i);
 
         for (uint32_t k = 0; k < feature_plots.size(); k++) {
             vector<double> feature_point = { feature[k] };
@@ -687,17 +683,16 @@ void ofApp::updateTestWindowPlot() {
 }
 
 void ofApp::runPredictionOnTestData() {
-    test_data_predicted_class_labels_.resize(test_data_.getNumRows());
-    for (int i = 0; i < test_data_.getNumRows(); i++) {
-        if (pipeline_->getTrained()) {
-            pipeline_->predict(test_data_.getRowVector(i));
-
-            int predicted_label = pipeline_->getPredictedClassLabel();
+    InferenceWorker::PipelineLock lock = inference_.lockPipeline();
+    test_data_predicted_class_labels_.assign(test_data_.getNumRows(), 0);
+    if (!pipeline_->getTrained()) { return; }
 
-            test_data_predicted_class_labels_[i] = predicted_label;
-        } else {
-            test_data_predicted_class_labels_[i] = 0;
-        }
+    BatchPrediction prediction;
+    if (!predictBatch(*pipeline_, test_data_, prediction)) {
+        ofLog(OF_LOG_ERROR) << "Failed to run prediction on test data";
+    }
+    for (int i = 0; i < test_data_.getNumRows(); i++) {
+        test_data_predicted_class_labels_[i] = prediction.labels[i];
     }
 }
 
@@ -709,6 +704,7 @@ bool ofApp::savePipelineWithPrompt() {
 }
 
 bool ofApp::savePipeline(const string& filename) {
+    InferenceWorker::PipelineLock lock = inference_.lockPipeline();
     if (pipeline_->save(filename)) {
         setStatus("Pipeline is saved to " + filename);
         should_save_pipeline_ = false;
@@ -732,7 +728,9 @@ bool ofApp::loadPipelineWithPrompt() {
 }
 
 bool ofApp::loadPipeline(const string& filename) {
+    InferenceWorker::PipelineLock lock = inference_.lockPipeline();
     if (pipeline_->load(filename)) {
+        pipeline_generation_++;
         setStatus("Pipeline is loaded from " + filename);
         should_save_pipeline_ = false;
         if (pipeline_->getTrained()) afterTrainModel();
@@ -832,6 +830,7 @@ bool ofApp::loadCalibrationData(const string& filename) {
                                   << "') differs from current calibration sample name ('"
                                   << calibrators[i].getName() << "')";
         }
+        InferenceWorker::PipelineLock lock = inference_.lockPipeline();
         calibrators[i].clear();
         plot_calibrators_[i].reset();
         if (calibrators[i].calibrate(data[i].getData()).getResult() ==
@@ -880,6 +879,7 @@ bool ofApp::loadTrainingDataWithPrompt() {
 bool ofApp::loadTrainingData(const string& filename) {
     GRT::TimeSeriesClassificationData training_data;
 
+    scorer_.cancel();
     if (training_data_manager_.load(filename)) {
         setStatus("Training data is loaded from " + filename);
         ESP_EVENT("Training data load info, " +
@@ -925,7 +925,9 @@ bool ofApp::saveTestData(const string& filename) {
     // file, which we won't be able to load.
     if (test_data_.getNumRows() == 0) return true;
 
-    if (test_data_.save(filename)) {
+    bool saved = isBinaryDataFilename(filename) ?
+        saveMatrixBinary(filename, test_data_) : test_data_.save(filename);
+    if (saved) {
         setStatus("Test data is saved to " + filename);
         ESP_EVENT(std::string("Test data save info, points: ") +
                   std::to_string(test_data_.getNumRows()));
@@ -948,7 +950,9 @@ bool ofApp::loadTestData(const string& filename) {
     GRT::MatrixDouble test_data;
 
     if (ofFile::doesFileExist(filename)) {
-        if (test_data.load(filename) ){
+        bool loaded = isBinaryDataFilename(filename) ?
+            loadMatrixBinary(filename, test_data) : test_data.load(filename);
+        if (loaded) {
             setStatus("Test data is loaded from " + filename);
             ESP_EVENT(std::string("Test data load info, points: ") +
                       std::to_string(test_data_.getNumRows()));
@@ -1017,14 +1021,22 @@ void ofApp::loadAll() {
     save_path_ = result.getPath();
     const string dir = save_path_ + "/";
 
+    // Prefer the binary data files; older sessions only have GRT text files.
+    const string training_data_file =
+        ofFile::doesFileExist(dir + kTrainingDataBinaryFilename) ?
+        kTrainingDataBinaryFilename : kTrainingDataFilename;
+    const string test_data_file =
+        ofFile::doesFileExist(dir + kTestDataBinaryFilename) ?
+        kTestDataBinaryFilename : kTestDataFilename;
+
     // Need to load tuneable before pipeline because loading the tuneables
     // resets the pipeline. Also, need to load pipeline after training and
     // test data so we can use the loaded pipeline to score training data and
     // evaluate test data.
     if (loadCalibrationData(dir + kCalibrationDataFilename) &&
         loadTuneables(dir + kTuneablesFilename) &&
-        loadTrainingData(dir + kTrainingDataFilename) &&
-        loadTestData(dir + kTestDataFilename) &&
+        loadTrainingData(dir + training_data_file) &&
+        loadTestData(dir + test_data_file) &&
         loadPipeline(dir + kPipelineFilename)) {
 
         setStatus("ESP session is loaded from " + dir);
@@ -1049,8 +1061,8 @@ void ofApp::saveAll(bool saveAs) {
     if (ofDirectory::createDirectory(dir, false, false)
         && saveCalibrationData(dir + kCalibrationDataFilename)
         && savePipeline(dir + kPipelineFilename)
-        && saveTrainingData(dir + kTrainingDataFilename)
-        && saveTestData(dir + kTestDataFilename)
+        && saveTrainingData(dir + kTrainingDataBinaryFilename)
+        && saveTestData(dir + kTestDataBinaryFilename)
         && saveTuneables(dir + kTuneablesFilename)) {
 
         setStatus("ESP session is saved to " + dir);
@@ -1142,6 +1154,8 @@ void ofApp::deleteTrainingSample(int num) {
     int label = num + 1;
 
     if (plot_sample_indices_[num] < 0) { return; }
+    // Scores in flight refer to samples by index, which this invalidates.
+    scorer_.cancel();
     training_data_manager_.deleteSample(label, plot_sample_indices_[num]);
 
     uint32_t num_sample_left = training_data_manager_.getNumSampleForLabel(label);
@@ -1169,6 +1183,7 @@ void ofApp::deleteTrainingSample(int num) {
 void ofApp::deleteAllTrainingSamples(int num) {
     int label = num + 1;
 
+    scorer_.cancel();
     training_data_manager_.deleteAllSamplesWithLabel(label);
 
     uint32_t num_sample_left = training_data_manager_.getNumSampleForLabel(label);
@@ -1191,6 +1206,7 @@ void ofApp::trimTrainingSample(int num) {
 
     int label = num + 1;
 
+    scorer_.cancel();
     training_data_manager_.trimSample(label, plot_sample_indices_[num],
                                       selection.first, selection.second);
     plot_samples_[num].setData(
@@ -1230,6 +1246,7 @@ void ofApp::doRelabelTrainingSample(uint32_t source, uint32_t target) {
     uint32_t num = source - 1;
     uint32_t label = source;
     if (plot_sample_indices_[num] < 0) { return; }
+    scorer_.cancel();
     training_data_manager_.relabelSample(source, plot_sample_indices_[num], target);
 
     // Update the source plot
@@ -1301,53 +1318,49 @@ void ofApp::update() {
         }
     }
     
-    MatrixDouble input;
-
-    {
-        std::lock_guard<std::mutex> guard(input_data_mutex_);
-        for (int i = 0; i < input_data_.getNumRows(); i++)
-            input.push_back(input_data_.getRowVector(i));
-        input_data_.clear();
+    SampleQueue::Stats queue_stats = input_queue_.getStats();
+    if (queue_stats.dropped > input_queue_reported_drops_) {
+        ofLog(OF_LOG_WARNING) << "Input queue full, dropped "
+                              << queue_stats.dropped - input_queue_reported_drops_
+                              << " samples (" << queue_stats.dropped << " total)";
+        input_queue_reported_drops_ = queue_stats.dropped;
     }
-    
-    for (int i = 0; i < input.getNumRows(); i++){
-        vector<double> raw_data = input.getRowVector(i);
-        vector<double> data_point;
-        plot_raw_.update(raw_data);
-        if (calibrator_ == nullptr) {
-            data_point = raw_data;
-        } else if (calibrator_->isCalibrated()) {
-            data_point = calibrator_->calibrate(raw_data);
-        } else {
+
+    // Prediction itself happens on the inference thread; here we only fold
+    // its per-sample results into the plots and the recorded sample.
+    inference_.setCaptureAllStages(state_ == AppState::kPipeline);
+    inference_.takeResults(inference_results_);
+
+    for (const InferenceResult& result : inference_results_) {
+        plot_raw_.update(result.raw);
+
+        if (!result.calibrated) {
             // Not calibrated! For now, force the tab to be CALIBRATION.
             fragment_ = CALIBRATION;
             state_ = AppState::kCalibration;
+            if (is_recording_) sample_data_.push_back(result.raw);
+            continue;
         }
 
+        const vector<double>& data_point = result.data;
+
         // title variable here captures the predicted class name, we use it
         // to highlight the prediction in plotting live data and
         // classlikelihood plot.
         std::string title;
 
-        if (pipeline_->getTrained()) {
-            pipeline_->predict(data_point);
-
-            predicted_label_ = pipeline_->getPredictedClassLabel();
+        if (result.predicted) {
+            predicted_label_ = result.predicted_label;
             predicted_label_buffer_.push_back(predicted_label_);
 
             if (predicted_label_ != 0) {
-                for (OStream *ostream : ostreams_)
-                    ostream->onReceive(predicted_label_);
-                for (OStream *ostream : ostreamvectors_)
-                    ostream->onReceive(predicted_label_);
-
                 title = training_data_manager_.getLabelName(predicted_label_);
             }
 
-            predicted_class_labels_ = pipeline_->getClassLabels();
+            predicted_class_labels_ = result.class_labels;
             predicted_class_labels_buffer_.push_back(predicted_class_labels_);
 
-            predicted_class_likelihoods_ = pipeline_->getClassLikelihoods();
+            predicted_class_likelihoods_ = result.class_likelihoods;
             predicted_class_likelihoods_buffer_.push_back(predicted_class_likelihoods_);
 
             vector<double> likelihoods(kNumMaxLabels_);
@@ -1359,49 +1372,17 @@ void ofApp::update() {
             }
             plot_class_likelihoods_.update(likelihoods, predicted_label_ != 0, title);
 
-            predicted_class_distances_ = pipeline_->getClassDistances();
-            if (pipeline_->getClassifier()->
-                getSupportsClassDistanceToNullRejectionCoefficient()) {
-                for (int k = 0; k < predicted_class_distances_.size() &&
-                                k < predicted_class_labels_.size(); k++) {
-                    predicted_class_distances_[k] =
-                        pipeline_->getClassifier()->classDistanceToNullRejectionCoefficient(
-                            predicted_class_labels_[k],
-                            predicted_class_distances_[k]);
-                }
-            }
+            predicted_class_distances_ = result.class_distances;
             predicted_class_distances_buffer_.push_back(predicted_class_distances_);
 
-            for (int i = 0; i < predicted_class_distances_.size() &&
-                            i < predicted_class_labels_.size(); i++) {
-                if (pipeline_->getClassifier()->
-                    getSupportsClassDistanceToNullRejectionCoefficient()) {
-                    double nullRejectionCoeff =
-                        pipeline_->getClassifier()->getNullRejectionCoeff();
-                    plot_class_distances_[predicted_class_labels_[i] - 1]->update(
-                        vector<double>{
-                            nullRejectionCoeff,
-                            predicted_class_distances_[i]
-                        }, predicted_class_distances_[i] < nullRejectionCoeff,
-                        "");
-                } else {
-                    vector<double> thresholds = pipeline_->getClassifier()->getNullRejectionThresholds();
-                    plot_class_distances_[predicted_class_labels_[i] - 1]->update(
-                        vector<double>{
-                            (thresholds.size() > i ? thresholds[i] : 0.0),
-                            predicted_class_distances_[i]
-                        }, thresholds.size() > i && predicted_class_distances_[i] < thresholds[i],
-                        "");
-                }
+            for (int i = 0; i < result.class_distance_thresholds.size(); i++) {
+                double threshold = result.class_distance_thresholds[i];
+                plot_class_distances_[predicted_class_labels_[i] - 1]->update(
+                    vector<double>{ threshold, predicted_class_distances_[i] },
+                    predicted_class_distances_[i] < threshold, "");
             }
-
-        } else {  // pipeline_->getTrained() is false
+        } else {
             predicted_label_ = 0;
-
-            // Here we manually call `preProcessData` for the live plot.
-            if (!pipeline_->preProcessData(data_point)) {
-                ofLog(OF_LOG_ERROR) << "ERROR: Failed to compute features!";
-            }
         }
 
         // live data
@@ -1412,9 +1393,9 @@ void ofApp::update() {
 
         // live feature data
         if (num_preprocessing_modules_ + num_feature_modules_ > 0) {
-            vector<double> data = getLastStageProcessedData();
+            const vector<double>& data = result.last_stage;
 
-            if (pipeline_->getNumFeatureExtractionModules() == 0) {
+            if (num_feature_modules_ == 0) {
                 // no feature extraction modules, so we're showing the last
                 // stage of pre-processing, which is a single, timeseries plot.
                 plot_live_features_[0]->update(data);
@@ -1435,29 +1416,28 @@ void ofApp::update() {
         }
 
         // At pipeline state implicitly means that the istream has started
-        // and the calibration is done
-        if (state_ == AppState::kPipeline) {
+        // and the calibration is done. Stage data is only captured while
+        // we're in this state, so results queued before switching to it may
+        // not have any.
+        if (state_ == AppState::kPipeline &&
+            result.pre_processed.size() == num_preprocessing_modules_ &&
+            result.features.size() == num_feature_modules_) {
             int j = 0;
-            vector<double> data = data_point;
-            // Till this point, either `pipeline_->predict` or
-            // `pipeline->preProcessData` has been called. It's safe to directly
-            // get the data and update the plots in the PIPELINE tab.
-            
+
             // don't update the last plot, because it's already being updated
             // via plot_live_features_.
 
             // Pre-processed data
             for (j = 0;
-                 j + (pipeline_->getNumFeatureExtractionModules() == 0 ? 1 : 0)
-                   < pipeline_->getNumPreProcessingModules(); j++) {
-                data = pipeline_->getPreProcessedData(j);
-                plot_pre_processed_[j]->update(data);
+                 j + (num_feature_modules_ == 0 ? 1 : 0)
+                   < num_preprocessing_modules_; j++) {
+                plot_pre_processed_[j]->update(result.pre_processed[j]);
             }
 
             // feature data
-            for (j = 0; j + 1 < pipeline_->getNumFeatureExtractionModules(); j++) {
+            for (j = 0; j + 1 < num_feature_modules_; j++) {
                 // Working on j-th stage.
-                data = pipeline_->getFeatureExtractionData(j);
+                const vector<double>& data = result.features[j];
                 if (data.size() < kTooManyFeaturesThreshold) {
                     for (int k = 0; k < data.size(); k++) {
                         vector<double> v = { data[k] };
@@ -1468,31 +1448,33 @@ void ofApp::update() {
                     plot_features_[j][0]->setData(data);
                 }
             }
-
-            // If there's no classifier set, we've got a signal processing
-            // pipeline and we should send the results of the pipeline to
-            // any OStreamVector instances that are listening for it.
-            // TODO(damellis): this logic will need updating when / if we
-            // support regression and clustering pipelines.
-            if (!pipeline_->getIsClassifierSet()) {
-                for (OStreamVector *stream : ostreamvectors_) {
-                    stream->onReceive(data);
-                }
-            }
         }
 
         if (is_recording_) {
             if (fragment_ == CALIBRATION) {
-                sample_data_.push_back(raw_data);
+                sample_data_.push_back(result.raw);
             } else {
                 sample_data_.push_back(data_point);
             }
         }
     }
 
-    if (is_training_scheduled_ == true &&
-        (ofGetElapsedTimeMillis() - schedule_time_ > kDelayBeforeTraining)) {
-        trainModel();
+    updateTraining();
+    updateScores();
+
+    bool is_busy = trainer_.isTraining() || scorer_.isRunning();
+    if (is_busy != train_button_shows_cancel_) {
+        train_model_button_->setLabel(is_busy ? "Cancel" : "Train Model");
+        train_button_shows_cancel_ = is_busy;
+    }
+
+    // GRT errors (e.g. from the training thread) are shown as status text.
+    {
+        std::lock_guard<std::mutex> guard(grt_error_mutex_);
+        if (!grt_error_text_.empty()) {
+            status_text_ = grt_error_text_;
+            grt_error_text_.clear();
+        }
     }
 }
 
@@ -1646,6 +1628,43 @@ void ofApp::draw() {
     train_model_button_->draw();
     toggle_features_button_->draw();
     gui_.draw();    
+
+    if (show_latency_overlay_) drawLatencyOverlay();
+}
+
+void ofApp::drawLatencyOverlay() {
+    const uint32_t kLineHeight = 14;
+    const uint32_t kCharWidth = 8;
+    const uint32_t kPadding = 10;
+
+    vector<string> lines;
+    lines.push_back("Pipeline latency per sample (press `i` to hide)");
+    for (const PipelineProfiler::StageStats& stage : getStageLatencies()) {
+        lines.push_back(stage.name + ": " + stage.latency.toString());
+    }
+    lines.push_back("");
+    lines.push_back("Latency from arrival on the input stream");
+    for (const LatencyTracer::HopStats& hop : getHopLatencies()) {
+        if (hop.latency.count == 0) continue;
+        lines.push_back(hop.name + ": " + hop.latency.toString());
+    }
+
+    size_t width = 0;
+    for (const string& line : lines) width = std::max(width, line.size());
+
+    float left = kPadding;
+    float top = ofGetHeight() / 2;
+    ofPushStyle();
+    ofFill();
+    ofSetColor(0, 0, 0, 200);
+    ofDrawRectangle(left, top, width * kCharWidth + 2 * kPadding,
+                    lines.size() * kLineHeight + 2 * kPadding);
+    ofSetColor(255);
+    for (size_t i = 0; i < lines.size(); i++) {
+        ofDrawBitmapString(lines[i], left + kPadding,
+                           top + kPadding + (i + 1) * kLineHeight - 3);
+    }
+    ofPopStyle();
 }
 
 void ofApp::drawInputs(uint32_t stage_left, uint32_t stage_top,
@@ -1992,10 +2011,15 @@ void ofApp::drawPrediction() {
 void ofApp::exit() {
     ESP_EVENT("Quit the program");
 
-    if (training_thread_.joinable()) {
-        training_thread_.join();
-    }
     istream_->stop();
+    inference_.stop();
+    trainer_.cancel();
+    scorer_.cancel();
+
+    if (!latency_dump_file_.empty() &&
+        !inference_.getTracer().dump(latency_dump_file_)) {
+        ofLog(OF_LOG_ERROR) << "Can't write latencies to " << latency_dump_file_;
+    }
 
     // Save data here!
     if (should_save_calibration_data_ || should_save_training_data_ ||
@@ -2013,10 +2037,15 @@ void ofApp::exit() {
     }
 }
 
-void ofApp::onDataIn(GRT::MatrixDouble input) {
-    std::lock_guard<std::mutex> guard(input_data_mutex_);
-    for (int i = 0; i < input.getNumRows(); i++)
-        input_data_.push_back(input.getRowVector(i));
+void ofApp::onDataIn(const SampleBlock& input) {
+    if (input.getNumDimensions() != input_queue_.getNumDimensions()) {
+        ofLog(OF_LOG_ERROR) << "Input stream sent " << input.getNumDimensions()
+                            << "-dimensional data; expected "
+                            << input_queue_.getNumDimensions();
+        return;
+    }
+    for (uint32_t i = 0; i < input.getNumRows(); i++)
+        input_queue_.push(input.getRow(i), input.getTimestamp(i));
 }
 
 void ofApp::pauseResume() {
@@ -2027,8 +2056,7 @@ void ofApp::pauseResume() {
         class_distance_values_.resize(0);
     }
     
-    std::lock_guard<std::mutex> guard(input_data_mutex_);
-    input_data_.clear();
+    inference_.clearPendingSamples();
 
     ESP_EVENT("Toggle streaming");
 }
@@ -2054,10 +2082,13 @@ void ofApp::toggleFeatureView() {
 }
 
 void ofApp::beginTrainModel() {
-    // Update UI to reflect training starts.
-    status_text_ = "Training the model . . .";
-    is_training_scheduled_ = true;
-    schedule_time_ = ofGetElapsedTimeMillis();
+    // The train button (and `t`) doubles as a cancel button while training
+    // or scoring is in progress.
+    if (trainer_.isTraining() || scorer_.isRunning()) {
+        cancelTrainModel();
+    } else {
+        trainModel();
+    }
 }
 
 void ofApp::trainModel() {
@@ -2065,47 +2096,67 @@ void ofApp::trainModel() {
               std::to_string(training_data_manager_.getTotalNumSamples()) +
               " samples");
 
-    is_training_scheduled_ = false;
+    // Train a copy of the pipeline on a snapshot of the training data; the
+    // live pipeline keeps running until updateTraining() swaps the result in.
+    InferenceWorker::PipelineLock lock = inference_.lockPipeline();
+    scorer_.cancel();
+    // Enable logging. GRT error logs will call ofApp::notify().
+    GRT::ErrorLog::enableLogging(true);
+    trainer_.start(*pipeline_, training_data_manager_.getSnapshot());
+    training_pipeline_generation_ = pipeline_generation_;
+    status_text_ = "Training the model . . .";
+}
 
-   // If prior training has not finished, we wait.
-   if (training_thread_.joinable()) {
-       training_thread_.join();
-   }
+void ofApp::cancelTrainModel() {
+    bool was_training = trainer_.isTraining();
+    trainer_.cancel();
+    scorer_.cancel();
+    GRT::ErrorLog::enableLogging(false);
 
-   auto training_func = [this]() -> bool {
-       ofLog() << "Training started";
-       bool training_status = false;
+    status_text_ = was_training ? "Training cancelled" : "Scoring cancelled";
+    ESP_EVENT(status_text_);
+}
 
-       // Enable logging. GRT error logs will call ofApp::notify().
-       GRT::ErrorLog::enableLogging(true);
+void ofApp::updateTraining() {
+    if (!trainer_.isTraining()) return;
 
-       if (pipeline_->train(training_data_manager_.getAllData())) {
-           for (Plotter& plot : plot_samples_) {
-               assert(true == plot.clearContentModifiedFlag());
-           }
+    if (!trainer_.isDone()) {
+        status_text_ = "Training the model . . . " +
+            std::to_string(trainer_.getElapsedMillis() / 1000) + "s";
+        return;
+    }
 
-           should_save_pipeline_ = true;
-           training_status = true;
+    // Stop logging.
+    GRT::ErrorLog::enableLogging(false);
 
-           ESP_EVENT("Training is successful");
-       } else {
-           ofLog(OF_LOG_ERROR) << "Failed to train the model";
-           ESP_EVENT("Training failed");
-       }
+    // Tuneables or a pipeline load replaced the modules while we were
+    // training; the trained copy no longer matches what the user configured.
+    if (training_pipeline_generation_ != pipeline_generation_) {
+        trainer_.cancel();
+        status_text_ = "Pipeline changed during training, please train again";
+        ESP_EVENT("Training discarded, pipeline changed");
+        return;
+    }
 
-       // Stop logging.
-       GRT::ErrorLog::enableLogging(false);
-       return training_status;
-   };
+    InferenceWorker::PipelineLock lock = inference_.lockPipeline();
+    if (trainer_.takeResult(*pipeline_)) {
+        for (Plotter& plot : plot_samples_) {
+            assert(true == plot.clearContentModifiedFlag());
+        }
 
-   // TODO(benzh) Fix data race issue later.
-   if (training_func()) {
-       afterTrainModel();
-       status_text_ = "Training was successful";
-   }
+        should_save_pipeline_ = true;
+        ESP_EVENT("Training is successful");
+        afterTrainModel();
+        status_text_ = "Training was successful";
+    } else {
+        ofLog(OF_LOG_ERROR) << "Failed to train the model";
+        ESP_EVENT("Training failed");
+        status_text_ = "Failed to train the model";
+    }
 }
 
 void ofApp::afterTrainModel() {
+    InferenceWorker::PipelineLock lock = inference_.lockPipeline();
     ESP_EVENT("Post training, jump to TRAINING tab");
     scoreTrainingData(use_leave_one_out_scoring_);
 
@@ -2120,68 +2171,54 @@ void ofApp::afterTrainModel() {
 }
 
 void ofApp::scoreTrainingData(bool leaveOneOut) {
-    for (int label = 1; label <= training_data_manager_.getNumLabels(); label++) {
-        // No point in doing leave-one-out scoring for labels w/ one sample.
-        if (leaveOneOut && training_data_manager_.getNumSampleForLabel(label) == 1)
-            continue;
-
-        for (int i = 0; i < training_data_manager_.getNumSampleForLabel(label); i++) {
-            GRT::MatrixDouble sample =
-                training_data_manager_.getSample(label, (leaveOneOut ? 0 : i));
-
-            if (leaveOneOut) {
-                training_data_manager_.deleteSample(label, 0);
-                pipeline_->train(training_data_manager_.getAllData());
-            }
-
-            //ofLog(OF_LOG_NOTICE) << "sample " << i << " (class " << label << "):";
-            vector<double> likelihoods(training_data_manager_.getNumLabels() + 1, 0.0);
-            for (int j = 0; j < sample.getNumRows(); j++) {
-                pipeline_->predict(sample.getRowVector(j));
-                auto l = pipeline_->getClassLikelihoods();
-                for (int k = 0; k < l.size(); k++) {
-                    likelihoods[pipeline_->getClassLabels()[k]] += l[k];
-                }
-            }
-            double sum = 0.0;
-            for (int j = 0; j < likelihoods.size(); j++) {
-                //ofLog(OF_LOG_NOTICE) << "\t" << (j + 1) << ": " << likelihoods[j] << "%";
-                sum += likelihoods[j];
-            }
-            for (int j = 0; j < likelihoods.size(); j++) {
-                likelihoods[j] /= (sum == 0.0 ? 1e-9 : sum);
-                //ofLog(OF_LOG_NOTICE) << "\t" << (j + 1) << ": " << likelihoods[j] << "%";
-            }
-
-            if (leaveOneOut) training_data_manager_.addSample(label, sample);
+    // The scorer works on its own copies of the pipeline and the training
+    // data; the results are picked up in update().
+    InferenceWorker::PipelineLock lock = inference_.lockPipeline();
+    if (scorer_.start(*pipeline_, training_data_manager_.getSnapshot(),
+                      training_data_manager_.getNumLabels(), leaveOneOut)) {
+        ESP_EVENT("Scoring " + std::to_string(scorer_.getNumTotal()) +
+                  " training samples" + (leaveOneOut ? " (leave-one-out)" : ""));
+    }
+}
 
-            training_data_manager_.setSampleClassLikelihoods(label,
-                (leaveOneOut ? training_data_manager_.getNumSampleForLabel(label) - 1 : i),
-                likelihoods);
+void ofApp::updateScores() {
+    if (!scorer_.isRunning()) return;
 
-            pipeline_->reset();
-        }
+    if (!scorer_.isDone()) {
+        status_text_ = "Scoring training samples: " +
+            std::to_string(scorer_.getNumCompleted()) + " / " +
+            std::to_string(scorer_.getNumTotal());
+        return;
     }
 
-    if (leaveOneOut) pipeline_->train(training_data_manager_.getAllData());
+    vector<TrainingScorer::Result> scores;
+    scorer_.takeResults(scores);
+    for (TrainingScorer::Result& score : scores) {
+        training_data_manager_.setSampleClassLikelihoods(
+            score.label, score.index, score.likelihoods);
+    }
+    status_text_ = "Scored " + std::to_string(scores.size()) + " training samples";
+    ESP_EVENT(status_text_);
 }
 
 void ofApp::scoreImpactOfTrainingSample(int label, const MatrixDouble &sample) {
+    InferenceWorker::PipelineLock lock = inference_.lockPipeline();
     if (!pipeline_->getTrained()) return; // can't calculate a score
 
     GestureRecognitionPipeline p(*pipeline_);
+    lock.unlock();
 
     p.reset();
     //std::cout << "Scoring sample impact: " << std::endl;
     double score = 0.0;
     int num_non_zero = 0;
     for (int j = 0; j < sample.getNumRows(); j++) {
-        pipeline_->predict(sample.getRowVector(j));
-        auto l = pipeline_->getClassLikelihoods();
+        p.predict(sample.getRowVector(j));
+        auto l = p.getClassLikelihoods();
         bool non_zero = false;
         for (int k = 0; k < l.size(); k++) {
             if (l[k] > 1e-9) non_zero = true;
-            if (pipeline_->getClassLabels()[k] == label) {
+            if (p.getClassLabels()[k] == label) {
                 //std::cout << l[k] << " ";
                 score += l[k];
             }
@@ -2195,8 +2232,10 @@ void ofApp::scoreImpactOfTrainingSample(int label, const MatrixDouble &sample) {
 }
 
 void ofApp::reloadPipelineModules() {
+    InferenceWorker::PipelineLock lock = inference_.lockPipeline();
     pipeline_->clearAll();
     ::setup();
+    pipeline_generation_++;
 }
 
 //--------------------------------------------------------------
@@ -2289,6 +2328,11 @@ void ofApp::keyPressed(int key) {
             else if (fragment_ == ANALYSIS) loadTestDataWithPrompt();
             break;
         case 'p': pauseResume(); break;
+        case 'i':
+            show_latency_overlay_ = !show_latency_overlay_;
+            inference_.setProfiling(use_stage_profiling_ || show_latency_overlay_);
+            inference_.setTracing(use_latency_tracing_ || show_latency_overlay_);
+            break;
         case 'a': saveAll(true); break;
         case 's': saveAll(); break;
         case 'S':
@@ -2430,6 +2474,7 @@ void ofApp::keyReleased(int key) {
                 return;
             }
 
+            InferenceWorker::PipelineLock lock = inference_.lockPipeline();
             vector<CalibrateProcess>& calibrators =
                 calibrator_->getCalibrateProcesses();
             if (label_ - 1 < calibrators.size()) {
@@ -2665,51 +2710,132 @@ string decodeName(const string &from) {
 }
 
 void useInputStream(InputStream &stream) {
+    if (HeadlessApp* app = HeadlessApp::get()) {
+        app->useIStream(stream);
+        return;
+    }
     ((ofApp *) ofGetAppPtr())->useIStream(stream);
 }
 
 void useOutputStream(OStream &stream) {
+    if (HeadlessApp* app = HeadlessApp::get()) {
+        app->useOStream(stream);
+        return;
+    }
     ((ofApp *) ofGetAppPtr())->useOStream(stream);
 }
 
 void useOutputStream(OStreamVector &stream) {
+    if (HeadlessApp* app = HeadlessApp::get()) {
+        app->useOStream(stream);
+        return;
+    }
     ((ofApp *) ofGetAppPtr())->useOStream(stream);
 }
 
 void usePipeline(GRT::GestureRecognitionPipeline &pipeline) {
+    if (HeadlessApp* app = HeadlessApp::get()) {
+        app->usePipeline(pipeline);
+        return;
+    }
     ((ofApp *) ofGetAppPtr())->usePipeline(pipeline);
 }
 
 void useCalibrator(Calibrator &calibrator) {
+    if (HeadlessApp* app = HeadlessApp::get()) {
+        app->useCalibrator(calibrator);
+        return;
+    }
     ((ofApp *) ofGetAppPtr())->useCalibrator(calibrator);
 }
 
 void setGUIBufferSize(uint32_t buffer_size) {
+    if (HeadlessApp::get() != nullptr) return;  // GUI only
     ((ofApp *) ofGetAppPtr())->setBufferSize(buffer_size);
 }
 
 void useStream(IOStream &stream) {
+    if (HeadlessApp* app = HeadlessApp::get()) {
+        app->useIStream(stream);
+        app->useOStream(stream);
+        return;
+    }
     ((ofApp *) ofGetAppPtr())->useIStream(stream);
     ((ofApp *) ofGetAppPtr())->useOStream(stream);
 }
 
 void useStream(IOStreamVector &stream) {
+    if (HeadlessApp* app = HeadlessApp::get()) {
+        app->useIStream(stream);
+        app->useOStream(stream);
+        return;
+    }
     ((ofApp *) ofGetAppPtr())->useIStream(stream);
     ((ofApp *) ofGetAppPtr())->useOStream(stream);
 }
 
 void useTrainingSampleChecker(TrainingSampleChecker checker) {
+    if (HeadlessApp::get() != nullptr) return;  // GUI only
     ((ofApp *) ofGetAppPtr())->useTrainingSampleChecker(checker);
 }
 
 void useLeaveOneOutScoring(bool enable) {
+    if (HeadlessApp::get() != nullptr) return;  // GUI only
     ((ofApp *) ofGetAppPtr())->useLeaveOneOutScoring(enable);
 }
 
 void setTruePositiveWarningThreshold(double threshold) {
+    if (HeadlessApp::get() != nullptr) return;  // GUI only
     ((ofApp *) ofGetAppPtr())->true_positive_threshold_ = threshold;
 }
 
 void setFalseNegativeWarningThreshold(double threshold) {
+    if (HeadlessApp::get() != nullptr) return;  // GUI only
     ((ofApp *) ofGetAppPtr())->false_negative_threshold_ = threshold;
 }
+
+void setInputQueueSize(uint32_t capacity) {
+    if (HeadlessApp* app = HeadlessApp::get()) {
+        app->setInputQueueSize(capacity);
+        return;
+    }
+    ((ofApp *) ofGetAppPtr())->setInputQueueSize(capacity);
+}
+
+void setInputQueueOverflowPolicy(SampleQueue::OverflowPolicy policy) {
+    if (HeadlessApp* app = HeadlessApp::get()) {
+        app->setInputQueueOverflowPolicy(policy);
+        return;
+    }
+    ((ofApp *) ofGetAppPtr())->setInputQueueOverflowPolicy(policy);
+}
+
+void useStageProfiling(bool enable) {
+    if (HeadlessApp* app = HeadlessApp::get()) {
+        app->useStageProfiling(enable);
+        return;
+    }
+    ((ofApp *) ofGetAppPtr())->useStageProfiling(enable);
+}
+
+vector<PipelineProfiler::StageStats> getStageLatencies() {
+    if (HeadlessApp* app = HeadlessApp::get()) {
+        return app->getStageLatencies();
+    }
+    return ((ofApp *) ofGetAppPtr())->getStageLatencies();
+}
+
+void useLatencyTracing(bool enable, const string& dump_file) {
+    if (HeadlessApp* app = HeadlessApp::get()) {
+        app->useLatencyTracing(enable, dump_file);
+        return;
+    }
+    ((ofApp *) ofGetAppPtr())->useLatencyTracing(enable, dump_file);
+}
+
+vector<LatencyTracer::HopStats> getHopLatencies() {
+    if (HeadlessApp* app = HeadlessApp::get()) {
+        return app->getHopLatencies();
+    }
+    return ((ofApp *) ofGetAppPtr())->getHopLatencies();
+}
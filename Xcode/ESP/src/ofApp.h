@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <mutex>
 #include <thread>
 
 // of System
@@ -11,10 +12,15 @@
 
 // custom
 #include "calibrator.h"
+#include "inference-worker.h"
 #include "iostream.h"
+#include "model-trainer.h"
 #include "plotter.h"
+#include "sample-queue.h"
+#include "session.h"
 #include "training.h"
 #include "training-data-manager.h"
+#include "training-scorer.h"
 #include "tuneable.h"
 
 #define ESP_EVENT(s)                                                \
@@ -92,9 +98,17 @@ class ofApp : public ofBaseApp, public GRT::Observer<GRT::ErrorLogMessage> {
 
     void reloadPipelineModules();
 
+    // Hold this while changing the pipeline or calibrator from outside the
+    // inference thread (e.g. in a tuneable callback).
+    InferenceWorker::PipelineLock lockPipeline() {
+        return inference_.lockPipeline();
+    }
+
     // GRT error log observer callback: we simply display it as status text.
+    // May be called from the training thread, so update() does the display.
     virtual void notify(const ErrorLogMessage& data) final {
-        status_text_ = data.getMessage();
+        std::lock_guard<std::mutex> guard(grt_error_mutex_);
+        grt_error_text_ = data.getMessage();
     }
 
     void setBufferSize(uint32_t buffer_size) {
@@ -160,6 +174,7 @@ class ofApp : public ofBaseApp, public GRT::Observer<GRT::ErrorLogMessage> {
     void enableTrainingSampleGUI(bool);
     void drawAnalysis();
     void drawPrediction();
+    void drawLatencyOverlay();
 
     void useCalibrator(Calibrator& calibrator);
     void usePipeline(GRT::GestureRecognitionPipeline& pipeline);
@@ -169,6 +184,21 @@ class ofApp : public ofBaseApp, public GRT::Observer<GRT::ErrorLogMessage> {
     void useTrainingSampleChecker(TrainingSampleChecker checker);
     void useLeaveOneOutScoring(bool enable) {
         use_leave_one_out_scoring_ = enable;}
+    void setInputQueueSize(uint32_t capacity) {
+        if (!setup_finished_) input_queue_capacity_ = capacity;}
+    void setInputQueueOverflowPolicy(SampleQueue::OverflowPolicy policy) {
+        if (!setup_finished_) input_queue_policy_ = policy;}
+    void useStageProfiling(bool enable) {
+        use_stage_profiling_ = enable;
+        inference_.setProfiling(enable || show_latency_overlay_);}
+    vector<PipelineProfiler::StageStats> getStageLatencies() const {
+        return inference_.getProfiler().getStageStats();}
+    void useLatencyTracing(bool enable, const string& dump_file) {
+        use_latency_tracing_ = enable;
+        latency_dump_file_ = dump_file;
+        inference_.setTracing(enable || show_latency_overlay_);}
+    vector<LatencyTracer::HopStats> getHopLatencies() const {
+        return inference_.getTracer().getHopStats();}
 
     friend void useCalibrator(Calibrator &calibrator);
     friend void usePipeline(GRT::GestureRecognitionPipeline &pipeline);
@@ -181,6 +211,12 @@ class ofApp : public ofBaseApp, public GRT::Observer<GRT::ErrorLogMessage> {
     friend void useLeaveOneOutScoring(bool enable);
     friend void setTruePositiveWarningThreshold(double threshold);
     friend void setFalseNegativeWarningThreshold(double threshold);
+    friend void setInputQueueSize(uint32_t capacity);
+    friend void setInputQueueOverflowPolicy(SampleQueue::OverflowPolicy policy);
+    friend void useStageProfiling(bool enable);
+    friend vector<PipelineProfiler::StageStats> getStageLatencies();
+    friend void useLatencyTracing(bool enable, const string& dump_file);
+    friend vector<LatencyTracer::HopStats> getHopLatencies();
 
     // This variable is a guard so that code can check its status and made to be
     // executed only once. Because we are loading the user code ::setup()
@@ -207,11 +243,10 @@ class ofApp : public ofBaseApp, public GRT::Observer<GRT::ErrorLogMessage> {
     uint32_t num_pipeline_stages_;
 
     // These two variables just track the number of pre-processing modules and
-    // feature extraction modules so that we can control what data to read for
-    // getLastStageProcessedData.
+    // feature extraction modules so that we know whether there are any
+    // features to plot.
     uint32_t num_preprocessing_modules_;
     uint32_t num_feature_modules_;
-    vector<double> getLastStageProcessedData() const;
 
     vector<Tuneable*> tuneable_parameters_;
     Calibrator* calibrator_;
@@ -219,9 +254,19 @@ class ofApp : public ofBaseApp, public GRT::Observer<GRT::ErrorLogMessage> {
     TrainingSampleChecker training_sample_checker_ = 0;
 
     GRT::MatrixDouble sample_data_;
-    GRT::MatrixDouble input_data_;
-    std::mutex input_data_mutex_;  // input_data_ is written by istream_ thread
-                                   // and read by GUI thread.
+    // Samples are pushed by the istream_ thread (onDataIn) and drained by the
+    // GUI thread (update). The queue is sized in setup(), once the number of
+    // input dimensions is known.
+    SampleQueue input_queue_;
+    uint32_t input_queue_capacity_ = 4096;
+    SampleQueue::OverflowPolicy input_queue_policy_ = SampleQueue::kDropOldest;
+    uint64_t input_queue_reported_drops_ = 0;
+
+    // Runs calibration, prediction and output streams on its own thread.
+    // Anything else that touches pipeline_ or calibrator_ must hold
+    // inference_.lockPipeline().
+    InferenceWorker inference_;
+    std::deque<InferenceResult> inference_results_;
     GRT::MatrixDouble test_data_;
 
     //========================================================================
@@ -247,7 +292,7 @@ class ofApp : public ofBaseApp, public GRT::Observer<GRT::ErrorLogMessage> {
     // Input/Output streams
     //========================================================================
     InputStream *istream_;
-    void onDataIn(GRT::MatrixDouble in);
+    void onDataIn(const SampleBlock& in);
     vector<OStream *> ostreams_;
     vector<OStreamVector *> ostreamvectors_;
 
@@ -280,6 +325,9 @@ class ofApp : public ofBaseApp, public GRT::Observer<GRT::ErrorLogMessage> {
     // visual: status message
     //========================================================================
     string status_text_;
+    // Latest GRT error message, handed from notify() to update().
+    std::mutex grt_error_mutex_;
+    string grt_error_text_;
     void setStatus(const string& msg) {
         ESP_EVENT(msg);
         status_text_ = msg;
@@ -584,13 +632,8 @@ class ofApp : public ofBaseApp, public GRT::Observer<GRT::ErrorLogMessage> {
 
     // Convenient functions that save and load everything from a directory. This
     // assumes the structure of the directory follows our naming convention (see
-    // the following few const string definitions). If the naming convention is
-    // not satisfied, the load will fail.
-    const string kPipelineFilename        = "Pipeline.grt";
-    const string kCalibrationDataFilename = "CalibrationData.grt";
-    const string kTrainingDataFilename    = "TrainingData.grt";
-    const string kTestDataFilename        = "TestData.grt";
-    const string kTuneablesFilename       = "TuneableParameters.grt";
+    // the file names in session.h). If the naming convention is not
+    // satisfied, the load will fail.
     string save_path_ = "";
 
     // Load all and save all
@@ -603,23 +646,47 @@ class ofApp : public ofBaseApp, public GRT::Observer<GRT::ErrorLogMessage> {
     //========================================================================
     // Training
     //========================================================================
-    std::thread training_thread_;
-    bool is_training_scheduled_;
-    std::uint64_t schedule_time_;
+    ModelTrainer trainer_;
+    // Incremented whenever the pipeline's modules are replaced, so that a
+    // model trained on an outdated copy is not swapped in.
+    uint64_t pipeline_generation_ = 0;
+    uint64_t training_pipeline_generation_ = 0;
+    bool train_button_shows_cancel_ = false;
 
     void trainModel(ofxDatGuiButtonEvent e) { beginTrainModel(); }
 
+    // Start training, or cancel training/scoring if either is in progress.
     void beginTrainModel();
     void trainModel();
+    void cancelTrainModel();
+    // Called from update(): swaps in the trained pipeline once it's ready.
+    void updateTraining();
     void afterTrainModel();
 
     //========================================================================
     // Scoring
     //========================================================================
+    // Starts scoring in the background; see updateScores().
     void scoreTrainingData(bool leaveOneOut);
+    // Called from update(): shows scoring progress and stores the scores in
+    // training_data_manager_ once they are ready.
+    void updateScores();
+    TrainingScorer scorer_;
     void scoreImpactOfTrainingSample(int label, const MatrixDouble &sample);
     bool use_leave_one_out_scoring_ = true;
 
+    //========================================================================
+    // Latency
+    //========================================================================
+    // Stage profiling is on while either the user's setup() asked for it or
+    // the overlay (toggled with 'i') is shown.
+    bool use_stage_profiling_ = false;
+    bool show_latency_overlay_ = false;
+    // Likewise for latency tracing, whose results are written to
+    // latency_dump_file_ (if set) on exit.
+    bool use_latency_tracing_ = false;
+    string latency_dump_file_;
+
     double true_positive_threshold_;
     double false_negative_threshold_;
 
@@ -0,0 +1,190 @@
+#include "pipeline-profiler.h"
+
+#include <limits>
+
+using namespace GRT;
+
+// Marks a stage that didn't run this time (e.g. because an earlier feature
+// extraction module didn't have data ready yet).
+static const uint64_t kNotRun = std::numeric_limits<uint64_t>::max();
+
+void PipelineProfiler::beginRun(GestureRecognitionPipeline& pipeline) {
+    modules_.clear();
+    for (UINT j = 0; j < pipeline.getNumPreProcessingModules(); j++)
+        modules_.push_back(pipeline.getPreProcessingModule(j));
+    for (UINT j = 0; j < pipeline.getNumFeatureExtractionModules(); j++)
+        modules_.push_back(pipeline.getFeatureExtractionModule(j));
+    if (pipeline.getIsClassifierSet())
+        modules_.push_back(pipeline.getClassifier());
+    for (UINT j = 0; j < pipeline.getNumPostProcessingModules(); j++)
+        modules_.push_back(pipeline.getPostProcessingModule(j));
+
+    elapsed_.assign(modules_.size(), kNotRun);
+
+    bool changed = modules_.size() != stages_.size();
+    for (size_t i = 0; !changed && i < modules_.size(); i++) {
+        changed = modules_[i] != stages_[i].module;
+    }
+
+    if (changed) {
+        // Tuneables and pipeline loads replace the modules; start over.
+        vector<Stage> stages(modules_.size());
+        size_t i = 0;
+        for (UINT j = 0; j < pipeline.getNumPreProcessingModules(); j++, i++) {
+            stages[i].name = "PreProcessing " + std::to_string(j) + " (" +
+                pipeline.getPreProcessingModule(j)->getClassType() + ")";
+        }
+        for (UINT j = 0; j < pipeline.getNumFeatureExtractionModules(); j++, i++) {
+            stages[i].name = "Feature " + std::to_string(j) + " (" +
+                pipeline.getFeatureExtractionModule(j)->getClassType() + ")";
+        }
+        if (pipeline.getIsClassifierSet()) {
+            stages[i++].name = "Classifier (" +
+                pipeline.getClassifier()->getClassifierType() + ")";
+        }
+        for (UINT j = 0; j < pipeline.getNumPostProcessingModules(); j++, i++) {
+            stages[i].name = "PostProcessing " + std::to_string(j) + " (" +
+                pipeline.getPostProcessingModule(j)->getClassType() + ")";
+        }
+        for (i = 0; i < stages.size(); i++) stages[i].module = modules_[i];
+
+        std::lock_guard<std::mutex> guard(mutex_);
+        stages_.swap(stages);
+        total_.reset();
+    }
+
+    lap_start_ = Clock::now();
+}
+
+void PipelineProfiler::lap(uint32_t stage) {
+    Clock::time_point now = Clock::now();
+    elapsed_[stage] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        now - lap_start_).count();
+    lap_start_ = now;
+}
+
+void PipelineProfiler::endRun(Clock::time_point start) {
+    uint64_t total = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - start).count();
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (size_t i = 0; i < stages_.size(); i++) {
+        if (elapsed_[i] != kNotRun) stages_[i].histogram.record(elapsed_[i]);
+    }
+    total_.record(total);
+}
+
+bool PipelineProfiler::runPreProcessing(GestureRecognitionPipeline& pipeline,
+                                        VectorDouble& data) {
+    for (UINT j = 0; j < pipeline.getNumPreProcessingModules(); j++) {
+        PreProcessing* module = pipeline.getPreProcessingModule(j);
+        if (!module->process(data)) return false;
+        data = module->getProcessedData();
+        lap(j);
+    }
+    return true;
+}
+
+bool PipelineProfiler::runFeatureExtraction(GestureRecognitionPipeline& pipeline,
+                                            VectorDouble& data, bool& ready,
+                                            bool stop_if_not_ready) {
+    UINT offset = pipeline.getNumPreProcessingModules();
+    ready = true;
+    for (UINT j = 0; j < pipeline.getNumFeatureExtractionModules(); j++) {
+        FeatureExtraction* module = pipeline.getFeatureExtractionModule(j);
+        if (!module->computeFeatures(data)) return false;
+        lap(offset + j);
+        if (!module->getFeatureDataReady()) {
+            ready = false;
+            // Prediction stops here, but preProcessData() carries on.
+            if (stop_if_not_ready) return true;
+        }
+        data = module->getFeatureVector();
+    }
+    return true;
+}
+
+bool PipelineProfiler::predict(GestureRecognitionPipeline& pipeline,
+                               const VectorDouble& input, UINT& label) {
+    Clock::time_point start = Clock::now();
+    beginRun(pipeline);
+    label = 0;
+
+    if (pipeline.getIsContextSet() || !pipeline.getIsClassifierSet()) {
+        bool ok = pipeline.predict(input);
+        label = pipeline.getPredictedClassLabel();
+        endRun(start);
+        return ok;
+    }
+
+    VectorDouble data = input;
+    bool ready = true;
+    bool ok = runPreProcessing(pipeline, data) &&
+              runFeatureExtraction(pipeline, data, ready, true);
+    if (!ok || !ready) {
+        endRun(start);
+        return ok;
+    }
+
+    UINT stage = pipeline.getNumPreProcessingModules() +
+                 pipeline.getNumFeatureExtractionModules();
+    Classifier* classifier = pipeline.getClassifier();
+    if (!classifier->predict(data)) {
+        endRun(start);
+        return false;
+    }
+    label = classifier->getPredictedClassLabel();
+    lap(stage++);
+
+    for (UINT j = 0; j < pipeline.getNumPostProcessingModules(); j++, stage++) {
+        PostProcessing* module = pipeline.getPostProcessingModule(j);
+        if (module->getIsPostProcessingInputModePredictedClassLabel()) {
+            data.assign(1, label);
+        } else {
+            data = classifier->getClassLikelihoods();
+        }
+        if (!module->process(data)) {
+            endRun(start);
+            return false;
+        }
+        if (module->getIsPostProcessingOutputModeClassLabel()) {
+            VectorDouble out = module->getProcessedData();
+            if (!out.empty()) label = static_cast<UINT>(out[0]);
+        }
+        lap(stage);
+    }
+
+    endRun(start);
+    return true;
+}
+
+bool PipelineProfiler::preProcessData(GestureRecognitionPipeline& pipeline,
+                                      const VectorDouble& input) {
+    Clock::time_point start = Clock::now();
+    beginRun(pipeline);
+
+    VectorDouble data = input;
+    bool ready = true;
+    bool ok = runPreProcessing(pipeline, data) &&
+              runFeatureExtraction(pipeline, data, ready, false);
+    endRun(start);
+    return ok;
+}
+
+vector<PipelineProfiler::StageStats> PipelineProfiler::getStageStats() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    vector<StageStats> stats(stages_.size() + 1);
+    for (size_t i = 0; i < stages_.size(); i++) {
+        stats[i].name = stages_[i].name;
+        stats[i].latency = stages_[i].histogram.getSummary();
+    }
+    stats.back().name = "Total";
+    stats.back().latency = total_.getSummary();
+    return stats;
+}
+
+void PipelineProfiler::reset() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (Stage& stage : stages_) stage.histogram.reset();
+    total_.reset();
+}
@@ -0,0 +1,91 @@
+/** @file pipeline-profiler.h
+ *  @brief PipelineProfiler runs a GestureRecognitionPipeline one stage at a
+ *  time and keeps a latency histogram for each stage.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <GRT/GRT.h>
+
+#include "latency-histogram.h"
+
+/**
+ @brief Drop-in replacement for GestureRecognitionPipeline::predict() and
+ preProcessData() that times every pre-processing, feature extraction,
+ classifier and post-processing stage.
+
+ The stages are run the same way the pipeline runs them, so afterwards
+ getPreProcessedData(j), getFeatureExtractionData(j) and the classifier's
+ likelihoods and distances read back as usual. The only exception is the
+ pipeline's own predicted class label, which is returned by predict()
+ instead. Pipelines with context modules are run through the pipeline as a
+ whole; only the total is timed for those.
+
+ predict() and preProcessData() must be called from one thread (with the
+ pipeline locked); getStageStats() and reset() may be called from any.
+ */
+class PipelineProfiler {
+  public:
+    struct StageStats {
+        string name;
+        LatencyHistogram::Summary latency;
+    };
+
+    /**
+     Run input through the pipeline, which must be trained.
+     @param label: set to the predicted class label, after post-processing.
+     */
+    bool predict(GRT::GestureRecognitionPipeline& pipeline,
+                 const GRT::VectorDouble& input, GRT::UINT& label);
+
+    /**
+     Run input through pre-processing and feature extraction only, like
+     GestureRecognitionPipeline::preProcessData().
+     */
+    bool preProcessData(GRT::GestureRecognitionPipeline& pipeline,
+                        const GRT::VectorDouble& input);
+
+    /**
+     Latency of each stage of the pipeline last run, in pipeline order,
+     followed by the total.
+     */
+    vector<StageStats> getStageStats() const;
+
+    void reset();
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stage {
+        string name;
+        const void* module;
+        LatencyHistogram histogram;
+    };
+
+    // Start a run: rebuild the stage list if the pipeline's modules changed.
+    void beginRun(GRT::GestureRecognitionPipeline& pipeline);
+    void lap(uint32_t stage);
+    void endRun(Clock::time_point start);
+
+    bool runPreProcessing(GRT::GestureRecognitionPipeline& pipeline,
+                          GRT::VectorDouble& data);
+    bool runFeatureExtraction(GRT::GestureRecognitionPipeline& pipeline,
+                              GRT::VectorDouble& data, bool& ready,
+                              bool stop_if_not_ready);
+
+    // Guards stages_ (not the pipeline, which the caller locks).
+    mutable std::mutex mutex_;
+    vector<Stage> stages_;
+    LatencyHistogram total_;
+
+    // Per-run scratch, only touched by the thread that runs the pipeline.
+    vector<const void*> modules_;
+    vector<uint64_t> elapsed_;
+    Clock::time_point lap_start_;
+};
@@ -0,0 +1,116 @@
+#include "recording-file.h"
+#include "gtest/gtest.h"
+
+#include "binary-data-file.h"
+
+#include <fstream>
+
+static void put16(std::string* bytes, uint16_t value) {
+    bytes->push_back(value & 0xFF);
+    bytes->push_back(value >> 8);
+}
+
+static void put32(std::string* bytes, uint32_t value) {
+    put16(bytes, value & 0xFFFF);
+    put16(bytes, value >> 16);
+}
+
+// A WAV file with the given format and data chunk, plus an odd-sized chunk
+// before the data that has to be skipped.
+static void writeWav(const std::string& filename, uint16_t format,
+                     uint16_t channels, uint16_t bits, const std::string& data) {
+    std::string fmt;
+    put16(&fmt, format);
+    put16(&fmt, channels);
+    put32(&fmt, 8000);
+    put32(&fmt, 8000 * channels * bits / 8);
+    put16(&fmt, channels * bits / 8);
+    put16(&fmt, bits);
+
+    std::string body = "WAVE";
+    body += "fmt ";
+    put32(&body, fmt.size());
+    body += fmt;
+    body += "LIST";
+    put32(&body, 3);
+    body += std::string("abc\0", 4);
+    body += "data";
+    put32(&body, data.size());
+    body += data;
+
+    std::string file = "RIFF";
+    put32(&file, body.size());
+    file += body;
+    std::ofstream(filename, std::ios::binary) << file;
+}
+
+TEST(RecordingFileTest, DecodesPcmWav) {
+    std::string data;
+    put16(&data, 0x8000);  // -1, left
+    put16(&data, 0x4000);  // 0.5, right
+    put16(&data, 0);
+    put16(&data, 0x7FFF);
+    put16(&data, 1);       // a partial sample, ignored
+    writeWav("recording.wav", 1, 2, 16, data);
+
+    RecordingFile recording;
+    ASSERT_TRUE(recording.open("recording.wav")) << recording.getLastError();
+    ASSERT_EQ(2, recording.getNumDimensions());
+    ASSERT_EQ(2, recording.getNumSamples());
+    EXPECT_EQ(8000, recording.getSampleRate());
+    EXPECT_EQ(-1.0, recording.getSample(0)[0]);
+    EXPECT_EQ(0.5, recording.getSample(0)[1]);
+    EXPECT_EQ(0.0, recording.getSample(1)[0]);
+    EXPECT_EQ(32767 / 32768.0, recording.getSample(1)[1]);
+
+    // 24-bit, sign extended.
+    data = std::string("\x00\x00\x80\x00\x00\x40", 6);
+    writeWav("recording.wav", 1, 1, 24, data);
+    ASSERT_TRUE(recording.open("recording.wav")) << recording.getLastError();
+    ASSERT_EQ(2, recording.getNumSamples());
+    EXPECT_EQ(-1.0, recording.getSample(0)[0]);
+    EXPECT_EQ(0.5, recording.getSample(1)[0]);
+
+    writeWav("recording.wav", 1, 1, 12, data);
+    EXPECT_FALSE(recording.open("recording.wav"));
+    EXPECT_EQ(0, recording.getNumSamples());
+    EXPECT_FALSE(recording.getLastError().empty());
+}
+
+TEST(RecordingFileTest, DecodesFloatAndRawFiles) {
+    const float values[] = {0.25f, -0.75f, 1.5f};
+    std::string data(reinterpret_cast<const char*>(values), sizeof(values));
+    writeWav("recording.WAV", 3, 1, 32, data);
+
+    RecordingFile recording;
+    ASSERT_TRUE(recording.open("recording.WAV")) << recording.getLastError();
+    ASSERT_EQ(3, recording.getNumSamples());
+    EXPECT_EQ(-0.75, recording.getSample(1)[0]);
+
+    std::ofstream("recording.raw", std::ios::binary) << data;
+    ASSERT_TRUE(recording.openRaw("recording.raw", 1, 100));
+    ASSERT_EQ(3, recording.getNumSamples());
+    EXPECT_EQ(100, recording.getSampleRate());
+    EXPECT_EQ(1.5, recording.getSample(2)[0]);
+
+    EXPECT_FALSE(recording.open("recording.raw"));
+}
+
+TEST(RecordingFileTest, ConcatenatesBinaryDataSamples) {
+    GRT::MatrixDouble first(2, 2), second(1, 2);
+    first[0][0] = 1; first[0][1] = 2; first[1][0] = 3; first[1][1] = 4;
+    second[0][0] = 5; second[0][1] = 6;
+    BinaryDataFile::Writer writer(2, "replay");
+    writer.addSample(1, first);
+    writer.addSample(2, second);
+    ASSERT_TRUE(writer.save("recording.espb"));
+
+    RecordingFile recording;
+    ASSERT_TRUE(recording.open("recording.espb")) << recording.getLastError();
+    ASSERT_EQ(2, recording.getNumDimensions());
+    ASSERT_EQ(3, recording.getNumSamples());
+    EXPECT_EQ(0, recording.getSampleRate());
+    for (uint32_t i = 0; i < 6; i++) {
+        EXPECT_EQ(i + 1, recording.getSample(0)[i]);
+    }
+}
@@ -0,0 +1,219 @@
+#include "recording-file.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+
+#include "binary-data-file.h"
+
+namespace {
+
+// WAVE format codes.
+const uint16_t kWavePcm = 1;
+const uint16_t kWaveFloat = 3;
+const uint16_t kWaveExtensible = 0xFFFE;
+
+uint16_t readU16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+uint32_t readU32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint64_t readU64(const uint8_t* p) {
+    return readU32(p) | (static_cast<uint64_t>(readU32(p + 4)) << 32);
+}
+
+float readFloat(const uint8_t* p) {
+    uint32_t bits = readU32(p);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+double readDouble(const uint8_t* p) {
+    uint64_t bits = readU64(p);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Decode one WAV sample of the given format code and size to [-1, 1).
+double decodeWavSample(const uint8_t* p, uint16_t format, uint16_t bytes) {
+    if (format == kWaveFloat) {
+        return bytes == 4 ? readFloat(p) : readDouble(p);
+    }
+    switch (bytes) {
+        case 1: return (static_cast<int>(p[0]) - 128) / 128.0;  // unsigned
+        case 2: return static_cast<int16_t>(readU16(p)) / 32768.0;
+        case 3: {
+            // Shift the 24 bits to the top so the sign extends back down.
+            const uint32_t bits = (static_cast<uint32_t>(p[0]) << 8) |
+                                  (static_cast<uint32_t>(p[1]) << 16) |
+                                  (static_cast<uint32_t>(p[2]) << 24);
+            return (static_cast<int32_t>(bits) >> 8) / 8388608.0;
+        }
+        default: return static_cast<int32_t>(readU32(p)) / 2147483648.0;
+    }
+}
+
+bool readFile(const string& filename, vector<uint8_t>* bytes) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file) return false;
+    std::streamoff size = file.tellg();
+    if (size < 0) return false;
+    bytes->resize(static_cast<size_t>(size));
+    file.seekg(0);
+    return size == 0 ||
+           static_cast<bool>(file.read(reinterpret_cast<char*>(bytes->data()),
+                                       size));
+}
+
+}  // namespace
+
+bool isWavFilename(const string& filename) {
+    if (filename.size() < 4) return false;
+    string extension = filename.substr(filename.size() - 4);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](char c) { return std::tolower(c); });
+    return extension == ".wav";
+}
+
+bool RecordingFile::open(const string& filename) {
+    close();
+    if (isBinaryDataFilename(filename)) return readBinaryDataFile(filename);
+    if (!isWavFilename(filename)) {
+        return fail(filename + " is neither a WAV file nor a binary data file");
+    }
+
+    vector<uint8_t> bytes;
+    if (!readFile(filename, &bytes)) return fail("Can't read " + filename);
+    if (!decodeWav(bytes)) {
+        error_ = filename + ": " + error_;
+        return false;
+    }
+    return true;
+}
+
+bool RecordingFile::openRaw(const string& filename, uint32_t num_dimensions,
+                            double sample_rate) {
+    close();
+    if (num_dimensions == 0) return fail("A raw file needs a dimension");
+
+    vector<uint8_t> bytes;
+    if (!readFile(filename, &bytes)) return fail("Can't read " + filename);
+
+    const size_t sample_bytes = 4 * num_dimensions;
+    const size_t num_values = bytes.size() / sample_bytes * num_dimensions;
+    values_.resize(num_values);
+    for (size_t i = 0; i < num_values; i++) {
+        values_[i] = readFloat(&bytes[4 * i]);
+    }
+    num_dimensions_ = num_dimensions;
+    sample_rate_ = sample_rate;
+    return true;
+}
+
+void RecordingFile::close() {
+    num_dimensions_ = 0;
+    sample_rate_ = 0;
+    values_.clear();
+    error_.clear();
+}
+
+bool RecordingFile::fail(const string& error) {
+    close();
+    error_ = error;
+    return false;
+}
+
+bool RecordingFile::decodeWav(const vector<uint8_t>& bytes) {
+    if (bytes.size() < 12 || memcmp(&bytes[0], "RIFF", 4) != 0 ||
+        memcmp(&bytes[8], "WAVE", 4) != 0) {
+        return fail("not a RIFF/WAVE file");
+    }
+
+    uint16_t format = 0;
+    uint16_t channels = 0;
+    uint16_t bits = 0;
+    uint32_t sample_rate = 0;
+    bool have_format = false;
+
+    // Chunks are word aligned. A data chunk whose size runs past the end of
+    // the file (as written by recorders that never went back to fill it in)
+    // is read up to the end.
+    size_t pos = 12;
+    while (pos + 8 <= bytes.size()) {
+        const uint8_t* chunk = &bytes[pos];
+        const size_t size = std::min<size_t>(readU32(chunk + 4),
+                                             bytes.size() - pos - 8);
+        const uint8_t* body = chunk + 8;
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            if (size < 16) return fail("fmt chunk is too short");
+            format = readU16(body);
+            channels = readU16(body + 2);
+            sample_rate = readU32(body + 4);
+            bits = readU16(body + 14);
+            if (format == kWaveExtensible) {
+                if (size < 26) return fail("fmt chunk is too short");
+                // The format code leads the sub-format GUID.
+                format = readU16(body + 24);
+            }
+            have_format = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!have_format) return fail("data chunk before the fmt chunk");
+
+            const uint16_t sample_bytes = bits / 8;
+            const bool supported =
+                bits % 8 == 0 &&
+                ((format == kWavePcm && sample_bytes >= 1 && sample_bytes <= 4) ||
+                 (format == kWaveFloat && (sample_bytes == 4 || sample_bytes == 8)));
+            if (!supported) {
+                return fail("unsupported sample format " + std::to_string(format) +
+                            " with " + std::to_string(bits) + " bits");
+            }
+            if (channels == 0) return fail("no channels");
+
+            const size_t frame_bytes = static_cast<size_t>(sample_bytes) * channels;
+            const size_t num_values = size / frame_bytes * channels;
+            values_.resize(num_values);
+            for (size_t i = 0; i < num_values; i++) {
+                values_[i] = decodeWavSample(body + i * sample_bytes, format,
+                                             sample_bytes);
+            }
+            num_dimensions_ = channels;
+            sample_rate_ = sample_rate;
+            return true;
+        }
+        pos += 8 + size + (size & 1);
+    }
+    return fail(have_format ? "no data chunk" : "no fmt chunk");
+}
+
+bool RecordingFile::readBinaryDataFile(const string& filename) {
+    BinaryDataFile file;
+    if (!file.open(filename)) {
+        return fail("Can't read " + filename + " as a binary data file");
+    }
+
+    uint64_t num_rows = 0;
+    for (uint32_t i = 0; i < file.getNumSamples(); i++) {
+        num_rows += file.getNumRows(i);
+    }
+    num_dimensions_ = file.getNumDimensions();
+    values_.reserve(num_rows * num_dimensions_);
+
+    GRT::MatrixDouble sample;
+    for (uint32_t i = 0; i < file.getNumSamples(); i++) {
+        file.copySample(i, sample);
+        for (uint32_t r = 0; r < sample.getNumRows(); r++) {
+            values_.insert(values_.end(), sample[r], sample[r] + num_dimensions_);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,75 @@
+/** @file recording-file.h
+ *  @brief Reading recorded sensor data (WAV, ESP binary data or raw float
+ *  files) into memory, for ReplayStream.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+/**
+ @brief A recording of samples, decoded into memory in one go.
+
+ Three kinds of file can be read:
+ - WAV files (.wav), with integer PCM samples of 8 to 32 bits or float
+   samples of 32 or 64 bits. Each channel is one dimension, and samples are
+   scaled to [-1, 1), as AudioStream delivers them.
+ - ESP binary data files (see binary-data-file.h), whose samples are
+   concatenated in order. They don't store a sample rate.
+ - Raw files: little-endian float32 values, num_dimensions per sample, with
+   nothing else in the file.
+
+ Decoding doesn't depend on the platform, so the same file always yields the
+ same doubles.
+ */
+class RecordingFile {
+  public:
+    /**
+     Read a WAV or ESP binary data file, chosen by the extension.
+     @return false if the file can't be read or decoded; see getLastError().
+     */
+    bool open(const string& filename);
+
+    /**
+     Read a raw file of num_dimensions float32 values per sample. A partial
+     sample at the end of the file is ignored.
+     */
+    bool openRaw(const string& filename, uint32_t num_dimensions,
+                 double sample_rate);
+
+    void close();
+
+    uint32_t getNumDimensions() const { return num_dimensions_; }
+    uint64_t getNumSamples() const {
+        return num_dimensions_ == 0 ? 0 : values_.size() / num_dimensions_;
+    }
+
+    // Samples per second, or 0 if the file doesn't say.
+    double getSampleRate() const { return sample_rate_; }
+    void setSampleRate(double sample_rate) { sample_rate_ = sample_rate; }
+
+    // The num_dimensions values of sample i; later samples follow it.
+    const double* getSample(uint64_t i) const {
+        return &values_[i * num_dimensions_];
+    }
+
+    const string& getLastError() const { return error_; }
+
+  private:
+    bool fail(const string& error);
+    bool decodeWav(const vector<uint8_t>& bytes);
+    bool readBinaryDataFile(const string& filename);
+
+    uint32_t num_dimensions_ = 0;
+    double sample_rate_ = 0;
+    vector<double> values_;
+    string error_;
+};
+
+// Whether filename should be read as a WAV file.
+bool isWavFilename(const string& filename);
@@ -0,0 +1,41 @@
+#include "sample-block.h"
+#include "gtest/gtest.h"
+
+TEST(SampleBlockTest, StoresRowsContiguously) {
+    SampleBlock block(3);
+    block.setSourceId(7);
+    double* row = block.addRow(100, 5);
+    row[0] = 1; row[1] = 2; row[2] = 3;
+    row = block.addRow(200, 6);
+    row[0] = 4; row[1] = 5; row[2] = 6;
+
+    ASSERT_EQ(2u, block.getNumRows());
+    EXPECT_EQ(3u, block.getNumDimensions());
+    EXPECT_EQ(7u, block.getSourceId());
+    EXPECT_EQ(std::vector<double>({1, 2, 3, 4, 5, 6}),
+              std::vector<double>(block.data(), block.data() + 6));
+    EXPECT_EQ(4, block.getRow(1)[0]);
+    EXPECT_EQ(100u, block.getTimestamp(0));
+    EXPECT_EQ(6u, block.getSequence(1));
+}
+
+TEST(SampleBlockTest, KeepsStorageWhenRefilled) {
+    SampleBlock block(2);
+    for (int i = 0; i < 64; i++) block.addRow(0, i);
+    const double* storage = block.data();
+
+    block.clear();
+    EXPECT_TRUE(block.empty());
+    for (int i = 0; i < 64; i++) block.addRow(0, i);
+    EXPECT_EQ(storage, block.data());
+
+    block.reset(1);
+    EXPECT_TRUE(block.empty());
+    EXPECT_EQ(1u, block.getNumDimensions());
+}
+
+TEST(SampleBlockTest, ClockIsMonotonic) {
+    uint64_t a = SampleBlock::now();
+    uint64_t b = SampleBlock::now();
+    EXPECT_LE(a, b);
+}
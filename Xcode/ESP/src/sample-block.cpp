@@ -0,0 +1,28 @@
+#include "sample-block.h"
+
+#include <chrono>
+
+uint64_t SampleBlock::now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void SampleBlock::reset(uint32_t num_dimensions) {
+    num_dimensions_ = num_dimensions;
+    clear();
+}
+
+void SampleBlock::clear() {
+    values_.clear();
+    timestamps_.clear();
+    sequences_.clear();
+}
+
+double* SampleBlock::addRow(uint64_t timestamp_us, uint64_t sequence) {
+    const size_t old_size = values_.size();
+    values_.resize(old_size + num_dimensions_);
+    timestamps_.push_back(timestamp_us);
+    sequences_.push_back(sequence);
+    return values_.data() + old_size;
+}
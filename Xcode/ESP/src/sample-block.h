@@ -0,0 +1,68 @@
+/** @file sample-block.h
+ *  @brief SampleBlock, the unit in which input streams deliver samples.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+using std::vector;
+
+/**
+ *  @brief A block of samples delivered by an input stream in one go.
+ *
+ *  The samples are num_dimensions doubles each, stored contiguously and
+ *  row-major. Every row also carries the time it was captured, on the
+ *  monotonic clock of now(), and a sequence number counting the samples the
+ *  stream has delivered, so that downstream stages can measure latency and
+ *  notice dropped samples. The block records which stream it came from.
+ *
+ *  Streams keep one block and refill it for every delivery: clear() and
+ *  reset() keep the storage, so a steady stream of samples doesn't allocate.
+ *  Consumers get the block by const reference and must copy what they want
+ *  to keep past the callback.
+ */
+class SampleBlock {
+  public:
+    SampleBlock() = default;
+    explicit SampleBlock(uint32_t num_dimensions)
+        : num_dimensions_(num_dimensions) {
+    }
+
+    // Microseconds on a monotonic clock, the one capture times are taken on.
+    static uint64_t now();
+
+    // Drop every row and change the number of dimensions.
+    void reset(uint32_t num_dimensions);
+
+    // Drop every row.
+    void clear();
+
+    // Append a row and return its num_dimensions values, to be filled in.
+    double* addRow(uint64_t timestamp_us, uint64_t sequence);
+
+    uint32_t getNumRows() const { return timestamps_.size(); }
+    uint32_t getNumDimensions() const { return num_dimensions_; }
+    bool empty() const { return timestamps_.empty(); }
+
+    const double* getRow(uint32_t i) const {
+        return &values_[i * num_dimensions_];
+    }
+    double* getRow(uint32_t i) { return &values_[i * num_dimensions_]; }
+    // All the rows, row-major.
+    const double* data() const { return values_.data(); }
+
+    uint64_t getTimestamp(uint32_t i) const { return timestamps_[i]; }
+    uint64_t getSequence(uint32_t i) const { return sequences_[i]; }
+
+    uint32_t getSourceId() const { return source_id_; }
+    void setSourceId(uint32_t id) { source_id_ = id; }
+
+  private:
+    uint32_t num_dimensions_ = 0;
+    uint32_t source_id_ = 0;
+    vector<double> values_;
+    vector<uint64_t> timestamps_;
+    vector<uint64_t> sequences_;
+};
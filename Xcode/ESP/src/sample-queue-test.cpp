@@ -0,0 +1,180 @@
+#include "sample-queue.h"
+#include "gtest/gtest.h"
+
+#include <thread>
+
+static const uint32_t kSampleDim = 3;
+
+TEST(SampleQueueTest, PushAndPopInOrder) {
+    SampleQueue queue(kSampleDim, 4);
+    double sample[kSampleDim];
+
+    for (int i = 0; i < 3; i++) {
+        std::fill(sample, sample + kSampleDim, i);
+        ASSERT_TRUE(queue.push(sample));
+    }
+    ASSERT_EQ(3, queue.size());
+
+    vector<double> out;
+    for (int i = 0; i < 3; i++) {
+        ASSERT_TRUE(queue.pop(out));
+        ASSERT_EQ(kSampleDim, out.size());
+        ASSERT_EQ(i, out[0]);
+        ASSERT_EQ(i, out[kSampleDim - 1]);
+    }
+    ASSERT_FALSE(queue.pop(out));
+}
+
+TEST(SampleQueueTest, TimestampsTravelWithSamples) {
+    SampleQueue queue(kSampleDim, 2);
+    double sample[kSampleDim] = {0};
+    queue.push(sample, 100);
+    queue.push(sample, 200);
+    queue.push(sample, 300);  // drops the oldest
+
+    uint64_t timestamp = 0;
+    ASSERT_TRUE(queue.pop(sample, &timestamp));
+    EXPECT_EQ(200u, timestamp);
+    vector<double> out;
+    ASSERT_TRUE(queue.pop(out, &timestamp));
+    EXPECT_EQ(300u, timestamp);
+}
+
+TEST(SampleQueueTest, DropOldest) {
+    SampleQueue queue(kSampleDim, 2);
+    queue.setOverflowPolicy(SampleQueue::kDropOldest);
+    double sample[kSampleDim] = { 0 };
+
+    for (int i = 1; i <= 3; i++) {
+        sample[0] = i;
+        ASSERT_EQ(i <= 2, queue.push(sample));
+    }
+
+    vector<double> out;
+    ASSERT_TRUE(queue.pop(out));
+    ASSERT_EQ(2, out[0]);
+    ASSERT_TRUE(queue.pop(out));
+    ASSERT_EQ(3, out[0]);
+
+    SampleQueue::Stats stats = queue.getStats();
+    ASSERT_EQ(3, stats.pushed);
+    ASSERT_EQ(2, stats.popped);
+    ASSERT_EQ(1, stats.dropped);
+}
+
+TEST(SampleQueueTest, DropNewest) {
+    SampleQueue queue(kSampleDim, 2);
+    queue.setOverflowPolicy(SampleQueue::kDropNewest);
+    double sample[kSampleDim] = { 0 };
+
+    for (int i = 1; i <= 3; i++) {
+        sample[0] = i;
+        ASSERT_EQ(i <= 2, queue.push(sample));
+    }
+
+    vector<double> out;
+    ASSERT_TRUE(queue.pop(out));
+    ASSERT_EQ(1, out[0]);
+    ASSERT_TRUE(queue.pop(out));
+    ASSERT_EQ(2, out[0]);
+    ASSERT_FALSE(queue.pop(out));
+    ASSERT_EQ(1, queue.getStats().dropped);
+}
+
+TEST(SampleQueueTest, Clear) {
+    SampleQueue queue(kSampleDim, 4);
+    double sample[kSampleDim] = { 0 };
+    queue.push(sample);
+    queue.push(sample);
+
+    queue.clear();
+    ASSERT_EQ(0, queue.size());
+
+    vector<double> out;
+    ASSERT_FALSE(queue.pop(out));
+    ASSERT_TRUE(queue.push(sample));
+    ASSERT_TRUE(queue.pop(out));
+}
+
+TEST(SampleQueueTest, ConcurrentProducerConsumer) {
+    const uint64_t kNumSamples = 200000;
+    SampleQueue queue(kSampleDim, 64);
+    queue.setOverflowPolicy(SampleQueue::kDropOldest);
+
+    std::thread producer([&queue, kNumSamples]() {
+        double sample[kSampleDim];
+        for (uint64_t i = 0; i < kNumSamples; i++) {
+            std::fill(sample, sample + kSampleDim, i);
+            queue.push(sample);
+        }
+    });
+
+    // Every sample we see must be intact (no torn slots) and strictly
+    // increasing; dropped samples simply never show up.
+    vector<double> out;
+    double last = -1;
+    uint64_t received = 0;
+    while (true) {
+        if (queue.pop(out)) {
+            ASSERT_EQ(out[0], out[kSampleDim - 1]);
+            ASSERT_GT(out[0], last);
+            last = out[0];
+            received++;
+            if (last == kNumSamples - 1) break;
+        }
+    }
+    producer.join();
+
+    SampleQueue::Stats stats = queue.getStats();
+    ASSERT_EQ(kNumSamples, stats.pushed);
+    ASSERT_EQ(received, stats.popped);
+    ASSERT_EQ(kNumSamples, stats.popped + stats.dropped);
+}
+
+TEST(SampleQueueTest, BlockLosesNothing) {
+    const uint64_t kNumSamples = 200000;
+    SampleQueue queue(kSampleDim, 16);
+    queue.setOverflowPolicy(SampleQueue::kBlock);
+
+    std::thread producer([&queue, kNumSamples]() {
+        double sample[kSampleDim];
+        for (uint64_t i = 0; i < kNumSamples; i++) {
+            std::fill(sample, sample + kSampleDim, i);
+            ASSERT_TRUE(queue.push(sample));
+        }
+    });
+
+    // A slow start makes the producer fill the queue and wait.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    vector<double> out;
+    for (uint64_t i = 0; i < kNumSamples; i++) {
+        while (!queue.waitForData(1000)) {}
+        ASSERT_TRUE(queue.pop(out));
+        ASSERT_EQ(i, out[0]);
+        ASSERT_EQ(i, out[kSampleDim - 1]);
+    }
+    producer.join();
+
+    SampleQueue::Stats stats = queue.getStats();
+    ASSERT_EQ(kNumSamples, stats.popped);
+    ASSERT_EQ(0, stats.dropped);
+    ASSERT_GT(stats.blocked, 0);
+}
+
+TEST(SampleQueueTest, WaitForData) {
+    SampleQueue queue(kSampleDim, 4);
+    ASSERT_FALSE(queue.waitForData(1));
+
+    std::thread producer([&queue]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        double sample[kSampleDim] = { 7 };
+        queue.push(sample);
+    });
+
+    // Generous timeout: we should be woken by the push, not the timeout.
+    ASSERT_TRUE(queue.waitForData(10000));
+    vector<double> out;
+    ASSERT_TRUE(queue.pop(out));
+    ASSERT_EQ(7, out[0]);
+    producer.join();
+}
@@ -0,0 +1,155 @@
+#include "sample-queue.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
+SampleQueue::SampleQueue(uint32_t num_dimensions, uint32_t capacity) {
+    reset(num_dimensions, capacity);
+}
+
+void SampleQueue::reset(uint32_t num_dimensions, uint32_t capacity) {
+    assert(capacity > 0 && "SampleQueue needs room for at least one sample");
+    num_dimensions_ = num_dimensions;
+    capacity_ = capacity;
+    slots_.assign(static_cast<size_t>(num_dimensions) * capacity, 0.0);
+    timestamps_.assign(capacity, 0);
+    head_ = 0;
+    tail_ = 0;
+    popped_ = 0;
+    dropped_ = 0;
+    blocked_ = 0;
+}
+
+bool SampleQueue::push(const double* sample, uint64_t timestamp_us) {
+    if (capacity_ == 0) {
+        dropped_++;
+        return false;
+    }
+
+    bool dropped = false;
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    uint64_t head = head_.load(std::memory_order_acquire);
+
+    if (tail - head >= capacity_ && policy_ == kBlock) {
+        blocked_++;
+        waitForRoom(tail);
+    } else if (tail - head >= capacity_) {
+        if (policy_ == kDropNewest) {
+            dropped_++;
+            return false;
+        }
+
+        // Drop the oldest sample. If the CAS fails the consumer has just
+        // popped it, which frees the slot just the same.
+        if (head_.compare_exchange_strong(head, head + 1,
+                                          std::memory_order_acq_rel)) {
+            dropped_++;
+            dropped = true;
+        }
+    }
+
+    std::memcpy(slot(tail), sample, num_dimensions_ * sizeof(double));
+    timestamps_[tail % capacity_] = timestamp_us;
+    tail_.store(tail + 1, std::memory_order_release);
+
+    // Pairs with the store to consumer_waiting_ in waitForData(): either we
+    // see the consumer waiting, or the consumer sees the new tail_.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (consumer_waiting_.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> guard(wait_mutex_);
+        wait_cv_.notify_one();
+    }
+    return !dropped;
+}
+
+bool SampleQueue::pop(double* sample, uint64_t* timestamp_us) {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    while (true) {
+        uint64_t tail = tail_.load(std::memory_order_acquire);
+        if (head == tail) return false;
+
+        std::memcpy(sample, slot(head), num_dimensions_ * sizeof(double));
+        if (timestamp_us != nullptr) {
+            *timestamp_us = timestamps_[head % capacity_];
+        }
+
+        // Claim the sample only after copying it. If the producer dropped it
+        // (advancing head_) in the meantime, the slot may have been
+        // overwritten mid-copy, so discard the copy and retry; the failed
+        // CAS reloads head.
+        if (head_.compare_exchange_weak(head, head + 1,
+                                        std::memory_order_acq_rel)) {
+            popped_++;
+            if (policy_ == kBlock) notifyProducer();
+            return true;
+        }
+    }
+}
+
+bool SampleQueue::pop(vector<double>& sample, uint64_t* timestamp_us) {
+    sample.resize(num_dimensions_);
+    return pop(sample.data(), timestamp_us);
+}
+
+bool SampleQueue::waitForData(uint32_t timeout_ms) {
+    if (size() > 0) return true;
+
+    std::unique_lock<std::mutex> lock(wait_mutex_);
+    consumer_waiting_.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool ready = wait_cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                                   [this]() { return size() > 0; });
+    consumer_waiting_.store(false);
+    return ready;
+}
+
+void SampleQueue::clear() {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t tail = tail_.load(std::memory_order_acquire);
+    while (head < tail &&
+           !head_.compare_exchange_weak(head, tail, std::memory_order_acq_rel)) {
+        tail = tail_.load(std::memory_order_acquire);
+    }
+    if (policy_ == kBlock) notifyProducer();
+}
+
+void SampleQueue::waitForRoom(uint64_t tail) {
+    auto has_room = [this, tail]() {
+        return tail - head_.load(std::memory_order_acquire) < capacity_;
+    };
+
+    std::unique_lock<std::mutex> lock(room_mutex_);
+    producer_waiting_.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    room_cv_.wait(lock, has_room);
+    producer_waiting_.store(false);
+}
+
+void SampleQueue::notifyProducer() {
+    // Pairs with the store to producer_waiting_ in waitForRoom(), like
+    // push() does for the consumer.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (producer_waiting_.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> guard(room_mutex_);
+        room_cv_.notify_one();
+    }
+}
+
+uint32_t SampleQueue::size() const {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    uint64_t tail = tail_.load(std::memory_order_acquire);
+    return tail > head ? static_cast<uint32_t>(std::min<uint64_t>(tail - head, capacity_)) : 0;
+}
+
+SampleQueue::Stats SampleQueue::getStats() const {
+    Stats stats;
+    stats.pushed = tail_.load(std::memory_order_relaxed);
+    stats.popped = popped_.load(std::memory_order_relaxed);
+    stats.dropped = dropped_.load(std::memory_order_relaxed);
+    stats.blocked = blocked_.load(std::memory_order_relaxed);
+    stats.size = size();
+    stats.capacity = capacity_;
+    return stats;
+}
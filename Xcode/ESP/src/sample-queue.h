@@ -0,0 +1,144 @@
+/** @file sample-queue.h
+ *  @brief SampleQueue, a bounded lock-free queue that hands samples from an
+ *  input stream thread to the thread that runs the pipeline.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+using std::vector;
+
+/**
+ *  @brief Bounded single-producer/single-consumer ring of fixed-width samples.
+ *
+ *  Each slot holds one sample (a vector of num_dimensions doubles), and all
+ *  slots live in one contiguous allocation made by reset(). Pushing and
+ *  popping never allocate or take a lock, so a stalled consumer cannot block
+ *  the producer; instead, samples are dropped according to the
+ *  OverflowPolicy once the queue is full, and the drops are counted. The
+ *  exception is kBlock, under which a full queue makes the producer wait.
+ *
+ *  Exactly one thread may call push() and exactly one (other) thread may call
+ *  pop(), waitForData() and clear(). reset() and setOverflowPolicy() must only
+ *  be called while neither side is running.
+ */
+class SampleQueue {
+  public:
+    enum OverflowPolicy {
+        // Discard the oldest queued sample to make room for the new one. This
+        // keeps the consumer close to real time after a stall.
+        kDropOldest,
+        // Discard the incoming sample, keeping what is already queued.
+        kDropNewest,
+        // Make push() wait until the consumer has popped a sample. Nothing is
+        // lost, but the producer runs no faster than the consumer, so this is
+        // only for offline input such as a ReplayStream, never a live sensor.
+        kBlock,
+    };
+
+    struct Stats {
+        uint64_t pushed = 0;    // samples accepted into the queue
+        uint64_t popped = 0;    // samples handed to the consumer
+        uint64_t dropped = 0;   // samples discarded because the queue was full
+        uint64_t blocked = 0;   // pushes that waited for room (kBlock)
+        uint32_t size = 0;      // samples currently queued
+        uint32_t capacity = 0;
+    };
+
+    SampleQueue() = default;
+    SampleQueue(uint32_t num_dimensions, uint32_t capacity);
+
+    /**
+     * Re-allocate the queue for samples of num_dimensions values, holding at
+     * most capacity samples. Discards queued samples and resets counters.
+     */
+    void reset(uint32_t num_dimensions, uint32_t capacity);
+
+    void setOverflowPolicy(OverflowPolicy policy) { policy_ = policy; }
+    OverflowPolicy getOverflowPolicy() const { return policy_; }
+
+    uint32_t getNumDimensions() const { return num_dimensions_; }
+    uint32_t getCapacity() const { return capacity_; }
+
+    /**
+     * Producer side. Copy one sample (num_dimensions values) into the queue,
+     * along with the time it arrived (see SampleBlock::now()), which comes
+     * back out of pop().
+     *
+     * @return false if a sample had to be dropped to make this push fit (the
+     * new sample under kDropNewest, the oldest queued one under kDropOldest).
+     * Under kBlock, waits for room instead and always returns true.
+     */
+    bool push(const double* sample, uint64_t timestamp_us = 0);
+
+    /**
+     * Consumer side. Copy the oldest queued sample into sample, which must
+     * have room for num_dimensions values, and its arrival time into
+     * timestamp_us unless that's null.
+     *
+     * @return false if the queue is empty.
+     */
+    bool pop(double* sample, uint64_t* timestamp_us = nullptr);
+    bool pop(vector<double>& sample, uint64_t* timestamp_us = nullptr);
+
+    /**
+     * Consumer side. Block until at least one sample is queued or timeout_ms
+     * elapses. The producer only pays for a wakeup while the consumer is
+     * actually waiting.
+     *
+     * @return true if a sample is ready to be popped.
+     */
+    bool waitForData(uint32_t timeout_ms);
+
+    /**
+     * Consumer side. Drop every queued sample.
+     */
+    void clear();
+
+    /**
+     * Number of queued samples. Exact on the consumer thread, approximate
+     * elsewhere.
+     */
+    uint32_t size() const;
+
+    Stats getStats() const;
+
+  private:
+    double* slot(uint64_t position) {
+        return &slots_[(position % capacity_) * num_dimensions_];
+    }
+
+    vector<double> slots_;
+    vector<uint64_t> timestamps_;  // parallel to the slots
+    uint32_t num_dimensions_ = 0;
+    uint32_t capacity_ = 0;
+    OverflowPolicy policy_ = kDropOldest;
+
+    // Monotonically increasing positions; a sample at position p lives in
+    // slot p % capacity_. The consumer owns head_ and the producer owns tail_,
+    // except that the producer may also advance head_ (with a CAS) when it
+    // drops the oldest sample.
+    std::atomic<uint64_t> head_{0};
+    std::atomic<uint64_t> tail_{0};
+
+    std::atomic<uint64_t> popped_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> blocked_{0};
+
+    std::atomic<bool> consumer_waiting_{false};
+    std::mutex wait_mutex_;
+    std::condition_variable wait_cv_;
+
+    // Under kBlock, the same handshake in the other direction: the producer
+    // waits on room_cv_ for the consumer to pop.
+    void waitForRoom(uint64_t tail);
+    void notifyProducer();
+    std::atomic<bool> producer_waiting_{false};
+    std::mutex room_mutex_;
+    std::condition_variable room_cv_;
+};
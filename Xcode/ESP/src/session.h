@@ -0,0 +1,21 @@
+/** @file session.h
+ *  @brief Names of the files that make up a saved ESP session directory.
+ *
+ *  A session is a directory written by ofApp::saveAll() and read back by
+ *  ofApp::loadAll() and by the headless runtime. Loading fails if these names
+ *  are not followed.
+ *
+ *  Training and test data are saved in ESP's binary format (see
+ *  binary-data-file.h). Sessions saved before that have the GRT text files
+ *  instead, which are still loaded when there is no binary file.
+ */
+
+#pragma once
+
+const char kPipelineFilename[]        = "Pipeline.grt";
+const char kCalibrationDataFilename[] = "CalibrationData.grt";
+const char kTrainingDataFilename[]    = "TrainingData.grt";
+const char kTestDataFilename[]        = "TestData.grt";
+const char kTrainingDataBinaryFilename[] = "TrainingData.espb";
+const char kTestDataBinaryFilename[]     = "TestData.espb";
+const char kTuneablesFilename[]       = "TuneableParameters.grt";
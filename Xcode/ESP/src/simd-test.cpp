@@ -0,0 +1,83 @@
+#include "simd.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+TEST(SimdTest, DotMatchesLoopForAllTailLengths) {
+    std::vector<float> a(67), b(67);
+    for (uint32_t i = 0; i < a.size(); i++) {
+        a[i] = std::sin(i * 0.37f);
+        b[i] = 1.0f + 0.01f * i;
+    }
+
+    for (uint32_t n = 0; n <= a.size(); n++) {
+        double expected = 0;
+        for (uint32_t i = 0; i < n; i++) expected += double(a[i]) * b[i];
+        EXPECT_NEAR(expected, simd::dot(a.data(), b.data(), n), 1e-4) << n;
+    }
+}
+
+TEST(SimdTest, DotHandlesUnalignedPointers) {
+    std::vector<float> a(33, 2.0f), b(33, 0.5f);
+    EXPECT_FLOAT_EQ(32.0f, simd::dot(a.data() + 1, b.data() + 1, 32));
+}
+
+TEST(SimdTest, EnvelopeDistanceMatchesLoopForAllTailLengths) {
+    std::vector<float> x(141), lower(141), upper(141);
+    for (uint32_t i = 0; i < x.size(); i++) {
+        x[i] = std::sin(i * 0.37f);
+        lower[i] = -0.5f + 0.001f * i;
+        upper[i] = lower[i] + 0.6f;
+    }
+
+    for (uint32_t n = 0; n <= x.size(); n++) {
+        double expected = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            double d = std::max(0.0f, std::max(x[i] - upper[i], lower[i] - x[i]));
+            expected += d * d;
+        }
+        EXPECT_NEAR(expected, simd::envelopeDistance(x.data(), lower.data(),
+                                                     upper.data(), n, 1e30f),
+                    1e-4) << n;
+    }
+}
+
+TEST(SimdTest, EnvelopeDistanceStopsPastCutoff) {
+    std::vector<float> x(1024, 1.0f), lower(1024, 0.0f), upper(1024, 0.0f);
+    float partial = simd::envelopeDistance(x.data(), lower.data(),
+                                           upper.data(), 1024, 10.0f);
+    EXPECT_GT(partial, 10.0f);
+    EXPECT_LT(partial, 1024.0f);
+}
+
+TEST(SimdTest, ToFloat) {
+    double in[5] = {0.5, -1.25, 3.0, 1e-3, 7.0};
+    float out[5];
+    simd::toFloat(in, out, 5);
+    for (int i = 0; i < 5; i++) EXPECT_FLOAT_EQ(static_cast<float>(in[i]), out[i]);
+}
+
+TEST(SimdTest, Decode7BitPairsMatchesLoopForAllTailLengths) {
+    std::vector<uint8_t> bytes(2 * 40);
+    for (size_t i = 0; i < bytes.size(); i++) bytes[i] = (i * 37 + 11) & 0xff;
+    for (uint32_t n = 0; n <= 40; n++) {
+        std::vector<double> out(n + 1, -1);
+        uint32_t sum = simd::decode7BitPairs(bytes.data(), n, out.data());
+        uint32_t expected_sum = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            expected_sum += bytes[2 * i] + bytes[2 * i + 1];
+            EXPECT_EQ(((bytes[2 * i + 1] & 0x7f) << 7) | (bytes[2 * i] & 0x7f),
+                      out[i]) << "n = " << n << ", i = " << i;
+        }
+        EXPECT_EQ(expected_sum, sum) << "n = " << n;
+        EXPECT_EQ(-1, out[n]);
+    }
+}
+
+TEST(SimdTest, ReportsInstructionSet) {
+    std::string name = simd::getInstructionSet();
+    EXPECT_TRUE(name == "avx2" || name == "sse2" || name == "neon" ||
+                name == "scalar");
+}
@@ -0,0 +1,295 @@
+#include "simd.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ESP_SIMD_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__)
+#define ESP_SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ESP_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace simd {
+namespace {
+
+// envelopeDistance() checks the cutoff after every block of this many values.
+const uint32_t kEnvelopeBlock = 64;
+
+inline float outside(float x, float lower, float upper) {
+    float above = x - upper, below = lower - x;
+    return above > 0 ? above : (below > 0 ? below : 0);
+}
+
+#if !ESP_SIMD_SSE2 && !ESP_SIMD_NEON
+float dotScalar(const float* a, const float* b, uint32_t n) {
+    float sum = 0;
+    for (uint32_t i = 0; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+float envelopeScalar(const float* x, const float* lower, const float* upper,
+                     uint32_t n, float cutoff) {
+    float sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        float d = outside(x[i], lower[i], upper[i]);
+        sum += d * d;
+        if ((i + 1) % kEnvelopeBlock == 0 && sum > cutoff) return sum;
+    }
+    return sum;
+}
+#endif
+
+#if ESP_SIMD_SSE2
+float dotSSE2(const float* a, const float* b, uint32_t n) {
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i),
+                                           _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4),
+                                           _mm_loadu_ps(b + i + 4)));
+    }
+    if (i + 4 <= n) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i),
+                                           _mm_loadu_ps(b + i)));
+        i += 4;
+    }
+    __m128 acc = _mm_add_ps(acc0, acc1);
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    float sum = _mm_cvtss_f32(acc);
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+#endif
+
+#if ESP_SIMD_SSE2
+float envelopeSSE2(const float* x, const float* lower, const float* upper,
+                   uint32_t n, float cutoff) {
+    const __m128 zero = _mm_setzero_ps();
+    float sum = 0;
+    uint32_t i = 0;
+    while (i + 4 <= n) {
+        __m128 acc = _mm_setzero_ps();
+        uint32_t end = i + kEnvelopeBlock <= n ? i + kEnvelopeBlock : n & ~3u;
+        for (; i < end; i += 4) {
+            __m128 v = _mm_loadu_ps(x + i);
+            // At most one of the two is positive.
+            __m128 d = _mm_add_ps(
+                _mm_max_ps(_mm_sub_ps(v, _mm_loadu_ps(upper + i)), zero),
+                _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(lower + i), v), zero));
+            acc = _mm_add_ps(acc, _mm_mul_ps(d, d));
+        }
+        acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+        acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+        sum += _mm_cvtss_f32(acc);
+        if (sum > cutoff) return sum;
+    }
+    for (; i < n; i++) {
+        float d = outside(x[i], lower[i], upper[i]);
+        sum += d * d;
+    }
+    return sum;
+}
+#endif
+
+#if ESP_SIMD_AVX2
+__attribute__((target("avx2,fma")))
+float envelopeAVX2(const float* x, const float* lower, const float* upper,
+                   uint32_t n, float cutoff) {
+    const __m256 zero = _mm256_setzero_ps();
+    float sum = 0;
+    uint32_t i = 0;
+    while (i + 8 <= n) {
+        __m256 acc = _mm256_setzero_ps();
+        uint32_t end = i + kEnvelopeBlock <= n ? i + kEnvelopeBlock : n & ~7u;
+        for (; i < end; i += 8) {
+            __m256 v = _mm256_loadu_ps(x + i);
+            // At most one of the two is positive.
+            __m256 d = _mm256_add_ps(
+                _mm256_max_ps(_mm256_sub_ps(v, _mm256_loadu_ps(upper + i)),
+                              zero),
+                _mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(lower + i), v),
+                              zero));
+            acc = _mm256_fmadd_ps(d, d, acc);
+        }
+        __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc),
+                                 _mm256_extractf128_ps(acc, 1));
+        half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+        half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+        sum += _mm_cvtss_f32(half);
+        if (sum > cutoff) return sum;
+    }
+    for (; i < n; i++) {
+        float d = outside(x[i], lower[i], upper[i]);
+        sum += d * d;
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+float dotAVX2(const float* a, const float* b, uint32_t n) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i),
+                               acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8),
+                               _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    if (i + 8 <= n) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i),
+                               acc0);
+        i += 8;
+    }
+    __m256 acc = _mm256_add_ps(acc0, acc1);
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc),
+                             _mm256_extractf128_ps(acc, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+    float sum = _mm_cvtss_f32(half);
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+#endif
+
+#if ESP_SIMD_NEON
+float dotNEON(const float* a, const float* b, uint32_t n) {
+    float32x4_t acc0 = vdupq_n_f32(0), acc1 = vdupq_n_f32(0);
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    if (i + 4 <= n) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        i += 4;
+    }
+    float32x4_t acc = vaddq_f32(acc0, acc1);
+    float32x2_t pair = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    float sum = vget_lane_f32(vpadd_f32(pair, pair), 0);
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+#endif
+
+#if ESP_SIMD_NEON
+float envelopeNEON(const float* x, const float* lower, const float* upper,
+                   uint32_t n, float cutoff) {
+    const float32x4_t zero = vdupq_n_f32(0);
+    float sum = 0;
+    uint32_t i = 0;
+    while (i + 4 <= n) {
+        float32x4_t acc = vdupq_n_f32(0);
+        uint32_t end = i + kEnvelopeBlock <= n ? i + kEnvelopeBlock : n & ~3u;
+        for (; i < end; i += 4) {
+            float32x4_t v = vld1q_f32(x + i);
+            // At most one of the two is positive.
+            float32x4_t d = vaddq_f32(
+                vmaxq_f32(vsubq_f32(v, vld1q_f32(upper + i)), zero),
+                vmaxq_f32(vsubq_f32(vld1q_f32(lower + i), v), zero));
+            acc = vmlaq_f32(acc, d, d);
+        }
+        float32x2_t pair = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+        sum += vget_lane_f32(vpadd_f32(pair, pair), 0);
+        if (sum > cutoff) return sum;
+    }
+    for (; i < n; i++) {
+        float d = outside(x[i], lower[i], upper[i]);
+        sum += d * d;
+    }
+    return sum;
+}
+#endif
+
+typedef float (*DotFunction)(const float*, const float*, uint32_t);
+typedef float (*EnvelopeFunction)(const float*, const float*, const float*,
+                                  uint32_t, float);
+
+struct Kernels {
+    DotFunction dot;
+    EnvelopeFunction envelope;
+    const char* name;
+};
+
+Kernels pickKernels() {
+#if ESP_SIMD_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return {dotAVX2, envelopeAVX2, "avx2"};
+    }
+#endif
+#if ESP_SIMD_SSE2
+    return {dotSSE2, envelopeSSE2, "sse2"};
+#elif ESP_SIMD_NEON
+    return {dotNEON, envelopeNEON, "neon"};
+#else
+    return {dotScalar, envelopeScalar, "scalar"};
+#endif
+}
+
+const Kernels& kernels() {
+    static const Kernels k = pickKernels();
+    return k;
+}
+
+}  // namespace
+
+float dot(const float* a, const float* b, uint32_t n) {
+    return kernels().dot(a, b, n);
+}
+
+float envelopeDistance(const float* x, const float* lower, const float* upper,
+                       uint32_t n, float cutoff) {
+    return kernels().envelope(x, lower, upper, n, cutoff);
+}
+
+void toFloat(const double* in, float* out, uint32_t n) {
+    // Simple enough for the compiler to vectorize.
+    for (uint32_t i = 0; i < n; i++) out[i] = static_cast<float>(in[i]);
+}
+
+uint32_t decode7BitPairs(const uint8_t* in, uint32_t n, double* out) {
+    uint32_t sum = 0;
+    uint32_t i = 0;
+#if ESP_SIMD_SSE2
+    // Eight values (16 bytes) at a time. SSE2 is always there on x86.
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i low_bits = _mm_set1_epi16(0x007f);
+    const __m128i high_bits = _mm_set1_epi16(0x7f00);
+    __m128i sums = _mm_setzero_si128();
+    for (; i + 8 <= n; i += 8) {
+        __m128i bytes =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i));
+        sums = _mm_add_epi64(sums, _mm_sad_epu8(bytes, zero));
+        // Each 16-bit lane is LSB | MSB << 8.
+        __m128i values = _mm_or_si128(
+            _mm_and_si128(bytes, low_bits),
+            _mm_srli_epi16(_mm_and_si128(bytes, high_bits), 1));
+        __m128i lo = _mm_unpacklo_epi16(values, zero);
+        __m128i hi = _mm_unpackhi_epi16(values, zero);
+        _mm_storeu_pd(out + i, _mm_cvtepi32_pd(lo));
+        _mm_storeu_pd(out + i + 2, _mm_cvtepi32_pd(_mm_shuffle_epi32(lo, 0x4e)));
+        _mm_storeu_pd(out + i + 4, _mm_cvtepi32_pd(hi));
+        _mm_storeu_pd(out + i + 6, _mm_cvtepi32_pd(_mm_shuffle_epi32(hi, 0x4e)));
+    }
+    sum = _mm_cvtsi128_si32(sums) +
+          _mm_cvtsi128_si32(_mm_unpackhi_epi64(sums, sums));
+#endif
+    for (; i < n; i++) {
+        uint8_t lsb = in[2 * i], msb = in[2 * i + 1];
+        sum += lsb + msb;
+        out[i] = ((msb & 0x7f) << 7) | (lsb & 0x7f);
+    }
+    return sum;
+}
+
+const char* getInstructionSet() {
+    return kernels().name;
+}
+
+}  // namespace simd
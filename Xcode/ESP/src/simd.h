@@ -0,0 +1,36 @@
+/** @file simd.h
+ *  @brief Small float32 kernels that use the best SIMD instruction set the
+ *  CPU supports, picked at runtime.
+ *
+ *  On x86, AVX2/FMA is used when the CPU has it and SSE2 otherwise (AVX2 is
+ *  only detected with GCC and Clang). On ARM, NEON is used when the compiler
+ *  targets it. Everything else falls back to plain loops.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace simd {
+
+// Sum of a[i] * b[i] for i in [0, n).
+float dot(const float* a, const float* b, uint32_t n);
+
+// Sum of the squared distances from x[i] to the interval [lower[i], upper[i]]
+// for i in [0, n), i.e. how far x lies outside an envelope. Stops early and
+// returns a partial sum greater than cutoff once the sum exceeds cutoff.
+float envelopeDistance(const float* x, const float* lower, const float* upper,
+                       uint32_t n, float cutoff);
+
+// out[i] = float(in[i]) for i in [0, n).
+void toFloat(const double* in, float* out, uint32_t n);
+
+// Decode n 14-bit values sent as pairs of 7-bit bytes, low byte first (the
+// high bit of each byte is ignored): out[i] = (in[2i + 1] & 0x7f) << 7 |
+// (in[2i] & 0x7f). Returns the sum of the 2n bytes, for checksums.
+uint32_t decode7BitPairs(const uint8_t* in, uint32_t n, double* out);
+
+// Name of the instruction set in use: "avx2", "sse2", "neon" or "scalar".
+const char* getInstructionSet();
+
+}  // namespace simd
@@ -0,0 +1,100 @@
+/** @file socket-util.h
+ *  @brief Small portability shims for the non-blocking sockets used by
+ *  TcpSampleServer and UdpSampleReceiver.
+ */
+
+#pragma once
+
+#if defined( __WIN32__ ) || defined( _WIN32 )
+#ifndef _WINSOCKAPI_
+#define _WINSOCKAPI_
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+typedef int socklen_t;
+#define poll WSAPoll
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace socket_util {
+
+const intptr_t kNoSocket = -1;
+
+#if defined( __WIN32__ ) || defined( _WIN32 )
+inline bool startup() {
+    WSADATA wsa_data;
+    return WSAStartup(MAKEWORD(2, 2), &wsa_data) == 0;
+}
+inline bool wouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+inline bool interrupted() { return WSAGetLastError() == WSAEINTR; }
+inline void closeSocket(intptr_t s) { closesocket(static_cast<SOCKET>(s)); }
+inline bool setNonBlocking(intptr_t s) {
+    u_long on = 1;
+    return ioctlsocket(static_cast<SOCKET>(s), FIONBIO, &on) == 0;
+}
+#else
+inline bool startup() { return true; }
+inline bool wouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK; }
+inline bool interrupted() { return errno == EINTR; }
+inline void closeSocket(intptr_t s) { ::close(static_cast<int>(s)); }
+inline bool setNonBlocking(intptr_t s) {
+    int flags = fcntl(static_cast<int>(s), F_GETFL, 0);
+    return flags >= 0 &&
+           fcntl(static_cast<int>(s), F_SETFL, flags | O_NONBLOCK) == 0;
+}
+#endif
+
+/**
+ Open a non-blocking socket of the given type (SOCK_STREAM or SOCK_DGRAM)
+ bound to port on all interfaces, listening if it's a stream socket.
+ @return the socket and, in bound_port, the port actually bound (port may be
+ 0 to pick a free one); kNoSocket on failure.
+ */
+inline intptr_t openBoundSocket(int type, int port, int* bound_port) {
+    intptr_t s = socket(AF_INET, type,
+                        type == SOCK_STREAM ? IPPROTO_TCP : IPPROTO_UDP);
+    if (s == kNoSocket) return kNoSocket;
+
+    int reuse = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR,
+               reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    socklen_t length = sizeof(address);
+    if (bind(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        (type == SOCK_STREAM && listen(s, SOMAXCONN) != 0) ||
+        !setNonBlocking(s) ||
+        getsockname(s, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+        closeSocket(s);
+        return kNoSocket;
+    }
+    *bound_port = ntohs(address.sin_port);
+    return s;
+}
+
+inline std::string describe(const sockaddr_in& address) {
+    char ip[INET_ADDRSTRLEN] = "?";
+    inet_ntop(AF_INET, const_cast<in_addr*>(&address.sin_addr), ip,
+              sizeof(ip));
+    return std::string(ip) + ":" + std::to_string(ntohs(address.sin_port));
+}
+
+}  // namespace socket_util
@@ -0,0 +1,237 @@
+#include "tcp-sample-server.h"
+#include "gtest/gtest.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+class Receiver {
+  public:
+    void add(const double* samples, uint32_t num_samples, uint32_t dims) {
+        std::lock_guard<std::mutex> guard(mutex_);
+        values_.insert(values_.end(), samples, samples + num_samples * dims);
+        blocks_++;
+        cv_.notify_all();
+    }
+
+    // Wait until at least n values have arrived.
+    std::vector<double> waitFor(size_t n) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait_for(lock, std::chrono::seconds(5),
+                     [&] { return values_.size() >= n; });
+        return values_;
+    }
+
+    int blocks() {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return blocks_;
+    }
+
+  private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<double> values_;
+    int blocks_ = 0;
+};
+
+int connectTo(int port) {
+    int s = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(s, reinterpret_cast<sockaddr*>(&address), sizeof(address))) {
+        close(s);
+        return -1;
+    }
+    return s;
+}
+
+void send(int s, const std::string& text) {
+    ASSERT_EQ(static_cast<ssize_t>(text.size()),
+              ::send(s, text.data(), text.size(), 0));
+}
+
+// Poll the server's counters until the client has sent n lines.
+TcpSampleServer::ClientStats waitForLines(const TcpSampleServer& server,
+                                          size_t client, uint64_t n) {
+    for (int i = 0; i < 500; i++) {
+        std::vector<TcpSampleServer::ClientStats> stats =
+            server.getClientStats();
+        if (stats.size() > client && stats[client].lines >= n) {
+            return stats[client];
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return TcpSampleServer::ClientStats();
+}
+
+}  // namespace
+
+TEST(TcpSampleServerTest, ParsesLinesSplitAcrossReads) {
+    Receiver receiver;
+    TcpSampleServer server(3);
+    ASSERT_TRUE(server.start(0, [&](const double* samples, uint32_t n) {
+        receiver.add(samples, n, 3);
+    }));
+    ASSERT_NE(0, server.getPort());
+
+    int s = connectTo(server.getPort());
+    ASSERT_GE(s, 0);
+    send(s, "1 2 3\n4.5\t5.5\t6.");
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    send(s, "5\r\n-7,8e1,9\n");
+
+    std::vector<double> values = receiver.waitFor(9);
+    std::vector<double> expected = {1, 2, 3, 4.5, 5.5, 6.5, -7, 80, 9};
+    EXPECT_EQ(expected, values);
+
+    TcpSampleServer::ClientStats stats = waitForLines(server, 0, 3);
+    EXPECT_TRUE(stats.connected);
+    EXPECT_EQ(3u, stats.lines);
+    EXPECT_EQ(0u, stats.parse_errors);
+    EXPECT_EQ(std::string("1 2 3\n4.5\t5.5\t6.5\r\n-7,8e1,9\n").size(),
+              stats.bytes);
+
+    close(s);
+    server.stop();
+}
+
+TEST(TcpSampleServerTest, CountsBadLinesPerClient) {
+    Receiver receiver;
+    TcpSampleServer server(2);
+    ASSERT_TRUE(server.start(0, [&](const double* samples, uint32_t n) {
+        receiver.add(samples, n, 2);
+    }));
+
+    int a = connectTo(server.getPort());
+    ASSERT_GE(a, 0);
+    send(a, "1 2\n\n1 2 3\nabc\n3 4\n");
+    waitForLines(server, 0, 5);
+
+    int b = connectTo(server.getPort());
+    ASSERT_GE(b, 0);
+    send(b, "1\n5 6\n");
+    waitForLines(server, 1, 2);
+
+    std::vector<double> values = receiver.waitFor(6);
+    EXPECT_EQ(6u, values.size());
+
+    std::vector<TcpSampleServer::ClientStats> stats = server.getClientStats();
+    ASSERT_EQ(2u, stats.size());
+    EXPECT_EQ(5u, stats[0].lines);
+    EXPECT_EQ(2u, stats[0].parse_errors);
+    EXPECT_EQ(2u, stats[1].lines);
+    EXPECT_EQ(1u, stats[1].parse_errors);
+
+    // Set at connect, and kept as the counters are updated.
+    EXPECT_EQ(0u, stats[0].address.find("127.0.0.1:"));
+
+    // A client that disconnects is folded into the totals, so that the
+    // counters don't grow with every client that ever connected.
+    close(a);
+    for (int i = 0; i < 500 && server.getClientStats().size() > 1; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    stats = server.getClientStats();
+    ASSERT_EQ(1u, stats.size());
+    EXPECT_TRUE(stats[0].connected);
+    EXPECT_EQ(2u, stats[0].lines);
+    TcpSampleServer::ClientStats disconnected =
+        server.getDisconnectedClientStats();
+    EXPECT_FALSE(disconnected.connected);
+    EXPECT_EQ(5u, disconnected.lines);
+    EXPECT_EQ(2u, disconnected.parse_errors);
+
+    // Clients that connect later get their own entries again.
+    int c = connectTo(server.getPort());
+    ASSERT_GE(c, 0);
+    send(c, "7 8\n");
+    EXPECT_EQ(1u, waitForLines(server, 1, 1).lines);
+    close(b);
+    for (int i = 0; i < 500 && server.getClientStats().size() > 1; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    stats = server.getClientStats();
+    ASSERT_EQ(1u, stats.size());
+    EXPECT_EQ(1u, stats[0].lines);
+    EXPECT_EQ(7u, server.getDisconnectedClientStats().lines);
+    EXPECT_EQ(3u, server.getDisconnectedClientStats().parse_errors);
+
+    close(c);
+    server.stop();
+}
+
+TEST(TcpSampleServerTest, DropsOverlongLines) {
+    Receiver receiver;
+    TcpSampleServer server(1);
+    ASSERT_TRUE(server.start(0, [&](const double* samples, uint32_t n) {
+        receiver.add(samples, n, 1);
+    }));
+
+    int s = connectTo(server.getPort());
+    ASSERT_GE(s, 0);
+    send(s, std::string(TcpSampleServer::kMaxLineLength + 10, '1') + "\n7\n");
+
+    std::vector<double> values = receiver.waitFor(1);
+    EXPECT_EQ(std::vector<double>({7}), values);
+    TcpSampleServer::ClientStats stats = waitForLines(server, 0, 2);
+    EXPECT_EQ(2u, stats.lines);
+    EXPECT_EQ(1u, stats.parse_errors);
+
+    close(s);
+    server.stop();
+}
+
+TEST(TcpSampleServerTest, DecodesBinaryFrames) {
+    Receiver receiver;
+    TcpSampleServer server(2, TcpSampleServer::kFrames);
+    ASSERT_TRUE(server.start(0, [&](const double* samples, uint32_t n) {
+        receiver.add(samples, n, 2);
+    }));
+
+    std::vector<uint8_t> bytes;
+    FrameHeader header;
+    header.num_dimensions = 2;
+    header.num_samples = 2;
+    const float first[] = {1, 2, 3, 4};
+    ASSERT_TRUE(encodeFrame(header, first, &bytes));
+    header.num_samples = 1;
+    header.sequence = 5;  // 2..4 lost
+    const float second[] = {5, 6};
+    ASSERT_TRUE(encodeFrame(header, second, &bytes));
+    std::string data(bytes.begin(), bytes.end());
+
+    int s = connectTo(server.getPort());
+    ASSERT_GE(s, 0);
+    send(s, data.substr(0, 30));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    send(s, data.substr(30));
+
+    std::vector<double> values = receiver.waitFor(6);
+    EXPECT_EQ(std::vector<double>({1, 2, 3, 4, 5, 6}), values);
+
+    FrameStats stats;
+    for (int i = 0; i < 500 && stats.frames < 2; i++) {
+        stats = server.getClientStats()[0].frame_stats;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(2u, stats.frames);
+    EXPECT_EQ(3u, stats.samples);
+    EXPECT_EQ(3u, stats.lost_samples);
+    EXPECT_EQ(0u, server.getClientStats()[0].lines);
+
+    close(s);
+    server.stop();
+}
@@ -0,0 +1,232 @@
+#include "tcp-sample-server.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "socket-util.h"
+
+using namespace socket_util;
+
+namespace {
+
+// Bytes requested from the socket per read.
+const size_t kReadChunkSize = 64 * 1024;
+
+}  // namespace
+
+TcpSampleServer::TcpSampleServer(uint32_t num_dimensions, Format format)
+        : num_dimensions_(num_dimensions), format_(format),
+          listen_socket_(kNoSocket) {
+}
+
+TcpSampleServer::~TcpSampleServer() {
+    stop();
+}
+
+bool TcpSampleServer::start(int port, SamplesCallback callback) {
+    if (running_) return false;
+
+    if (!startup()) {
+        last_error_ = "WSAStartup() failed";
+        return false;
+    }
+    listen_socket_ = openBoundSocket(SOCK_STREAM, port, &port_);
+    if (listen_socket_ == kNoSocket) {
+        last_error_ = "can't listen on port " + std::to_string(port);
+        return false;
+    }
+    callback_ = callback;
+    {
+        std::lock_guard<std::mutex> guard(stats_mutex_);
+        stats_.clear();
+        disconnected_stats_ = ClientStats();
+    }
+    running_ = true;
+    thread_.reset(new std::thread(&TcpSampleServer::run, this));
+    return true;
+}
+
+void TcpSampleServer::stop() {
+    running_ = false;
+    if (thread_ != nullptr && thread_->joinable()) {
+        thread_->join();
+    }
+    thread_.reset();
+}
+
+vector<TcpSampleServer::ClientStats> TcpSampleServer::getClientStats() const {
+    std::lock_guard<std::mutex> guard(stats_mutex_);
+    return stats_;
+}
+
+TcpSampleServer::ClientStats TcpSampleServer::getDisconnectedClientStats() const {
+    std::lock_guard<std::mutex> guard(stats_mutex_);
+    return disconnected_stats_;
+}
+
+void TcpSampleServer::ClientStats::add(const ClientStats& other) {
+    bytes += other.bytes;
+    lines += other.lines;
+    parse_errors += other.parse_errors;
+    frame_stats.add(other.frame_stats);
+}
+
+void TcpSampleServer::run() {
+    vector<pollfd> fds;
+    while (running_) {
+        fds.clear();
+        pollfd listen_fd;
+        listen_fd.fd = listen_socket_;
+        listen_fd.events = POLLIN;
+        listen_fd.revents = 0;
+        fds.push_back(listen_fd);
+        for (Client& client : clients_) {
+            pollfd fd;
+            fd.fd = client.socket;
+            fd.events = POLLIN;
+            fd.revents = 0;
+            fds.push_back(fd);
+        }
+
+        int ready = poll(fds.data(), fds.size(), max_wait_ms_);
+        if (ready < 0 && !interrupted()) {
+            // Avoid spinning if a descriptor has gone bad.
+            std::this_thread::sleep_for(
+                std::chrono::milliseconds(max_wait_ms_));
+        }
+        if (ready <= 0) continue;
+
+        samples_.clear();
+        bool disconnected = false;
+        for (size_t i = 0; i < clients_.size(); i++) {
+            if (fds[i + 1].revents == 0) continue;
+            Client& client = clients_[i];
+            if (!readClient(client)) {
+                closeClient(client);
+                disconnected = true;
+            }
+        }
+        if (disconnected) {
+            clients_.erase(
+                std::remove_if(clients_.begin(), clients_.end(),
+                               [](const Client& c) {
+                                   return c.socket == kNoSocket;
+                               }),
+                clients_.end());
+        }
+        if (fds[0].revents & POLLIN) acceptClients();
+
+        if (!samples_.empty() && callback_ != nullptr) {
+            callback_(samples_.data(), samples_.size() / num_dimensions_);
+        }
+
+        std::lock_guard<std::mutex> guard(stats_mutex_);
+        for (const Client& client : clients_) publishStats(client);
+    }
+
+    for (Client& client : clients_) closeClient(client);
+    clients_.clear();
+    closeSocket(listen_socket_);
+    listen_socket_ = kNoSocket;
+}
+
+void TcpSampleServer::acceptClients() {
+    while (true) {
+        sockaddr_in address;
+        socklen_t length = sizeof(address);
+        intptr_t s = accept(listen_socket_,
+                            reinterpret_cast<sockaddr*>(&address), &length);
+        if (s == kNoSocket) return;
+        if (!setNonBlocking(s)) {
+            closeSocket(s);
+            continue;
+        }
+
+        Client client(num_dimensions_);
+        client.socket = s;
+        client.buffer.resize(kReadChunkSize);
+        client.stats.connected = true;
+
+        std::lock_guard<std::mutex> guard(stats_mutex_);
+        client.stats_index = stats_.size();
+        stats_.push_back(client.stats);
+        stats_.back().address = describe(address);
+        clients_.push_back(std::move(client));
+    }
+}
+
+bool TcpSampleServer::readClient(Client& client) {
+    while (true) {
+        if (client.buffer.size() - client.size < kReadChunkSize) {
+            client.buffer.resize(client.size + kReadChunkSize);
+        }
+        int result = recv(client.socket, &client.buffer[client.size],
+                          kReadChunkSize, 0);
+        if (result == 0) return false;  // closed by the client
+        if (result < 0) {
+            if (interrupted()) continue;
+            return wouldBlock();
+        }
+
+        client.size += result;
+        client.stats.bytes += result;
+        if (format_ == kFrames) {
+            decodeFrames(client);
+        } else {
+            parseLines(client);
+        }
+        if (static_cast<size_t>(result) < kReadChunkSize) return true;
+    }
+}
+
+void TcpSampleServer::parseLines(Client& client) {
+    char* data = client.buffer.data();
+    size_t consumed = client.parser.parse(data, client.size, &samples_);
+    client.stats.lines = client.parser.getNumLines();
+    client.stats.parse_errors = client.parser.getNumErrors();
+
+    // Keep the partial line for the next read.
+    client.size -= consumed;
+    if (consumed > 0 && client.size > 0) {
+        std::memmove(data, data + consumed, client.size);
+    }
+}
+
+void TcpSampleServer::decodeFrames(Client& client) {
+    char* data = client.buffer.data();
+    size_t consumed = client.decoder.decode(
+        reinterpret_cast<const uint8_t*>(data), client.size, &samples_);
+    client.stats.frame_stats = client.decoder.getStats();
+
+    // Keep the partial frame for the next read.
+    client.size -= consumed;
+    if (consumed > 0 && client.size > 0) {
+        std::memmove(data, data + consumed, client.size);
+    }
+}
+
+void TcpSampleServer::closeClient(Client& client) {
+    closeSocket(client.socket);
+    client.socket = kNoSocket;
+
+    // Entries after the client's move up; the closed clients' indices are no
+    // longer used.
+    std::lock_guard<std::mutex> guard(stats_mutex_);
+    disconnected_stats_.add(client.stats);
+    stats_.erase(stats_.begin() + client.stats_index);
+    for (Client& other : clients_) {
+        if (other.socket != kNoSocket && other.stats_index > client.stats_index) {
+            other.stats_index--;
+        }
+    }
+}
+
+void TcpSampleServer::publishStats(const Client& client) {
+    ClientStats& stats = stats_[client.stats_index];
+    stats.connected = client.stats.connected;
+    stats.bytes = client.stats.bytes;
+    stats.lines = client.stats.lines;
+    stats.parse_errors = client.stats.parse_errors;
+    stats.frame_stats = client.stats.frame_stats;
+}
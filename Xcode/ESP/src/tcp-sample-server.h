@@ -0,0 +1,156 @@
+/** @file tcp-sample-server.h
+ *  @brief TcpSampleServer, a TCP server that turns lines of numbers, or
+ *  binary frames, sent by any number of clients into blocks of samples.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "binary-frame.h"
+#include "number-parser.h"
+
+using std::string;
+using std::vector;
+
+/**
+ *  @brief Accepts TCP connections and parses each line that clients send as
+ *  one sample of num_dimensions numbers (see parseNumbers()).
+ *
+ *  A single thread waits on the listening socket and every client at once
+ *  with poll(), so it wakes as soon as any of them has data. It then reads
+ *  everything each ready client has sent into that client's buffer, parses
+ *  the complete lines in place, and hands all the samples of the wakeup to
+ *  the callback as one row-major block. Buffers are reused from one wakeup to
+ *  the next, so a steady stream of samples doesn't allocate.
+ *
+ *  Lines that aren't exactly num_dimensions numbers are dropped and counted
+ *  as parse errors; so are lines longer than kMaxLineLength, which could
+ *  otherwise grow a client's buffer without bound. Empty lines are ignored.
+ *
+ *  With the kFrames format, clients send binary frames (see binary-frame.h)
+ *  instead, which are decoded in place the same way; each client has its own
+ *  FrameDecoder, so sequence gaps are accounted for per client and stream id.
+ */
+class TcpSampleServer {
+  public:
+    // Longest line accepted, in bytes.
+    static const size_t kMaxLineLength = LineParser::kMaxLineLength;
+
+    enum Format {
+        kLines,   // one sample per line of text
+        kFrames,  // binary frames
+    };
+
+    struct ClientStats {
+        string address;            // "ip:port" of the client
+        bool connected = false;
+        uint64_t bytes = 0;        // bytes received
+        uint64_t lines = 0;        // complete lines received, including bad ones
+        uint64_t parse_errors = 0; // lines dropped
+        FrameStats frame_stats;    // kFrames only
+
+        // Add other's counters to these.
+        void add(const ClientStats& other);
+    };
+
+    /**
+     Called on the server thread with the samples parsed in one wakeup:
+     num_samples rows of num_dimensions values, row-major, in the order they
+     were received from each client. The data is only valid during the call.
+     */
+    using SamplesCallback =
+        std::function<void(const double* samples, uint32_t num_samples)>;
+
+    explicit TcpSampleServer(uint32_t num_dimensions, Format format = kLines);
+    ~TcpSampleServer();
+
+    /**
+     Listen on port (0 picks a free one, see getPort()) on all interfaces and
+     start the server thread.
+     @return false if the port can't be opened; see getLastError().
+     */
+    bool start(int port, SamplesCallback callback);
+
+    // Disconnect every client and stop the server thread.
+    void stop();
+
+    bool isRunning() const { return running_; }
+    int getPort() const { return port_; }
+    uint32_t getNumDimensions() const { return num_dimensions_; }
+    Format getFormat() const { return format_; }
+
+    /**
+     Set the longest time the server thread blocks waiting for data before
+     re-checking whether it has been stopped. This bounds how long stop()
+     takes; it does not add latency to data that arrives.
+     */
+    void setMaxWait(uint32_t ms) { max_wait_ms_ = ms; }
+
+    // Counters for every connected client, in the order they connected.
+    vector<ClientStats> getClientStats() const;
+
+    // Counters of every client that has disconnected since start(), added up,
+    // with no address.
+    ClientStats getDisconnectedClientStats() const;
+
+    // Why the last start() failed.
+    const string& getLastError() const { return last_error_; }
+
+  private:
+    struct Client {
+        explicit Client(uint32_t num_dimensions)
+            : parser(num_dimensions), decoder(num_dimensions) {
+        }
+
+        intptr_t socket;
+        ClientStats stats;   // the address is only set in stats_
+        size_t stats_index;  // in stats_
+        vector<char> buffer;
+        size_t size = 0;       // bytes of buffer in use
+        LineParser parser;     // kLines only
+        FrameDecoder decoder;  // kFrames only
+    };
+
+    void run();
+    void acceptClients();
+    // Read and parse what the client has sent; false once it has
+    // disconnected.
+    bool readClient(Client& client);
+    // Parse the complete lines in the client's buffer into samples_.
+    void parseLines(Client& client);
+    // Decode the complete frames in the client's buffer into samples_.
+    void decodeFrames(Client& client);
+    // Close the socket and fold the client's counters from stats_ into
+    // disconnected_stats_.
+    void closeClient(Client& client);
+    // Copy the client's counters into stats_; stats_mutex_ must be held.
+    // The address is set once at connect, so this doesn't allocate.
+    void publishStats(const Client& client);
+
+    const uint32_t num_dimensions_;
+    const Format format_;
+    intptr_t listen_socket_;
+    int port_ = 0;
+    SamplesCallback callback_;
+    string last_error_;
+
+    std::atomic<bool> running_{false};
+    std::atomic<uint32_t> max_wait_ms_{100};
+    std::unique_ptr<std::thread> thread_;
+
+    // Only touched by the server thread while it runs.
+    vector<Client> clients_;
+    vector<double> samples_;  // samples of the current wakeup
+
+    mutable std::mutex stats_mutex_;
+    vector<ClientStats> stats_;  // connected clients only
+    ClientStats disconnected_stats_;
+};
@@ -1,9 +1,22 @@
 #include "training-data-manager.h"
 #include "gtest/gtest.h"
 
+#include <fstream>
+
 static const uint32_t kNumClasses = 3;
 static const uint32_t kSampleDim = 3;
 
+// Overwrite the label of the first sample in a binary data file, whose labels
+// section offset is the first entry of the section table, at byte 32.
+static void setFirstLabel(const std::string& filename, uint32_t label) {
+    std::fstream file(filename, std::ios::in | std::ios::out | std::ios::binary);
+    uint64_t labels_offset = 0;
+    file.seekg(32);
+    file.read(reinterpret_cast<char*>(&labels_offset), sizeof(labels_offset));
+    file.seekp(labels_offset);
+    file.write(reinterpret_cast<const char*>(&label), sizeof(label));
+}
+
 class TrainingDataManagerTest : public ::testing::Test {
   protected:
     // Properly populate the manager for testing
@@ -105,6 +118,75 @@ TEST_F(TrainingDataManagerTest, TestRelabelSample) {
     ASSERT_EQ(2, manager->getSample(2, 1)[0][0]);
 }
 
+TEST_F(TrainingDataManagerTest, TestSampleIdsAreStable) {
+    uint64_t first = manager->getSampleId(1, 0);
+    uint64_t middle = manager->getSampleId(1, 1);
+    uint64_t last = manager->getSampleId(1, 2);
+    ASSERT_NE(first, middle);
+    ASSERT_NE(middle, last);
+
+    // Deleting a sample shifts the index, but not the ID, of later samples.
+    manager->deleteSample(1, 0);
+    ASSERT_EQ(middle, manager->getSampleId(1, 0));
+    ASSERT_EQ(last, manager->getSampleId(1, 1));
+
+    uint32_t label, index;
+    ASSERT_FALSE(manager->findSample(first, &label, &index));
+
+    // Relabeling and trimming keep the ID.
+    manager->relabelSample(1, 0, 3);
+    ASSERT_TRUE(manager->findSample(middle, &label, &index));
+    ASSERT_EQ(3, label);
+    ASSERT_EQ(0, index);
+
+    manager->trimSample(3, 0, 0, 0);
+    ASSERT_EQ(middle, manager->getSampleId(3, 0));
+}
+
+TEST_F(TrainingDataManagerTest, TestGetAllDataReflectsEdits) {
+    ASSERT_EQ(4, manager->getAllData().getNumSamples());
+
+    manager->deleteSample(1, 1);
+    manager->relabelSample(1, 0, 3);
+
+    // Samples come out ordered by label, then by index.
+    const GRT::TimeSeriesClassificationData& data = manager->getAllData();
+    ASSERT_EQ(3, data.getNumSamples());
+    ASSERT_EQ(3, manager->getTotalNumSamples());
+    ASSERT_EQ(1, data[0].getClassLabel());
+    ASSERT_EQ(3, data[0].getData()[0][0]);
+    ASSERT_EQ(2, data[1].getClassLabel());
+    ASSERT_EQ(4, data[1].getData()[0][0]);
+    ASSERT_EQ(3, data[2].getClassLabel());
+    ASSERT_EQ(1, data[2].getData()[0][0]);
+}
+
+TEST_F(TrainingDataManagerTest, TestSnapshotIsUnaffectedByEdits) {
+    TrainingDataSnapshot snapshot = manager->getSnapshot();
+    ASSERT_EQ(4, snapshot.getNumSamples());
+
+    // The snapshot shares the sample memory.
+    ASSERT_EQ(&manager->getSample(1, 1), &snapshot.getData(1));
+
+    manager->deleteSample(1, 0);
+    manager->trimSample(1, 0, 0, 0);
+    manager->deleteAllSamplesWithLabel(2);
+
+    ASSERT_EQ(4, snapshot.getNumSamples());
+    ASSERT_EQ(1, snapshot.getLabel(0));
+    ASSERT_EQ(1, snapshot.getData(0)[0][0]);
+    ASSERT_EQ(2, snapshot.getLabel(3));
+    ASSERT_EQ(4, snapshot.getData(3)[0][0]);
+    ASSERT_NE(&manager->getSample(1, 0), &snapshot.getData(1));
+
+    // Leave-one-out materialization.
+    GRT::TimeSeriesClassificationData data = snapshot.materialize(1);
+    ASSERT_EQ(3, data.getNumSamples());
+    ASSERT_EQ(1, data[0].getData()[0][0]);
+    ASSERT_EQ(3, data[1].getData()[0][0]);
+    ASSERT_EQ(4, data[2].getData()[0][0]);
+}
+
 TEST_F(TrainingDataManagerTest, TestAssignName) {
     // Default name
     ASSERT_STREQ("Label 1 [1]", manager->getSampleName(1, 1).c_str());
@@ -178,3 +260,49 @@ TEST_F(TrainingDataManagerTest, TestSaveLoad) {
     ASSERT_STREQ("Label 1 [1]", manager->getSampleName(1, 1).c_str());
     ASSERT_STREQ("Special 2 [0]", manager->getSampleName(2, 0).c_str());
 }
+
+TEST_F(TrainingDataManagerTest, TestSaveLoadBinary) {
+    manager->setNameForLabel("Special2", 2);
+    manager->setSampleName(1, 2, "Third");
+    manager->setSampleScore(1, 1, 0.5);
+    manager->setSampleClassLikelihoods(2, 0, {0.0, 0.25, 0.75});
+    ASSERT_TRUE(manager->save("tmp.espb"));
+
+    TrainingDataManager new_manager(0);
+    ASSERT_TRUE(new_manager.load("tmp.espb"));
+
+    ASSERT_EQ(kNumClasses, new_manager.getNumLabels());
+    ASSERT_EQ(3, new_manager.getNumSampleForLabel(1));
+    ASSERT_EQ(1, new_manager.getNumSampleForLabel(2));
+    ASSERT_EQ(2, new_manager.getSample(1, 1)[0][0]);
+    ASSERT_EQ(4, new_manager.getSample(2, 0)[0][0]);
+    ASSERT_EQ(kSampleDim, new_manager.getSample(2, 0).getNumCols());
+
+    // Metadata that GRT's format drops survives the binary format.
+    ASSERT_EQ("Special2", new_manager.getLabelName(2));
+    ASSERT_EQ("Third", new_manager.getSampleName(1, 2));
+    ASSERT_FALSE(new_manager.hasSampleScore(1, 0));
+    ASSERT_TRUE(new_manager.hasSampleScore(1, 1));
+    ASSERT_EQ(0.5, new_manager.getSampleScore(1, 1));
+    ASSERT_TRUE(new_manager.hasSampleClassLikelihoods(2, 0));
+    ASSERT_EQ(0.75, new_manager.getSampleClassLikelihoods(2, 0)[2]);
+
+    // New samples must still match the loaded dimensions.
+    GRT::MatrixDouble sample(1, kSampleDim);
+    ASSERT_TRUE(new_manager.addSample(3, sample));
+}
+
+TEST_F(TrainingDataManagerTest, TestLoadBinaryRejectsBadLabels) {
+    ASSERT_TRUE(manager->save("tmp.espb"));
+    TrainingDataManager new_manager(0);
+
+    setFirstLabel("tmp.espb", kNumClasses + 1);
+    ASSERT_FALSE(new_manager.load("tmp.espb"));
+
+    setFirstLabel("tmp.espb", 0xFFFFFFFF);
+    ASSERT_FALSE(new_manager.load("tmp.espb"));
+
+    setFirstLabel("tmp.espb", kNumClasses);
+    ASSERT_TRUE(new_manager.load("tmp.espb"));
+    ASSERT_EQ(kNumClasses, new_manager.getNumLabels());
+}
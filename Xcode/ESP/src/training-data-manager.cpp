@@ -2,6 +2,10 @@
 
 #include <sstream>
 
+#include "binary-data-file.h"
+
+using std::shared_ptr;
+
 const char kDefaultTrainingDataName[] = "Default";
 
 // Useful macros that simplifies the coding.
@@ -10,44 +14,68 @@ const char kDefaultTrainingDataName[] = "Default";
     assert((label) > 0 && label <= num_classes_ &&  \
            "Label should be [1, num_classes_]");
 
-#define CHECK_INDEX(label, index)                       \
-    assert((index) < num_samples_per_label_[(label)] && \
+#define CHECK_INDEX(label, index)                      \
+    assert((index) < samples_[(label)].size() &&       \
            "Index exceeds the available samples");
 
 TrainingDataManager::TrainingDataManager(uint32_t num_classes)
         : num_classes_(num_classes) {
-    training_sample_names_.resize(num_classes + 1);
-    training_sample_scores_.resize(num_classes + 1);
-    training_sample_class_likelihoods_.resize(num_classes + 1);
-    num_samples_per_label_.resize(num_classes + 1, 0);
+    samples_.resize(num_classes + 1);
 
     for (uint32_t i = 0; i <= num_classes; i++) {
         default_label_names_.push_back(std::to_string(i));
     }
 
-    data_.setDatasetName(kDefaultTrainingDataName);
+    dataset_name_ = kDefaultTrainingDataName;
 }
 
 bool TrainingDataManager::setNumDimensions(uint32_t dim) {
-    return data_.setNumDimensions(dim);
+    if (dim == 0) return false;
+
+    // GRT clears the data when the dimension changes; do the same here.
+    for (auto& samples : samples_) samples.clear();
+    num_samples_ = 0;
+    num_dimensions_ = dim;
+    snapshot_dirty_ = true;
+    return true;
 }
 
 bool TrainingDataManager::setDatasetName(const std::string name) {
-    return data_.setDatasetName(name);
+    // Same rule as TimeSeriesClassificationData::setDatasetName().
+    if (name.find(' ') != std::string::npos) return false;
+    dataset_name_ = name;
+    snapshot_dirty_ = true;
+    return true;
 }
 
 bool TrainingDataManager::setDatasetName(const char* const name) {
     if ((name != NULL) && (name[0] == '\0')) {
-        return data_.setDatasetName(std::string(name));
+        return setDatasetName(std::string(name));
     }
     return false;
 }
 
+TrainingDataSnapshot TrainingDataManager::getSnapshot() {
+    if (!snapshot_dirty_) return snapshot_;
+
+    vector<TrainingDataSnapshot::Sample> samples;
+    samples.reserve(num_samples_);
+    for (uint32_t label = 1; label <= num_classes_; label++) {
+        for (const auto& sample : samples_[label]) {
+            samples.push_back({label, sample->data});
+        }
+    }
+    snapshot_ = TrainingDataSnapshot(num_dimensions_, dataset_name_,
+                                     default_label_names_, std::move(samples));
+    snapshot_dirty_ = false;
+    return snapshot_;
+}
+
 std::string TrainingDataManager::getSampleName(uint32_t label, uint32_t index) {
     CHECK_LABEL(label);
     CHECK_INDEX(label, index);
 
-    const auto& name = training_sample_names_[label][index];
+    const auto& name = samples_[label][index]->name;
     if (name.first) {
         return name.second;
     } else {
@@ -58,29 +86,39 @@ std::string TrainingDataManager::getSampleName(uint32_t label, uint32_t index) {
 bool TrainingDataManager::setSampleName(
     uint32_t label, uint32_t index, const std::string new_name) {
     CHECK_LABEL(label);
+    CHECK_INDEX(label, index);
 
-    auto& name = training_sample_names_[label][index];
+    auto& name = samples_[label][index]->name;
     name.first = true;
     name.second = new_name;
     return true;
 }
 
+void TrainingDataManager::appendSample(
+    uint32_t label, shared_ptr<const GRT::MatrixDouble> data) {
+    std::unique_ptr<Sample> sample(new Sample());
+    sample->id = next_sample_id_++;
+    sample->data = std::move(data);
+    // By default, set the name be <false, ""> so we will use the default name.
+    sample->name = std::make_pair(false, std::string());
+    sample->score = std::make_pair(false, 0.0);
+    sample->likelihoods = std::make_pair(false, vector<double>());
+    samples_[label].push_back(std::move(sample));
+    num_samples_++;
+    snapshot_dirty_ = true;
+}
+
 bool TrainingDataManager::addSample(
     uint32_t label, const GRT::MatrixDouble& sample) {
     CHECK_LABEL(label);
 
-    if (data_.addSample(label, sample)) {
-        // By default, set the name be <false, ""> so we will use the default name.
-        training_sample_names_[label].push_back(
-            std::make_pair(false, std::string()));
-        training_sample_scores_[label].push_back(std::make_pair(false, 0.0));
-        training_sample_class_likelihoods_[label].push_back(std::make_pair(false, std::vector<double>()));
-        num_samples_per_label_[label]++;
-
-        return true;
+    // Same check as TimeSeriesClassificationData::addSample().
+    if (sample.getNumCols() != num_dimensions_) {
+        return false;
     }
-    
-    return false;
+
+    appendSample(label, std::make_shared<const GRT::MatrixDouble>(sample));
+    return true;
 }
 
 std::string TrainingDataManager::getLabelName(uint32_t label) {
@@ -91,73 +129,68 @@ std::string TrainingDataManager::getLabelName(uint32_t label) {
 bool TrainingDataManager::setNameForLabel(const std::string name, uint32_t label) {
     CHECK_LABEL(label);
     default_label_names_[label] = name;
-    data_.setClassNameForCorrespondingClassLabel(name, label);
+    snapshot_dirty_ = true;
     return true;
 }
 
-GRT::MatrixDouble TrainingDataManager::getSample(uint32_t label, uint32_t index) {
+const GRT::MatrixDouble& TrainingDataManager::getSample(
+    uint32_t label, uint32_t index) {
     CHECK_LABEL(label);
     CHECK_INDEX(label, index);
-    return data_.getClassData(label)[index].getData();
+    return *samples_[label][index]->data;
 }
 
 uint32_t TrainingDataManager::getNumSampleForLabel(uint32_t label) {
     CHECK_LABEL(label);
-    assert(num_samples_per_label_[label] ==
-           data_.getClassData(label).getNumSamples());
-    return num_samples_per_label_[label];
+    return samples_[label].size();
 }
 
-bool TrainingDataManager::deleteSample(uint32_t label, uint32_t index) {
+uint64_t TrainingDataManager::getSampleId(uint32_t label, uint32_t index) {
     CHECK_LABEL(label);
     CHECK_INDEX(label, index);
+    return samples_[label][index]->id;
+}
 
-    // The implementation first remove all data and then add them back. This is
-    // a temporary solution because GRT::TimeSeriesClassificationData doesn't
-    // allow per-sample operation.
-    GRT::TimeSeriesClassificationData data = data_.getClassData(label);
-    data_.eraseAllSamplesWithClassLabel(label);
-
-    for (uint32_t i = 0; i < data.getNumSamples(); i++) {
-        if (i != index) {
-            data_.addSample(label, data[i].getData());
+bool TrainingDataManager::findSample(
+    uint64_t id, uint32_t* label, uint32_t* index) {
+    for (uint32_t l = 1; l <= num_classes_; l++) {
+        const auto& samples = samples_[l];
+        for (uint32_t i = 0; i < samples.size(); i++) {
+            if (samples[i]->id == id) {
+                *label = l;
+                *index = i;
+                return true;
+            }
         }
     }
+    return false;
+}
 
-    auto& names = training_sample_names_[label];
-    names.erase(names.begin() + index);
-
-    auto& scores = training_sample_scores_[label];
-    scores.erase(scores.begin() + index);
-
-    auto& likelihoods = training_sample_class_likelihoods_[label];
-    likelihoods.erase(likelihoods.begin() + index);
-
-    num_samples_per_label_[label]--;
+bool TrainingDataManager::deleteSample(uint32_t label, uint32_t index) {
+    CHECK_LABEL(label);
+    CHECK_INDEX(label, index);
 
+    auto& samples = samples_[label];
+    samples.erase(samples.begin() + index);
+    num_samples_--;
+    snapshot_dirty_ = true;
     return true;
 }
 
 bool TrainingDataManager::deleteAllSamples() {
     for (uint32_t i = 0; i < num_classes_; i++) {
-        data_.eraseAllSamplesWithClassLabel(i + 1);
-        num_samples_per_label_[i + 1] = 0;
-        auto& scores = training_sample_scores_[i + 1];
-        scores.erase(scores.begin(), scores.end());
-        auto& likelihoods = training_sample_class_likelihoods_[i + 1];
-        likelihoods.erase(likelihoods.begin(), likelihoods.end());
+        samples_[i + 1].clear();
     }
+    num_samples_ = 0;
+    snapshot_dirty_ = true;
     return true;
 }
 
 bool TrainingDataManager::deleteAllSamplesWithLabel(uint32_t label) {
     CHECK_LABEL(label);
-    data_.eraseAllSamplesWithClassLabel(label);
-    num_samples_per_label_[label] = 0;
-    auto& scores = training_sample_scores_[label];
-    scores.erase(scores.begin(), scores.end());
-    auto& likelihoods = training_sample_class_likelihoods_[label];
-    likelihoods.erase(likelihoods.begin(), likelihoods.end());
+    num_samples_ -= samples_[label].size();
+    samples_[label].clear();
+    snapshot_dirty_ = true;
     return true;
 }
 
@@ -167,10 +200,18 @@ bool TrainingDataManager::relabelSample(
     CHECK_LABEL(new_label);
     CHECK_INDEX(label, index);
 
-    GRT::MatrixDouble data = getSample(label, index);
-    deleteSample(label, index);
-    addSample(new_label, data);
+    auto& samples = samples_[label];
+    std::unique_ptr<Sample> sample = std::move(samples[index]);
+    samples.erase(samples.begin() + index);
 
+    // The sample keeps its ID and data, but its name, score and likelihoods
+    // belonged to the old label.
+    sample->name = std::make_pair(false, std::string());
+    sample->score = std::make_pair(false, 0.0);
+    sample->likelihoods = std::make_pair(false, vector<double>());
+    samples_[new_label].push_back(std::move(sample));
+
+    snapshot_dirty_ = true;
     return true;
 }
 
@@ -179,30 +220,25 @@ bool TrainingDataManager::trimSample(
     CHECK_LABEL(label);
     CHECK_INDEX(label, index);
 
-    GRT::TimeSeriesClassificationData data = data_.getClassData(label);
-    data_.eraseAllSamplesWithClassLabel(label);
+    // Snapshots may share the old matrix, so build a new one.
+    shared_ptr<const GRT::MatrixDouble>& sample = samples_[label][index]->data;
+    shared_ptr<GRT::MatrixDouble> new_sample =
+        std::make_shared<GRT::MatrixDouble>();
 
-    for (uint32_t i = 0; i < data.getNumSamples(); i++) {
-        if (i == index) {
-            GRT::MatrixDouble sample = data[i].getData();
-            GRT::MatrixDouble new_sample;
-
-            for (uint32_t row = start; row <= end; row++) {
-                new_sample.push_back(sample.getRowVector(row));
-            }
-            data_.addSample(label, new_sample);
-        } else {
-            data_.addSample(label, data[i].getData());
-        }
+    for (uint32_t row = start; row <= end; row++) {
+        new_sample->push_back(sample->getRowVector(row));
     }
+    sample = new_sample;
+
+    snapshot_dirty_ = true;
     return true;
 }
 
 bool TrainingDataManager::hasSampleScore(uint32_t label, uint32_t index) {
     if (!(label > 0 && label <= num_classes_)) return false;
-    if (!(index < num_samples_per_label_[label])) return false;
+    if (!(index < samples_[label].size())) return false;
 
-    const auto& score = training_sample_scores_[label][index];
+    const auto& score = samples_[label][index]->score;
     return score.first;
 }
 
@@ -210,7 +246,7 @@ double TrainingDataManager::getSampleScore(uint32_t label, uint32_t index) {
     CHECK_LABEL(label);
     CHECK_INDEX(label, index);
 
-    const auto& score = training_sample_scores_[label][index];
+    const auto& score = samples_[label][index]->score;
     if (score.first) {
         return score.second;
     } else {
@@ -221,8 +257,9 @@ double TrainingDataManager::getSampleScore(uint32_t label, uint32_t index) {
 bool TrainingDataManager::setSampleScore(
     uint32_t label, uint32_t index, double new_score) {
     CHECK_LABEL(label);
+    CHECK_INDEX(label, index);
 
-    auto& score = training_sample_scores_[label][index];
+    auto& score = samples_[label][index]->score;
     score.first = true;
     score.second = new_score;
     return true;
@@ -230,9 +267,9 @@ bool TrainingDataManager::setSampleScore(
 
 bool TrainingDataManager::hasSampleClassLikelihoods(uint32_t label, uint32_t index) {
     if (!(label > 0 && label <= num_classes_)) return false;
-    if (!(index < num_samples_per_label_[label])) return false;
+    if (!(index < samples_[label].size())) return false;
 
-    const auto& likelihood = training_sample_class_likelihoods_[label][index];
+    const auto& likelihood = samples_[label][index]->likelihoods;
     return likelihood.first;
 }
 
@@ -240,7 +277,7 @@ std::vector<double> TrainingDataManager::getSampleClassLikelihoods(uint32_t labe
     CHECK_LABEL(label);
     CHECK_INDEX(label, index);
 
-    const auto& likelihood = training_sample_class_likelihoods_[label][index];
+    const auto& likelihood = samples_[label][index]->likelihoods;
     if (likelihood.first) {
         return likelihood.second;
     } else {
@@ -251,55 +288,116 @@ std::vector<double> TrainingDataManager::getSampleClassLikelihoods(uint32_t labe
 bool TrainingDataManager::setSampleClassLikelihoods(
     uint32_t label, uint32_t index, vector<double> new_likelihoods) {
     CHECK_LABEL(label);
+    CHECK_INDEX(label, index);
 
-    auto& likelihood = training_sample_class_likelihoods_[label][index];
+    auto& likelihood = samples_[label][index]->likelihoods;
     likelihood.first = true;
     likelihood.second = new_likelihoods;
     return true;
 }
 
-bool TrainingDataManager::load(const std::string& filename) {
-    if (!data_.load(filename)) {
-        return false;
+bool TrainingDataManager::save(const std::string& filename) {
+    if (isBinaryDataFilename(filename)) {
+        return saveBinary(filename);
+    }
+    return getAllData().save(filename);
+}
+
+bool TrainingDataManager::saveBinary(const std::string& filename) {
+    BinaryDataFile::Writer writer(num_dimensions_, dataset_name_);
+    writer.setLabelNames(default_label_names_);
+    for (uint32_t label = 1; label <= num_classes_; label++) {
+        for (const auto& sample : samples_[label]) {
+            writer.addSample(
+                label, *sample->data,
+                sample->name.first ? &sample->name.second : nullptr,
+                sample->score.first ? &sample->score.second : nullptr,
+                sample->likelihoods.first ? &sample->likelihoods.second : nullptr);
+        }
     }
+    return writer.save(filename);
+}
 
+void TrainingDataManager::resetForLoad(uint32_t num_classes) {
     // Use the larger of the current value of num_classes_ and
-    // data_.getNumClasses(). See discussion at
+    // the number of classes in the file. See discussion at
     // https://github.com/damellis/ESP/issues/252.
-    num_classes_ = std::max(data_.getNumClasses(), num_classes_);
+    num_classes_ = std::max(num_classes, num_classes_);
 
-    // Populate the internals of the manager from data_. Most importantly, need
-    // to resize all vectors to hold the data.
-    training_sample_names_.resize(num_classes_ + 1);
     default_label_names_.resize(num_classes_ + 1);
-    num_samples_per_label_.resize(num_classes_ + 1);
-    training_sample_scores_.resize(num_classes_ + 1);
-    training_sample_class_likelihoods_.resize(num_classes_ + 1);
+    samples_.clear();
+    samples_.resize(num_classes_ + 1);
+    num_samples_ = 0;
+    snapshot_dirty_ = true;
+}
+
+bool TrainingDataManager::loadBinary(const std::string& filename) {
+    BinaryDataFile file;
+    if (!file.open(filename)) {
+        return false;
+    }
+
+    // The file guarantees that no sample's label exceeds the label count.
+    resetForLoad(file.getNumLabels());
+
+    for (uint32_t i = 1; i <= num_classes_; i++) {
+        const std::string name = file.getLabelName(i);
+        default_label_names_[i] = name.empty() ? std::to_string(i) : name;
+    }
+
+    for (uint32_t i = 0; i < file.getNumSamples(); i++) {
+        uint32_t label = file.getLabel(i);
+        if (label < 1) continue;
+
+        std::shared_ptr<GRT::MatrixDouble> data =
+            std::make_shared<GRT::MatrixDouble>();
+        file.copySample(i, *data);
+        appendSample(label, data);
+
+        Sample& sample = *samples_[label].back();
+        if (file.hasName(i)) sample.name = std::make_pair(true, file.getName(i));
+        if (file.hasScore(i)) sample.score = std::make_pair(true, file.getScore(i));
+        if (file.hasLikelihoods(i)) {
+            sample.likelihoods = std::make_pair(true, file.getLikelihoods(i));
+        }
+    }
+
+    num_dimensions_ = file.getNumDimensions();
+    dataset_name_ = file.getDatasetName();
+    return true;
+}
+
+bool TrainingDataManager::load(const std::string& filename) {
+    if (isBinaryDataFilename(filename)) {
+        return loadBinary(filename);
+    }
+
+    GRT::TimeSeriesClassificationData data;
+    if (!data.load(filename)) {
+        return false;
+    }
+
+    // Populate the internals of the manager from data. GRT's format doesn't
+    // have per-sample names, so samples will use default names.
+    resetForLoad(data.getNumClasses());
 
     for (uint32_t i = 1; i <= num_classes_; i++) {
-        const string class_name = data_.getClassNameForCorrespondingClassLabel(i);
+        const string class_name = data.getClassNameForCorrespondingClassLabel(i);
         if (class_name == "NOT_SET" || class_name == "CLASS_LABEL_NOT_FOUND") {
             default_label_names_[i] = std::to_string(i);
         } else {
             default_label_names_[i] = class_name;
         }
+    }
 
-        uint32_t num_samples = data_.getClassData(i).getNumSamples();
-        num_samples_per_label_[i] = num_samples;
-
-        training_sample_names_[i].clear();
-        training_sample_scores_[i].clear();
-        training_sample_class_likelihoods_[i].clear();
-        for (uint32_t j = 0; j < num_samples; j++) {
-            // Since we don't yet have per-sample name saved, we will use
-            // default names (marking the pair as <false, "">).
-            training_sample_names_[i].push_back(
-                std::make_pair(false, std::string()));
-            training_sample_scores_[i].push_back(std::make_pair(false, 0.0));
-            training_sample_class_likelihoods_[i].push_back(
-                std::make_pair(false, vector<double>()));
-        }
+    for (uint32_t i = 0; i < data.getNumSamples(); i++) {
+        uint32_t label = data[i].getClassLabel();
+        if (label < 1 || label > num_classes_) continue;
+        appendSample(label,
+                     std::make_shared<const GRT::MatrixDouble>(data[i].getData()));
     }
 
+    num_dimensions_ = data.getNumDimensions();
+    dataset_name_ = data.getDatasetName();
     return true;
 }
@@ -9,11 +9,15 @@
 
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include <tuple>
 #include <vector>
 
 #include <GRT/GRT.h>
 
+#include "training-data-snapshot.h"
+
 using std::vector;
 
 /**
@@ -33,7 +37,14 @@ using std::vector;
  *    2. Name individual sample.
  *
  *  Each individual sample is addressable by (label, index) tuple. Label starts
- *  from 1 and index starts from 0.
+ *  from 1 and index starts from 0. Each sample also has an ID that stays the
+ *  same while the sample is edited, relabeled or moved by the deletion of
+ *  other samples.
+ *
+ *  Samples are stored one by one, grouped by label, so that editing a sample
+ *  only touches that sample. Sample matrices are never modified in place, so
+ *  they can be shared with snapshots (see TrainingDataSnapshot) that trainers
+ *  and scorers hold while the data keeps being edited.
  */
 class TrainingDataManager {
   public:
@@ -49,11 +60,19 @@ class TrainingDataManager {
     // Set the name of the training data
     bool setDatasetName(const char* const name);
 
-    GRT::TimeSeriesClassificationData getAllData() { return data_; }
+    /// @brief A snapshot of all samples, ordered by label and then by index.
+    /// Cheap: the samples are shared, not copied.
+    TrainingDataSnapshot getSnapshot();
+
+    /// @brief A copy of all samples as GRT training data. Prefer getSnapshot()
+    /// unless GRT needs the data right away.
+    GRT::TimeSeriesClassificationData getAllData() {
+        return getSnapshot().materialize();
+    }
 
     uint32_t getNumLabels() { return num_classes_; }
 
-    uint32_t getTotalNumSamples() { return data_.getNumSamples(); }
+    uint32_t getTotalNumSamples() { return num_samples_; }
 
     // =================================================
     //  Functions that enables per-sample naming
@@ -80,8 +99,16 @@ class TrainingDataManager {
 
     uint32_t getNumSampleForLabel(uint32_t label);
 
-    /// @brief Get the sample by label and index.
-    GRT::MatrixDouble getSample(uint32_t label, uint32_t index);
+    /// @brief Get the ID of the sample at (label, index). IDs are never reused.
+    uint64_t getSampleId(uint32_t label, uint32_t index);
+
+    /// @brief Find the current (label, index) of the sample with the given ID.
+    /// Returns false if the sample has been deleted.
+    bool findSample(uint64_t id, uint32_t* label, uint32_t* index);
+
+    /// @brief Get the sample by label and index. The reference is valid until
+    /// the sample is trimmed or deleted.
+    const GRT::MatrixDouble& getSample(uint32_t label, uint32_t index);
 
     /// @brief Remove sample by label and the index.
     bool deleteSample(uint32_t label, uint32_t index);
@@ -116,42 +143,61 @@ class TrainingDataManager {
     //  Functions for saving/loading training data
     // =================================================
 
-    inline bool save(const std::string& filename) {
-        return data_.save(filename);
-    }
-
+    /// @brief Files ending in kBinaryDataExtension use ESP's binary format
+    /// (see BinaryDataFile), which keeps per-sample names, scores and
+    /// likelihoods. Any other file uses GRT's text format, which only has the
+    /// samples and label names.
+    bool save(const std::string& filename);
     bool load(const std::string& filename);
 
   private:
     uint32_t num_classes_;
+    uint32_t num_dimensions_ = 0;
+    std::string dataset_name_;
+    vector<std::string> default_label_names_;
 
     // Name simulates Option<std::string> type. If `Name.first` is true, then
     // the name is valid; else use the default name.
     using Name = std::pair<bool, std::string>;
-    vector<vector<Name>> training_sample_names_;
-    vector<std::string> default_label_names_;
 
     // Score simulates Option<double> type. If `Score.first` is true, then
     // the score is valid; else use the default score.
     using Score = std::pair<bool, double>;
-    vector<vector<Score>> training_sample_scores_;
 
     // Probability that the sample belongs to each class (e.g. when the model
     // is trained on all other samples). If ClassLikelihoods.first is true,
     // then vector is valid.
     using ClassLikelihoods = std::pair<bool, vector<double>>;
-    vector<vector<ClassLikelihoods>> training_sample_class_likelihoods_;
 
-    // This variable tracks the number of samples for each label. Although We
-    // can get the number with TimeSeriesClassificationData::getClassData and
-    // then getNumSamples. Caching the information here helps with bound checks!
-    //
-    // The use of this class requires index not beyond the
-    // num_samples_per_label_.
-    vector<uint32_t> num_samples_per_label_;
+    struct Sample {
+        uint64_t id;
+        std::shared_ptr<const GRT::MatrixDouble> data;
+        Name name;
+        Score score;
+        ClassLikelihoods likelihoods;
+    };
+
+    bool saveBinary(const std::string& filename);
+    bool loadBinary(const std::string& filename);
 
-    // The underlying data store backed up by GRT's TimeSeriesClassificationData
-    GRT::TimeSeriesClassificationData data_;
+    // Clears the samples and makes room for labels up to num_classes.
+    void resetForLoad(uint32_t num_classes);
+
+    // Adds a new sample with a fresh ID and no name, score or likelihoods.
+    void appendSample(uint32_t label,
+                      std::shared_ptr<const GRT::MatrixDouble> data);
+
+    // Samples by label, then by index. Samples are held by pointer so that
+    // deleting or relabeling one only moves pointers, never sample data.
+    //
+    // The use of this class requires index not beyond samples_[label].size().
+    vector<vector<std::unique_ptr<Sample>>> samples_;
+    uint32_t num_samples_ = 0;
+    uint64_t next_sample_id_ = 0;
+
+    // Snapshot of all samples, rebuilt by getSnapshot() when dirty.
+    TrainingDataSnapshot snapshot_;
+    bool snapshot_dirty_ = true;
 
     // Disallow copy and assign
     TrainingDataManager(TrainingDataManager&) = delete;
@@ -0,0 +1,37 @@
+#include "training-data-snapshot.h"
+
+TrainingDataSnapshot::TrainingDataSnapshot()
+        : contents_(std::make_shared<Contents>()) {}
+
+TrainingDataSnapshot::TrainingDataSnapshot(
+    uint32_t num_dimensions, const std::string& name,
+    const vector<std::string>& label_names, vector<Sample> samples) {
+    std::shared_ptr<Contents> contents = std::make_shared<Contents>();
+    contents->num_dimensions = num_dimensions;
+    contents->name = name;
+    contents->label_names = label_names;
+    contents->samples = std::move(samples);
+    contents_ = contents;
+}
+
+GRT::TimeSeriesClassificationData TrainingDataSnapshot::materialize(
+    uint32_t exclude) const {
+    GRT::TimeSeriesClassificationData data(contents_->num_dimensions);
+    data.setDatasetName(contents_->name);
+
+    const vector<Sample>& samples = contents_->samples;
+    for (uint32_t i = 0; i < samples.size(); i++) {
+        if (i == exclude) continue;
+        data.addSample(samples[i].label, *samples[i].data);
+    }
+
+    // Class names can only be set once the class has samples; GRT logs an
+    // error for any other label.
+    const vector<std::string>& names = contents_->label_names;
+    for (GRT::UINT label : data.getClassLabels()) {
+        if (label < names.size()) {
+            data.setClassNameForCorrespondingClassLabel(names[label], label);
+        }
+    }
+    return data;
+}
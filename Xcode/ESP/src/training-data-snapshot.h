@@ -0,0 +1,77 @@
+/** @file training-data-snapshot.h
+ *  @brief TrainingDataSnapshot is a read-only view of the training data that
+ *  shares sample memory with TrainingDataManager.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <GRT/GRT.h>
+
+using std::vector;
+
+/**
+ @brief An immutable copy of the training data that doesn't copy the samples.
+
+ Samples are held by shared pointers to const matrices. TrainingDataManager
+ never modifies a sample matrix in place (trimming a sample replaces it), so a
+ snapshot stays valid and unchanged however the manager is edited afterwards,
+ and a sample's memory is freed once neither the manager nor any snapshot
+ refers to it. Copying a snapshot is O(1), so it can be handed to background
+ trainers and scorers freely.
+
+ GRT trains on a TimeSeriesClassificationData, which owns its samples;
+ materialize() builds one, so call it where the data is about to be used (e.g.
+ on the training thread) and let it go as soon as training is done.
+ */
+class TrainingDataSnapshot {
+  public:
+    struct Sample {
+        uint32_t label;
+        std::shared_ptr<const GRT::MatrixDouble> data;
+    };
+
+    static const uint32_t kNoSample = std::numeric_limits<uint32_t>::max();
+
+    // An empty snapshot.
+    TrainingDataSnapshot();
+
+    /**
+     @param label_names: class names, indexed by label.
+     @param samples: ordered as they should appear in the materialized data.
+     */
+    TrainingDataSnapshot(uint32_t num_dimensions, const std::string& name,
+                         const vector<std::string>& label_names,
+                         vector<Sample> samples);
+
+    uint32_t getNumSamples() const { return contents_->samples.size(); }
+    uint32_t getNumDimensions() const { return contents_->num_dimensions; }
+
+    uint32_t getLabel(uint32_t i) const { return contents_->samples[i].label; }
+    const GRT::MatrixDouble& getData(uint32_t i) const {
+        return *contents_->samples[i].data;
+    }
+
+    /**
+     Copy the samples into GRT training data.
+     @param exclude: position of a sample to leave out (for leave-one-out
+     training), or kNoSample.
+     */
+    GRT::TimeSeriesClassificationData materialize(
+        uint32_t exclude = kNoSample) const;
+
+  private:
+    struct Contents {
+        uint32_t num_dimensions = 0;
+        std::string name;
+        vector<std::string> label_names;
+        vector<Sample> samples;
+    };
+
+    std::shared_ptr<const Contents> contents_;
+};
@@ -0,0 +1,174 @@
+#include "training-scorer.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "batch-pipeline.h"
+
+using namespace GRT;
+
+TrainingScorer::~TrainingScorer() {
+    retire();
+    reap(true);
+}
+
+bool TrainingScorer::start(const GestureRecognitionPipeline& pipeline,
+                           const TrainingDataSnapshot& data,
+                           uint32_t num_labels, bool leave_one_out,
+                           uint32_t num_threads) {
+    retire();
+    reap(false);
+
+    std::unique_ptr<Job> job(new Job);
+    job->data = data;
+    job->num_labels = num_labels;
+    job->leave_one_out = leave_one_out;
+
+    vector<uint32_t> counts(num_labels + 1, 0);
+    for (UINT i = 0; i < data.getNumSamples(); i++) {
+        UINT label = data.getLabel(i);
+        if (label <= num_labels) counts[label]++;
+    }
+
+    vector<uint32_t> indices(num_labels + 1, 0);
+    for (UINT i = 0; i < data.getNumSamples(); i++) {
+        UINT label = data.getLabel(i);
+        if (label > num_labels) continue;
+        uint32_t index = indices[label]++;
+
+        // No point in doing leave-one-out scoring for labels w/ one sample.
+        if (leave_one_out && counts[label] == 1) continue;
+
+        Fold fold;
+        fold.label = label;
+        fold.index = index;
+        fold.sample = i;
+        job->folds.push_back(fold);
+    }
+    if (job->folds.empty()) return false;
+
+    job->pipeline.reset(new GestureRecognitionPipeline(pipeline));
+
+    if (num_threads == 0) num_threads = std::thread::hardware_concurrency();
+    num_threads = std::max<uint32_t>(1, std::min<uint32_t>(num_threads, job->folds.size()));
+
+    job_ = std::move(job);
+    job_->num_running_workers = num_threads;
+    for (uint32_t i = 0; i < num_threads; i++) {
+        job_->workers.emplace_back(&TrainingScorer::run, this,
+                                   std::ref(*job_));
+    }
+    return true;
+}
+
+void TrainingScorer::Job::join() {
+    for (std::thread& worker : workers) {
+        if (worker.joinable()) worker.join();
+    }
+    workers.clear();
+}
+
+void TrainingScorer::retire() {
+    if (!job_) return;
+    job_->cancelled = true;
+    retired_.push_back(std::move(job_));
+}
+
+void TrainingScorer::reap(bool wait) {
+    auto done = [wait](const std::unique_ptr<Job>& job) {
+        if (!wait && job->num_running_workers != 0) return false;
+        job->join();
+        return true;
+    };
+    retired_.erase(std::remove_if(retired_.begin(), retired_.end(), done),
+                   retired_.end());
+}
+
+bool TrainingScorer::takeResults(vector<Result>& results) {
+    if (!isDone()) return false;
+
+    results.clear();
+    for (Fold& fold : job_->folds) {
+        if (!fold.scored) continue;
+        Result result;
+        result.label = fold.label;
+        result.index = fold.index;
+        result.likelihoods.swap(fold.likelihoods);
+        results.push_back(std::move(result));
+    }
+
+    job_->join();
+    job_.reset();
+    reap(false);
+    return true;
+}
+
+void TrainingScorer::run(Job& job) {
+    GestureRecognitionPipeline pipeline;
+    {
+        std::lock_guard<std::mutex> guard(copy_mutex_);
+        pipeline = *job.pipeline;
+    }
+
+    TimeSeriesClassificationData data;
+    if (job.leave_one_out) data = job.data.materialize();
+
+    while (!job.cancelled) {
+        uint32_t f = job.next_fold++;
+        if (f >= job.folds.size()) break;
+        job.folds[f].scored = score(job, pipeline, data, job.folds[f]);
+        job.num_completed++;
+    }
+
+    job.num_running_workers--;
+}
+
+bool TrainingScorer::trainWithout(GestureRecognitionPipeline& pipeline,
+                                  TimeSeriesClassificationData& data,
+                                  uint32_t sample) {
+    // Swap the sample to the end to take it out without copying the samples
+    // after it; the last sample stands in its place until it is put back.
+    // Labels with one sample aren't scored, so no class disappears.
+    const UINT last = data.getNumSamples() - 1;
+    std::swap(data[sample], data[last]);
+    TimeSeriesClassificationSample held_out = data[last];
+    data.removeLastSample();
+
+    bool trained = pipeline.train(data);
+
+    data.addSample(held_out.getClassLabel(), held_out.getData());
+    std::swap(data[sample], data[last]);
+    return trained;
+}
+
+bool TrainingScorer::score(Job& job, GestureRecognitionPipeline& pipeline,
+                           TimeSeriesClassificationData& data, Fold& fold) {
+    if (job.leave_one_out) {
+        if (!trainWithout(pipeline, data, fold.sample)) return false;
+    }
+
+    pipeline.reset();
+
+    if (job.cancelled) return false;
+
+    BatchPrediction prediction;
+    if (!predictBatch(pipeline, job.data.getData(fold.sample), prediction,
+                      &job.cancelled)) {
+        return false;
+    }
+
+    vector<UINT> labels = pipeline.getClassLabels();
+    vector<double> likelihoods(job.num_labels + 1, 0.0);
+    for (const VectorDouble& l : prediction.likelihoods) {
+        for (size_t k = 0; k < l.size() && k < labels.size(); k++) {
+            if (labels[k] <= job.num_labels) likelihoods[labels[k]] += l[k];
+        }
+    }
+
+    double sum = 0.0;
+    for (double l : likelihoods) sum += l;
+    for (double& l : likelihoods) l /= (sum == 0.0 ? 1e-9 : sum);
+
+    fold.likelihoods.swap(likelihoods);
+    return true;
+}
@@ -0,0 +1,140 @@
+/** @file training-scorer.h
+ *  @brief TrainingScorer computes per-sample class likelihoods for the
+ *  training data on a pool of background threads.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <GRT/GRT.h>
+
+#include "training-data-snapshot.h"
+
+using std::vector;
+
+/**
+ @brief Scores every training sample by running it through a pipeline and
+ averaging the class likelihoods over its rows.
+
+ With leave-one-out scoring, each sample (a "fold") is scored by a pipeline
+ trained on all the other samples. Folds are independent, so they are spread
+ over a pool of threads, each of which owns a copy of the pipeline and of the
+ training data, materialized once from a snapshot. For each fold a thread
+ takes the held-out sample out of its copy and puts it back afterwards, so a
+ fold copies one sample rather than the whole dataset. Neither the caller's
+ pipeline nor the caller's training data are touched once start() returns.
+
+ Samples are identified by (label, index) as in TrainingDataManager, i.e.
+ index is the position of the sample among the samples with that label in
+ the data passed to start().
+ */
+class TrainingScorer {
+  public:
+    struct Result {
+        uint32_t label;
+        uint32_t index;
+        // Indexed by class label (0 to num_labels), normalized to sum to 1.
+        vector<double> likelihoods;
+    };
+
+    TrainingScorer() = default;
+    ~TrainingScorer();
+
+    /**
+     Start scoring in the background, cancelling any scoring in progress
+     without waiting for it (see cancel()).
+
+     @param pipeline: copied. Must be trained unless leave_one_out is set.
+     @param num_threads: 0 to use one thread per hardware thread.
+     @return false if there is nothing to score.
+     */
+    bool start(const GRT::GestureRecognitionPipeline& pipeline,
+               const TrainingDataSnapshot& data,
+               uint32_t num_labels, bool leave_one_out,
+               uint32_t num_threads = 0);
+
+    /**
+     Stop scoring and discard the results. Doesn't block: the threads give up
+     on their current fold at the next check (between training and predicting,
+     and between the rows being predicted). Once they have, they are joined by
+     a later start() or takeResults(), or by the destructor.
+     */
+    void cancel() {
+        if (job_) job_->cancelled = true;
+    }
+
+    // True from start() until the results are taken or scoring is cancelled.
+    bool isRunning() const { return job_ && !job_->cancelled; }
+
+    // True once every fold is scored and the results are ready to be taken.
+    bool isDone() const {
+        return isRunning() && job_->num_running_workers == 0;
+    }
+
+    uint32_t getNumCompleted() const {
+        return job_ ? job_->num_completed.load() : 0;
+    }
+    uint32_t getNumTotal() const { return job_ ? job_->folds.size() : 0; }
+
+    /**
+     Move the results into results, in no particular order, and reset the
+     scorer. Samples whose fold failed to train are left out.
+     @return false if scoring isn't done (see isDone()).
+     */
+    bool takeResults(vector<Result>& results);
+
+  private:
+    struct Fold {
+        uint32_t label;
+        uint32_t index;
+        // Position of the sample in data_.
+        uint32_t sample;
+        bool scored = false;
+        vector<double> likelihoods;
+    };
+
+    // Everything one start() hands to its threads. A cancelled job is kept
+    // until its threads have given up, so that start() needn't wait for them.
+    struct Job {
+        std::unique_ptr<GRT::GestureRecognitionPipeline> pipeline;
+        TrainingDataSnapshot data;
+        uint32_t num_labels = 0;
+        bool leave_one_out = false;
+        vector<Fold> folds;
+
+        vector<std::thread> workers;
+        std::atomic<uint32_t> next_fold{0};
+        std::atomic<uint32_t> num_completed{0};
+        std::atomic<uint32_t> num_running_workers{0};
+        std::atomic_bool cancelled{false};
+
+        // Join the threads, which must have given up or finished.
+        void join();
+    };
+
+    void run(Job& job);
+    bool score(Job& job, GRT::GestureRecognitionPipeline& pipeline,
+               GRT::TimeSeriesClassificationData& data, Fold& fold);
+    // Train pipeline on data without the sample at position sample, leaving
+    // data as it was.
+    bool trainWithout(GRT::GestureRecognitionPipeline& pipeline,
+                      GRT::TimeSeriesClassificationData& data,
+                      uint32_t sample);
+    // Cancel the current job, if any, and keep it until its threads are done.
+    void retire();
+    // Join and drop the retired jobs whose threads are done; all of them with
+    // wait, blocking until they are.
+    void reap(bool wait);
+
+    std::unique_ptr<Job> job_;
+    vector<std::unique_ptr<Job>> retired_;
+
+    // GRT pipelines are copied one at a time.
+    std::mutex copy_mutex_;
+};
@@ -2,15 +2,27 @@
 
 #include <cmath>
 
+#include "headless.h"
 #include "ofApp.h"
 
 static std::map<void*, Tuneable*> allTuneables;
 
+static void addTuneableToApp(Tuneable* t) {
+    if (HeadlessApp* app = HeadlessApp::get()) {
+        app->registerTuneable(t);
+    } else {
+        ((ofApp *) ofGetAppPtr())->registerTuneable(t);
+    }
+}
+
 void Tuneable::onSliderEvent(ofxDatGuiSliderEvent e) {
     for (const auto& t : allTuneables) {
         void* data_ptr = t.second->getDataAddress();
         void* ui_ptr = t.second->getUIAddress();
         if (e.target == ui_ptr) {
+            // Callbacks typically reconfigure the pipeline, which is in use
+            // by the inference thread.
+            auto lock = ((ofApp *) ofGetAppPtr())->lockPipeline();
             if (t.second->getType() == Tuneable::INT_RANGE) {
                 int* value = static_cast<int*>(data_ptr);
                 int set_value = std::round(e.value);
@@ -47,6 +59,7 @@ void Tuneable::onToggleEvent(ofxDatGuiButtonEvent e) {
         void* data_ptr = t.second->getDataAddress();
         void* ui_ptr = t.second->getUIAddress();
         if (e.target == ui_ptr) {
+            auto lock = ((ofApp *) ofGetAppPtr())->lockPipeline();
             bool* value = static_cast<bool*>(data_ptr);
             *value = e.enabled;
 
@@ -71,7 +84,7 @@ void registerTuneable(int& value, int min, int max,
 
     Tuneable* t = new Tuneable(&value, min, max, title, description, cb);
     allTuneables[address] = t;
-    ((ofApp *) ofGetAppPtr())->registerTuneable(t);
+    addTuneableToApp(t);
 }
 
 void registerTuneable(double& value, double min, double max,
@@ -85,7 +98,7 @@ void registerTuneable(double& value, double min, double max,
 
     Tuneable* t = new Tuneable(&value, min, max, title, description, cb);
     allTuneables[address] = t;
-    ((ofApp *) ofGetAppPtr())->registerTuneable(t);
+    addTuneableToApp(t);
 }
 
 void registerTuneable(bool& value,
@@ -99,5 +112,5 @@ void registerTuneable(bool& value,
 
     Tuneable* t = new Tuneable(&value, title, description, cb);
     allTuneables[address] = t;
-    ((ofApp *) ofGetAppPtr())->registerTuneable(t);
+    addTuneableToApp(t);
 }
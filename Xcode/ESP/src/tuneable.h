@@ -108,7 +108,8 @@ class Tuneable {
         return "";
     }
 
-    // Return value indicates success or not.
+    // Return value indicates success or not. The GUI control, if there is one
+    // (there isn't when running headless), is updated to match.
     bool fromString(std::string str) {
         std::istringstream iss(str);
         std::string word;
@@ -118,18 +119,18 @@ class Tuneable {
             int* p = static_cast<int*>(value_ptr_);
             iss >> *p;
             ofxDatGuiSlider *slider = static_cast<ofxDatGuiSlider*>(ui_ptr_);
-            slider->setValue(*p);
+            if (slider != NULL) slider->setValue(*p);
         } else if (word == "DOUBLE") {
             double* p = static_cast<double*>(value_ptr_);
             iss >> *p;
             ofxDatGuiSlider *slider = static_cast<ofxDatGuiSlider*>(ui_ptr_);
-            slider->setValue(*p);
+            if (slider != NULL) slider->setValue(*p);
         } else if (word == "BOOL") {
             bool* p = static_cast<bool*>(value_ptr_);
             iss >> word;
             *p = (word == "true") ? true : false;
             ofxDatGuiToggle *toggle = static_cast<ofxDatGuiToggle*>(ui_ptr_);
-            toggle->setEnabled(*p);
+            if (toggle != NULL) toggle->setEnabled(*p);
         }
 
         return false;
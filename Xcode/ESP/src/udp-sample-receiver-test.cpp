@@ -0,0 +1,80 @@
+#include "udp-sample-receiver.h"
+#include "gtest/gtest.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void sendDatagram(int s, int port, const std::vector<uint8_t>& bytes) {
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(static_cast<ssize_t>(bytes.size()),
+              sendto(s, bytes.data(), bytes.size(), 0,
+                     reinterpret_cast<sockaddr*>(&address), sizeof(address)));
+}
+
+std::vector<uint8_t> frame(uint16_t stream_id, uint32_t sequence, float value) {
+    FrameHeader header;
+    header.stream_id = stream_id;
+    header.num_dimensions = 1;
+    header.num_samples = 1;
+    header.sequence = sequence;
+    std::vector<uint8_t> out;
+    encodeFrame(header, &value, &out);
+    return out;
+}
+
+}  // namespace
+
+TEST(UdpSampleReceiverTest, ReceivesFramesAndCountsLosses) {
+    std::mutex mutex;
+    std::vector<double> values;
+    UdpSampleReceiver receiver(1);
+    ASSERT_TRUE(receiver.start(0, [&](const double* samples, uint32_t n) {
+        std::lock_guard<std::mutex> guard(mutex);
+        values.insert(values.end(), samples, samples + n);
+    }));
+    ASSERT_NE(0, receiver.getPort());
+
+    int s = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(s, 0);
+    // Two frames in one datagram, then one cut short, then a gap.
+    std::vector<uint8_t> two = frame(7, 0, 1);
+    std::vector<uint8_t> second = frame(7, 1, 2);
+    two.insert(two.end(), second.begin(), second.end());
+    sendDatagram(s, receiver.getPort(), two);
+    std::vector<uint8_t> cut = frame(7, 2, 3);
+    cut.resize(cut.size() - 1);
+    sendDatagram(s, receiver.getPort(), cut);
+    sendDatagram(s, receiver.getPort(), frame(7, 4, 5));
+
+    FrameStats stats;
+    for (int i = 0; i < 500 && stats.frames < 3; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        stats = receiver.getStats();
+    }
+    EXPECT_EQ(3u, stats.frames);
+    EXPECT_EQ(3u, stats.samples);
+    EXPECT_EQ(2u, stats.lost_samples);
+    EXPECT_EQ(frame(7, 2, 3).size() - 1, stats.skipped_bytes);
+    EXPECT_EQ(3u, receiver.getNumDatagrams());
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        EXPECT_EQ(std::vector<double>({1, 2, 5}), values);
+    }
+
+    close(s);
+    receiver.stop();
+}
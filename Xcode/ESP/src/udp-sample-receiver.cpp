@@ -0,0 +1,111 @@
+#include "udp-sample-receiver.h"
+
+#include <chrono>
+
+#include "socket-util.h"
+
+using namespace socket_util;
+
+namespace {
+
+// Larger than any UDP datagram.
+const size_t kMaxDatagramSize = 64 * 1024;
+
+// Most datagrams drained per wakeup, so that a flood of them can't keep the
+// thread from delivering samples or noticing stop().
+const uint32_t kMaxDatagramsPerWakeup = 256;
+
+}  // namespace
+
+UdpSampleReceiver::UdpSampleReceiver(uint32_t num_dimensions)
+        : num_dimensions_(num_dimensions), socket_(kNoSocket),
+          decoder_(num_dimensions) {
+}
+
+UdpSampleReceiver::~UdpSampleReceiver() {
+    stop();
+}
+
+bool UdpSampleReceiver::start(int port, SamplesCallback callback) {
+    if (running_) return false;
+
+    if (!startup()) {
+        last_error_ = "WSAStartup() failed";
+        return false;
+    }
+    socket_ = openBoundSocket(SOCK_DGRAM, port, &port_);
+    if (socket_ == kNoSocket) {
+        last_error_ = "can't bind UDP port " + std::to_string(port);
+        return false;
+    }
+    callback_ = callback;
+    decoder_.reset();
+    {
+        std::lock_guard<std::mutex> guard(stats_mutex_);
+        stats_ = FrameStats();
+        num_datagrams_ = 0;
+    }
+    running_ = true;
+    thread_.reset(new std::thread(&UdpSampleReceiver::run, this));
+    return true;
+}
+
+void UdpSampleReceiver::stop() {
+    running_ = false;
+    if (thread_ != nullptr && thread_->joinable()) {
+        thread_->join();
+    }
+    thread_.reset();
+}
+
+FrameStats UdpSampleReceiver::getStats() const {
+    std::lock_guard<std::mutex> guard(stats_mutex_);
+    return stats_;
+}
+
+uint64_t UdpSampleReceiver::getNumDatagrams() const {
+    std::lock_guard<std::mutex> guard(stats_mutex_);
+    return num_datagrams_;
+}
+
+void UdpSampleReceiver::run() {
+    datagram_.resize(kMaxDatagramSize);
+    while (running_) {
+        pollfd fd;
+        fd.fd = socket_;
+        fd.events = POLLIN;
+        fd.revents = 0;
+        int ready = poll(&fd, 1, max_wait_ms_);
+        if (ready < 0 && !interrupted()) {
+            // Avoid spinning if the socket has gone bad.
+            std::this_thread::sleep_for(
+                std::chrono::milliseconds(max_wait_ms_));
+        }
+        if (ready <= 0) continue;
+
+        samples_.clear();
+        uint64_t num_datagrams = 0;
+        while (num_datagrams < kMaxDatagramsPerWakeup) {
+            int result = recv(socket_, reinterpret_cast<char*>(datagram_.data()),
+                              datagram_.size(), 0);
+            if (result < 0) {
+                if (interrupted()) continue;
+                break;  // drained, or an error we'll see again next poll()
+            }
+            num_datagrams++;
+            size_t consumed = decoder_.decode(datagram_.data(), result, &samples_);
+            decoder_.discard(result - consumed);
+        }
+
+        if (!samples_.empty() && callback_ != nullptr) {
+            callback_(samples_.data(), samples_.size() / num_dimensions_);
+        }
+
+        std::lock_guard<std::mutex> guard(stats_mutex_);
+        stats_ = decoder_.getStats();
+        num_datagrams_ += num_datagrams;
+    }
+
+    closeSocket(socket_);
+    socket_ = kNoSocket;
+}
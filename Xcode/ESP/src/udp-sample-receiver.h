@@ -0,0 +1,90 @@
+/** @file udp-sample-receiver.h
+ *  @brief UdpSampleReceiver, which turns binary frames sent as UDP datagrams
+ *  into blocks of samples.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "binary-frame.h"
+
+using std::string;
+using std::vector;
+
+/**
+ *  @brief Receives binary frames (see binary-frame.h) on a UDP port.
+ *
+ *  Each datagram holds one or more whole frames; a frame cut off at the end
+ *  of a datagram is dropped. A single thread waits on the socket with
+ *  poll(), drains the datagrams that have arrived (up to a few hundred per
+ *  wakeup), and hands all their samples to the callback as one row-major
+ *  block, like TcpSampleServer.
+ *
+ *  Any number of senders can share the port. Sequence numbers are checked
+ *  per stream id, so senders should use distinct ones. UDP may drop or
+ *  reorder datagrams: the gaps show up as lost samples and frames that
+ *  arrive after a later one are dropped as late. A sender that restarts its
+ *  sequence numbers is picked up again (see FrameDecoder).
+ */
+class UdpSampleReceiver {
+  public:
+    // Called on the receiver thread; see TcpSampleServer::SamplesCallback.
+    using SamplesCallback =
+        std::function<void(const double* samples, uint32_t num_samples)>;
+
+    explicit UdpSampleReceiver(uint32_t num_dimensions);
+    ~UdpSampleReceiver();
+
+    /**
+     Bind port (0 picks a free one, see getPort()) on all interfaces and
+     start the receiver thread.
+     @return false if the port can't be opened; see getLastError().
+     */
+    bool start(int port, SamplesCallback callback);
+    void stop();
+
+    bool isRunning() const { return running_; }
+    int getPort() const { return port_; }
+    uint32_t getNumDimensions() const { return num_dimensions_; }
+
+    // See TcpSampleServer::setMaxWait().
+    void setMaxWait(uint32_t ms) { max_wait_ms_ = ms; }
+
+    // Counters since start().
+    FrameStats getStats() const;
+    // Datagrams received since start(), including ones without a valid frame.
+    uint64_t getNumDatagrams() const;
+
+    // Why the last start() failed.
+    const string& getLastError() const { return last_error_; }
+
+  private:
+    void run();
+
+    const uint32_t num_dimensions_;
+    intptr_t socket_;
+    int port_ = 0;
+    SamplesCallback callback_;
+    string last_error_;
+
+    std::atomic<bool> running_{false};
+    std::atomic<uint32_t> max_wait_ms_{100};
+    std::unique_ptr<std::thread> thread_;
+
+    // Only touched by the receiver thread while it runs.
+    FrameDecoder decoder_;
+    vector<uint8_t> datagram_;
+    vector<double> samples_;  // samples of the current wakeup
+
+    mutable std::mutex stats_mutex_;
+    FrameStats stats_;
+    uint64_t num_datagrams_ = 0;
+};